@@ -0,0 +1,596 @@
+/*
+** Shortcircuit XT is Free and Open Source Software
+**
+** Shortcircuit is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html; The authors of the code
+** reserve the right to re-license their contributions under the MIT license in the
+** future at the discretion of the project maintainers.
+**
+** Copyright 2004-2022 by various individuals as described by the git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/shortcircuit-xt.git
+**
+** Shortcircuit was a commercial product from 2004-2018, with copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Shortcircuit
+** open source in December 2020.
+*/
+
+/*
+ * sc3-bench renders synthetic and real patches through the whole engine (sampler::process_audio)
+ * and reports the cost per block and per voice-block. See usage() for the scenario matrix.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "sampler.h"
+#include "sampler_state.h"
+#include "synthesis/filter.h"
+#include "infrastructure/trace.h"
+
+namespace
+{
+struct SampleFormat
+{
+    const char *name;
+    bool int16;
+    int channels;
+};
+
+const SampleFormat formats[] = {{"i16-mono", true, 1},
+                                 {"i16-stereo", true, 2},
+                                 {"f32-mono", false, 1},
+                                 {"f32-stereo", false, 2}};
+
+struct Scenario
+{
+    std::string group, name;
+    std::string patch;       // real patch file, synthetic zones if empty
+    SampleFormat format{formats[1]};
+    bool loop{true};
+    bool oversample{false};
+    int zoneFilter{ft_none};
+    int partFilter{ft_none};
+    int voices{1};
+};
+
+struct Result
+{
+    Scenario scenario;
+    double nsPerBlock{0};
+    double avgVoices{0};
+    double nsPerVoiceBlock{0};
+    double load{0}; // fraction of the realtime budget
+    // with --stages, ns per voice-block spent in each trace stage
+    std::vector<double> stageNs;
+    uint64_t droppedEvents{0}; // trace events that found no free ring
+    bool ok{false};
+};
+
+struct Options
+{
+    std::vector<int> voices{1, 4, 16, 64, 256};
+    int filterVoices{16};
+    int blocks{1000};
+    int warmup{50};
+    int repeats{3};
+    int threads{0};
+    int samplerate{48000};
+    std::string match;
+    std::string json;
+    std::vector<std::string> patches;
+    bool list{false};
+    bool stages{false};
+};
+
+void usage()
+{
+    std::cout
+        << "usage: sc3-bench [options]\n"
+        << "\n"
+        << "Scenarios (all at the block size the engine was built with):\n"
+        << "  core/   every voice count x sample format (i16/f32, mono/stereo) x loop on/off\n"
+        << "          x oversampling on/off, no filters\n"
+        << "  zone/   every zone filter type, i16 stereo looped, --filter-voices voices\n"
+        << "  part/   every part filter and effect type, same setup\n"
+        << "  patch/  each --patch file, every voice count\n"
+        << "\n"
+        << "options:\n"
+        << "  -v, --voices <a,b,..>   voice counts to sweep (1,4,16,64,256)\n"
+        << "  --filter-voices <n>     voices for the filter sweeps (16)\n"
+        << "  -n, --blocks <n>        measured blocks per repeat (1000)\n"
+        << "  --repeats <n>           repeats per scenario, the fastest is reported (3)\n"
+        << "  -t, --threads <n>       voice render threads, 0 renders on the calling thread\n"
+        << "  -r, --samplerate <hz>   engine sample rate (48000)\n"
+        << "  -p, --patch <file>      also benchmark a real patch, multi or sample file\n"
+        << "  -m, --match <text>      only run scenarios whose name contains text\n"
+        << "  -j, --json <file>       write the results as JSON\n"
+        << "  -s, --stages            also break each scenario down by trace stage\n"
+        << "  -l, --list              list the scenarios and exit" << std::endl;
+}
+
+bool parseArgs(int argc, char **argv, Options &o)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string a = argv[i];
+        auto value = [&]() -> const char * { return (i + 1 < argc) ? argv[++i] : nullptr; };
+        auto intValue = [&](int &dest, int lo) {
+            auto v = value();
+            return v && ((dest = atoi(v)) >= lo);
+        };
+
+        if ((a == "-v") || (a == "--voices"))
+        {
+            auto v = value();
+            if (!v)
+                return false;
+            o.voices.clear();
+            std::stringstream ss(v);
+            std::string item;
+            while (std::getline(ss, item, ','))
+                o.voices.push_back(std::clamp(atoi(item.c_str()), 1, (int)MAX_VOICES));
+        }
+        else if (a == "--filter-voices")
+        {
+            if (!intValue(o.filterVoices, 1))
+                return false;
+            o.filterVoices = std::min(o.filterVoices, (int)MAX_VOICES);
+        }
+        else if ((a == "-n") || (a == "--blocks"))
+        {
+            if (!intValue(o.blocks, 1))
+                return false;
+        }
+        else if (a == "--repeats")
+        {
+            if (!intValue(o.repeats, 1))
+                return false;
+        }
+        else if ((a == "-t") || (a == "--threads"))
+        {
+            if (!intValue(o.threads, 0))
+                return false;
+        }
+        else if ((a == "-r") || (a == "--samplerate"))
+        {
+            if (!intValue(o.samplerate, 8000))
+                return false;
+        }
+        else if ((a == "-p") || (a == "--patch"))
+        {
+            auto v = value();
+            if (!v)
+                return false;
+            o.patches.push_back(v);
+        }
+        else if ((a == "-m") || (a == "--match"))
+        {
+            auto v = value();
+            if (!v)
+                return false;
+            o.match = v;
+        }
+        else if ((a == "-j") || (a == "--json"))
+        {
+            auto v = value();
+            if (!v)
+                return false;
+            o.json = v;
+        }
+        else if ((a == "-l") || (a == "--list"))
+        {
+            o.list = true;
+        }
+        else if ((a == "-s") || (a == "--stages"))
+        {
+            o.stages = true;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// filter names come from the filters themselves, so spawn one to ask
+std::string filterName(int type)
+{
+    float fp[n_filter_parameters] = {};
+    int ip[n_filter_iparameters] = {};
+    filter *f = spawn_filter(type, fp, ip, 0, true);
+    std::string name = f ? f->get_filtername() : "none";
+    spawn_filter_release(f);
+    std::replace(name.begin(), name.end(), ' ', '-');
+    return std::to_string(type) + "-" + name;
+}
+
+std::vector<Scenario> buildScenarios(const Options &o)
+{
+    std::vector<Scenario> res;
+    for (auto v : o.voices)
+        for (auto &fmt : formats)
+            for (int loop = 1; loop >= 0; loop--)
+                for (int os = 0; os < 2; os++)
+                {
+                    Scenario s;
+                    s.group = "core";
+                    s.format = fmt;
+                    s.loop = loop;
+                    s.oversample = os;
+                    s.voices = v;
+                    s.name = "core/" + std::to_string(v) + "v/" + fmt.name +
+                             (loop ? "/loop" : "/oneshot") + (os ? "/os" : "");
+                    res.push_back(s);
+                }
+
+    for (int ft = ft_zone_first; ft <= ft_zone_last; ft++)
+    {
+        Scenario s;
+        s.group = "zone";
+        s.zoneFilter = ft;
+        s.voices = o.filterVoices;
+        s.name = "zone/" + filterName(ft);
+        res.push_back(s);
+    }
+    for (int ft = ft_part_first; ft <= ft_part_last; ft++)
+    {
+        Scenario s;
+        s.group = "part";
+        s.partFilter = ft;
+        s.voices = o.filterVoices;
+        s.name = "part/" + filterName(ft);
+        res.push_back(s);
+    }
+
+    for (auto &p : o.patches)
+        for (auto v : o.voices)
+        {
+            Scenario s;
+            s.group = "patch";
+            s.patch = p;
+            s.voices = v;
+            s.name = "patch/" + path_to_string(string_to_path(p).filename()) + "/" +
+                     std::to_string(v) + "v";
+            res.push_back(s);
+        }
+
+    if (!o.match.empty())
+        res.erase(std::remove_if(res.begin(), res.end(),
+                                 [&](const Scenario &s) {
+                                     return s.name.find(o.match) == std::string::npos;
+                                 }),
+                  res.end());
+    return res;
+}
+
+/*
+ * The synthetic samples are written as wav files once and then loaded through add_zone like
+ * any user sample. They are long enough that one shot voices survive the warmup and measurement
+ * even when played an octave up.
+ */
+fs::path syntheticSample(const SampleFormat &fmt, const Options &o)
+{
+    const int rate = 44100; // not the engine rate, so voices always resample
+    uint32_t length = (o.warmup + o.blocks) * BLOCK_SIZE * 2 + rate;
+
+    auto fn = fs::temp_directory_path() /
+              ("sc3-bench-" + std::string(fmt.name) + "-" + std::to_string(length) + ".wav");
+    if (fs::exists(fn))
+        return fn;
+
+    std::ofstream out(path_to_string(fn), std::ios::binary);
+    auto put = [&](uint32_t v, int bytes) {
+        for (int i = 0; i < bytes; i++)
+            out.put((char)((v >> (8 * i)) & 0xff));
+    };
+    uint32_t bytesPerSample = fmt.int16 ? 2 : 4;
+    uint32_t dataBytes = length * fmt.channels * bytesPerSample;
+
+    out.write("RIFF", 4);
+    put(4 + 24 + 8 + dataBytes, 4);
+    out.write("WAVEfmt ", 8);
+    put(16, 4);
+    put(fmt.int16 ? 1 : 3, 2); // PCM or IEEE float
+    put(fmt.channels, 2);
+    put(rate, 4);
+    put(rate * fmt.channels * bytesPerSample, 4);
+    put(fmt.channels * bytesPerSample, 2);
+    put(bytesPerSample * 8, 2);
+    out.write("data", 4);
+    put(dataBytes, 4);
+
+    // a detuned saw and sine pair, so there is broadband content for the filters
+    double ph0 = 0, ph1 = 0;
+    for (uint32_t i = 0; i < length; i++)
+    {
+        ph0 += 110.0 / rate;
+        ph1 += 110.7 / rate;
+        ph0 -= floor(ph0);
+        ph1 -= floor(ph1);
+        for (int c = 0; c < fmt.channels; c++)
+        {
+            float v = (float)(0.4 * (2.0 * ph0 - 1.0) + 0.4 * sin(2.0 * M_PI * (ph1 + 0.25 * c)));
+            if (fmt.int16)
+            {
+                put((uint16_t)(int16_t)(v * 32767.f), 2);
+            }
+            else
+            {
+                uint32_t bits;
+                memcpy(&bits, &v, sizeof(bits));
+                put(bits, 4);
+            }
+        }
+    }
+    out.close();
+    if (!out)
+        return fs::path();
+    return fn;
+}
+
+void initFilter(filterstruct &fs)
+{
+    filter *f = spawn_filter(fs.type, fs.p, fs.ip, 0, true);
+    if (f)
+        f->init_params();
+    spawn_filter_release(f);
+}
+
+bool setupSynthetic(sampler &sc3, const Scenario &sc, const Options &o)
+{
+    auto fn = syntheticSample(sc.format, o);
+    if (fn.empty())
+        return false;
+
+    // one zone per part, each part plays up to 128 voices on its own channel
+    int parts = (sc.voices + 127) / 128;
+    for (int p = 0; p < parts; p++)
+    {
+        int z;
+        if (!sc3.add_zone(fn, &z, p, false))
+            return false;
+
+        auto &zone = sc3.zones[z];
+        zone.key_low = 0;
+        zone.key_high = 127;
+        zone.key_root = 60;
+        zone.keytrack = 0; // every voice at the same pitch, independent of the key
+        zone.transpose = sc.oversample ? 12 : 0;
+        zone.playmode = sc.loop ? pm_forward_loop : pm_forward;
+        zone.loop_start = 0;
+        zone.loop_end = zone.sample_stop;
+        zone.Filter[0].type = sc.zoneFilter;
+        initFilter(zone.Filter[0]);
+
+        sc3.parts[p].polylimit = 128;
+        sc3.parts[p].Filter[0].type = sc.partFilter;
+        initFilter(sc3.parts[p].Filter[0]);
+    }
+    sc3.invalidate_zone_index();
+    return true;
+}
+
+void playNotes(sampler &sc3, const Scenario &sc)
+{
+    for (int i = 0; i < sc.voices; i++)
+        sc3.PlayNote(i / 128, i % 128, 100);
+}
+
+/*
+ * A separate traced pass, so tracing doesn't disturb the timed ones. The rings are kept small
+ * and the blocks traced in chunks that fit them (a voice records a dozen events per block),
+ * summing the stage totals of each chunk.
+ */
+void traceStages(sampler &sc3, const Scenario &sc, const Options &o, Result &r)
+{
+    const int ringEvents = 1 << 16;
+    int chunk = std::max(1, ringEvents / (sc.voices * 16 + 64));
+
+    sc3.AllNotesOff();
+    playNotes(sc3, sc);
+    for (int b = 0; b < o.warmup; b++)
+        sc3.process_audio();
+
+    r.stageNs.assign((int)scxt::Trace::Stage::numStages, 0.0);
+    double seconds[(int)scxt::Trace::Stage::numStages];
+    int64_t polySum = 0;
+    for (int b = 0; b < o.blocks; b += chunk)
+    {
+        scxt::Trace::start(ringEvents);
+        for (int i = b; i < std::min(o.blocks, b + chunk); i++)
+        {
+            sc3.process_audio();
+            polySum += sc3.polyphony;
+        }
+        scxt::Trace::stop();
+        r.droppedEvents += scxt::Trace::stageTotals(seconds);
+        for (size_t s = 0; s < r.stageNs.size(); s++)
+            r.stageNs[s] += seconds[s] * 1e9;
+    }
+    for (auto &ns : r.stageNs)
+        ns = polySum ? ns / polySum : 0;
+}
+
+Result run(const Scenario &sc, const Options &o)
+{
+    Result r;
+    r.scenario = sc;
+
+    auto sc3 = std::make_unique<sampler>(nullptr, 1);
+    sc3->set_samplerate(o.samplerate);
+    if (o.threads)
+        sc3->set_voice_render_threads(o.threads);
+
+    if (sc.patch.empty())
+    {
+        if (!setupSynthetic(*sc3, sc, o))
+            return r;
+    }
+    else if (!sc3->load_file(string_to_path(sc.patch)))
+    {
+        return r;
+    }
+    for (int p = 0; p < (int)N_SAMPLER_PARTS; p++)
+        sc3->parts[p].polylimit = std::max(sc3->parts[p].polylimit, 128);
+    // mips, rate conversion and the zone index are built off the audio thread
+    sc3->wait_for_background();
+
+    double best = 0;
+    double voiceBlocks = 0;
+    for (int rep = 0; rep < o.repeats; rep++)
+    {
+        sc3->AllNotesOff();
+        playNotes(*sc3, sc);
+        for (int b = 0; b < o.warmup; b++)
+            sc3->process_audio();
+
+        int64_t polySum = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int b = 0; b < o.blocks; b++)
+        {
+            sc3->process_audio();
+            polySum += sc3->polyphony;
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() -
+                                                             start)
+                        .count();
+
+        double perBlock = ns / o.blocks;
+        if ((rep == 0) || (perBlock < best))
+        {
+            best = perBlock;
+            voiceBlocks = (double)polySum / o.blocks;
+        }
+    }
+
+    r.nsPerBlock = best;
+    r.avgVoices = voiceBlocks;
+    r.nsPerVoiceBlock = (voiceBlocks > 0) ? best / voiceBlocks : 0;
+    r.load = best / (1e9 * BLOCK_SIZE / o.samplerate);
+    r.ok = true;
+
+    if (o.stages)
+        traceStages(*sc3, sc, o, r);
+    return r;
+}
+
+std::string jsonEscape(const std::string &s)
+{
+    std::string r;
+    for (auto c : s)
+    {
+        if ((c == '"') || (c == '\\'))
+            r += '\\';
+        r += c;
+    }
+    return r;
+}
+
+bool writeJson(const std::string &fn, const Options &o, const std::vector<Result> &results)
+{
+    std::ofstream out(fn);
+    if (!out)
+        return false;
+
+    out << "{\n"
+        << "  \"block_size\": " << BLOCK_SIZE << ",\n"
+        << "  \"samplerate\": " << o.samplerate << ",\n"
+        << "  \"threads\": " << o.threads << ",\n"
+        << "  \"blocks\": " << o.blocks << ",\n"
+        << "  \"repeats\": " << o.repeats << ",\n"
+        << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        auto &r = results[i];
+        auto &s = r.scenario;
+        out << "    {\"name\": \"" << jsonEscape(s.name) << "\", \"group\": \"" << s.group
+            << "\", \"voices\": " << s.voices << ", \"format\": \"" << s.format.name
+            << "\", \"loop\": " << (s.loop ? "true" : "false")
+            << ", \"oversample\": " << (s.oversample ? "true" : "false")
+            << ", \"zone_filter\": " << s.zoneFilter << ", \"part_filter\": " << s.partFilter
+            << ", \"ok\": " << (r.ok ? "true" : "false") << std::fixed << std::setprecision(1)
+            << ", \"ns_per_block\": " << r.nsPerBlock << ", \"avg_voices\": " << r.avgVoices
+            << ", \"ns_per_voice_block\": " << r.nsPerVoiceBlock << std::setprecision(5)
+            << ", \"load\": " << r.load;
+        if (!r.stageNs.empty())
+        {
+            out << ", \"stage_ns_per_voice_block\": {" << std::setprecision(1);
+            for (size_t st = 0; st < r.stageNs.size(); st++)
+                out << (st ? ", " : "") << "\""
+                    << scxt::Trace::stageName((scxt::Trace::Stage)st) << "\": " << r.stageNs[st];
+            out << "}, \"dropped_events\": " << r.droppedEvents;
+        }
+        out << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+    return (bool)out;
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Options o;
+    if (!parseArgs(argc, argv, o))
+    {
+        usage();
+        return 1;
+    }
+
+    auto scenarios = buildScenarios(o);
+    if (o.list)
+    {
+        for (auto &s : scenarios)
+            std::cout << s.name << std::endl;
+        return 0;
+    }
+
+    std::cout << "# sc3-bench: block size " << BLOCK_SIZE << ", " << o.samplerate << "Hz, "
+              << o.threads << " render threads, " << scenarios.size() << " scenarios"
+              << std::endl;
+    std::cout << std::left << std::setw(48) << "scenario" << std::right << std::setw(8) << "voices"
+              << std::setw(14) << "ns/block" << std::setw(14) << "ns/voice-blk" << std::setw(9)
+              << "load %" << std::endl;
+
+    std::vector<Result> results;
+    for (auto &s : scenarios)
+    {
+        auto r = run(s, o);
+        std::cout << std::left << std::setw(48) << s.name << std::right;
+        if (r.ok)
+            std::cout << std::fixed << std::setprecision(1) << std::setw(8) << r.avgVoices
+                      << std::setw(14) << std::setprecision(0) << r.nsPerBlock << std::setw(14)
+                      << r.nsPerVoiceBlock << std::setw(9) << std::setprecision(2)
+                      << 100.0 * r.load << std::endl;
+        else
+            std::cout << "  failed to set up" << std::endl;
+        for (size_t st = 0; st < r.stageNs.size(); st++)
+            if (r.stageNs[st] > 0)
+                std::cout << std::left << std::setw(8) << "" << std::setw(62)
+                          << scxt::Trace::stageName((scxt::Trace::Stage)st) << std::right
+                          << std::setprecision(0) << std::setw(14) << r.stageNs[st] << std::endl;
+        if (r.droppedEvents)
+            std::cout << "# " << r.droppedEvents
+                      << " trace events dropped, more threads than rings; stages are low"
+                      << std::endl;
+        results.push_back(r);
+    }
+
+    if (!o.json.empty() && !writeJson(o.json, o, results))
+    {
+        std::cout << "# Couldn't write " << o.json << std::endl;
+        return 1;
+    }
+    return 0;
+}
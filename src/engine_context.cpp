@@ -0,0 +1,54 @@
+/*
+** Shortcircuit XT is Free and Open Source Software
+**
+** Shortcircuit is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html; The authors of the code
+** reserve the right to re-license their contributions under the MIT license in the
+** future at the discretion of the project maintainers.
+**
+** Copyright 2004-2022 by various individuals as described by the git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/shortcircuit-xt.git
+**
+** Shortcircuit was a commercial product from 2004-2018, with copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Shortcircuit
+** open source in December 2020.
+*/
+
+#include "engine_context.h"
+#include "globals.h"
+#include "synthesis/mathtables.h"
+
+#include <cmath>
+#include <mutex>
+
+thread_local const engine_context *current_engine_context = nullptr;
+
+const engine_context &default_engine_context()
+{
+    static engine_context ctx;
+    return ctx;
+}
+
+engine_context::engine_context()
+{
+    static std::once_flag tables_initialized;
+    std::call_once(tables_initialized, init_tables);
+
+    set_samplerate(48000.f);
+}
+
+void engine_context::set_samplerate(float sr)
+{
+    samplerate = sr;
+    samplerate_inv = 1.f / sr;
+    multiplier_freq2omega = PI_2 * FILTER_FREQRANGE / samplerate;
+
+    float db60 = powf(10.f, 0.05f * -60.f);
+    for (int i = 0; i < 512; i++)
+    {
+        double k = samplerate * pow(2.0, (((double)i - 256.0) / 16.0)) / (double)BLOCK_SIZE;
+        table_envrate_lpf[i] = (float)(1.f - exp(log(db60) / k));
+        table_envrate_linear[i] = 1 / k;
+    }
+}
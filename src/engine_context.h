@@ -0,0 +1,80 @@
+/*
+** Shortcircuit XT is Free and Open Source Software
+**
+** Shortcircuit is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html; The authors of the code
+** reserve the right to re-license their contributions under the MIT license in the
+** future at the discretion of the project maintainers.
+**
+** Copyright 2004-2022 by various individuals as described by the git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/shortcircuit-xt.git
+**
+** Shortcircuit was a commercial product from 2004-2018, with copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Shortcircuit
+** open source in December 2020.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+/*
+ * Sample rate dependent engine state. Each sampler owns one of these, so several instances
+ * running at different rates in the same process (or a bounce running next to a live
+ * instance) no longer fight over one set of globals.
+ *
+ * The DSP code (voices, envelopes, LFOs, filters and effects) reads it through
+ * current_engine(), which returns the context of the sampler currently running on the calling
+ * thread. The sampler makes its context current with an engine_context_scope on every entry
+ * point that can reach that code, and the voice render workers do the same for the job they
+ * were handed. Outside of any scope a default 48k context is used, which covers the editor
+ * spawning filters to query their labels.
+ *
+ * The rate independent tables (table_dB, table_pitch, waveshapers) stay shared and are filled
+ * once by the first context constructed.
+ */
+struct engine_context
+{
+    engine_context();
+
+    void set_samplerate(float sr);
+
+    float samplerate;
+    float samplerate_inv;
+    float multiplier_freq2omega;
+    float table_envrate_lpf[512], table_envrate_linear[512];
+
+    // moved on by editor and loader threads, read by the voices (release and acquire). the
+    // modulation matrices recompile their routing when patch_generation changes, which is on
+    // route edits and zone changes. param_generation moves on for every other edit and only
+    // makes them reseed the unmodulated values (see modmatrix::compile)
+    std::atomic<uint32_t> patch_generation{0};
+    std::atomic<uint32_t> param_generation{0};
+};
+
+extern thread_local const engine_context *current_engine_context;
+const engine_context &default_engine_context();
+
+inline const engine_context &current_engine()
+{
+    auto c = current_engine_context;
+    return c ? *c : default_engine_context();
+}
+
+class engine_context_scope
+{
+  public:
+    explicit engine_context_scope(const engine_context *c) : previous(current_engine_context)
+    {
+        current_engine_context = c;
+    }
+    ~engine_context_scope() { current_engine_context = previous; }
+
+    engine_context_scope(const engine_context_scope &) = delete;
+    engine_context_scope &operator=(const engine_context_scope &) = delete;
+
+  private:
+    const engine_context *previous;
+};
@@ -21,20 +21,861 @@
 #include "sampler_voice.h"
 #include "util/tools.h"
 #include <vt_dsp/basic_dsp.h>
+#include <cassert>
 #include <iostream>
+#include <type_traits>
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#define SCXT_GENERATOR_NEON 1
+#else
+#include <immintrin.h>
+#define SCXT_GENERATOR_AVX 1
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#endif
+
+/*
+ * The wider kernels are built in this TU alongside the SSE2 one, so the rest of the engine keeps
+ * its SSE2 baseline. With gcc and clang each AVX entry point gets a target attribute and is
+ * flattened, which pulls the shared body and its helpers into the AVX function instead of
+ * emitting them out of line with AVX encoding. MSVC accepts the intrinsics without either.
+ */
+#if defined(_MSC_VER) && !defined(__clang__)
+#define SCXT_TARGET_AVX2
+#define SCXT_TARGET_AVX512
+#define SCXT_FLATTEN
+#else
+#define SCXT_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define SCXT_TARGET_AVX512 __attribute__((target("avx512f,avx512bw,avx2,fma")))
+#define SCXT_FLATTEN __attribute__((flatten))
+#endif
 
 extern float SincTableF32[(FIRipol_M + 1) * FIRipol_N];
 extern float SincOffsetF32[(FIRipol_M)*FIRipol_N];
 extern short SincTableI16[(FIRipol_M + 1) * FIRipol_N];
 extern short SincOffsetI16[(FIRipol_M)*FIRipol_N];
+extern float SincPhaseF32[(FIRipol_M)*FIRipol_N * 2];
+extern short SincPhaseI16[(FIRipol_M)*FIRipolI16_N * 2];
+extern float SincLongPhaseF32[(FIRipol_M)*FIRipolLong_N * 2];
+extern float SincLongerPhaseF32[(FIRipol_M)*FIRipolLonger_N * 2];
+
+// oversampled voices run the generator for twice the engine block
+const int MaxGeneratorBlockSize = BLOCK_SIZE * 2;
 
 const float I16InvScale = (1.f / (16384.f * 32768.f));
 const __m128 I16InvScale_m128 = _mm_set1_ps(I16InvScale);
 
-template <bool, bool, int, int>
+/*
+ * Resampling kernels. f32/i16 compute a single output sample (per channel) from the 16 tap
+ * windowed sinc, with the tap coefficients interpolated between the two nearest table rows.
+ * L/R point at the first input sample under the filter, which is taps / 2 before the play
+ * position. The int16 kernels do integer math
+ * and so give identical output everywhere; the float ones may differ in the last bits from
+ * the summation order and FMA.
+ *
+ * Kernels with outputs_per_pass == 4 and partial_sums also have f32_partial/i16_partial, which
+ * stop before the horizontal reduction. The block drivers below then finish four outputs at
+ * once with a transpose, instead of reducing every sample on its own.
+ *
+ * GeneratorKernelSSE2 is the one output at a time kernel the engine started with, kept as
+ * the reference (GA_Reference) the others are tested against.
+ */
+struct GeneratorKernelSSE2
+{
+    static constexpr int outputs_per_pass = 1;
+    static constexpr int taps = FIRipol_N;
+
+    template <bool stereo>
+    static inline void f32(int SampleSubPos, const float *L, const float *R, float *OutL,
+                           float *OutR)
+    {
+        unsigned int m0 = ((SampleSubPos >> 12) & 0xff0);
+        __m128 lipol0, tmp[4], sL4, sR4;
+        lipol0 = _mm_setzero_ps();
+        lipol0 = _mm_cvtsi32_ss(lipol0, SampleSubPos & 0xffff);
+        lipol0 = _mm_shuffle_ps(lipol0, lipol0, _MM_SHUFFLE(0, 0, 0, 0));
+        tmp[0] = _mm_add_ps(_mm_mul_ps(*((__m128 *)&SincOffsetF32[m0]), lipol0),
+                            *((__m128 *)&SincTableF32[m0]));
+        tmp[1] = _mm_add_ps(_mm_mul_ps(*((__m128 *)&SincOffsetF32[m0 + 4]), lipol0),
+                            *((__m128 *)&SincTableF32[m0 + 4]));
+        tmp[2] = _mm_add_ps(_mm_mul_ps(*((__m128 *)&SincOffsetF32[m0 + 8]), lipol0),
+                            *((__m128 *)&SincTableF32[m0 + 8]));
+        tmp[3] = _mm_add_ps(_mm_mul_ps(*((__m128 *)&SincOffsetF32[m0 + 12]), lipol0),
+                            *((__m128 *)&SincTableF32[m0 + 12]));
+        sL4 = _mm_mul_ps(tmp[0], _mm_loadu_ps(&L[0]));
+        sL4 = _mm_add_ps(sL4, _mm_mul_ps(tmp[1], _mm_loadu_ps(&L[4])));
+        sL4 = _mm_add_ps(sL4, _mm_mul_ps(tmp[2], _mm_loadu_ps(&L[8])));
+        sL4 = _mm_add_ps(sL4, _mm_mul_ps(tmp[3], _mm_loadu_ps(&L[12])));
+        sL4 = sum_ps_to_ss(sL4);
+        _mm_store_ss(OutL, sL4);
+        if (stereo)
+        {
+            sR4 = _mm_mul_ps(tmp[0], _mm_loadu_ps(&R[0]));
+            sR4 = _mm_add_ps(sR4, _mm_mul_ps(tmp[1], _mm_loadu_ps(&R[4])));
+            sR4 = _mm_add_ps(sR4, _mm_mul_ps(tmp[2], _mm_loadu_ps(&R[8])));
+            sR4 = _mm_add_ps(sR4, _mm_mul_ps(tmp[3], _mm_loadu_ps(&R[12])));
+            sR4 = sum_ps_to_ss(sR4);
+            _mm_store_ss(OutR, sR4);
+        }
+    }
+
+    template <bool stereo>
+    static inline void i16(int SampleSubPos, const short *L, const short *R, float *OutL,
+                           float *OutR)
+    {
+        unsigned int m0 = ((SampleSubPos >> 12) & 0xff0);
+        __m128i lipol0, tmp, sL8A, sR8A, tmp2, sL8B, sR8B;
+        __m128 fL, fR;
+        lipol0 = _mm_set1_epi16(SampleSubPos & 0xffff);
+
+        tmp = _mm_add_epi16(_mm_mulhi_epi16(*((__m128i *)&SincOffsetI16[m0]), lipol0),
+                            *((__m128i *)&SincTableI16[m0]));
+        sL8A = _mm_madd_epi16(tmp, _mm_loadu_si128((__m128i *)&L[0]));
+        if (stereo)
+            sR8A = _mm_madd_epi16(tmp, _mm_loadu_si128((__m128i *)&R[0]));
+        tmp2 = _mm_add_epi16(_mm_mulhi_epi16(*((__m128i *)&SincOffsetI16[m0 + 8]), lipol0),
+                             *((__m128i *)&SincTableI16[m0 + 8]));
+        sL8B = _mm_madd_epi16(tmp2, _mm_loadu_si128((__m128i *)&L[8]));
+        if (stereo)
+            sR8B = _mm_madd_epi16(tmp2, _mm_loadu_si128((__m128i *)&R[8]));
+        sL8A = _mm_add_epi32(sL8A, sL8B);
+        if (stereo)
+            sR8A = _mm_add_epi32(sR8A, sR8B);
+
+        int l alignas(16)[4], r alignas(16)[4];
+        _mm_store_si128((__m128i *)&l, sL8A);
+        if (stereo)
+            _mm_store_si128((__m128i *)&r, sR8A);
+        l[0] = (l[0] + l[1]) + (l[2] + l[3]);
+        if (stereo)
+            r[0] = (r[0] + r[1]) + (r[2] + r[3]);
+        fL = _mm_mul_ss(_mm_cvtsi32_ss(fL, l[0]), I16InvScale_m128);
+        if (stereo)
+            fR = _mm_mul_ss(_mm_cvtsi32_ss(fR, r[0]), I16InvScale_m128);
+        _mm_store_ss(OutL, fL);
+        if (stereo)
+            _mm_store_ss(OutR, fR);
+    }
+};
+
+// sums of the four lanes of a, b, c and d, in the same order as sum_ps_to_ss
+static inline __m128 sum_transposed(__m128 a, __m128 b, __m128 c, __m128 d)
+{
+    __m128 t0 = _mm_unpacklo_ps(a, b), t1 = _mm_unpacklo_ps(c, d);
+    __m128 t2 = _mm_unpackhi_ps(a, b), t3 = _mm_unpackhi_ps(c, d);
+    __m128 l0 = _mm_movelh_ps(t0, t1), l1 = _mm_movehl_ps(t1, t0);
+    __m128 l2 = _mm_movelh_ps(t2, t3), l3 = _mm_movehl_ps(t3, t2);
+    return _mm_add_ps(_mm_add_ps(l0, l2), _mm_add_ps(l1, l3));
+}
+
+static inline __m128i sum_transposed(__m128i a, __m128i b, __m128i c, __m128i d)
+{
+    __m128i t0 = _mm_unpacklo_epi32(a, b), t1 = _mm_unpacklo_epi32(c, d);
+    __m128i t2 = _mm_unpackhi_epi32(a, b), t3 = _mm_unpackhi_epi32(c, d);
+    __m128i l0 = _mm_unpacklo_epi64(t0, t1), l1 = _mm_unpackhi_epi64(t0, t1);
+    __m128i l2 = _mm_unpacklo_epi64(t2, t3), l3 = _mm_unpackhi_epi64(t2, t3);
+    return _mm_add_epi32(_mm_add_epi32(l0, l2), _mm_add_epi32(l1, l3));
+}
+
+/*
+ * Four outputs per pass with SSE2. Same operations in the same order as GeneratorKernelSSE2,
+ * so it is bit exact with it.
+ */
+struct GeneratorKernelSSE2x4 : GeneratorKernelSSE2
+{
+    static constexpr int outputs_per_pass = 4;
+    static constexpr bool partial_sums = true;
+
+    // the four lane partial sums of one output, before the final reduction
+    template <bool stereo>
+    static inline void f32_partial(int SampleSubPos, const float *L, const float *R, __m128 &pL,
+                                   __m128 &pR)
+    {
+        const float *row = &SincPhaseF32[((SampleSubPos >> 12) & 0xff0) * 2];
+        __m128 lipol0 = _mm_set1_ps((float)(SampleSubPos & 0xffff));
+        __m128 c0 = _mm_add_ps(_mm_mul_ps(_mm_load_ps(&row[16]), lipol0), _mm_load_ps(&row[0]));
+        __m128 c1 = _mm_add_ps(_mm_mul_ps(_mm_load_ps(&row[20]), lipol0), _mm_load_ps(&row[4]));
+        __m128 c2 = _mm_add_ps(_mm_mul_ps(_mm_load_ps(&row[24]), lipol0), _mm_load_ps(&row[8]));
+        __m128 c3 = _mm_add_ps(_mm_mul_ps(_mm_load_ps(&row[28]), lipol0), _mm_load_ps(&row[12]));
+
+        pL = _mm_mul_ps(c0, _mm_loadu_ps(&L[0]));
+        pL = _mm_add_ps(pL, _mm_mul_ps(c1, _mm_loadu_ps(&L[4])));
+        pL = _mm_add_ps(pL, _mm_mul_ps(c2, _mm_loadu_ps(&L[8])));
+        pL = _mm_add_ps(pL, _mm_mul_ps(c3, _mm_loadu_ps(&L[12])));
+        if (stereo)
+        {
+            pR = _mm_mul_ps(c0, _mm_loadu_ps(&R[0]));
+            pR = _mm_add_ps(pR, _mm_mul_ps(c1, _mm_loadu_ps(&R[4])));
+            pR = _mm_add_ps(pR, _mm_mul_ps(c2, _mm_loadu_ps(&R[8])));
+            pR = _mm_add_ps(pR, _mm_mul_ps(c3, _mm_loadu_ps(&R[12])));
+        }
+    }
+
+    template <bool stereo>
+    static inline void i16_partial(int SampleSubPos, const short *L, const short *R, __m128i &pL,
+                                   __m128i &pR)
+    {
+        const short *row = &SincPhaseI16[((SampleSubPos >> 12) & 0xff0) * 2];
+        __m128i lipol0 = _mm_set1_epi16(SampleSubPos & 0xffff);
+        const __m128i *rowv = (const __m128i *)row; // table in 0, 1 and offsets in 2, 3
+        __m128i c0 = _mm_add_epi16(_mm_mulhi_epi16(rowv[2], lipol0), rowv[0]);
+        __m128i c1 = _mm_add_epi16(_mm_mulhi_epi16(rowv[3], lipol0), rowv[1]);
+
+        pL = _mm_add_epi32(_mm_madd_epi16(c0, _mm_loadu_si128((const __m128i *)&L[0])),
+                           _mm_madd_epi16(c1, _mm_loadu_si128((const __m128i *)&L[8])));
+        if (stereo)
+            pR = _mm_add_epi32(_mm_madd_epi16(c0, _mm_loadu_si128((const __m128i *)&R[0])),
+                               _mm_madd_epi16(c1, _mm_loadu_si128((const __m128i *)&R[8])));
+    }
+};
+
+#if SCXT_GENERATOR_AVX
+struct GeneratorKernelAVX2
+{
+    static constexpr int outputs_per_pass = 4;
+    static constexpr bool partial_sums = true;
+    static constexpr int taps = FIRipol_N;
+
+    // horizontal sums of one or two 8 lane accumulators
+    SCXT_TARGET_AVX2 static inline float hsum(__m256 x)
+    {
+        __m128 a = _mm_add_ps(_mm256_castps256_ps128(x), _mm256_extractf128_ps(x, 1));
+        a = _mm_add_ps(a, _mm_movehl_ps(a, a));
+        return _mm_cvtss_f32(_mm_add_ss(a, _mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 0, 0, 1))));
+    }
+    SCXT_TARGET_AVX2 static inline void hsum2(__m256 l, __m256 r, float *OutL, float *OutR)
+    {
+        __m256 h = _mm256_hadd_ps(l, r); // l01 l23 r01 r23 | l45 l67 r45 r67
+        __m128 a = _mm_add_ps(_mm256_castps256_ps128(h), _mm256_extractf128_ps(h, 1));
+        a = _mm_hadd_ps(a, a);
+        _mm_store_ss(OutL, a);
+        _mm_store_ss(OutR, _mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 0, 0, 1)));
+    }
+    SCXT_TARGET_AVX2 static inline __m128i hsum2(__m256i l, __m256i r)
+    {
+        __m256i h = _mm256_hadd_epi32(l, r);
+        __m128i a = _mm_add_epi32(_mm256_castsi256_si128(h), _mm256_extracti128_si256(h, 1));
+        return _mm_hadd_epi32(a, a); // l r l r
+    }
+
+    template <bool stereo>
+    SCXT_TARGET_AVX2 static inline void f32(int SampleSubPos, const float *L, const float *R,
+                                            float *OutL, float *OutR)
+    {
+        unsigned int m0 = ((SampleSubPos >> 12) & 0xff0);
+        __m256 lipol0 = _mm256_set1_ps((float)(SampleSubPos & 0xffff));
+        __m256 c0 = _mm256_fmadd_ps(_mm256_load_ps(&SincOffsetF32[m0]), lipol0,
+                                    _mm256_load_ps(&SincTableF32[m0]));
+        __m256 c1 = _mm256_fmadd_ps(_mm256_load_ps(&SincOffsetF32[m0 + 8]), lipol0,
+                                    _mm256_load_ps(&SincTableF32[m0 + 8]));
+        __m256 sL = _mm256_fmadd_ps(c1, _mm256_loadu_ps(&L[8]),
+                                    _mm256_mul_ps(c0, _mm256_loadu_ps(&L[0])));
+        if (stereo)
+        {
+            __m256 sR = _mm256_fmadd_ps(c1, _mm256_loadu_ps(&R[8]),
+                                        _mm256_mul_ps(c0, _mm256_loadu_ps(&R[0])));
+            hsum2(sL, sR, OutL, OutR);
+        }
+        else
+        {
+            *OutL = hsum(sL);
+        }
+    }
+
+    // all 16 int16 taps fit one register, so this is one mulhi/add/madd per channel
+    SCXT_TARGET_AVX2 static inline __m256i i16_coefficients(int SampleSubPos)
+    {
+        unsigned int m0 = ((SampleSubPos >> 12) & 0xff0);
+        __m256i lipol0 = _mm256_set1_epi16(SampleSubPos & 0xffff);
+        return _mm256_add_epi16(
+            _mm256_mulhi_epi16(_mm256_load_si256((const __m256i *)&SincOffsetI16[m0]), lipol0),
+            _mm256_load_si256((const __m256i *)&SincTableI16[m0]));
+    }
+
+    template <bool stereo>
+    SCXT_TARGET_AVX2 static inline void i16(int SampleSubPos, const short *L, const short *R,
+                                            float *OutL, float *OutR)
+    {
+        __m256i c = i16_coefficients(SampleSubPos);
+        __m256i sL = _mm256_madd_epi16(c, _mm256_loadu_si256((const __m256i *)L));
+        __m256i sR = stereo ? _mm256_madd_epi16(c, _mm256_loadu_si256((const __m256i *)R))
+                            : _mm256_setzero_si256();
+        __m128i s = hsum2(sL, sR);
+        *OutL = (float)_mm_cvtsi128_si32(s) * I16InvScale;
+        if (stereo)
+            *OutR = (float)_mm_extract_epi32(s, 1) * I16InvScale;
+    }
+
+    // adds the upper 4 lanes onto the lower 4
+    SCXT_TARGET_AVX2 static inline __m128 fold128(__m256 x)
+    {
+        return _mm_add_ps(_mm256_castps256_ps128(x), _mm256_extractf128_ps(x, 1));
+    }
+    SCXT_TARGET_AVX2 static inline __m128i fold128(__m256i x)
+    {
+        return _mm_add_epi32(_mm256_castsi256_si128(x), _mm256_extracti128_si256(x, 1));
+    }
+
+    template <bool stereo>
+    SCXT_TARGET_AVX2 static inline void f32_partial(int SampleSubPos, const float *L,
+                                                    const float *R, __m128 &pL, __m128 &pR)
+    {
+        const float *row = &SincPhaseF32[((SampleSubPos >> 12) & 0xff0) * 2];
+        __m256 lipol0 = _mm256_set1_ps((float)(SampleSubPos & 0xffff));
+        __m256 c0 = _mm256_fmadd_ps(_mm256_load_ps(&row[16]), lipol0, _mm256_load_ps(&row[0]));
+        __m256 c1 = _mm256_fmadd_ps(_mm256_load_ps(&row[24]), lipol0, _mm256_load_ps(&row[8]));
+        pL = fold128(_mm256_fmadd_ps(c1, _mm256_loadu_ps(&L[8]),
+                                     _mm256_mul_ps(c0, _mm256_loadu_ps(&L[0]))));
+        if (stereo)
+            pR = fold128(_mm256_fmadd_ps(c1, _mm256_loadu_ps(&R[8]),
+                                         _mm256_mul_ps(c0, _mm256_loadu_ps(&R[0]))));
+    }
+
+    template <bool stereo>
+    SCXT_TARGET_AVX2 static inline void i16_partial(int SampleSubPos, const short *L,
+                                                    const short *R, __m128i &pL, __m128i &pR)
+    {
+        const __m256i *row = (const __m256i *)&SincPhaseI16[((SampleSubPos >> 12) & 0xff0) * 2];
+        __m256i lipol0 = _mm256_set1_epi16(SampleSubPos & 0xffff);
+        __m256i c = _mm256_add_epi16(_mm256_mulhi_epi16(_mm256_load_si256(&row[1]), lipol0),
+                                     _mm256_load_si256(&row[0]));
+        pL = fold128(_mm256_madd_epi16(c, _mm256_loadu_si256((const __m256i *)L)));
+        if (stereo)
+            pR = fold128(_mm256_madd_epi16(c, _mm256_loadu_si256((const __m256i *)R)));
+    }
+};
+
+/*
+ * The 16 float taps are one zmm register. The int16 taps only fill a ymm, so that path is
+ * the AVX2 one.
+ */
+struct GeneratorKernelAVX512 : GeneratorKernelAVX2
+{
+    template <bool stereo>
+    SCXT_TARGET_AVX512 static inline void f32(int SampleSubPos, const float *L, const float *R,
+                                              float *OutL, float *OutR)
+    {
+        unsigned int m0 = ((SampleSubPos >> 12) & 0xff0);
+        __m512 lipol0 = _mm512_set1_ps((float)(SampleSubPos & 0xffff));
+        __m512 c = _mm512_fmadd_ps(_mm512_load_ps(&SincOffsetF32[m0]), lipol0,
+                                   _mm512_load_ps(&SincTableF32[m0]));
+        __m512 sL = _mm512_mul_ps(c, _mm512_loadu_ps(L));
+        if (stereo)
+        {
+            __m512 sR = _mm512_mul_ps(c, _mm512_loadu_ps(R));
+            hsum2(fold256(sL), fold256(sR), OutL, OutR);
+        }
+        else
+        {
+            *OutL = hsum(fold256(sL));
+        }
+    }
+
+    template <bool stereo>
+    SCXT_TARGET_AVX512 static inline void f32_partial(int SampleSubPos, const float *L,
+                                                      const float *R, __m128 &pL, __m128 &pR)
+    {
+        const float *row = &SincPhaseF32[((SampleSubPos >> 12) & 0xff0) * 2];
+        __m512 lipol0 = _mm512_set1_ps((float)(SampleSubPos & 0xffff));
+        __m512 c = _mm512_fmadd_ps(_mm512_load_ps(&row[16]), lipol0, _mm512_load_ps(&row[0]));
+        pL = fold128(fold256(_mm512_mul_ps(c, _mm512_loadu_ps(L))));
+        if (stereo)
+            pR = fold128(fold256(_mm512_mul_ps(c, _mm512_loadu_ps(R))));
+    }
+
+    // adds the upper 8 lanes onto the lower 8
+    SCXT_TARGET_AVX512 static inline __m256 fold256(__m512 x)
+    {
+        x = _mm512_add_ps(x, _mm512_shuffle_f32x4(x, x, _MM_SHUFFLE(1, 0, 3, 2)));
+        return _mm512_castps512_ps256(x);
+    }
+};
+#endif
+
+#if SCXT_GENERATOR_NEON
+struct GeneratorKernelNEON
+{
+    // vaddvq makes the per sample reduction cheap, so this stays one output at a time
+    static constexpr int outputs_per_pass = 1;
+    static constexpr int taps = FIRipol_N;
+
+    template <bool stereo>
+    static inline void f32(int SampleSubPos, const float *L, const float *R, float *OutL,
+                           float *OutR)
+    {
+        unsigned int m0 = ((SampleSubPos >> 12) & 0xff0);
+        float32x4_t lipol0 = vdupq_n_f32((float)(SampleSubPos & 0xffff));
+        float32x4_t c[4];
+        for (int k = 0; k < 4; k++)
+            c[k] = vfmaq_f32(vld1q_f32(&SincTableF32[m0 + 4 * k]),
+                             vld1q_f32(&SincOffsetF32[m0 + 4 * k]), lipol0);
+        float32x4_t sL = vmulq_f32(c[0], vld1q_f32(&L[0]));
+        for (int k = 1; k < 4; k++)
+            sL = vfmaq_f32(sL, c[k], vld1q_f32(&L[4 * k]));
+        *OutL = vaddvq_f32(sL);
+        if (stereo)
+        {
+            float32x4_t sR = vmulq_f32(c[0], vld1q_f32(&R[0]));
+            for (int k = 1; k < 4; k++)
+                sR = vfmaq_f32(sR, c[k], vld1q_f32(&R[4 * k]));
+            *OutR = vaddvq_f32(sR);
+        }
+    }
+
+    template <bool stereo>
+    static inline void i16(int SampleSubPos, const short *L, const short *R, float *OutL,
+                           float *OutR)
+    {
+        unsigned int m0 = ((SampleSubPos >> 12) & 0xff0);
+        int16x8_t lipol0 = vdupq_n_s16((int16_t)(SampleSubPos & 0xffff));
+        int32x4_t sL = vdupq_n_s32(0), sR = vdupq_n_s32(0);
+        for (int k = 0; k < 2; k++)
+        {
+            // (a * b) >> 16 like _mm_mulhi_epi16, then the same wrapping add of the table row
+            int16x8_t o = vld1q_s16(&SincOffsetI16[m0 + 8 * k]);
+            int32x4_t pl = vmull_s16(vget_low_s16(o), vget_low_s16(lipol0));
+            int32x4_t ph = vmull_high_s16(o, lipol0);
+            int16x8_t hi = vcombine_s16(vshrn_n_s32(pl, 16), vshrn_n_s32(ph, 16));
+            int16x8_t c = vaddq_s16(hi, vld1q_s16(&SincTableI16[m0 + 8 * k]));
+
+            int16x8_t l = vld1q_s16(&L[8 * k]);
+            sL = vmlal_s16(sL, vget_low_s16(c), vget_low_s16(l));
+            sL = vmlal_high_s16(sL, c, l);
+            if (stereo)
+            {
+                int16x8_t r = vld1q_s16(&R[8 * k]);
+                sR = vmlal_s16(sR, vget_low_s16(c), vget_low_s16(r));
+                sR = vmlal_high_s16(sR, c, r);
+            }
+        }
+        *OutL = (float)vaddvq_s32(sL) * I16InvScale;
+        if (stereo)
+            *OutR = (float)vaddvq_s32(sR) * I16InvScale;
+    }
+};
+#endif
+
+/*
+ * The other interpolation modes, the same code on every instruction set (SIMDe on aarch64).
+ * Every mode has its weight-one tap at taps / 2 - 1 for a zero SampleSubPos, so switching
+ * mode doesn't move the sample in time.
+ *
+ * Linear and cubic have so few taps that a reduction per output would cost more than the
+ * filter, so x4 works across outputs instead: one lane per output, with the weights computed
+ * for four positions at once. The int16 paths do the same float math on converted samples.
+ */
+const float SubPosScale = 1.f / (float)(1 << 24);
+const float I16Scale = 1.f / 32768.f;
+
+// four int16 samples to float, unscaled
+static inline __m128 load4_i16_ps(const short *p)
+{
+    __m128i x = _mm_loadl_epi64((const __m128i *)p);
+    return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16));
+}
+static inline __m128 load4_ps(const float *p) { return _mm_loadu_ps(p); }
+static inline __m128 load4_ps(const short *p) { return load4_i16_ps(p); }
+
+template <class T> inline float SampleScale()
+{
+    return std::is_same<T, short>::value ? I16Scale : 1.f;
+}
+
+// the f32/i16 entry points for kernels which are written once for both sample types
+template <class Kernel> struct GeneratorKernelTyped
+{
+    template <bool stereo>
+    static inline void f32(int SampleSubPos, const float *L, const float *R, float *OutL,
+                           float *OutR)
+    {
+        Kernel::template one<stereo>(SampleSubPos, L, R, OutL, OutR);
+    }
+    template <bool stereo>
+    static inline void i16(int SampleSubPos, const short *L, const short *R, float *OutL,
+                           float *OutR)
+    {
+        Kernel::template one<stereo>(SampleSubPos, L, R, OutL, OutR);
+    }
+};
+
+struct GeneratorKernelLinear : GeneratorKernelTyped<GeneratorKernelLinear>
+{
+    static constexpr int outputs_per_pass = 4;
+    static constexpr bool partial_sums = false;
+    static constexpr int taps = 2;
+
+    template <bool stereo, class T>
+    static inline void one(int SampleSubPos, const T *L, const T *R, float *OutL, float *OutR)
+    {
+        float f = (float)SampleSubPos * SubPosScale;
+        *OutL = ((float)L[0] + f * ((float)L[1] - (float)L[0])) * SampleScale<T>();
+        if (stereo)
+            *OutR = ((float)R[0] + f * ((float)R[1] - (float)R[0])) * SampleScale<T>();
+    }
+
+    template <bool stereo, class T>
+    static inline void x4(const int *Pos, const int *SubPos, const T *L, const T *R, float *OutL,
+                          float *OutR)
+    {
+        __m128 f = _mm_mul_ps(_mm_cvtepi32_ps(_mm_load_si128((const __m128i *)SubPos)),
+                              _mm_set1_ps(SubPosScale));
+        __m128 scale = _mm_set1_ps(SampleScale<T>());
+        auto lerp = [&](const T *d) {
+            __m128 a = _mm_setr_ps(d[Pos[0]], d[Pos[1]], d[Pos[2]], d[Pos[3]]);
+            __m128 b = _mm_setr_ps(d[Pos[0] + 1], d[Pos[1] + 1], d[Pos[2] + 1], d[Pos[3] + 1]);
+            return _mm_mul_ps(_mm_add_ps(a, _mm_mul_ps(f, _mm_sub_ps(b, a))), scale);
+        };
+        _mm_storeu_ps(OutL, lerp(L));
+        if (stereo)
+            _mm_storeu_ps(OutR, lerp(R));
+    }
+};
+
+// Catmull-Rom spline through the two samples either side of the position
+struct GeneratorKernelCubic : GeneratorKernelTyped<GeneratorKernelCubic>
+{
+    static constexpr int outputs_per_pass = 4;
+    static constexpr bool partial_sums = false;
+    static constexpr int taps = 4;
+
+    template <bool stereo, class T>
+    static inline void one(int SampleSubPos, const T *L, const T *R, float *OutL, float *OutR)
+    {
+        float f = (float)SampleSubPos * SubPosScale;
+        float f2 = f * f, f3 = f2 * f;
+        float w0 = 0.5f * ((2.f * f2 - f3) - f), w1 = 0.5f * ((3.f * f3 - 5.f * f2) + 2.f);
+        float w2 = 0.5f * ((4.f * f2 - 3.f * f3) + f), w3 = 0.5f * (f3 - f2);
+        *OutL = ((w0 * L[0] + w1 * L[1]) + (w2 * L[2] + w3 * L[3])) * SampleScale<T>();
+        if (stereo)
+            *OutR = ((w0 * R[0] + w1 * R[1]) + (w2 * R[2] + w3 * R[3])) * SampleScale<T>();
+    }
+
+    template <bool stereo, class T>
+    static inline void x4(const int *Pos, const int *SubPos, const T *L, const T *R, float *OutL,
+                          float *OutR)
+    {
+        const __m128 half = _mm_set1_ps(0.5f);
+        __m128 f = _mm_mul_ps(_mm_cvtepi32_ps(_mm_load_si128((const __m128i *)SubPos)),
+                              _mm_set1_ps(SubPosScale));
+        __m128 f2 = _mm_mul_ps(f, f), f3 = _mm_mul_ps(f2, f);
+        __m128 w0 = _mm_sub_ps(_mm_sub_ps(_mm_mul_ps(_mm_set1_ps(2.f), f2), f3), f);
+        __m128 w1 = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(3.f), f3), _mm_mul_ps(_mm_set1_ps(5.f), f2));
+        __m128 w2 = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(4.f), f2), _mm_mul_ps(_mm_set1_ps(3.f), f3));
+        w0 = _mm_mul_ps(half, w0);
+        w1 = _mm_mul_ps(half, _mm_add_ps(w1, _mm_set1_ps(2.f)));
+        w2 = _mm_mul_ps(half, _mm_add_ps(w2, f));
+        __m128 w3 = _mm_mul_ps(half, _mm_sub_ps(f3, f2));
+        __m128 scale = _mm_set1_ps(SampleScale<T>());
+
+        // rows are the four taps of one output, transposed to one tap of four outputs
+        auto spline = [&](const T *d) {
+            __m128 x0 = load4_ps(&d[Pos[0]]), x1 = load4_ps(&d[Pos[1]]);
+            __m128 x2 = load4_ps(&d[Pos[2]]), x3 = load4_ps(&d[Pos[3]]);
+            _MM_TRANSPOSE4_PS(x0, x1, x2, x3);
+            __m128 a = _mm_add_ps(_mm_mul_ps(w0, x0), _mm_mul_ps(w1, x1));
+            __m128 b = _mm_add_ps(_mm_mul_ps(w2, x2), _mm_mul_ps(w3, x3));
+            return _mm_mul_ps(_mm_add_ps(a, b), scale);
+        };
+        _mm_storeu_ps(OutL, spline(L));
+        if (stereo)
+            _mm_storeu_ps(OutR, spline(R));
+    }
+};
+
+// GI_Sinc32 and GI_Sinc64, one output at a time. The int16 path converts the samples and uses
+// the float table
+template <int N> struct GeneratorKernelSinc
+{
+    static constexpr int outputs_per_pass = 1;
+    static constexpr int taps = N;
+
+    static inline const float *row(int SampleSubPos)
+    {
+        const float *table = (N == FIRipolLonger_N) ? SincLongerPhaseF32 : SincLongPhaseF32;
+        return &table[((SampleSubPos >> 16) & 0xff) * N * 2];
+    }
+
+    // two accumulators per channel to halve the add chain
+    template <bool stereo, class Load, class T>
+    static inline void run(int SampleSubPos, const T *L, const T *R, __m128 &sL, __m128 &sR,
+                           Load load)
+    {
+        const float *r = row(SampleSubPos);
+        __m128 lipol0 = _mm_set1_ps((float)(SampleSubPos & 0xffff));
+        __m128 aL = _mm_setzero_ps(), bL = _mm_setzero_ps();
+        __m128 aR = _mm_setzero_ps(), bR = _mm_setzero_ps();
+        for (int k = 0; k < N; k += 8)
+        {
+            __m128 c0 = _mm_add_ps(_mm_mul_ps(_mm_load_ps(&r[N + k]), lipol0), _mm_load_ps(&r[k]));
+            __m128 c1 = _mm_add_ps(_mm_mul_ps(_mm_load_ps(&r[N + k + 4]), lipol0),
+                                   _mm_load_ps(&r[k + 4]));
+            aL = _mm_add_ps(aL, _mm_mul_ps(c0, load(&L[k])));
+            bL = _mm_add_ps(bL, _mm_mul_ps(c1, load(&L[k + 4])));
+            if (stereo)
+            {
+                aR = _mm_add_ps(aR, _mm_mul_ps(c0, load(&R[k])));
+                bR = _mm_add_ps(bR, _mm_mul_ps(c1, load(&R[k + 4])));
+            }
+        }
+        sL = sum_ps_to_ss(_mm_add_ps(aL, bL));
+        if (stereo)
+            sR = sum_ps_to_ss(_mm_add_ps(aR, bR));
+    }
+
+    template <bool stereo>
+    static inline void f32(int SampleSubPos, const float *L, const float *R, float *OutL,
+                           float *OutR)
+    {
+        __m128 sL, sR;
+        run<stereo>(SampleSubPos, L, R, sL, sR, [](const float *p) { return _mm_loadu_ps(p); });
+        _mm_store_ss(OutL, sL);
+        if (stereo)
+            _mm_store_ss(OutR, sR);
+    }
+
+    template <bool stereo>
+    static inline void i16(int SampleSubPos, const short *L, const short *R, float *OutL,
+                           float *OutR)
+    {
+        __m128 sL, sR;
+        run<stereo>(SampleSubPos, L, R, sL, sR, load4_i16_ps);
+        _mm_store_ss(OutL, _mm_mul_ss(sL, _mm_set_ss(I16Scale)));
+        if (stereo)
+            _mm_store_ss(OutR, _mm_mul_ss(sR, _mm_set_ss(I16Scale)));
+    }
+};
+
+/*
+ * Drivers for the kernels with outputs_per_pass == 4: partial sums for four outputs, then one
+ * transpose and vertical add. Pos/SubPos hold the play position of every output in the block.
+ */
+template <class Kernel, bool stereo>
+inline void ResampleBlockF32(int n, const int *Pos, const int *SubPos, const float *L,
+                             const float *R, float *OutL, float *OutR)
+{
+    int i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128 pL[4], pR[4];
+        Kernel::template f32_partial<stereo>(SubPos[i], &L[Pos[i]], stereo ? &R[Pos[i]] : nullptr,
+                                             pL[0], pR[0]);
+        Kernel::template f32_partial<stereo>(SubPos[i + 1], &L[Pos[i + 1]],
+                                             stereo ? &R[Pos[i + 1]] : nullptr, pL[1], pR[1]);
+        Kernel::template f32_partial<stereo>(SubPos[i + 2], &L[Pos[i + 2]],
+                                             stereo ? &R[Pos[i + 2]] : nullptr, pL[2], pR[2]);
+        Kernel::template f32_partial<stereo>(SubPos[i + 3], &L[Pos[i + 3]],
+                                             stereo ? &R[Pos[i + 3]] : nullptr, pL[3], pR[3]);
+        _mm_storeu_ps(&OutL[i], sum_transposed(pL[0], pL[1], pL[2], pL[3]));
+        if (stereo)
+            _mm_storeu_ps(&OutR[i], sum_transposed(pR[0], pR[1], pR[2], pR[3]));
+    }
+    for (; i < n; i++)
+        Kernel::template f32<stereo>(SubPos[i], &L[Pos[i]], stereo ? &R[Pos[i]] : nullptr,
+                                     &OutL[i], stereo ? &OutR[i] : nullptr);
+}
+
+template <class Kernel, bool stereo>
+inline void ResampleBlockI16(int n, const int *Pos, const int *SubPos, const short *L,
+                             const short *R, float *OutL, float *OutR)
+{
+    int i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128i pL[4], pR[4];
+        Kernel::template i16_partial<stereo>(SubPos[i], &L[Pos[i]], stereo ? &R[Pos[i]] : nullptr,
+                                             pL[0], pR[0]);
+        Kernel::template i16_partial<stereo>(SubPos[i + 1], &L[Pos[i + 1]],
+                                             stereo ? &R[Pos[i + 1]] : nullptr, pL[1], pR[1]);
+        Kernel::template i16_partial<stereo>(SubPos[i + 2], &L[Pos[i + 2]],
+                                             stereo ? &R[Pos[i + 2]] : nullptr, pL[2], pR[2]);
+        Kernel::template i16_partial<stereo>(SubPos[i + 3], &L[Pos[i + 3]],
+                                             stereo ? &R[Pos[i + 3]] : nullptr, pL[3], pR[3]);
+        __m128 fL = _mm_cvtepi32_ps(sum_transposed(pL[0], pL[1], pL[2], pL[3]));
+        _mm_storeu_ps(&OutL[i], _mm_mul_ps(fL, I16InvScale_m128));
+        if (stereo)
+        {
+            __m128 fR = _mm_cvtepi32_ps(sum_transposed(pR[0], pR[1], pR[2], pR[3]));
+            _mm_storeu_ps(&OutR[i], _mm_mul_ps(fR, I16InvScale_m128));
+        }
+    }
+    for (; i < n; i++)
+        Kernel::template i16<stereo>(SubPos[i], &L[Pos[i]], stereo ? &R[Pos[i]] : nullptr,
+                                     &OutL[i], stereo ? &OutR[i] : nullptr);
+}
+
+// and for the ones which work across outputs (partial_sums == false)
+template <class Kernel, bool stereo, class T>
+inline void ResampleBlockX4(int n, const int *Pos, const int *SubPos, const T *L, const T *R,
+                            float *OutL, float *OutR)
+{
+    int i = 0;
+    for (; i + 4 <= n; i += 4)
+        Kernel::template x4<stereo>(&Pos[i], &SubPos[i], L, R, &OutL[i],
+                                    stereo ? &OutR[i] : nullptr);
+    for (; i < n; i++)
+        Kernel::template one<stereo>(SubPos[i], &L[Pos[i]], stereo ? &R[Pos[i]] : nullptr,
+                                     &OutL[i], stereo ? &OutR[i] : nullptr);
+}
+
+// and for a ratio of exactly one, where every output is the sample before its position
+template <bool stereo, class T>
+inline void CopyBlock(int n, const int *Pos, const T *L, const T *R, float *OutL, float *OutR)
+{
+    const float scale = SampleScale<T>();
+    for (int i = 0; i < n; i++)
+    {
+        OutL[i] = (float)L[Pos[i] - 1] * scale;
+        if (stereo)
+            OutR[i] = (float)R[Pos[i] - 1] * scale;
+    }
+}
+
+template <bool, bool, int, class>
 void GeneratorSample(GeneratorState *__restrict GD, GeneratorIO *__restrict IO);
 
-GeneratorFPtr GetFPtrGeneratorSample(bool Stereo, bool Float, int LoopMode)
+#if SCXT_GENERATOR_AVX
+template <bool stereo, bool fp, int playmode>
+SCXT_TARGET_AVX2 SCXT_FLATTEN void GeneratorSampleAVX2(GeneratorState *__restrict GD,
+                                                       GeneratorIO *__restrict IO)
+{
+    GeneratorSample<stereo, fp, playmode, GeneratorKernelAVX2>(GD, IO);
+}
+
+template <bool stereo, bool fp, int playmode>
+SCXT_TARGET_AVX512 SCXT_FLATTEN void GeneratorSampleAVX512(GeneratorState *__restrict GD,
+                                                           GeneratorIO *__restrict IO)
+{
+    GeneratorSample<stereo, fp, playmode, GeneratorKernelAVX512>(GD, IO);
+}
+#endif
+
+static bool DetectGeneratorArch(GeneratorArch arch)
+{
+    switch (arch)
+    {
+    case GA_Reference:
+    case GA_SSE2:
+        return true;
+#if SCXT_GENERATOR_AVX
+#if defined(_MSC_VER) && !defined(__clang__)
+    case GA_AVX2:
+    case GA_AVX512:
+    {
+        int r[4];
+        __cpuid(r, 0);
+        if (r[0] < 7)
+            return false;
+        __cpuid(r, 1);
+        bool fma = r[2] & (1 << 12), osxsave = r[2] & (1 << 27), avx = r[2] & (1 << 28);
+        if (!fma || !osxsave || !avx)
+            return false;
+        auto xcr0 = _xgetbv(0);
+        if ((xcr0 & 0x6) != 0x6) // OS saves ymm state
+            return false;
+        __cpuidex(r, 7, 0);
+        bool avx2 = r[1] & (1 << 5);
+        if (arch == GA_AVX2)
+            return avx2;
+        bool avx512 = (r[1] & (1 << 16)) && (r[1] & (1 << 30)); // F and BW
+        return avx2 && avx512 && ((xcr0 & 0xe6) == 0xe6);         // and zmm state
+    }
+#else
+    case GA_AVX2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    case GA_AVX512:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") &&
+               __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+#endif
+#endif
+#if SCXT_GENERATOR_NEON
+    case GA_NEON:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+static GeneratorArch DetectBestGeneratorArch()
+{
+    for (int a = GA_NumArchs - 1; a > GA_SSE2; a--)
+        if (DetectGeneratorArch((GeneratorArch)a))
+            return (GeneratorArch)a;
+    return GA_SSE2;
+}
+
+const char *GeneratorArchName(GeneratorArch arch)
+{
+    switch (arch)
+    {
+#if SCXT_GENERATOR_NEON
+    case GA_Reference:
+        return "SSE2 reference (SIMDe)";
+    case GA_SSE2:
+        return "SSE2 (SIMDe)";
+#else
+    case GA_Reference:
+        return "SSE2 reference";
+    case GA_SSE2:
+        return "SSE2";
+#endif
+    case GA_AVX2:
+        return "AVX2";
+    case GA_AVX512:
+        return "AVX-512";
+    case GA_NEON:
+        return "NEON";
+    default:
+        break;
+    }
+    return "Unknown";
+}
+
+template <bool stereo, bool fp, int playmode>
+GeneratorFPtr GeneratorSampleVariant(int arch, int interpolation)
+{
+    switch (interpolation)
+    {
+    case GI_Linear:
+        return GeneratorSample<stereo, fp, playmode, GeneratorKernelLinear>;
+    case GI_Cubic:
+        return GeneratorSample<stereo, fp, playmode, GeneratorKernelCubic>;
+    case GI_Sinc16:
+        break;
+    case GI_Sinc32:
+        return GeneratorSample<stereo, fp, playmode, GeneratorKernelSinc<FIRipolLong_N>>;
+    case GI_Sinc64:
+        return GeneratorSample<stereo, fp, playmode, GeneratorKernelSinc<FIRipolLonger_N>>;
+    default:
+        return 0;
+    }
+
+    switch (arch)
+    {
+    case GA_Reference:
+        return GeneratorSample<stereo, fp, playmode, GeneratorKernelSSE2>;
+    case GA_SSE2:
+        return GeneratorSample<stereo, fp, playmode, GeneratorKernelSSE2x4>;
+#if SCXT_GENERATOR_AVX
+    case GA_AVX2:
+        return GeneratorSampleAVX2<stereo, fp, playmode>;
+    case GA_AVX512:
+        return GeneratorSampleAVX512<stereo, fp, playmode>;
+#endif
+#if SCXT_GENERATOR_NEON
+    case GA_NEON:
+        return GeneratorSample<stereo, fp, playmode, GeneratorKernelNEON>;
+#endif
+    }
+    return 0;
+}
+
+static GeneratorFPtr LookupGeneratorSample(bool Stereo, bool Float, int LoopMode,
+                                           GeneratorArch arch, int Interpolation)
 {
     if (Stereo)
     {
@@ -43,15 +884,15 @@ GeneratorFPtr GetFPtrGeneratorSample(bool Stereo, bool Float, int LoopMode)
             switch (LoopMode)
             {
             case 0:
-                return GeneratorSample<1, 1, 0, 1>;
+                return GeneratorSampleVariant<1, 1, 0>(arch, Interpolation);
             case 1:
-                return GeneratorSample<1, 1, 1, 1>;
+                return GeneratorSampleVariant<1, 1, 1>(arch, Interpolation);
             case 2:
-                return GeneratorSample<1, 1, 2, 1>;
+                return GeneratorSampleVariant<1, 1, 2>(arch, Interpolation);
             case 3:
-                return GeneratorSample<1, 1, 3, 1>;
+                return GeneratorSampleVariant<1, 1, 3>(arch, Interpolation);
             case 4:
-                return GeneratorSample<1, 1, 4, 1>;
+                return GeneratorSampleVariant<1, 1, 4>(arch, Interpolation);
             }
         }
         else
@@ -59,15 +900,15 @@ GeneratorFPtr GetFPtrGeneratorSample(bool Stereo, bool Float, int LoopMode)
             switch (LoopMode)
             {
             case 0:
-                return GeneratorSample<1, 0, 0, 2>;
+                return GeneratorSampleVariant<1, 0, 0>(arch, Interpolation);
             case 1:
-                return GeneratorSample<1, 0, 1, 2>;
+                return GeneratorSampleVariant<1, 0, 1>(arch, Interpolation);
             case 2:
-                return GeneratorSample<1, 0, 2, 2>;
+                return GeneratorSampleVariant<1, 0, 2>(arch, Interpolation);
             case 3:
-                return GeneratorSample<1, 0, 3, 2>;
+                return GeneratorSampleVariant<1, 0, 3>(arch, Interpolation);
             case 4:
-                return GeneratorSample<1, 0, 4, 2>;
+                return GeneratorSampleVariant<1, 0, 4>(arch, Interpolation);
             }
         }
     }
@@ -78,15 +919,15 @@ GeneratorFPtr GetFPtrGeneratorSample(bool Stereo, bool Float, int LoopMode)
             switch (LoopMode)
             {
             case 0:
-                return GeneratorSample<0, 1, 0, 1>;
+                return GeneratorSampleVariant<0, 1, 0>(arch, Interpolation);
             case 1:
-                return GeneratorSample<0, 1, 1, 1>;
+                return GeneratorSampleVariant<0, 1, 1>(arch, Interpolation);
             case 2:
-                return GeneratorSample<0, 1, 2, 1>;
+                return GeneratorSampleVariant<0, 1, 2>(arch, Interpolation);
             case 3:
-                return GeneratorSample<0, 1, 3, 1>;
+                return GeneratorSampleVariant<0, 1, 3>(arch, Interpolation);
             case 4:
-                return GeneratorSample<0, 1, 4, 1>;
+                return GeneratorSampleVariant<0, 1, 4>(arch, Interpolation);
             }
         }
         else
@@ -94,22 +935,73 @@ GeneratorFPtr GetFPtrGeneratorSample(bool Stereo, bool Float, int LoopMode)
             switch (LoopMode)
             {
             case 0:
-                return GeneratorSample<0, 0, 0, 2>;
+                return GeneratorSampleVariant<0, 0, 0>(arch, Interpolation);
             case 1:
-                return GeneratorSample<0, 0, 1, 2>;
+                return GeneratorSampleVariant<0, 0, 1>(arch, Interpolation);
             case 2:
-                return GeneratorSample<0, 0, 2, 2>;
+                return GeneratorSampleVariant<0, 0, 2>(arch, Interpolation);
             case 3:
-                return GeneratorSample<0, 0, 3, 2>;
+                return GeneratorSampleVariant<0, 0, 3>(arch, Interpolation);
             case 4:
-                return GeneratorSample<0, 0, 4, 2>;
+                return GeneratorSampleVariant<0, 0, 4>(arch, Interpolation);
             }
         }
     }
     return 0;
 }
 
-template <bool stereo, bool fp, int playmode, int SSE>
+const int GeneratorLoopModes = GSM_LoopUntilRelease + 1;
+
+// every variant, resolved once at startup rather than on each note-on, which is on the audio
+// thread. the entries of architectures the CPU lacks stay empty
+struct GeneratorTable
+{
+    bool available[GA_NumArchs];
+    GeneratorArch best;
+    GeneratorFPtr fn[GA_NumArchs][GI_NumInterpolations][2][2][GeneratorLoopModes];
+
+    GeneratorTable() : best(DetectBestGeneratorArch())
+    {
+        for (int a = 0; a < GA_NumArchs; a++)
+        {
+            auto arch = (GeneratorArch)a;
+            available[a] = DetectGeneratorArch(arch);
+            for (int gi = 0; gi < GI_NumInterpolations; gi++)
+                for (int st = 0; st < 2; st++)
+                    for (int fp = 0; fp < 2; fp++)
+                        for (int lm = 0; lm < GeneratorLoopModes; lm++)
+                        {
+                            auto f = LookupGeneratorSample(st, fp, lm, arch, gi);
+                            fn[a][gi][st][fp][lm] = available[a] ? f : nullptr;
+                        }
+        }
+    }
+};
+static const GeneratorTable generatorTable;
+
+bool GeneratorArchAvailable(GeneratorArch arch)
+{
+    return (arch >= 0) && (arch < GA_NumArchs) && generatorTable.available[arch];
+}
+
+GeneratorArch GetGeneratorArch() { return generatorTable.best; }
+
+GeneratorFPtr GetFPtrGeneratorSample(bool Stereo, bool Float, int LoopMode, int Interpolation)
+{
+    return GetFPtrGeneratorSample(Stereo, Float, LoopMode, generatorTable.best, Interpolation);
+}
+
+GeneratorFPtr GetFPtrGeneratorSample(bool Stereo, bool Float, int LoopMode, GeneratorArch arch,
+                                     int Interpolation)
+{
+    if ((arch < 0) || (arch >= GA_NumArchs) || (Interpolation < 0) ||
+        (Interpolation >= GI_NumInterpolations) || (LoopMode < 0) ||
+        (LoopMode >= GeneratorLoopModes))
+        return 0;
+    return generatorTable.fn[arch][Interpolation][Stereo][Float][LoopMode];
+}
+
+template <bool stereo, bool fp, int playmode, class Kernel>
 void GeneratorSample(GeneratorState *__restrict GD, GeneratorIO *__restrict IO)
 {
     int SamplePos = GD->SamplePos;
@@ -123,107 +1015,43 @@ void GeneratorSample(GeneratorState *__restrict GD, GeneratorIO *__restrict IO)
     int RatioSign = Sign(Ratio);
     Ratio = abs(Ratio);
     int Direction = GD->Direction * RatioSign;
-    short *__restrict SampleDataL;
-    short *__restrict SampleDataR;
-    float *__restrict SampleDataFL;
-    float *__restrict SampleDataFR;
+    short *__restrict SampleDataL = nullptr;
+    short *__restrict SampleDataR = nullptr;
+    float *__restrict SampleDataFL = nullptr;
+    float *__restrict SampleDataFR = nullptr;
     float *__restrict OutputL;
-    float *__restrict OutputR;
+    float *__restrict OutputR = nullptr;
 
     GD->PositionWithinLoop = 0.f;
     GD->IsInLoop = false;
 
+    // the kernels take the first sample under the filter
     if (fp)
-        SampleDataFL = (float *)IO->SampleDataL;
+        SampleDataFL = (float *)IO->SampleDataL - Kernel::taps / 2;
     else
-        SampleDataL = (short *)IO->SampleDataL;
+        SampleDataL = (short *)IO->SampleDataL - Kernel::taps / 2;
     OutputL = IO->OutputL;
     if (stereo)
     {
         if (fp)
-            SampleDataFR = (float *)IO->SampleDataR;
-        SampleDataR = (short *)IO->SampleDataR;
+            SampleDataFR = (float *)IO->SampleDataR - Kernel::taps / 2;
+        else
+            SampleDataR = (short *)IO->SampleDataR - Kernel::taps / 2;
         OutputR = IO->OutputR;
     }
     int NSamples = GD->BlockSize;
 
+    // Walk the play positions for the whole block first. That takes the loop carried dependency
+    // out of the resampler below, which can then work on several outputs per pass.
+    int Pos alignas(16)[MaxGeneratorBlockSize], SubPos alignas(16)[MaxGeneratorBlockSize];
+    assert(NSamples <= MaxGeneratorBlockSize);
+
     for (int i = 0; i < NSamples; i++)
     {
-        // 2. Resample
-        unsigned int m0 = ((SampleSubPos >> 12) & 0xff0);
-        if (fp)
-        {
-            // float32 path (SSE)
-            __m128 lipol0, tmp[4], sL4, sR4;
-            lipol0 = _mm_setzero_ps();
-            lipol0 = _mm_cvtsi32_ss(lipol0, SampleSubPos & 0xffff);
-            lipol0 = _mm_shuffle_ps(lipol0, lipol0, _MM_SHUFFLE(0, 0, 0, 0));
-            tmp[0] = _mm_add_ps(_mm_mul_ps(*((__m128 *)&SincOffsetF32[m0]), lipol0),
-                                *((__m128 *)&SincTableF32[m0]));
-            tmp[1] = _mm_add_ps(_mm_mul_ps(*((__m128 *)&SincOffsetF32[m0 + 4]), lipol0),
-                                *((__m128 *)&SincTableF32[m0 + 4]));
-            tmp[2] = _mm_add_ps(_mm_mul_ps(*((__m128 *)&SincOffsetF32[m0 + 8]), lipol0),
-                                *((__m128 *)&SincTableF32[m0 + 8]));
-            tmp[3] = _mm_add_ps(_mm_mul_ps(*((__m128 *)&SincOffsetF32[m0 + 12]), lipol0),
-                                *((__m128 *)&SincTableF32[m0 + 12]));
-            sL4 = _mm_mul_ps(tmp[0], _mm_loadu_ps(&SampleDataFL[SamplePos]));
-            sL4 = _mm_add_ps(sL4, _mm_mul_ps(tmp[1], _mm_loadu_ps(&SampleDataFL[SamplePos + 4])));
-            sL4 = _mm_add_ps(sL4, _mm_mul_ps(tmp[2], _mm_loadu_ps(&SampleDataFL[SamplePos + 8])));
-            sL4 = _mm_add_ps(sL4, _mm_mul_ps(tmp[3], _mm_loadu_ps(&SampleDataFL[SamplePos + 12])));
-            sL4 = sum_ps_to_ss(sL4);
-            _mm_store_ss(&OutputL[i], sL4);
-            if (stereo)
-            {
-                sR4 = _mm_mul_ps(tmp[0], _mm_loadu_ps(&SampleDataFR[SamplePos]));
-                sR4 =
-                    _mm_add_ps(sR4, _mm_mul_ps(tmp[1], _mm_loadu_ps(&SampleDataFR[SamplePos + 4])));
-                sR4 =
-                    _mm_add_ps(sR4, _mm_mul_ps(tmp[2], _mm_loadu_ps(&SampleDataFR[SamplePos + 8])));
-                sR4 = _mm_add_ps(sR4,
-                                 _mm_mul_ps(tmp[3], _mm_loadu_ps(&SampleDataFR[SamplePos + 12])));
-                sR4 = sum_ps_to_ss(sR4);
-                _mm_store_ss(&OutputR[i], sR4);
-            }
-        }
-        else
-        {
-            // int16
-            // SSE2 path
-            __m128i lipol0, tmp, sL8A, sR8A, tmp2, sL8B, sR8B;
-            __m128 fL, fR;
-            lipol0 = _mm_set1_epi16(SampleSubPos & 0xffff);
-
-            tmp = _mm_add_epi16(_mm_mulhi_epi16(*((__m128i *)&SincOffsetI16[m0]), lipol0),
-                                *((__m128i *)&SincTableI16[m0]));
-            sL8A = _mm_madd_epi16(tmp, _mm_loadu_si128((__m128i *)&SampleDataL[SamplePos]));
-            if (stereo)
-                sR8A = _mm_madd_epi16(tmp, _mm_loadu_si128((__m128i *)&SampleDataR[SamplePos]));
-            tmp2 = _mm_add_epi16(_mm_mulhi_epi16(*((__m128i *)&SincOffsetI16[m0 + 8]), lipol0),
-                                 *((__m128i *)&SincTableI16[m0 + 8]));
-            sL8B = _mm_madd_epi16(tmp2, _mm_loadu_si128((__m128i *)&SampleDataL[SamplePos + 8]));
-            if (stereo)
-                sR8B =
-                    _mm_madd_epi16(tmp2, _mm_loadu_si128((__m128i *)&SampleDataR[SamplePos + 8]));
-            sL8A = _mm_add_epi32(sL8A, sL8B);
-            if (stereo)
-                sR8A = _mm_add_epi32(sR8A, sR8B);
-
-            int l alignas(16)[4], r alignas(16)[4];
-            _mm_store_si128((__m128i *)&l, sL8A);
-            if (stereo)
-                _mm_store_si128((__m128i *)&r, sR8A);
-            l[0] = (l[0] + l[1]) + (l[2] + l[3]);
-            if (stereo)
-                r[0] = (r[0] + r[1]) + (r[2] + r[3]);
-            fL = _mm_mul_ss(_mm_cvtsi32_ss(fL, l[0]), I16InvScale_m128);
-            if (stereo)
-                fR = _mm_mul_ss(_mm_cvtsi32_ss(fR, r[0]), I16InvScale_m128);
-            _mm_store_ss(&OutputL[i], fL);
-            if (stereo)
-                _mm_store_ss(&OutputR[i], fR);
-        }
+        Pos[i] = SamplePos;
+        SubPos[i] = SampleSubPos;
 
-        // 3. Forward sample position
+        // 1. Forward sample position
         SampleSubPos += Ratio * Direction;
         int incr = SampleSubPos >> 24;
         SamplePos += incr;
@@ -448,6 +1276,67 @@ store:
         }
     }
 
+    // positions in the mip level, the bits shifted out of Pos become the top of SubPos. the
+    // kernels output the sample before the position, so Mask moves that back to one sample of
+    // the original and the timing doesn't change with the level
+    if (int Level = GD->MipLevel)
+    {
+        int Mask = (1 << Level) - 1;
+        for (int i = 0; i < NSamples; i++)
+        {
+            int p = Pos[i] + Mask;
+            SubPos[i] = ((p & Mask) << (24 - Level)) | (SubPos[i] >> Level);
+            Pos[i] = p >> Level;
+        }
+    }
+
+    // 2. Resample. at unity (the sub position then stays at zero) the kernels would only put out
+    // the sample before the position, give or take the passband of the sincs, so copy that
+    if ((Ratio == (1 << 24)) && (GD->SampleSubPos == 0) && !GD->MipLevel)
+    {
+        if (fp)
+            CopyBlock<stereo>(NSamples, Pos, (const float *)IO->SampleDataL,
+                              (const float *)IO->SampleDataR, OutputL, OutputR);
+        else
+            CopyBlock<stereo>(NSamples, Pos, (const short *)IO->SampleDataL,
+                              (const short *)IO->SampleDataR, OutputL, OutputR);
+    }
+    else if constexpr (Kernel::outputs_per_pass > 1)
+    {
+        if constexpr (Kernel::partial_sums)
+        {
+            if (fp)
+                ResampleBlockF32<Kernel, stereo>(NSamples, Pos, SubPos, SampleDataFL,
+                                                 SampleDataFR, OutputL, OutputR);
+            else
+                ResampleBlockI16<Kernel, stereo>(NSamples, Pos, SubPos, SampleDataL, SampleDataR,
+                                                 OutputL, OutputR);
+        }
+        else
+        {
+            if (fp)
+                ResampleBlockX4<Kernel, stereo>(NSamples, Pos, SubPos, SampleDataFL, SampleDataFR,
+                                                OutputL, OutputR);
+            else
+                ResampleBlockX4<Kernel, stereo>(NSamples, Pos, SubPos, SampleDataL, SampleDataR,
+                                                OutputL, OutputR);
+        }
+    }
+    else
+    {
+        for (int i = 0; i < NSamples; i++)
+        {
+            if (fp)
+                Kernel::template f32<stereo>(SubPos[i], &SampleDataFL[Pos[i]],
+                                             stereo ? &SampleDataFR[Pos[i]] : nullptr,
+                                             &OutputL[i], stereo ? &OutputR[i] : nullptr);
+            else
+                Kernel::template i16<stereo>(SubPos[i], &SampleDataL[Pos[i]],
+                                             stereo ? &SampleDataR[Pos[i]] : nullptr,
+                                             &OutputL[i], stereo ? &OutputR[i] : nullptr);
+        }
+    }
+
     GD->Direction = Direction * RatioSign;
     GD->SamplePos = SamplePos;
     GD->SampleSubPos = SampleSubPos;
@@ -34,6 +34,10 @@ struct GeneratorState
 
     float PositionWithinLoop;
     bool IsInLoop;
+
+    // the sample data is decimated by 2^MipLevel (see sample::build_mips). positions, bounds
+    // and Ratio stay in samples of the original
+    int MipLevel{0};
 };
 
 typedef void (*ReleaseCallback)();
@@ -42,6 +46,8 @@ struct GeneratorIO
 {
     float *__restrict OutputL;
     float *__restrict OutputR;
+    // first sample of the wave. each interpolator reads up to half its taps either side of the
+    // play position, so the data needs that much zero padding (see SampleMargin)
     void *__restrict SampleDataL;
     void *__restrict SampleDataR;
     int WaveSize;
@@ -66,7 +72,45 @@ enum GeneratorSampleModes
 
 typedef void (*GeneratorFPtr)(GeneratorState *__restrict, GeneratorIO *__restrict);
 
-GeneratorFPtr GetFPtrGeneratorSample(bool Stereo, bool Float, int LoopMode);
+/*
+ * Instruction set variants of the sample generator. GetFPtrGeneratorSample picks the best one the
+ * CPU supports, detected once at startup. On aarch64 the SSE2 kernels are SIMDe translated.
+ * GA_Reference is the original one output at a time SSE2 kernel, kept to test the others.
+ */
+enum GeneratorArch
+{
+    GA_Reference = 0,
+    GA_SSE2,
+    GA_AVX2,
+    GA_AVX512,
+    GA_NEON,
+    GA_NumArchs
+};
+
+/*
+ * Interpolation quality. GI_Sinc16 is the 16 tap windowed sinc the engine has always used,
+ * and the only mode with the per instruction set variants above. Linear and cubic are for
+ * large polyphony and percussion, the longer sincs for offline renders.
+ */
+enum GeneratorInterpolation
+{
+    GI_Linear = 0,
+    GI_Cubic,
+    GI_Sinc16,
+    GI_Sinc32,
+    GI_Sinc64,
+    GI_NumInterpolations
+};
+
+bool GeneratorArchAvailable(GeneratorArch arch);
+GeneratorArch GetGeneratorArch();
+const char *GeneratorArchName(GeneratorArch arch);
+
+GeneratorFPtr GetFPtrGeneratorSample(bool Stereo, bool Float, int LoopMode,
+                                     int Interpolation = GI_Sinc16);
+// returns 0 if the variant isn't available on this CPU/build
+GeneratorFPtr GetFPtrGeneratorSample(bool Stereo, bool Float, int LoopMode, GeneratorArch arch,
+                                     int Interpolation = GI_Sinc16);
 
 // GeneratorFPtr GetFPtrGeneratorStretching(bool Stereo, bool Float);
 
@@ -35,7 +35,14 @@
 #include <cmath>
 #include <cstdint>
 
-static constexpr uint32_t BLOCK_SIZE = 32; // must be a multiple of 4 (SIMD)
+// The engine block size is chosen at build time with the SCXT_BLOCK_SIZE cmake option. Voices,
+// parts and effects all size their buffers and control rates from it.
+#ifndef SCXT_BLOCK_SIZE
+#define SCXT_BLOCK_SIZE 32
+#endif
+static constexpr uint32_t BLOCK_SIZE = SCXT_BLOCK_SIZE;
+static_assert(BLOCK_SIZE == 16 || BLOCK_SIZE == 32 || BLOCK_SIZE == 64 || BLOCK_SIZE == 128,
+              "BLOCK_SIZE must be 16, 32, 64 or 128"); // lipol_ps works on 8 floats at a time
 static constexpr uint32_t BLOCK_SIZE_QUAD = BLOCK_SIZE >> 2;
 static constexpr float INV_BLOCK_SIZE = 1.f / float(BLOCK_SIZE);
 static constexpr float INV_2BLOCK_SIZE = 1.f / float(BLOCK_SIZE << 1);
@@ -43,6 +50,12 @@ static const __m128 INV_BLOCK_SIZE_128 = _mm_set1_ps(INV_BLOCK_SIZE);
 static const __m128 INV_2BLOCK_SIZE_128 = _mm_set1_ps(INV_2BLOCK_SIZE);
 
 static constexpr uint32_t MAX_VOICES = 256;
+// the oversampling filters the voices share, set with the SCXT_HALFRATE_VOICES cmake option
+#ifndef SCXT_HALFRATE_VOICES
+#define SCXT_HALFRATE_VOICES 64
+#endif
+static constexpr uint32_t HALFRATE_VOICES = SCXT_HALFRATE_VOICES;
+static_assert(HALFRATE_VOICES <= MAX_VOICES, "more halfrate filters than voices");
 
 static constexpr uint32_t MAX_SAMPLES = 2048;
 static constexpr uint32_t MAX_ZONES = 2048;
@@ -57,9 +70,7 @@ static constexpr uint32_t PATHLENGTH = 1024;
 static constexpr float PI_1 = 3.1415926535898f;
 static constexpr float PI_2 = 6.2831853071796f;
 static constexpr float FILTER_FREQRANGE = 20000.0f; // Hz
-extern float samplerate;
-extern float samplerate_inv;
-extern float multiplier_freq2omega;
+#include "engine_context.h"
 
 // directory under user's profile where sc3 config file(s) will be sought
 // this should end up being same location that juce stores it's standalone app settings
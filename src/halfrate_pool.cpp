@@ -0,0 +1,117 @@
+/*
+** Shortcircuit XT is Free and Open Source Software
+**
+** Shortcircuit is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html; The authors of the code
+** reserve the right to re-license their contributions under the MIT license in the
+** future at the discretion of the project maintainers.
+**
+** Copyright 2004-2022 by various individuals as described by the git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/shortcircuit-xt.git
+**
+** Shortcircuit was a commercial product from 2004-2018, with copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Shortcircuit
+** open source in December 2020.
+*/
+
+#include "halfrate_pool.h"
+#include "generator.h"
+#include "sst/filters/HalfRateFilter.h"
+
+#include <cassert>
+#include <cstddef>
+#include <new>
+
+struct halfrate_pool::slot
+{
+    sst::filters::HalfRate::HalfRateFilter filter{4, false};
+    int order{4};
+    bool taken{false};
+    halfrate_pool::user *owner{nullptr};
+};
+
+halfrate_pool::halfrate_pool(int slots) : n_slots(slots), n_free(slots)
+{
+    this->slots = std::make_unique<slot[]>(slots);
+    free_stack = std::make_unique<int[]>(slots);
+    for (int i = 0; i < slots; i++)
+        free_stack[i] = slots - 1 - i;
+}
+
+halfrate_pool::~halfrate_pool() = default;
+
+// linear and cubic leave more images than a short filter does, so a steep one would only cost
+// them time. 4 is what every voice used before
+int halfrate_pool::filter_order(int interpolation)
+{
+    switch (interpolation)
+    {
+    case GI_Linear:
+        return 2;
+    case GI_Cubic:
+        return 3;
+    case GI_Sinc32:
+    case GI_Sinc64:
+        return 6;
+    default:
+        return 4;
+    }
+}
+
+sst::filters::HalfRate::HalfRateFilter *halfrate_pool::acquire(int interpolation, user *owner)
+{
+    if (n_free)
+        return take(free_stack[--n_free], interpolation, owner);
+
+    int victim = -1;
+    float lowest = 0.f;
+    for (int i = 0; i < n_slots; i++)
+    {
+        if (!slots[i].owner)
+            continue;
+        float p = slots[i].owner->keep_priority();
+        if ((victim < 0) || (p < lowest))
+        {
+            victim = i;
+            lowest = p;
+        }
+    }
+    if (victim < 0)
+    {
+        n_exhausted.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    slots[victim].owner->lost_halfrate();
+    n_stolen.fetch_add(1, std::memory_order_relaxed);
+    return take(victim, interpolation, owner);
+}
+
+sst::filters::HalfRate::HalfRateFilter *halfrate_pool::take(int i, int interpolation, user *owner)
+{
+    slot &s = slots[i];
+    int order = filter_order(interpolation);
+    if (order != s.order)
+    {
+        // the order is only set by the constructor. the object is the same size for all of them
+        s.filter.~HalfRateFilter();
+        new (&s.filter) sst::filters::HalfRate::HalfRateFilter(order, false);
+        s.order = order;
+    }
+    s.filter.reset();
+    s.taken = true;
+    s.owner = owner;
+    return &s.filter;
+}
+
+void halfrate_pool::release(sst::filters::HalfRate::HalfRateFilter *f)
+{
+    if (!f)
+        return;
+    auto i = (int)((reinterpret_cast<char *>(f) - reinterpret_cast<char *>(&slots[0].filter)) /
+                   (std::ptrdiff_t)sizeof(slot));
+    assert((i >= 0) && (i < n_slots) && slots[i].taken);
+    slots[i].taken = false;
+    slots[i].owner = nullptr;
+    free_stack[n_free++] = i;
+}
@@ -0,0 +1,76 @@
+/*
+** Shortcircuit XT is Free and Open Source Software
+**
+** Shortcircuit is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html; The authors of the code
+** reserve the right to re-license their contributions under the MIT license in the
+** future at the discretion of the project maintainers.
+**
+** Copyright 2004-2022 by various individuals as described by the git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/shortcircuit-xt.git
+**
+** Shortcircuit was a commercial product from 2004-2018, with copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Shortcircuit
+** open source in December 2020.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace sst::filters::HalfRate
+{
+class HalfRateFilter;
+}
+
+/*
+ * The 2x downsampling filters of the voices which oversample. Most notes don't, so rather
+ * than every voice carrying its own filter they take one from here at note on and give it back
+ * when they stop. When every slot is taken the new note gets the filter of the user with the
+ * lowest keep_priority(), which is told and carries on without oversampling. Only when no
+ * slot has a user to take it from does the note play without.
+ *
+ * The filter order follows the interpolation quality of the voice, all orders share the same
+ * slots. Nothing allocates after construction. Not thread safe: acquire and release belong to
+ * whichever thread owns the voices, the audio thread while it runs. Only exhausted() may be read
+ * from elsewhere.
+ */
+class halfrate_pool
+{
+  public:
+    struct user
+    {
+        // the lowest loses its filter first when a note finds the pool full
+        virtual float keep_priority() const = 0;
+        // the filter went to another note. stop using it, and don't release it
+        virtual void lost_halfrate() = 0;
+    };
+
+    explicit halfrate_pool(int slots);
+    ~halfrate_pool();
+
+    // a filter of the order for interpolation (a GeneratorInterpolation) with its state
+    // cleared. taken from another user if every slot is in use, nullptr if none has one
+    sst::filters::HalfRate::HalfRateFilter *acquire(int interpolation, user *owner = nullptr);
+    void release(sst::filters::HalfRate::HalfRateFilter *f);
+
+    static int filter_order(int interpolation);
+
+    int size() const { return n_slots; }
+    int in_use() const { return n_slots - n_free; }
+    // how many acquires found every slot taken and returned nullptr
+    uint32_t exhausted() const { return n_exhausted.load(std::memory_order_relaxed); }
+    // how many acquires took the filter of another user
+    uint32_t stolen() const { return n_stolen.load(std::memory_order_relaxed); }
+
+  private:
+    struct slot;
+    sst::filters::HalfRate::HalfRateFilter *take(int i, int interpolation, user *owner);
+    std::unique_ptr<slot[]> slots;
+    std::unique_ptr<int[]> free_stack;
+    int n_slots, n_free;
+    std::atomic<uint32_t> n_exhausted{0}, n_stolen{0};
+};
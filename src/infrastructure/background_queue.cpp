@@ -0,0 +1,78 @@
+/*
+** Shortcircuit XT is Free and Open Source Software
+**
+** Shortcircuit is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html; The authors of the code
+** reserve the right to re-license their contributions under the MIT license in the
+** future at the discretion of the project maintainers.
+**
+** Copyright 2004-2022 by various individuals as described by the git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/shortcircuit-xt.git
+**
+** Shortcircuit was a commercial product from 2004-2018, with copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Shortcircuit
+** open source in December 2020.
+*/
+
+#include "background_queue.h"
+
+namespace scxt::Threading
+{
+
+BackgroundQueue::BackgroundQueue() : mThread([this]() { threadMain(); }) {}
+
+BackgroundQueue::~BackgroundQueue()
+{
+    std::deque<std::function<void()>> dropped;
+    {
+        std::lock_guard<std::mutex> g(mMutex);
+        mQuit = true;
+        dropped.swap(mJobs);
+    }
+    mWake.notify_all();
+    mThread.join();
+}
+
+void BackgroundQueue::post(std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> g(mMutex);
+        if (mQuit)
+            return;
+        mJobs.push_back(std::move(job));
+    }
+    mWake.notify_one();
+}
+
+void BackgroundQueue::waitIdle()
+{
+    std::unique_lock<std::mutex> g(mMutex);
+    mIdle.wait(g, [this]() { return mJobs.empty() && !mRunning; });
+}
+
+void BackgroundQueue::threadMain()
+{
+    std::unique_lock<std::mutex> g(mMutex);
+    for (;;)
+    {
+        mWake.wait(g, [this]() { return mQuit || !mJobs.empty(); });
+        if (mQuit)
+            break;
+
+        auto job = std::move(mJobs.front());
+        mJobs.pop_front();
+        mRunning = true;
+        g.unlock();
+        job();
+        job = nullptr; // whatever the job holds goes here, not under the lock
+        g.lock();
+        mRunning = false;
+        if (mJobs.empty())
+            mIdle.notify_all();
+    }
+    mRunning = false;
+    mIdle.notify_all();
+}
+
+} // namespace scxt::Threading
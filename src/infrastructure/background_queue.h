@@ -0,0 +1,63 @@
+/*
+** Shortcircuit XT is Free and Open Source Software
+**
+** Shortcircuit is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html; The authors of the code
+** reserve the right to re-license their contributions under the MIT license in the
+** future at the discretion of the project maintainers.
+**
+** Copyright 2004-2022 by various individuals as described by the git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/shortcircuit-xt.git
+**
+** Shortcircuit was a commercial product from 2004-2018, with copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Shortcircuit
+** open source in December 2020.
+*/
+
+/*
+ * One thread for the slow work which follows a load (building sample mip maps and the like),
+ * so the loading thread doesn't have to wait for it.
+ *
+ * Jobs run one at a time in the order they were posted. Jobs still waiting when the queue is
+ * destroyed are dropped without running, the one running is waited for. Not for the audio
+ * thread: post() allocates and takes a lock.
+ */
+
+#ifndef SHORTCIRCUIT_BACKGROUND_QUEUE_H
+#define SHORTCIRCUIT_BACKGROUND_QUEUE_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace scxt::Threading
+{
+
+class BackgroundQueue
+{
+  public:
+    BackgroundQueue();
+    ~BackgroundQueue();
+
+    void post(std::function<void()> job);
+
+    // blocks until every job posted so far has run. for offline renders and tests
+    void waitIdle();
+
+  private:
+    void threadMain();
+
+    std::deque<std::function<void()>> mJobs;
+    bool mRunning{false};
+    bool mQuit{false};
+    std::mutex mMutex;
+    std::condition_variable mWake, mIdle;
+    std::thread mThread;
+};
+
+} // namespace scxt::Threading
+
+#endif // SHORTCIRCUIT_BACKGROUND_QUEUE_H
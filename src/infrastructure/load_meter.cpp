@@ -0,0 +1,64 @@
+/*
+** Shortcircuit XT is Free and Open Source Software
+**
+** Shortcircuit is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html; The authors of the code
+** reserve the right to re-license their contributions under the MIT license in the
+** future at the discretion of the project maintainers.
+**
+** Copyright 2004-2022 by various individuals as described by the git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/shortcircuit-xt.git
+**
+** Shortcircuit was a commercial product from 2004-2018, with copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Shortcircuit
+** open source in December 2020.
+*/
+
+#include "load_meter.h"
+
+#include <cmath>
+
+namespace scxt::Perf
+{
+
+LoadMeter::LoadMeter() { setBudget(48000, 32); }
+
+void LoadMeter::setBudget(double samplerate, int blockSize)
+{
+    double blockSeconds = blockSize / samplerate;
+    mStats.budgetNs = blockSeconds * 1e9;
+    mSmoothing = (float)(1.0 - exp(-blockSeconds / 0.3));
+    reset();
+}
+
+void LoadMeter::reset()
+{
+    auto budget = mStats.budgetNs;
+    mStats = Stats();
+    mStats.budgetNs = budget;
+}
+
+void LoadMeter::addBlock(double ns)
+{
+    float l = (float)(ns / mStats.budgetNs);
+
+    mStats.load += mSmoothing * (l - mStats.load);
+    if (l > mStats.peak)
+        mStats.peak = l;
+    if (l > mStats.worst)
+        mStats.worst = l;
+    mStats.totalNs += ns;
+    mStats.blocks++;
+    if (l > 1.f)
+        mStats.overBudget++;
+
+    int b;
+    if (l < 1.f)
+        b = (int)(l * 10.f);
+    else
+        b = (l < 1.5f) ? 10 : 11;
+    mStats.histogram[b < 0 ? 0 : b]++;
+}
+
+} // namespace scxt::Perf
@@ -0,0 +1,97 @@
+/*
+** Shortcircuit XT is Free and Open Source Software
+**
+** Shortcircuit is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html; The authors of the code
+** reserve the right to re-license their contributions under the MIT license in the
+** future at the discretion of the project maintainers.
+**
+** Copyright 2004-2022 by various individuals as described by the git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/shortcircuit-xt.git
+**
+** Shortcircuit was a commercial product from 2004-2018, with copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Shortcircuit
+** open source in December 2020.
+*/
+
+/*
+ * DSP load meter for the audio thread. Each engine block is timed against its realtime budget
+ * (BLOCK_SIZE / samplerate), giving a smoothed load, the worst block since the last look, a
+ * histogram of per-block load and a count of the blocks which took longer than their budget.
+ * A block over budget isn't necessarily an audible dropout, the host buffer usually holds
+ * several blocks, but a climbing count and a histogram creeping right are the warning.
+ *
+ * Owned and written by the audio thread only, the sampler publishes a copy of the stats to
+ * the wrappers as ip_dspload messages.
+ */
+
+#ifndef SHORTCIRCUIT_LOAD_METER_H
+#define SHORTCIRCUIT_LOAD_METER_H
+
+#include <chrono>
+#include <cstdint>
+
+namespace scxt::Perf
+{
+
+class LoadMeter
+{
+  public:
+    // buckets 0-9 are 10% of the budget wide, 10 is 100-150% and 11 everything slower
+    static constexpr int histogramBuckets = 12;
+
+    struct Stats
+    {
+        float load{0};     // smoothed over about 300ms, 1 is the whole budget
+        float peak{0};     // worst block since takePeak()
+        float worst{0};    // worst block since reset()
+        double budgetNs{0};
+        double totalNs{0}; // sum over all blocks, totalNs / (blocks * budgetNs) is the mean
+        uint64_t blocks{0};
+        uint64_t overBudget{0};
+        uint64_t histogram[histogramBuckets]{};
+    };
+
+    LoadMeter();
+
+    void setBudget(double samplerate, int blockSize);
+    void reset();
+
+    void begin() { mStart = clock::now(); }
+    void end()
+    {
+        auto d = std::chrono::duration<double, std::nano>(clock::now() - mStart);
+        addBlock(d.count());
+    }
+    void addBlock(double ns);
+
+    const Stats &stats() const { return mStats; }
+    float takePeak()
+    {
+        auto p = mStats.peak;
+        mStats.peak = 0;
+        return p;
+    }
+
+    // times the enclosing scope as one block
+    class Block
+    {
+      public:
+        explicit Block(LoadMeter &m) : mMeter(m) { mMeter.begin(); }
+        ~Block() { mMeter.end(); }
+
+      private:
+        LoadMeter &mMeter;
+    };
+
+  private:
+    typedef std::chrono::steady_clock clock;
+    clock::time_point mStart;
+    Stats mStats;
+    float mSmoothing{0};
+};
+
+} // namespace scxt::Perf
+
+#endif // SHORTCIRCUIT_LOAD_METER_H
@@ -0,0 +1,58 @@
+/*
+** Shortcircuit XT is Free and Open Source Software
+**
+** Shortcircuit is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html; The authors of the code
+** reserve the right to re-license their contributions under the MIT license in the
+** future at the discretion of the project maintainers.
+**
+** Copyright 2004-2022 by various individuals as described by the git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/shortcircuit-xt.git
+**
+** Shortcircuit was a commercial product from 2004-2018, with copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Shortcircuit
+** open source in December 2020.
+*/
+
+/*
+ * One thread running a fixed housekeeping task (rebuilding the zone index, freeing retired
+ * objects) on request and every period_ms regardless.
+ *
+ * Unlike BackgroundQueue::post(), request() neither allocates nor locks, so the audio thread
+ * may ask for work it mustn't do itself. Requests arriving while the task runs are folded
+ * into one more run.
+ */
+
+#ifndef SHORTCIRCUIT_MAINTENANCE_THREAD_H
+#define SHORTCIRCUIT_MAINTENANCE_THREAD_H
+
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <atomicops.h>
+
+namespace scxt::Threading
+{
+
+class MaintenanceThread
+{
+  public:
+    MaintenanceThread(std::function<void()> task, int period_ms = 100);
+    ~MaintenanceThread();
+
+    void request() { mWake.signal(); }
+
+  private:
+    void threadMain();
+
+    std::function<void()> mTask;
+    int64_t mPeriodUs;
+    std::atomic<bool> mQuit{false};
+    moodycamel::spsc_sema::LightweightSemaphore mWake;
+    std::thread mThread;
+};
+
+} // namespace scxt::Threading
+
+#endif // SHORTCIRCUIT_MAINTENANCE_THREAD_H
@@ -17,73 +17,109 @@
 
 #include "profiler.h"
 
+#include <atomic>
+#include <chrono>
 #include <map>
-#include <list>
+#include <thread>
+#include <vector>
 #include "logfile.h"
-#include "ticks.h"
-#include <string.h>
-
-#define MAX_ID_LEN 255
-
-#if WINDOWS
-#include <windows.h>
-static DWORD_PTR gThreadAffinityOriginal = 0;
-static int gTASet = 0;
-#endif
+#include "trace.h"
 
 namespace scxt::Perf
 {
 
-struct ProfID
+namespace
 {
-    char mID[MAX_ID_LEN];
-    ProfID(const char *id)
-    {
-        strncpy(mID, id, MAX_ID_LEN);
-        mID[MAX_ID_LEN - 1] = 0;
-    }
+struct Frame
+{
+    uint64_t start;
+    uint64_t subtract;
 };
 
-struct ProfIDComp
+// written only by the owning thread, read by dump()
+struct Bucket
 {
-    bool operator()(const ProfID &a, const ProfID &b) const { return strcmp(a.mID, b.mID) < 0; }
+    std::atomic<uint32_t> hash{0};
+    const char *name{nullptr};
+    std::atomic<uint64_t> ticks{0};
+    std::atomic<uint64_t> calls{0};
 };
 
-struct Metrics
+struct ThreadState
 {
-    scxt::Time::Timestamp mStamp;
-    unsigned mNumCalls;
+    std::atomic<uintptr_t> owner{0}; // address of the owning thread's tToken
+    Frame stack[Profiler::maxDepth];
+    int depth{0};
+    Bucket buckets[Profiler::maxIds];
+    std::atomic<uint64_t> dropped{0}, mismatched{0};
 };
 
-struct Prof
+std::atomic<uint64_t> gSerial{0};
+
+// the last profiler this thread used and its slot in it, so enter/exit don't search
+struct ThreadCache
 {
-    scxt::Time::Timestamp start;
-    scxt::Time::Timestamp subtract;
+    uint64_t serial{0};
+    ThreadState *state{nullptr};
 };
+thread_local ThreadCache tCache;
+thread_local char tToken;
+
+template <typename T> void relaxedAdd(std::atomic<T> &a, T v)
+{
+    // single writer, so a load and a store will do
+    a.store(a.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+}
+} // namespace
 
 struct InternalRep
 {
     explicit InternalRep(scxt::log::LoggingCallback *cb) : mLogger(cb) {}
     scxt::log::StreamLogger mLogger;
-    std::list<Prof> mProfList;
-    std::map<ProfID, Metrics, ProfIDComp> mProfTimes;
     bool logOutput{true};
+    uint64_t serial{++gSerial};
+    ThreadState threads[Profiler::maxThreads];
+    std::atomic<uint64_t> noSlot{0};
+
+    uint64_t startTicks{0};
+    std::chrono::steady_clock::time_point startTime;
+
+    ThreadState *thisThread()
+    {
+        if (tCache.serial == serial)
+            return tCache.state;
+
+        // find this thread's slot, or claim one on first use. lock free
+        auto me = (uintptr_t)&tToken;
+        ThreadState *ts = nullptr;
+        for (auto &t : threads)
+        {
+            if (t.owner.load(std::memory_order_relaxed) == me)
+            {
+                ts = &t;
+                break;
+            }
+        }
+        for (int i = 0; !ts && i < Profiler::maxThreads; i++)
+        {
+            uintptr_t expected = 0;
+            if (threads[i].owner.compare_exchange_strong(expected, me))
+                ts = &threads[i];
+        }
+        if (!ts)
+            noSlot++;
+        tCache.serial = serial;
+        tCache.state = ts;
+        return ts;
+    }
 };
 
 Profiler::Profiler(scxt::log::LoggingCallback *logger, const char *msg) : mData(0)
 {
     mData = (void *)new InternalRep(logger);
     InternalRep *rt = (InternalRep *)mData;
-
-#if WINDOWS
-    // set thread affinity for this thread so that our timers are always from core 1
-    gTASet++; // should be in tls, but for our purposes its fine
-    if (gTASet == 1)
-    {
-        gThreadAffinityOriginal = SetThreadAffinityMask(GetCurrentThread(), 1);
-    }
-
-#endif
+    rt->startTicks = scxt::Trace::now();
+    rt->startTime = std::chrono::steady_clock::now();
 
     if (msg)
         reset(msg);
@@ -91,13 +127,7 @@ Profiler::Profiler(scxt::log::LoggingCallback *logger, const char *msg) : mData(
 
 Profiler::~Profiler()
 {
-#if WINDOWS
-    gTASet--;
-    if (!gTASet)
-    {
-        SetThreadAffinityMask(GetCurrentThread(), gThreadAffinityOriginal);
-    }
-#endif
+    // a thread still caching this instance sees a different serial next time
     delete (InternalRep *)mData;
 }
 
@@ -113,92 +143,144 @@ void Profiler::reset(const char *msg)
 
     if (rt->logOutput)
         LOGDEBUG(rt->mLogger) << "Profiler reset " << msg << std::flush;
-    rt->mProfList.clear();
-    rt->mProfTimes.clear();
+
+    // the buckets stay claimed, a section running right now lands in the next dump
+    for (auto &t : rt->threads)
+    {
+        for (auto &b : t.buckets)
+        {
+            b.ticks.store(0, std::memory_order_relaxed);
+            b.calls.store(0, std::memory_order_relaxed);
+        }
+        t.dropped = 0;
+        t.mismatched = 0;
+    }
+    rt->noSlot = 0;
 }
 
 void Profiler::dump(const char *msg)
 {
     InternalRep *rt = (InternalRep *)mData;
-    int64_t calc;
-    if (rt->logOutput && rt->mLogger.setLevel(log::Level::Debug))
+    if (!(rt->logOutput && rt->mLogger.setLevel(log::Level::Debug)))
+        return;
+
+    // ticks to microseconds over the life of the profiler
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() -
+                                                          rt->startTime)
+                    .count();
+    uint64_t ticks = scxt::Trace::now() - rt->startTicks;
+    double usPerTick = ticks ? us / (double)ticks : 0.0;
+
+    struct Total
+    {
+        const char *name;
+        uint64_t ticks{0}, calls{0};
+    };
+    std::map<uint32_t, Total> totals;
+    uint64_t dropped = rt->noSlot, mismatched = 0;
+    for (auto &t : rt->threads)
     {
-        LOGDEBUG(rt->mLogger) << "Profiler dump '" << msg << "' (id/ms/calls)" << std::flush;
-        std::map<ProfID, Metrics, ProfIDComp>::iterator it;
-        for (it = rt->mProfTimes.begin(); it != rt->mProfTimes.end(); it++)
+        if (!t.owner)
+            continue;
+        for (auto &b : t.buckets)
         {
-            // cvt to milliseconds
-            calc = it->second.mStamp / 1000;
-            LOGDEBUG(rt->mLogger) << it->first.mID << "," << (int)calc << ","
-                                  << it->second.mNumCalls << std::flush;
+            auto h = b.hash.load(std::memory_order_acquire);
+            if (!h)
+                continue;
+            auto &tot = totals[h];
+            tot.name = b.name;
+            tot.ticks += b.ticks.load(std::memory_order_relaxed);
+            tot.calls += b.calls.load(std::memory_order_relaxed);
         }
+        dropped += t.dropped;
+        mismatched += t.mismatched;
+    }
+
+    LOGDEBUG(rt->mLogger) << "Profiler dump '" << msg << "' (id/ms/calls)" << std::flush;
+    for (auto &[h, tot] : totals)
+    {
+        if (!tot.calls)
+            continue;
+        auto ms = (int)(tot.ticks * usPerTick / 1000.0);
+        LOGDEBUG(rt->mLogger) << tot.name << "," << ms << "," << tot.calls << std::flush;
     }
+    if (dropped)
+        LOGDEBUG(rt->mLogger) << "Profiler dropped " << dropped
+                              << " sections (too many threads, ids or nested sections)"
+                              << std::flush;
+    if (mismatched)
+        LOGERROR(rt->mLogger) << "Inconsistent profile entry/exit count (" << mismatched << ")"
+                              << std::flush;
 }
 
 void Profiler::enter()
 {
     InternalRep *rt = (InternalRep *)mData;
-    Prof prof;
-    scxt::Time::getCurrentTimestamp(&prof.start);
-    prof.subtract = 0;
-    rt->mProfList.push_back(prof);
+    auto *ts = rt->thisThread();
+    if (!ts)
+        return;
+    // past maxDepth only the depth is tracked, so the exits still pair up
+    if (ts->depth < maxDepth)
+    {
+        auto &f = ts->stack[ts->depth];
+        f.start = scxt::Trace::now();
+        f.subtract = 0;
+    }
+    ts->depth++;
 }
 
-static void addTime(scxt::Time::Timestamp *target, scxt::Time::Timestamp *src) { *target += *src; }
-
-void Profiler::exit(const char *id)
+void Profiler::exit(const ProfileId &id)
 {
+    auto endtime = scxt::Trace::now();
     InternalRep *rt = (InternalRep *)mData;
-    std::map<ProfID, Metrics, ProfIDComp>::iterator it;
-    Prof prof;
-    scxt::Time::Timestamp endtime;
-    scxt::Time::Timestamp tot;
-    Metrics tot2;
-
-    scxt::Time::getCurrentTimestamp(&endtime);
-    if (!rt->mProfList.size())
+    auto *ts = rt->thisThread();
+    if (!ts)
+        return;
+
+    if (ts->depth <= 0)
     {
-        LOGERROR(rt->mLogger) << "Inconsistent profile entry/exit count for %s." << id
-                              << std::flush;
+        relaxedAdd<uint64_t>(ts->mismatched, 1);
         return;
     }
     // remove last item pushed
-    prof = rt->mProfList.back();
-    rt->mProfList.pop_back();
-    // determine it's time
-    scxt::Time::getTimestampDiff(&endtime, &prof.start, &tot);
-
-    if (rt->mProfList.size())
+    ts->depth--;
+    if (ts->depth >= maxDepth)
     {
-        // if there is a previous item, add the current items run time
-        // to the previous items subtract time - we don't want to include it in
-        // that item's time
-        Prof &profprev = rt->mProfList.back();
-        // this is added to the previous item's subtract time
-        addTime(&profprev.subtract, &tot);
+        relaxedAdd<uint64_t>(ts->dropped, 1);
+        return;
     }
+    auto &prof = ts->stack[ts->depth];
+    // determine its time
+    uint64_t tot = endtime - prof.start;
 
-    // for our current item, we will subtract any time that was registered
-    // when sub items ran
-    scxt::Time::getTimestampDiff(&tot, &prof.subtract, &tot2.mStamp);
+    // if there is a previous item, add the current items run time to the previous items
+    // subtract time - we don't want to include it in that item's time
+    if (ts->depth > 0)
+        ts->stack[ts->depth - 1].subtract += tot;
 
-    // and add that time to the big map
-    ProfID h(id);
+    // for our current item, we will subtract any time that was registered when sub items ran
+    uint64_t self = (tot > prof.subtract) ? tot - prof.subtract : 0;
 
-    it = rt->mProfTimes.find(h);
-    if (it == rt->mProfTimes.end())
+    // and add that time to the bucket for the id. open addressing, the owning thread is the
+    // only writer so claiming a bucket is a plain store
+    for (int i = 0; i < maxIds; i++)
     {
-        // not found
-        tot2.mNumCalls = 1; // initial value
-        // rt->mProfTimes.insert(std::make_pair<const ProfID, Metrics>(h, tot2));
-        rt->mProfTimes.insert(std::make_pair(h, tot2));
-    }
-    else
-    {
-        // found an entry for this id, so accumulate time and # of calls
-        addTime(&it->second.mStamp, &tot2.mStamp);
-        it->second.mNumCalls++;
+        auto &b = ts->buckets[(id.hash + i) & (maxIds - 1)];
+        auto h = b.hash.load(std::memory_order_relaxed);
+        if (h == 0)
+        {
+            b.name = id.name;
+            b.hash.store(id.hash, std::memory_order_release);
+        }
+        else if (h != id.hash)
+        {
+            continue;
+        }
+        relaxedAdd(b.ticks, self);
+        relaxedAdd<uint64_t>(b.calls, 1);
+        return;
     }
+    relaxedAdd<uint64_t>(ts->dropped, 1);
 }
 
-} // namespace scxt::Perf
\ No newline at end of file
+} // namespace scxt::Perf
@@ -23,21 +23,51 @@
  * same ID as is passed to the exit function. If other enter/exit pairs were pushed/popped
  * after the first enter call, their effective time is not counted in the effective time for
  * the first pair.
+ *
+ * enter() and exit() are realtime safe, so the profiler can be left on in the audio path.
+ * Each thread gets its own fixed size stack and buckets on first use (up to maxThreads), ids
+ * are hashes of the name, computed at compile time when a ProfileId is made constexpr from a
+ * literal, and times come from the TSC where there is one. Nothing allocates, locks or
+ * compares strings after construction. dump() and reset() gather the per thread buckets and
+ * belong on a non realtime thread. Names must outlive the profiler, string literals do.
  */
 
 #ifndef SHORTCIRCUIT_PROFILER_H
 #define SHORTCIRCUIT_PROFILER_H
 
 #include "logging.h"
+#include <cstddef>
+#include <cstdint>
 
 namespace scxt::Perf
 {
 
+struct ProfileId
+{
+    uint32_t hash;
+    const char *name;
+
+    template <size_t N> constexpr ProfileId(const char (&s)[N]) : hash(fnv1a(s)), name(s) {}
+    constexpr explicit ProfileId(const char *s) : hash(fnv1a(s)), name(s) {}
+
+    static constexpr uint32_t fnv1a(const char *s)
+    {
+        uint32_t h = 2166136261u;
+        while (*s)
+            h = (h ^ (uint8_t)*s++) * 16777619u;
+        return h ? h : 1; // 0 marks a free bucket
+    }
+};
+
 class Profiler
 {
     void *mData;
 
   public:
+    static constexpr int maxThreads = 16;
+    static constexpr int maxDepth = 32;
+    static constexpr int maxIds = 64; // per thread
+
     // implicit reset (msg is initial msg)
     Profiler(scxt::log::LoggingCallback *logger, const char *msg = 0);
 
@@ -54,8 +84,21 @@ class Profiler
     // enter a section of code to profile
     void enter();
 
-    // exit a section of code (id should not exceed max 255)
-    void exit(const char *id);
+    // exit a section of code. a literal converts to a ProfileId, for a runtime string
+    // use ProfileId(str) explicitly
+    void exit(const ProfileId &id);
+
+    // enter/exit around a scope
+    class Scope
+    {
+      public:
+        Scope(Profiler &p, const ProfileId &id) : mP(p), mId(id) { mP.enter(); }
+        ~Scope() { mP.exit(mId); }
+
+      private:
+        Profiler &mP;
+        ProfileId mId;
+    };
 };
 
 } // namespace scxt::Perf
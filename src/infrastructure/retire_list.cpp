@@ -0,0 +1,84 @@
+/*
+** Shortcircuit XT is Free and Open Source Software
+**
+** Shortcircuit is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html; The authors of the code
+** reserve the right to re-license their contributions under the MIT license in the
+** future at the discretion of the project maintainers.
+**
+** Copyright 2004-2022 by various individuals as described by the git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/shortcircuit-xt.git
+**
+** Shortcircuit was a commercial product from 2004-2018, with copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Shortcircuit
+** open source in December 2020.
+*/
+
+#include "retire_list.h"
+#include <cstdint>
+
+namespace scxt::Threading
+{
+
+RetireList::RetireList(size_t capacity)
+    : mSlots(new Slot[capacity ? capacity : 1]), mCapacity(capacity ? capacity : 1)
+{
+}
+
+RetireList::~RetireList() { reclaim(UINT64_MAX); }
+
+bool RetireList::retire(std::shared_ptr<void> p, uint64_t epoch)
+{
+    if (!p)
+        return true;
+
+    // start where the last producer left off so concurrent callers mostly probe different
+    // slots. a full scan is bounded by the capacity
+    size_t start = mNext.fetch_add(1, std::memory_order_relaxed);
+    for (size_t i = 0; i < mCapacity; i++)
+    {
+        Slot &s = mSlots[(start + i) % mCapacity];
+        int expected = slot_empty;
+        if (s.state.load(std::memory_order_relaxed) != slot_empty ||
+            !s.state.compare_exchange_strong(expected, slot_busy, std::memory_order_acquire))
+            continue;
+
+        s.object = std::move(p);
+        s.epoch = epoch;
+        mPending.fetch_add(1, std::memory_order_relaxed);
+        s.state.store(slot_full, std::memory_order_release);
+        return true;
+    }
+
+    mOverflows.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+size_t RetireList::reclaim(uint64_t before)
+{
+    size_t n = 0;
+    for (size_t i = 0; i < mCapacity; i++)
+    {
+        Slot &s = mSlots[i];
+        if (s.state.load(std::memory_order_acquire) != slot_full || s.epoch >= before)
+            continue;
+        int expected = slot_full;
+        if (!s.state.compare_exchange_strong(expected, slot_busy, std::memory_order_acquire))
+            continue;
+        if (s.epoch >= before)
+        {
+            // another reclaim emptied the slot and a producer refilled it since the check
+            s.state.store(slot_full, std::memory_order_release);
+            continue;
+        }
+
+        s.object.reset();
+        mPending.fetch_sub(1, std::memory_order_relaxed);
+        s.state.store(slot_empty, std::memory_order_release);
+        n++;
+    }
+    return n;
+}
+
+} // namespace scxt::Threading
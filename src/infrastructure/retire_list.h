@@ -0,0 +1,80 @@
+/*
+** Shortcircuit XT is Free and Open Source Software
+**
+** Shortcircuit is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html; The authors of the code
+** reserve the right to re-license their contributions under the MIT license in the
+** future at the discretion of the project maintainers.
+**
+** Copyright 2004-2022 by various individuals as described by the git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/shortcircuit-xt.git
+**
+** Shortcircuit was a commercial product from 2004-2018, with copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Shortcircuit
+** open source in December 2020.
+*/
+
+/*
+ * Holding area for objects the audio thread may still be reading (replaced samples, old zone
+ * indices), so they are destroyed later on a thread where freeing is fine.
+ *
+ * retire() is lock free and may be called from any number of threads at once, the audio thread
+ * included. It tags the object with an epoch, reclaim(e) destroys everything tagged below e.
+ * What an epoch means is up to the owner, the sampler counts completed audio blocks.
+ *
+ * Capacity is fixed at construction and nothing allocates afterwards. When every slot is taken
+ * retire() gives up, drops its reference in place and counts that in overflows().
+ */
+
+#ifndef SHORTCIRCUIT_RETIRE_LIST_H
+#define SHORTCIRCUIT_RETIRE_LIST_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace scxt::Threading
+{
+
+class RetireList
+{
+  public:
+    explicit RetireList(size_t capacity);
+    ~RetireList();
+
+    // false if the list was full and p was released in place
+    bool retire(std::shared_ptr<void> p, uint64_t epoch);
+
+    // destroys the objects retired with an epoch below 'before', returns how many
+    size_t reclaim(uint64_t before);
+
+    size_t pending() const { return mPending.load(std::memory_order_relaxed); }
+    uint32_t overflows() const { return mOverflows.load(std::memory_order_relaxed); }
+
+  private:
+    enum SlotState
+    {
+        slot_empty = 0,
+        slot_busy, // being filled or emptied
+        slot_full,
+    };
+
+    struct alignas(64) Slot
+    {
+        std::atomic<int> state{slot_empty};
+        std::shared_ptr<void> object;
+        uint64_t epoch{0};
+    };
+
+    std::unique_ptr<Slot[]> mSlots;
+    size_t mCapacity;
+    std::atomic<size_t> mNext{0};
+    std::atomic<size_t> mPending{0};
+    std::atomic<uint32_t> mOverflows{0};
+};
+
+} // namespace scxt::Threading
+
+#endif // SHORTCIRCUIT_RETIRE_LIST_H
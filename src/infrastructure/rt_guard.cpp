@@ -0,0 +1,159 @@
+/*
+** Shortcircuit XT is Free and Open Source Software
+**
+** Shortcircuit is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html; The authors of the code
+** reserve the right to re-license their contributions under the MIT license in the
+** future at the discretion of the project maintainers.
+**
+** Copyright 2004-2022 by various individuals as described by the git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/shortcircuit-xt.git
+**
+** Shortcircuit was a commercial product from 2004-2018, with copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Shortcircuit
+** open source in December 2020.
+*/
+
+#include "rt_guard.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__GLIBC__) || defined(__APPLE__)
+#include <execinfo.h>
+#include <unistd.h>
+#define SCXT_RT_GUARD_BACKTRACE 1
+#endif
+
+namespace scxt::Realtime
+{
+
+namespace
+{
+std::atomic<int> gMode{(int)Mode::Report};
+std::atomic<uint64_t> gAllocs{0}, gFrees{0}, gLocks{0};
+
+// plain ints with constant initialisers, so reading them from inside malloc needs no tls setup
+thread_local int tRealtime = 0;
+thread_local int tAllowed = 0;
+thread_local int tInGuard = 0;
+
+// call sites already reported. open addressing, never shrinks; when it fills up sites just
+// stop being reported
+constexpr int seenSize = 1024;
+std::atomic<uintptr_t> gSeen[seenSize];
+
+bool firstSighting(uintptr_t site)
+{
+    uint32_t h = (uint32_t)((site >> 4) * 0x9E3779B1u);
+    for (int probe = 0; probe < 32; probe++)
+    {
+        auto &slot = gSeen[(h + probe) & (seenSize - 1)];
+        uintptr_t expected = 0;
+        if (slot.compare_exchange_strong(expected, site))
+            return true;
+        if (expected == site)
+            return false;
+    }
+    return false;
+}
+
+#if SCXT_RT_GUARD_BACKTRACE
+void writeStr(const char *s) { (void)!::write(2, s, strlen(s)); }
+#endif
+
+void violation(std::atomic<uint64_t> &counter, const char *what)
+{
+    counter.fetch_add(1, std::memory_order_relaxed);
+    auto mode = (Mode)gMode.load(std::memory_order_relaxed);
+    if (mode == Mode::Count)
+        return;
+
+#if SCXT_RT_GUARD_BACKTRACE
+    void *frames[32];
+    int n = backtrace(frames, 32);
+    // frames 0-2 are violation(), note*() and the interposer. key the site on the next few
+    // so an allocation through operator new or std::vector isn't folded into one report
+    uintptr_t site = 0;
+    for (int i = 3; i < n && i < 8; i++)
+        site = (site * 31) ^ (uintptr_t)frames[i];
+    if (firstSighting(site | 1))
+    {
+        writeStr("scxt realtime guard: ");
+        writeStr(what);
+        writeStr(" on the audio thread\n");
+        if (n > 3)
+            backtrace_symbols_fd(frames + 3, n - 3, 2);
+    }
+#endif
+
+    if (mode == Mode::Abort)
+        abort();
+}
+
+inline bool guarded() { return (tRealtime > 0) && (tAllowed == 0) && (tInGuard == 0); }
+} // namespace
+
+void setMode(Mode m)
+{
+#if SCXT_RT_GUARD_BACKTRACE
+    // the first backtrace() loads the unwinder, which allocates. get that out of the way
+    void *f[2];
+    backtrace(f, 2);
+#endif
+    gMode.store((int)m);
+}
+
+Violations violations()
+{
+    Violations v;
+    v.allocs = gAllocs.load();
+    v.frees = gFrees.load();
+    v.locks = gLocks.load();
+    return v;
+}
+
+void resetViolations()
+{
+    gAllocs = 0;
+    gFrees = 0;
+    gLocks = 0;
+}
+
+bool threadIsRealtime() { return guarded(); }
+
+void noteAllocation()
+{
+    if (!guarded())
+        return;
+    tInGuard++;
+    violation(gAllocs, "allocation");
+    tInGuard--;
+}
+
+void noteFree()
+{
+    if (!guarded())
+        return;
+    tInGuard++;
+    violation(gFrees, "free");
+    tInGuard--;
+}
+
+void noteLock()
+{
+    if (!guarded())
+        return;
+    tInGuard++;
+    violation(gLocks, "mutex lock");
+    tInGuard--;
+}
+
+void enterRealtime() { tRealtime++; }
+void exitRealtime() { tRealtime--; }
+void enterAllowed() { tAllowed++; }
+void exitAllowed() { tAllowed--; }
+
+} // namespace scxt::Realtime
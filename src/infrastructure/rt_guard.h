@@ -0,0 +1,114 @@
+/*
+** Shortcircuit XT is Free and Open Source Software
+**
+** Shortcircuit is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html; The authors of the code
+** reserve the right to re-license their contributions under the MIT license in the
+** future at the discretion of the project maintainers.
+**
+** Copyright 2004-2022 by various individuals as described by the git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/shortcircuit-xt.git
+**
+** Shortcircuit was a commercial product from 2004-2018, with copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Shortcircuit
+** open source in December 2020.
+*/
+
+/*
+ * Realtime guard: finds heap and lock use on the audio thread(s).
+ *
+ * Threads doing audio work mark themselves with a Realtime::Scope (sampler::process_audio, the
+ * voice render workers, the plugin process callback). When the engine is built with
+ * SCXT_RT_GUARD, malloc/free and pthread_mutex_lock calls made while a thread is marked are
+ * counted and, depending on the mode, reported with a backtrace (once per call site) or
+ * abort the process.
+ *
+ * The interposers themselves live in rt_guard_hooks.cpp, which is only compiled into
+ * executables (sc3-test, sc3-headless) since replacing malloc from a plugin would reach into
+ * the host. Without SCXT_RT_GUARD the scopes compile to nothing. Malloc interception needs
+ * glibc, elsewhere only operator new/delete are seen and locks are not.
+ */
+
+#ifndef SHORTCIRCUIT_RT_GUARD_H
+#define SHORTCIRCUIT_RT_GUARD_H
+
+#include <cstdint>
+
+namespace scxt::Realtime
+{
+
+enum class Mode
+{
+    Count,  // just count violations
+    Report, // count, and print a backtrace to stderr the first time a call site is seen
+    Abort   // report and abort
+};
+
+struct Violations
+{
+    uint64_t allocs{0}, frees{0}, locks{0};
+    uint64_t total() const { return allocs + frees + locks; }
+};
+
+// true if this build counts violations at all
+constexpr bool guardCompiledIn()
+{
+#if SCXT_RT_GUARD
+    return true;
+#else
+    return false;
+#endif
+}
+
+void setMode(Mode m);
+Violations violations();
+void resetViolations();
+
+// called by the interposers
+bool threadIsRealtime();
+void noteAllocation();
+void noteFree();
+void noteLock();
+
+void enterRealtime();
+void exitRealtime();
+void enterAllowed();
+void exitAllowed();
+
+#if SCXT_RT_GUARD
+// marks the current thread as doing realtime work for its lifetime, nests
+class Scope
+{
+  public:
+    Scope() { enterRealtime(); }
+    ~Scope() { exitRealtime(); }
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+};
+
+// lifts the guard for a known, accepted violation inside a realtime scope
+class AllowScope
+{
+  public:
+    AllowScope() { enterAllowed(); }
+    ~AllowScope() { exitAllowed(); }
+    AllowScope(const AllowScope &) = delete;
+    AllowScope &operator=(const AllowScope &) = delete;
+};
+#else
+class Scope
+{
+  public:
+    Scope() {}
+};
+class AllowScope
+{
+  public:
+    AllowScope() {}
+};
+#endif
+
+} // namespace scxt::Realtime
+
+#endif // SHORTCIRCUIT_RT_GUARD_H
@@ -0,0 +1,140 @@
+/*
+** Shortcircuit XT is Free and Open Source Software
+**
+** Shortcircuit is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html; The authors of the code
+** reserve the right to re-license their contributions under the MIT license in the
+** future at the discretion of the project maintainers.
+**
+** Copyright 2004-2022 by various individuals as described by the git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/shortcircuit-xt.git
+**
+** Shortcircuit was a commercial product from 2004-2018, with copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Shortcircuit
+** open source in December 2020.
+*/
+
+/*
+ * Interposers for the realtime guard, see rt_guard.h. Only link this into executables, and
+ * only when SCXT_RT_GUARD is on.
+ */
+
+#include "rt_guard.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#if defined(__GLIBC__)
+
+#include <dlfcn.h>
+#include <pthread.h>
+
+extern "C"
+{
+    void *__libc_malloc(size_t);
+    void *__libc_calloc(size_t, size_t);
+    void *__libc_realloc(void *, size_t);
+    void *__libc_memalign(size_t, size_t);
+    void __libc_free(void *);
+
+    void *malloc(size_t n)
+    {
+        scxt::Realtime::noteAllocation();
+        return __libc_malloc(n);
+    }
+
+    void *calloc(size_t n, size_t s)
+    {
+        scxt::Realtime::noteAllocation();
+        return __libc_calloc(n, s);
+    }
+
+    void *realloc(void *p, size_t n)
+    {
+        scxt::Realtime::noteAllocation();
+        return __libc_realloc(p, n);
+    }
+
+    void *memalign(size_t a, size_t n)
+    {
+        scxt::Realtime::noteAllocation();
+        return __libc_memalign(a, n);
+    }
+
+    void *aligned_alloc(size_t a, size_t n)
+    {
+        scxt::Realtime::noteAllocation();
+        return __libc_memalign(a, n);
+    }
+
+    int posix_memalign(void **p, size_t a, size_t n)
+    {
+        scxt::Realtime::noteAllocation();
+        *p = __libc_memalign(a, n);
+        return *p ? 0 : ENOMEM;
+    }
+
+    void free(void *p)
+    {
+        if (p)
+            scxt::Realtime::noteFree();
+        __libc_free(p);
+    }
+
+    int pthread_mutex_lock(pthread_mutex_t *m)
+    {
+        // no function static here, its init guard could end up back in here
+        typedef int (*lock_fn)(pthread_mutex_t *);
+        static std::atomic<lock_fn> real{nullptr};
+        auto fn = real.load(std::memory_order_relaxed);
+        if (!fn)
+        {
+            fn = (lock_fn)dlsym(RTLD_NEXT, "pthread_mutex_lock");
+            real.store(fn, std::memory_order_relaxed);
+        }
+        scxt::Realtime::noteLock();
+        return fn(m);
+    }
+}
+
+#else
+
+// no malloc interposition here, catch what goes through the C++ allocator at least
+void *operator new(size_t n)
+{
+    scxt::Realtime::noteAllocation();
+    if (auto p = std::malloc(n ? n : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t n)
+{
+    scxt::Realtime::noteAllocation();
+    if (auto p = std::malloc(n ? n : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    if (p)
+        scxt::Realtime::noteFree();
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    if (p)
+        scxt::Realtime::noteFree();
+    std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept { operator delete(p); }
+void operator delete[](void *p, size_t) noexcept { operator delete[](p); }
+
+#endif
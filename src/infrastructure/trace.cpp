@@ -0,0 +1,228 @@
+/*
+** Shortcircuit XT is Free and Open Source Software
+**
+** Shortcircuit is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html; The authors of the code
+** reserve the right to re-license their contributions under the MIT license in the
+** future at the discretion of the project maintainers.
+**
+** Copyright 2004-2022 by various individuals as described by the git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/shortcircuit-xt.git
+**
+** Shortcircuit was a commercial product from 2004-2018, with copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Shortcircuit
+** open source in December 2020.
+*/
+
+#include "trace.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <memory>
+
+namespace scxt::Trace
+{
+
+namespace
+{
+struct Ring
+{
+    std::unique_ptr<Event[]> events;
+    std::atomic<uint64_t> head{0};
+    std::atomic<bool> owned{false};
+};
+
+Ring gRings[maxThreads];
+uint64_t gMask{0};
+std::atomic<uint64_t> gDropped{0};
+
+// a thread holds its ring until it exits, then the next thread to trace takes it over
+struct RingOwner
+{
+    int ring{-1};
+    ~RingOwner()
+    {
+        if (ring >= 0)
+            gRings[ring].owned.store(false, std::memory_order_release);
+    }
+    bool claim()
+    {
+        for (int i = 0; i < maxThreads; i++)
+        {
+            bool expected = false;
+            if (!gRings[i].owned.load(std::memory_order_relaxed) &&
+                gRings[i].owned.compare_exchange_strong(expected, true, std::memory_order_acquire))
+            {
+                ring = i;
+                return true;
+            }
+        }
+        return false;
+    }
+};
+thread_local RingOwner tOwner;
+
+struct Calibration
+{
+    uint64_t ticks;
+    std::chrono::steady_clock::time_point time;
+    static Calibration take() { return {now(), std::chrono::steady_clock::now()}; }
+};
+Calibration gStart, gStop;
+bool gStopped{true};
+
+const char *stageNames[(int)Stage::numStages] = {
+    "engine.block",
+    "engine.render_voices",
+    "engine.envelope_bank",
+    "voice",
+    "voice.filter_setup",
+    "voice.envelopes",
+    "voice.lfos",
+    "voice.modmatrix",
+    "voice.targets",
+    "voice.pitch",
+    "voice.generator",
+    "voice.oversampling",
+    "voice.filters",
+    "voice.mix",
+    "part",
+    "part.modmatrix",
+    "part.filters",
+    "part.mix",
+    "effect",
+};
+} // namespace
+
+std::atomic<bool> detail::gEnabled{false};
+
+const char *stageName(Stage s)
+{
+    return ((int)s < (int)Stage::numStages) ? stageNames[(int)s] : "unknown";
+}
+
+void detail::push(Stage s, uint16_t id, uint64_t start, uint64_t end)
+{
+    auto &owner = tOwner;
+    if (owner.ring < 0 && !owner.claim())
+    {
+        // more threads tracing at once than there are rings
+        gDropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    auto &r = gRings[owner.ring];
+    auto h = r.head.load(std::memory_order_relaxed);
+    auto &e = r.events[h & gMask];
+    e.start = start;
+    e.end = end;
+    e.stage = s;
+    e.id = id;
+    r.head.store(h + 1, std::memory_order_release);
+}
+
+void start(int eventsPerThread)
+{
+    if (!gRings[0].events)
+    {
+        uint64_t n = 1;
+        while (n < (uint64_t)eventsPerThread)
+            n <<= 1;
+        for (auto &r : gRings)
+            r.events = std::make_unique<Event[]>(n);
+        gMask = n - 1;
+    }
+    for (auto &r : gRings)
+        r.head.store(0);
+    gDropped.store(0);
+    gStart = Calibration::take();
+    gStopped = false;
+    detail::gEnabled.store(true);
+}
+
+void stop()
+{
+    detail::gEnabled.store(false);
+    gStop = Calibration::take();
+    gStopped = true;
+}
+
+namespace
+{
+double microsPerTick()
+{
+    auto end = gStopped ? gStop : Calibration::take();
+    double ns = std::chrono::duration<double, std::nano>(end.time - gStart.time).count();
+    return (end.ticks > gStart.ticks) ? (ns * 1e-3) / (end.ticks - gStart.ticks) : 0;
+}
+} // namespace
+
+bool writeChromeTrace(std::ostream &os)
+{
+    double usPerTick = microsPerTick();
+
+    auto us = [&](uint64_t t) { return (double)(int64_t)(t - gStart.ticks) * usPerTick; };
+
+    os << "{\"displayTimeUnit\":\"ns\",\"otherData\":{\"droppedEvents\":" << dropped()
+       << "},\"traceEvents\":[";
+    bool first = true;
+    auto sep = [&]() {
+        if (!first)
+            os << ",";
+        first = false;
+        os << "\n";
+    };
+
+    os << std::fixed << std::setprecision(3);
+    for (int t = 0; t < maxThreads; t++)
+    {
+        auto &r = gRings[t];
+        if (!r.events || r.head.load(std::memory_order_acquire) == 0)
+            continue;
+
+        sep();
+        os << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << t
+           << ",\"args\":{\"name\":\"audio " << t << "\"}}";
+
+        uint64_t head = r.head.load(std::memory_order_acquire);
+        uint64_t from = (head > gMask + 1) ? head - (gMask + 1) : 0;
+        for (uint64_t i = from; i < head; i++)
+        {
+            auto &e = r.events[i & gMask];
+            sep();
+            os << "{\"name\":\"" << stageName(e.stage) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << t
+               << ",\"ts\":" << us(e.start) << ",\"dur\":" << us(e.end) - us(e.start)
+               << ",\"args\":{\"id\":" << e.id << "}}";
+        }
+    }
+    os << "\n]}\n";
+    return os.good();
+}
+
+uint64_t dropped() { return gDropped.load(std::memory_order_relaxed); }
+
+uint64_t stageTotals(double *seconds)
+{
+    double sPerTick = microsPerTick() * 1e-6;
+    for (int s = 0; s < (int)Stage::numStages; s++)
+        seconds[s] = 0;
+
+    for (int t = 0; t < maxThreads; t++)
+    {
+        auto &r = gRings[t];
+        if (!r.events)
+            continue;
+        uint64_t head = r.head.load(std::memory_order_acquire);
+        uint64_t from = (head > gMask + 1) ? head - (gMask + 1) : 0;
+        for (uint64_t i = from; i < head; i++)
+        {
+            auto &e = r.events[i & gMask];
+            if ((int)e.stage < (int)Stage::numStages)
+                seconds[(int)e.stage] += (double)(e.end - e.start) * sPerTick;
+        }
+    }
+    return dropped();
+}
+
+} // namespace scxt::Trace
@@ -0,0 +1,175 @@
+/*
+** Shortcircuit XT is Free and Open Source Software
+**
+** Shortcircuit is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html; The authors of the code
+** reserve the right to re-license their contributions under the MIT license in the
+** future at the discretion of the project maintainers.
+**
+** Copyright 2004-2022 by various individuals as described by the git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/shortcircuit-xt.git
+**
+** Shortcircuit was a commercial product from 2004-2018, with copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Shortcircuit
+** open source in December 2020.
+*/
+
+/*
+ * Stage trace for the audio path. Each thread doing audio work writes (stage, id, start, end)
+ * records into its own fixed size ring, with no locks and no allocation, so where a heavy
+ * patch spends its time can be seen per voice, part and effect without an external profiler.
+ *
+ * Tracing is compiled in and off by default; a disabled Span or Laps costs one relaxed load.
+ * start() allocates the rings (once) and switches it on, stop() switches it off again and
+ * writeChromeTrace() exports what the rings still hold as Chrome trace JSON, which loads in
+ * chrome://tracing and ui.perfetto.dev. Rings keep the newest events when they wrap.
+ *
+ * A thread takes a ring on its first event and gives it back when it exits, so threads that
+ * come and go (a WorkerPool per sampler) reuse them. Events from threads beyond maxThreads
+ * running at once are dropped and counted.
+ *
+ * Timestamps are TSC ticks where available and steady_clock otherwise, converted to time
+ * using the start()/stop() interval.
+ */
+
+#ifndef SHORTCIRCUIT_TRACE_H
+#define SHORTCIRCUIT_TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define SCXT_TRACE_TSC 1
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define SCXT_TRACE_TSC 1
+#endif
+
+namespace scxt::Trace
+{
+
+enum class Stage : uint16_t
+{
+    EngineBlock,
+    RenderVoices,
+    EnvelopeBank,
+
+    Voice,
+    VoiceFilterSetup,
+    VoiceEnvelopes,
+    VoiceLFOs,
+    VoiceModMatrix,
+    VoiceTargets,
+    VoicePitch,
+    VoiceGenerator,
+    VoiceOversampling,
+    VoiceFilters,
+    VoiceMix,
+
+    Part,
+    PartModMatrix,
+    PartFilters,
+    PartMix,
+
+    Effect,
+
+    numStages
+};
+
+const char *stageName(Stage s);
+
+struct Event
+{
+    uint64_t start, end;
+    Stage stage;
+    uint16_t id; // voice, part or effect slot
+};
+
+// up to this many threads at once get a ring, events from any others are dropped
+static constexpr int maxThreads = 16;
+
+// not realtime safe, call from a control thread. the capacity only applies to the first call
+void start(int eventsPerThread = 1 << 15);
+void stop();
+// the dropped count goes in otherData.droppedEvents
+bool writeChromeTrace(std::ostream &os);
+// the time the events the rings still hold spent in each stage, seconds[numStages]. returns
+// dropped()
+uint64_t stageTotals(double *seconds);
+// events since start() that found no free ring
+uint64_t dropped();
+
+namespace detail
+{
+extern std::atomic<bool> gEnabled;
+void push(Stage s, uint16_t id, uint64_t start, uint64_t end);
+} // namespace detail
+
+inline bool enabled() { return detail::gEnabled.load(std::memory_order_relaxed); }
+
+inline uint64_t now()
+{
+#if SCXT_TRACE_TSC
+    return __rdtsc();
+#else
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+}
+
+// one event covering the enclosing scope
+class Span
+{
+  public:
+    Span(Stage s, int id) : mOn(enabled()), mStage(s), mId((uint16_t)id)
+    {
+        if (mOn)
+            mStart = now();
+    }
+    ~Span()
+    {
+        if (mOn)
+            detail::push(mStage, mId, mStart, now());
+    }
+    Span(const Span &) = delete;
+    Span &operator=(const Span &) = delete;
+
+  private:
+    bool mOn;
+    Stage mStage;
+    uint16_t mId;
+    uint64_t mStart{0};
+};
+
+// back to back stages of straight line code, mark(s) closes stage s at the current time
+class Laps
+{
+  public:
+    explicit Laps(int id) : mOn(enabled()), mId((uint16_t)id)
+    {
+        if (mOn)
+            mLast = now();
+    }
+    void mark(Stage s)
+    {
+        if (!mOn)
+            return;
+        auto t = now();
+        detail::push(s, mId, mLast, t);
+        mLast = t;
+    }
+
+  private:
+    bool mOn;
+    uint16_t mId;
+    uint64_t mLast{0};
+};
+
+} // namespace scxt::Trace
+
+#endif // SHORTCIRCUIT_TRACE_H
@@ -0,0 +1,148 @@
+/*
+** Shortcircuit XT is Free and Open Source Software
+**
+** Shortcircuit is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html; The authors of the code
+** reserve the right to re-license their contributions under the MIT license in the
+** future at the discretion of the project maintainers.
+**
+** Copyright 2004-2022 by various individuals as described by the git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/shortcircuit-xt.git
+**
+** Shortcircuit was a commercial product from 2004-2018, with copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Shortcircuit
+** open source in December 2020.
+*/
+
+#include "worker_pool.h"
+
+namespace scxt::Threading
+{
+
+// how often an idle worker looks at the run counter before it goes to sleep, a few
+// microseconds on current machines
+static constexpr int spin_checks = 4096;
+
+WorkerPool::WorkerPool(int workers)
+    : mRanges(workers < 1 ? 1 : workers), mSleepers(workers < 1 ? 1 : workers)
+{
+    for (int i = 1; i < size(); i++)
+        mThreads.emplace_back([this, i]() { threadMain(i); });
+}
+
+WorkerPool::~WorkerPool()
+{
+    mQuit.store(true);
+    wakeSleepers();
+    for (auto &t : mThreads)
+        t.join();
+}
+
+void WorkerPool::wakeSleepers()
+{
+    // a worker sets asleep before its last look at the counter, so either it sees the new
+    // value or it is asleep (or about to be) and gets its signal here
+    for (int w = 1; w < size(); w++)
+        if (mSleepers[w].asleep.exchange(false))
+            mSleepers[w].wake.signal();
+}
+
+void WorkerPool::run(int n_items, WorkFn fn, void *ctx)
+{
+    if (n_items <= 0)
+        return;
+
+    int n = size();
+    if (n == 1 || n_items == 1)
+    {
+        for (int i = 0; i < n_items; i++)
+            fn(ctx, i, 0);
+        return;
+    }
+
+    // the previous run is closed, so workers can only still be on their way out of it. once
+    // they are, nobody reads the ranges and they can be reset
+    while (mBusy.load() > 0)
+        ;
+
+    mFn = fn;
+    mCtx = ctx;
+    for (int w = 0; w < n; w++)
+    {
+        mRanges[w].next.store(n_items * w / n, std::memory_order_relaxed);
+        mRanges[w].end = n_items * (w + 1) / n;
+    }
+    mPending.store(n_items, std::memory_order_relaxed);
+    uint64_t open = mGeneration.load(std::memory_order_relaxed) + 1;
+    mGeneration.store(open);
+    wakeSleepers();
+
+    work(0);
+
+    // the stragglers are finishing their last item, which can't take long
+    while (mPending.load(std::memory_order_acquire) > 0)
+        ;
+    mGeneration.store(open + 1);
+}
+
+void WorkerPool::work(int worker)
+{
+    int n = size();
+    for (int k = 0; k < n; k++)
+    {
+        // own range first, then steal round-robin from the others
+        Range &r = mRanges[(worker + k) % n];
+        while (true)
+        {
+            int i = r.next.fetch_add(1, std::memory_order_relaxed);
+            if (i >= r.end)
+                break;
+            mFn(mCtx, i, worker);
+            mPending.fetch_sub(1, std::memory_order_acq_rel);
+        }
+    }
+}
+
+void WorkerPool::threadMain(int worker)
+{
+    Sleeper &me = mSleepers[worker];
+    uint64_t seen = 0;
+    auto has_news = [&]() {
+        uint64_t g = mGeneration.load();
+        return mQuit.load() || ((g & 1) && (g != seen));
+    };
+
+    while (true)
+    {
+        int spins = 0;
+        while (!has_news())
+        {
+            if (++spins < spin_checks)
+                continue;
+            me.asleep.store(true);
+            if (has_news())
+            {
+                // if run() got to the flag first, its signal is on the way and has to be taken
+                if (!me.asleep.exchange(false))
+                    me.wake.wait();
+                break;
+            }
+            me.wake.wait();
+            spins = 0;
+        }
+        if (mQuit.load())
+            return;
+
+        // join the run only if it is still open once counted in mBusy. run() closes it
+        // before it waits for mBusy to drop, so it can't reset the ranges under this worker
+        uint64_t g = mGeneration.load();
+        mBusy.fetch_add(1);
+        if (mGeneration.load() == g && (g & 1))
+            work(worker);
+        mBusy.fetch_sub(1, std::memory_order_release);
+        seen = g;
+    }
+}
+
+} // namespace scxt::Threading
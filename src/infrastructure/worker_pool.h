@@ -0,0 +1,89 @@
+/*
+** Shortcircuit XT is Free and Open Source Software
+**
+** Shortcircuit is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html; The authors of the code
+** reserve the right to re-license their contributions under the MIT license in the
+** future at the discretion of the project maintainers.
+**
+** Copyright 2004-2022 by various individuals as described by the git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/shortcircuit-xt.git
+**
+** Shortcircuit was a commercial product from 2004-2018, with copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Shortcircuit
+** open source in December 2020.
+*/
+
+/*
+ * Fixed pool of worker threads for splitting per-block work (voice rendering) over cores.
+ *
+ * run() hands out n items, the calling thread takes part as worker 0 and returns once every
+ * item is done. The items are split into one contiguous range per worker. A worker takes
+ * items from the front of its own range and, once that is empty, steals from the ranges of
+ * the others, so one expensive item doesn't leave the rest of the pool idle.
+ *
+ * Nothing allocates or locks after construction. Idle workers spin on the run counter for a
+ * moment, as the next block usually follows soon, and then sleep on a semaphore of their own
+ * which run() only signals if they are actually asleep. Callers must make sure items don't
+ * touch shared state, as there is no ordering between them.
+ */
+
+#ifndef SHORTCIRCUIT_WORKER_POOL_H
+#define SHORTCIRCUIT_WORKER_POOL_H
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include <atomicops.h>
+
+namespace scxt::Threading
+{
+
+class WorkerPool
+{
+  public:
+    typedef void (*WorkFn)(void *ctx, int item, int worker);
+
+    // total number of workers, including the thread calling run()
+    explicit WorkerPool(int workers);
+    ~WorkerPool();
+
+    int size() const { return (int)mRanges.size(); }
+
+    void run(int n_items, WorkFn fn, void *ctx);
+
+  private:
+    struct alignas(64) Range
+    {
+        std::atomic<int> next{0};
+        int end{0};
+    };
+    struct alignas(64) Sleeper
+    {
+        std::atomic<bool> asleep{false};
+        moodycamel::spsc_sema::LightweightSemaphore wake;
+    };
+
+    void threadMain(int worker);
+    void work(int worker);
+    void wakeSleepers();
+
+    std::vector<Range> mRanges;
+    std::vector<Sleeper> mSleepers;
+    std::vector<std::thread> mThreads;
+
+    WorkFn mFn{nullptr};
+    void *mCtx{nullptr};
+    std::atomic<int> mPending{0};
+    std::atomic<int> mBusy{0};
+
+    // odd while a run is open for the workers to join, even between runs
+    std::atomic<uint64_t> mGeneration{0};
+    std::atomic<bool> mQuit{false};
+};
+
+} // namespace scxt::Threading
+
+#endif // SHORTCIRCUIT_WORKER_POOL_H
@@ -40,6 +40,10 @@ enum InteractionId
     ip_config_refresh_db,
     ip_config_autopreview,
     ip_config_previewvolume,
+    ip_config_interpolation,
+    ip_config_draft,
+    ip_config_mipmaps,
+    ip_config_resample,
     ip_sample_prevnext,
     ip_patch_prevnext,
     ip_replace_sample,
@@ -49,6 +53,7 @@ enum InteractionId
     ip_select_layer,
     ip_select_all,
     ip_polyphony,
+    ip_dspload,
     ip_vumeter,
     n_ip_free_items = ip_vumeter,
     ip_zone_name,
@@ -112,6 +117,7 @@ enum InteractionId
     ip_nc_low,
     ip_nc_high,
     ip_ignore_part_polymode,
+    ip_zone_interpolation,
     // ip_polymode,
     // ip_portamento,
     // ip_portamento_mode,
@@ -496,6 +502,38 @@ static const interactiondata ip_data[] = {
         "conf preview volume",
         ip_range_and_units::fromDatamodeString("f,-96.0,0.100,0.0,0,dB"),
     },
+    {
+        ip_config_interpolation,
+        ipvt_int,
+        0,
+        1,
+        0,
+        "conf interpolation",
+    },
+    {
+        ip_config_draft,
+        ipvt_int,
+        0,
+        1,
+        0,
+        "conf draft on overload",
+    },
+    {
+        ip_config_mipmaps,
+        ipvt_int,
+        0,
+        1,
+        0,
+        "conf mip maps",
+    },
+    {
+        ip_config_resample,
+        ipvt_int,
+        0,
+        1,
+        0,
+        "conf resample on load",
+    },
     {
         ip_sample_prevnext,
         ipvt_int,
@@ -568,6 +606,14 @@ static const interactiondata ip_data[] = {
         0,
         "polyphony",
     },
+    {
+        ip_dspload,
+        ipvt_int,
+        0,
+        1,
+        0,
+        "DSP load",
+    },
     {
         ip_vumeter,
         ipvt_int,
@@ -1062,6 +1108,14 @@ static const interactiondata ip_data[] = {
         0,
         "ignore playmode",
     },
+    {
+        ip_zone_interpolation,
+        ipvt_int,
+        (int)offsetof(sample_zone, interpolation),
+        1,
+        0,
+        "interpolation",
+    },
     {
         ip_mute,
         ipvt_int,
@@ -418,6 +418,7 @@ bool sampler::load_akai_s6k_program(const fs::path &filename, char channel, bool
                                   20);
                     zones[newzone].transpose =
                         s6k_kloc[k].semitone_tune + s6k_zone[k][z].semitone_tune;
+                    invalidate_zone_index();
                 }
             }
         }
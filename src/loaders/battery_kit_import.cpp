@@ -156,6 +156,7 @@ bool sampler::load_battery_kit(const fs::path &fileName, char channel, bool repl
                     zones[newzone].mm[0].destination = 0;
                     zones[newzone].mm[0].strength = 0;
                 }
+                invalidate_zone_index();
             }
             samplefile = (TiXmlElement *)samplefile->NextSibling("Sample");
         }
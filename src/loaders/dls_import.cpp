@@ -370,6 +370,7 @@ bool sampler::parse_dls_preset(void *data, size_t filesize, char channel, int pa
                                 }
                             }
                         }
+                        invalidate_zone_index();
                     }
                 }
                 mf.SeekI(nextewl);
@@ -391,6 +392,7 @@ bool sampler::parse_dls_preset(void *data, size_t filesize, char channel, int pa
                 z->velocity_high = rgnh.RangeVelocity.usHigh;
                 z->mute_group = rgnh.usKeyGroup;
                 z->key_root = wsmp.usUnityNote;
+                invalidate_zone_index();
             }
         }
         mf.SeekI(next);
@@ -312,6 +312,10 @@ void sampler::recall_zone_from_element(TiXmlElement &element, sample_zone *zone,
     zone->mute_group = i;
     element.Attribute("ignore_polymode", &i);
     zone->ignore_part_polymode = i;
+    if (element.QueryIntAttribute("interpolation", &i) == TIXML_SUCCESS)
+        zone->interpolation = std::min(std::max(i, 0), (int)n_zone_interpolations - 1);
+    else
+        zone->interpolation = zi_default;
     //	element.Attribute("polymode",&i);		zone->polymode = i;
     //	element.Attribute("portamode",&i);		zone->portamento_mode = i;
     //	if (element.QueryDoubleAttribute("portamento",&d) == TIXML_SUCCESS) zone->portamento =
@@ -647,6 +651,7 @@ void sampler::store_zone_as_element(TiXmlElement &element, sample_zone *zone, co
     element.SetAttribute("PB_depth", zone->pitch_bend_depth);
     element.SetAttribute("mute_group", zone->mute_group);
     element.SetAttribute("ignore_polymode", zone->ignore_part_polymode);
+    element.SetAttribute("interpolation", zone->interpolation);
     // element.SetAttribute("polymode",zone->polymode);
     // element.SetAttribute("portamode",zone->portamento_mode);
     // element.SetAttribute("portamento",float_to_str(zone->portamento,tempstr));
@@ -1342,12 +1347,14 @@ bool sampler::load_all_from_xml(const void *data, int datasize, const fs::path &
                     }
                 }
                 update_zone_switches(zone_id);
+                invalidate_zone_index();
             }
 
             zone = zone->NextSibling("zone")->ToElement();
         }
         part = part->NextSibling("part")->ToElement();
     }
+    prepare_all_samples();
     return true;
 }
 
@@ -1544,11 +1551,13 @@ bool sampler::load_all_from_sc1_xml(const void *data, int datasize, const fs::pa
                     }
                 }
                 update_zone_switches(zone_id);
+                invalidate_zone_index();
             }
 
             zone = zone->NextSibling("zone")->ToElement();
         }
         part = part->NextSibling("group")->ToElement();
     }
+    prepare_all_samples();
     return true;
 }
@@ -804,6 +804,8 @@ bool sampler::LoadAllFromRIFF(const void *data, size_t datasize, bool Replace, i
     }
 
     // TODO, release any orphan samples (& assert)
+    invalidate_zone_index();
+    prepare_all_samples();
 
     // TODO, refresh editor
     post_initdata();
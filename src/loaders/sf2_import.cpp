@@ -780,6 +780,7 @@ spawn_patch_dialog((HWND)((AEffGUIEditor*)editor)->getFrame()->getSystemWindow()
                         z->Filter[0].p[1] =
                             max(0.f, min(1.f, float(i_generators[initialFilterQ].wAmount / 960.f)));
                         update_zone_switches(newzone);
+                        invalidate_zone_index();
                     }
                 }
             }
@@ -363,6 +363,7 @@ bool create_sfz_zone(sampler *s, std::map<std::string, std::string> &sfz_zone_op
     }
 
     s->update_zone_switches(z_id);
+    s->invalidate_zone_index();
 
     if (num_opcodes_processed < sfz_zone_opcodes.size())
     {
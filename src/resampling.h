@@ -21,4 +21,19 @@ const unsigned int FIRipol_M = 256;
 const unsigned int FIRipol_M_bits = 8;
 const unsigned int FIRipol_N = 16;
 const unsigned int FIRipolI16_N = 16;
-const unsigned int FIRoffset = 8;
\ No newline at end of file
+const unsigned int FIRoffset = 8;
+
+// long sinc interpolators for the generator (GI_Sinc32/GI_Sinc64)
+const unsigned int FIRipolLong_N = 32;
+const unsigned int FIRipolLonger_N = 64;
+// zero samples either side of the sample data, half the longest interpolator
+const unsigned int SampleMargin = FIRipolLonger_N / 2;
+
+// 8.24 ratios above which a voice reads from the next mip level (or oversamples when there is
+// none), and below which it goes back down
+const int MipUpRatio = 18000000;
+const int MipDownRatio = 17000000;
+
+// Fills the shared sinc tables (SincTableF32, SincPhaseF32, SincLongPhaseF32 and friends).
+// Done by the first sampler_voice; only the first call does any work.
+void init_sinc_tables();
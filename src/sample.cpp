@@ -37,9 +37,12 @@
 #endif
 
 #include "util/scxtstring.h"
+#include "util/tools.h"
 #include "infrastructure/logfile.h"
 #include "infrastructure/file_map_view.h"
 
+#include <vector>
+
 sample::sample(configuration *conf)
 {
     refcount = 1;
@@ -48,6 +51,8 @@ sample::sample(configuration *conf)
     // zero pointers
     SampleData[0] = 0;
     SampleData[1] = 0;
+    memset(MipData, 0, sizeof(MipData));
+    memset(conversions, 0, sizeof(conversions));
     meta.slice_start = 0;
     meta.slice_end = 0;
     graintable = 0;
@@ -61,19 +66,32 @@ short *sample::GetSamplePtrI16(int Channel)
 {
     if (!UseInt16)
         return 0;
-    return &((short *)SampleData[Channel])[FIRoffset];
+    return &((short *)SampleData[Channel])[SampleMargin];
 }
 float *sample::GetSamplePtrF32(int Channel)
 {
     if (UseInt16)
         return 0;
-    return &((float *)SampleData[Channel])[FIRoffset];
+    return &((float *)SampleData[Channel])[SampleMargin];
+}
+void *sample::GetMipPtr(int Level, int Channel)
+{
+    void *d = Level ? MipData[Level - 1][Channel] : SampleData[Channel];
+    if (!d)
+        return 0;
+    return (char *)d + SampleMargin * (UseInt16 ? sizeof(short) : sizeof(float));
+}
+void *sample::GetConvertedPtr(const conversion *c, int Channel)
+{
+    if (!c->data[Channel])
+        return 0;
+    return (char *)c->data[Channel] + SampleMargin * (UseInt16 ? sizeof(short) : sizeof(float));
 }
 
 bool sample::AllocateI16(int Channel, int Samples)
 {
     // int samplesizewithmargin = Samples + 2*FIRipol_N + BLOCK_SIZE + FIRoffset;
-    int samplesizewithmargin = Samples + FIRipol_N;
+    int samplesizewithmargin = Samples + 2 * SampleMargin;
     if (SampleData[Channel])
         free(SampleData[Channel]);
     SampleData[Channel] = malloc(sizeof(short) * samplesizewithmargin);
@@ -82,15 +100,15 @@ bool sample::AllocateI16(int Channel, int Samples)
     UseInt16 = true;
 
     // clear pre/post zero area
-    memset(SampleData[Channel], 0, FIRoffset * sizeof(short));
-    memset((char *)SampleData[Channel] + (Samples + FIRoffset) * sizeof(short), 0,
-           FIRoffset * sizeof(short));
+    memset(SampleData[Channel], 0, SampleMargin * sizeof(short));
+    memset((char *)SampleData[Channel] + (Samples + SampleMargin) * sizeof(short), 0,
+           SampleMargin * sizeof(short));
 
     return true;
 }
 bool sample::AllocateF32(int Channel, int Samples)
 {
-    int samplesizewithmargin = Samples + FIRipol_N;
+    int samplesizewithmargin = Samples + 2 * SampleMargin;
     if (SampleData[Channel])
         free(SampleData[Channel]);
     SampleData[Channel] = malloc(sizeof(float) * samplesizewithmargin);
@@ -99,9 +117,9 @@ bool sample::AllocateF32(int Channel, int Samples)
     UseInt16 = false;
 
     // clear pre/post zero area
-    memset(SampleData[Channel], 0, FIRoffset * sizeof(float));
-    memset((char *)SampleData[Channel] + (Samples + FIRoffset) * sizeof(float), 0,
-           FIRoffset * sizeof(float));
+    memset(SampleData[Channel], 0, SampleMargin * sizeof(float));
+    memset((char *)SampleData[Channel] + (Samples + SampleMargin) * sizeof(float), 0,
+           SampleMargin * sizeof(float));
 
     return true;
 }
@@ -125,6 +143,14 @@ void sample::clear_data()
         free(SampleData[0]);
     if (SampleData[1])
         free(SampleData[1]);
+    for (auto &l : MipData)
+        for (auto &c : l)
+            if (c)
+                free(c);
+    for (auto &c : conversions)
+        for (auto &d : c.data)
+            if (d)
+                free(d);
     if (meta.slice_start)
         delete meta.slice_start;
     if (meta.slice_end)
@@ -135,6 +161,12 @@ void sample::clear_data()
     // and zero their pointers
     SampleData[0] = 0;
     SampleData[1] = 0;
+    memset(MipData, 0, sizeof(MipData));
+    mip_levels = 0;
+    mips_requested = false;
+    memset(conversions, 0, sizeof(conversions));
+    n_conversions = 0;
+    conversion_requested = 0;
     meta.slice_start = 0;
     meta.slice_end = 0;
     graintable = 0;
@@ -149,6 +181,179 @@ sample::~sample()
     clear_data(); // this should free everything
 }
 
+/*
+ * Each mip level is the one below through a 51 tap half band lowpass (Kaiser window, about 80dB
+ * down from 0.3 of the input rate) keeping every other sample. The filter is symmetric and centred
+ * on the kept sample, so the levels stay aligned with the original.
+ */
+static const int MipHalfTaps = 25;
+
+// h[m] is the coefficient for offsets +m and -m
+static void mip_filter(float *h)
+{
+    double c[MipHalfTaps + 1], sum = 0;
+    for (int m = 0; m <= MipHalfTaps; m++)
+    {
+        c[m] = 0.5 * sincf(0.5 * m) * SymmetricKaiser(m, 2 * (MipHalfTaps + 1), 2.5);
+        sum += m ? 2 * c[m] : c[m];
+    }
+    for (int m = 0; m <= MipHalfTaps; m++)
+        h[m] = (float)(c[m] / sum);
+}
+
+static inline void mip_store(float v, float *out) { *out = v; }
+static inline void mip_store(float v, short *out)
+{
+    *out = (short)std::clamp((int)lrintf(v), -32768, 32767);
+}
+
+template <class T> static void mip_decimate(const T *in, T *out, int n_out, const float *h)
+{
+    for (int j = 0; j < n_out; j++)
+    {
+        const T *c = &in[2 * j];
+        float acc = h[0] * (float)c[0];
+        // the even offsets of a half band are zero
+        for (int m = 1; m <= MipHalfTaps; m += 2)
+            acc += h[m] * ((float)c[-m] + (float)c[m]);
+        mip_store(acc, &out[j]);
+    }
+}
+
+bool sample::build_mips()
+{
+    if (mip_levels.load(std::memory_order_acquire) || !SampleData[0])
+        return false;
+
+    float h[MipHalfTaps + 1];
+    mip_filter(h);
+    size_t size = UseInt16 ? sizeof(short) : sizeof(float);
+    void *levels[MaxMipLevels][2] = {};
+
+    int n = sample_length;
+    for (int k = 0; k < MaxMipLevels; k++)
+    {
+        // the last one covers position n >> (k + 1), which the generator can reach
+        int n_out = (n >> 1) + 1;
+        for (int c = 0; c < 2; c++)
+        {
+            if (!SampleData[c])
+                continue;
+            void *d = calloc(n_out + 2 * SampleMargin, size);
+            if (!d)
+            {
+                for (auto &l : levels)
+                    for (auto &p : l)
+                        free(p);
+                return false;
+            }
+            levels[k][c] = d;
+            char *in = k ? (char *)levels[k - 1][c] + SampleMargin * size
+                         : (char *)GetMipPtr(0, c);
+            char *out = (char *)d + SampleMargin * size;
+            if (UseInt16)
+                mip_decimate((short *)in, (short *)out, n_out, h);
+            else
+                mip_decimate((float *)in, (float *)out, n_out, h);
+        }
+        n = n_out;
+    }
+
+    memcpy(MipData, levels, sizeof(MipData));
+    mip_levels.store(MaxMipLevels, std::memory_order_release);
+    return true;
+}
+
+/*
+ * Rate conversion: a Kaiser windowed sinc, 64 taps when going up and stretched to keep the
+ * cutoff under the new Nyquist when going down, from a table of phases with linear
+ * interpolation between them. Slow, but it only runs once per sample and rate.
+ */
+static const int ConvertHalfTaps = 32;
+static const int ConvertPhases = 512;
+
+template <class T>
+static void convert_channel(const T *in, int n_in, T *out, int n_out, double step,
+                            const std::vector<float> &table, int half)
+{
+    int taps = 2 * half;
+    for (int j = 0; j < n_out; j++)
+    {
+        double t = j * step;
+        int i = (int)t;
+        double ph = (t - i) * ConvertPhases;
+        int p = std::min((int)ph, ConvertPhases - 1);
+        float f = (float)(ph - p);
+        const float *c0 = &table[p * taps], *c1 = c0 + taps;
+
+        // taps i - half + 1 .. i + half, the zero margins don't cover a stretched filter
+        int k0 = std::max(0, half - 1 - i), k1 = std::min(taps, n_in + half - 1 - i);
+        float acc = 0.f;
+        for (int k = k0; k < k1; k++)
+            acc += (c0[k] + f * (c1[k] - c0[k])) * (float)in[i - half + 1 + k];
+        mip_store(acc, &out[j]);
+    }
+}
+
+bool sample::convert_rate(uint32_t rate)
+{
+    int n = n_conversions.load(std::memory_order_acquire);
+    if (!SampleData[0] || !rate || (rate == sample_rate) || find_conversion(rate) ||
+        (n >= MaxConversions))
+        return false;
+
+    double step = (double)sample_rate / (double)rate;
+    double cutoff = 0.95 * std::min(1.0, 1.0 / step);
+    int half = (int)ceil(ConvertHalfTaps * std::max(1.0, step));
+    int taps = 2 * half;
+    std::vector<float> table((ConvertPhases + 1) * taps);
+    for (int p = 0; p <= ConvertPhases; p++)
+    {
+        for (int k = 0; k < taps; k++)
+        {
+            double x = (k - half + 1) - (double)p / ConvertPhases;
+            table[p * taps + k] =
+                (float)(cutoff * sincf(cutoff * x) * SymmetricKaiser(x, taps, 2.5));
+        }
+    }
+
+    conversion c = {};
+    c.rate = rate;
+    c.length = (uint32_t)ceil(sample_length / step);
+    size_t size = UseInt16 ? sizeof(short) : sizeof(float);
+    for (int ch = 0; ch < 2; ch++)
+    {
+        if (!SampleData[ch])
+            continue;
+        c.data[ch] = calloc(c.length + 2 * SampleMargin, size);
+        if (!c.data[ch])
+        {
+            free(c.data[0]);
+            return false;
+        }
+        char *out = (char *)c.data[ch] + SampleMargin * size;
+        if (UseInt16)
+            convert_channel(GetSamplePtrI16(ch), sample_length, (short *)out, c.length, step,
+                            table, half);
+        else
+            convert_channel(GetSamplePtrF32(ch), sample_length, (float *)out, c.length, step,
+                            table, half);
+    }
+
+    conversions[n] = c;
+    n_conversions.store(n + 1, std::memory_order_release);
+    return true;
+}
+
+const sample::conversion *sample::find_conversion(uint32_t rate)
+{
+    int n = n_conversions.load(std::memory_order_acquire);
+    for (int i = 0; i < n; i++)
+        if (conversions[i].rate == rate)
+            return &conversions[i];
+    return nullptr;
+}
+
 bool sample::SetMeta(unsigned int Channels, unsigned int SampleRate, unsigned int SampleLength)
 {
     if (Channels > 2)
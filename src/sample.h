@@ -18,6 +18,7 @@
 #pragma once
 
 #include "globals.h"
+#include <atomic>
 #include <cstdint>
 #include "filesystem/import.h"
 
@@ -36,6 +37,8 @@ class alignas(16) sample
     bool parse_riff_wave(void *data, size_t filesize, bool skip_riffchunk = false);
     short *GetSamplePtrI16(int Channel);
     float *GetSamplePtrF32(int Channel);
+    // first sample of mip level Level (0 is the sample itself), in the format of the sample
+    void *GetMipPtr(int Level, int Channel);
     int GetRefCount();
     size_t GetDataSize();
     char *GetName();
@@ -65,6 +68,33 @@ class alignas(16) sample
     void init_grains();
     char name[64];
 
+    // Band limited copies for playback far above the root key. Level k is the sample low passed
+    // and decimated by 2^k, sample j of it lines up with sample j * 2^k of the original, with the
+    // same format and zero margins. build_mips() is slow and meant for a background thread;
+    // mip_levels is stored last, so whoever reads a count n can use levels 1..n.
+    static constexpr int MaxMipLevels = 3;
+    void *__restrict MipData[MaxMipLevels][2];
+    std::atomic<int> mip_levels{0};
+    std::atomic<bool> mips_requested{false};
+    bool build_mips();
+
+    // Copies resampled to an engine rate, so zones which don't change pitch play at a ratio of
+    // exactly one. Sample j of a copy is at j * sample_rate / rate of the original. Built by
+    // convert_rate() off the audio thread, each in a new slot published by n_conversions, and
+    // kept until the sample goes away since voices may be reading them.
+    struct conversion
+    {
+        uint32_t rate, length;
+        void *data[2]; // with the SampleMargin zeros, like SampleData
+    };
+    static constexpr int MaxConversions = 4;
+    conversion conversions[MaxConversions];
+    std::atomic<int> n_conversions{0};
+    std::atomic<uint32_t> conversion_requested{0};
+    bool convert_rate(uint32_t rate);
+    const conversion *find_conversion(uint32_t rate);
+    void *GetConvertedPtr(const conversion *c, int Channel);
+
     void remember() { refcount++; }
     bool forget()
     {
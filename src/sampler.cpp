@@ -32,6 +32,10 @@
 #include "configuration.h"
 #include "interaction_parameters.h"
 #include "synthesis/morphEQ.h"
+#include "zone_index.h"
+#include "infrastructure/worker_pool.h"
+#include "infrastructure/background_queue.h"
+#include "infrastructure/maintenance_thread.h"
 
 #include <vt_dsp/basic_dsp.h>
 #include "util/scxtstring.h"
@@ -45,20 +49,28 @@ using std::list;
 using std::max;
 using std::min;
 
-float samplerate;
-float samplerate_inv;
-float multiplier_freq2omega;
-
 //-------------------------------------------------------------------------------------------------
 
 void sampler::set_samplerate(float sr)
 {
-    samplerate = sr;
-    samplerate_inv = 1.f / sr;
-    multiplier_freq2omega = PI_2 * FILTER_FREQRANGE / samplerate;
+    engine_ctx.set_samplerate(sr);
     VUidx = 0;
     VUrate = (int)(sr / ((float)BLOCK_SIZE * 30.f));
-    init_tables(sr, BLOCK_SIZE);
+    load_meter.setBudget(sr, BLOCK_SIZE);
+    // the wrapper may set the rate before the sampler is fully constructed
+    if (mBackground)
+        prepare_all_samples();
+}
+
+void sampler::set_random_seed(uint64_t seed)
+{
+    random_seed = seed;
+    uint64_t s = seed;
+    for (int i = 0; i < MAX_VOICES; i++)
+        voices[i]->seed_random(prng::splitmix64(s));
+    for (int c = 0; c < N_SAMPLER_PARTS; c++)
+        partv[c].mm->seed_noise(prng::splitmix64(s));
+    preset_rng.seed(prng::splitmix64(s));
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -96,7 +108,11 @@ sampler::sampler(EditorClass *editor, int NumOutputs, WrapperClass *effect,
     uint32_t i, c;
     for (i = 0; i < MAX_VOICES; i++)
     {
-        voices[i] = new sampler_voice(i, &time_data);
+#if SCXT_ENVELOPE_BANK
+        voices[i] = new sampler_voice(i, &time_data, &halfrates, &envelopes);
+#else
+        voices[i] = new sampler_voice(i, &time_data, &halfrates);
+#endif
 
         voice_state[i].active = false;
     }
@@ -119,11 +135,13 @@ sampler::sampler(EditorClass *editor, int NumOutputs, WrapperClass *effect,
         partv[c].last_ft[1] = 0;
         partv[c].pFilter[0] = 0;
         partv[c].pFilter[1] = 0;
+        partv[c].idle_samples = 0;
 
         partv[c].mm = new modmatrix();
         partv[c].mm->assign(conf.get(), 0, &parts[c], 0, &controllers[n_controllers * c],
                             automation, &time_data);
     }
+    set_random_seed(0);
 
     for (int i = 0; i < 16; i++)
     {
@@ -134,7 +152,11 @@ sampler::sampler(EditorClass *editor, int NumOutputs, WrapperClass *effect,
     for (i = 0; i < MAX_SAMPLES; i++)
         samples[i] = nullptr;
     for (i = 0; i < MAX_ZONES; i++)
+    {
         zone_exists[i] = false;
+        zone_kill_generation[i] = 0;
+    }
+    rebuild_zone_index();
 
     for (i = 0; i < N_AUTOMATION_PARAMETERS; i++)
         automation[i] = 0;
@@ -153,7 +175,6 @@ sampler::sampler(EditorClass *editor, int NumOutputs, WrapperClass *effect,
     editorpart = 0;
     editorlayer = 0;
     polyphony = 0;
-    highest_voice_id = 0;
     highest_group_id = 0;
     //	set_headroom(conf->headroom);
     time_data.tempo = 120; // default tempo
@@ -175,6 +196,18 @@ sampler::sampler(EditorClass *editor, int NumOutputs, WrapperClass *effect,
         100.0;
     mAutoPreview =
         defaultsProvider->getUserDefaultValue(scxt::defaults::DefaultKeys::previewAuto, false);
+    mInterpolation = limit_range(
+        defaultsProvider->getUserDefaultValue(scxt::defaults::DefaultKeys::interpolation,
+                                              (int)GI_Sinc16),
+        0, GI_NumInterpolations - 1);
+    mDraftOnOverload =
+        defaultsProvider->getUserDefaultValue(scxt::defaults::DefaultKeys::draftOnOverload, false);
+    mBuildMips =
+        defaultsProvider->getUserDefaultValue(scxt::defaults::DefaultKeys::buildMips, false);
+    mResampleOnLoad =
+        defaultsProvider->getUserDefaultValue(scxt::defaults::DefaultKeys::resampleOnLoad, false);
+    mBackground = std::make_unique<scxt::Threading::BackgroundQueue>();
+    mMaintenance = std::make_unique<scxt::Threading::MaintenanceThread>([this]() { maintain(); });
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -187,6 +220,7 @@ void sampler::multi_init()
     {
         multiv.pFilter[i] = 0;
         multiv.last_ft[i] = 0;
+        multiv.idle_samples[i] = 0;
         multi.filter_output[i] = out_output1;
     }
 }
@@ -195,7 +229,11 @@ void sampler::multi_init()
 
 sampler::~sampler(void)
 {
+    mMaintenance.reset();
+    mBackground.reset();
+    voice_render_pool.reset();
     free_all();
+    retiredObjects.reclaim(UINT64_MAX); // no audio thread left to wait for
     int i;
     for (i = 0; i < MAX_VOICES; i++)
     {
@@ -220,6 +258,98 @@ sampler::~sampler(void)
                                                  (int)(round(mPreviewLevel * 100.0)));
         defaultsProvider->updateUserDefaultValue(scxt::defaults::previewAuto, mAutoPreview);
     }
+    if (mInterpolationConfigChanged)
+    {
+        defaultsProvider->updateUserDefaultValue(scxt::defaults::interpolation, mInterpolation);
+        defaultsProvider->updateUserDefaultValue(scxt::defaults::draftOnOverload,
+                                                 mDraftOnOverload);
+    }
+    if (mMipConfigChanged)
+        defaultsProvider->updateUserDefaultValue(scxt::defaults::buildMips, mBuildMips);
+    if (mResampleConfigChanged)
+        defaultsProvider->updateUserDefaultValue(scxt::defaults::resampleOnLoad, mResampleOnLoad);
+}
+
+//-------------------------------------------------------------------------------------------------
+
+int sampler::voice_interpolation(const sample_zone &zone) const
+{
+    if (mDraftActive)
+        return GI_Linear;
+    if ((zone.interpolation > zi_default) && (zone.interpolation < n_zone_interpolations))
+        return zone.interpolation - 1;
+    return mInterpolation;
+}
+
+void sampler::set_interpolation(int interpolation)
+{
+    mInterpolation = limit_range(interpolation, 0, GI_NumInterpolations - 1);
+}
+
+void sampler::set_draft_on_overload(bool draft)
+{
+    mDraftOnOverload = draft;
+    if (!draft)
+        mDraftActive = false;
+}
+
+// turning it off leaves the mip maps already built in place, voices may be reading them
+void sampler::set_build_mips(bool build)
+{
+    mBuildMips = build;
+    if (build)
+        prepare_all_samples();
+}
+
+// likewise, voices started on a converted copy keep it
+void sampler::set_resample_on_load(bool resample)
+{
+    mResampleOnLoad = resample;
+    if (resample)
+        prepare_all_samples();
+}
+
+void sampler::prepare_sample(int sample_id)
+{
+    if ((sample_id < 0) || (sample_id >= MAX_SAMPLES) || !samples[sample_id])
+        return;
+    auto s = samples[sample_id];
+    if (mBuildMips && !s->mips_requested.exchange(true))
+        mBackground->post([s]() { s->build_mips(); });
+
+    uint32_t rate = (uint32_t)lrint(engine_ctx.samplerate);
+    if (!mResampleOnLoad || (rate == s->sample_rate) ||
+        (s->conversion_requested.exchange(rate) == rate))
+        return;
+    mBackground->post([s, rate]() { s->convert_rate(rate); });
+}
+
+void sampler::prepare_all_samples()
+{
+    for (int s = 0; s < MAX_SAMPLES; s++)
+        prepare_sample(s);
+}
+
+void sampler::wait_for_background()
+{
+    mBackground->waitIdle();
+    refresh_zone_index();
+}
+
+// runs after each block. the thresholds are apart so a load hovering around one of them
+// doesn't flip the quality of every other note
+void sampler::update_draft_state()
+{
+    if (!mDraftOnOverload)
+    {
+        mDraftActive = false;
+        return;
+    }
+    float load = load_meter.stats().load;
+    if (!mDraftActive && (load > 0.85f))
+        mDraftActive = true;
+    else if (mDraftActive && (load < 0.6f))
+        mDraftActive = false;
 }
 
 bool sampler::zone_exist(int id)
@@ -412,6 +542,7 @@ void sampler::purge_holdbuffer()
         if (voice_state[z].active && !hold[voice_state[z].channel])
         {
             voices[z]->release(127);
+            voice_alloc.mark_released(z);
             list<int>::iterator del = iter;
             iter++;
             holdbuffer.erase(del);
@@ -424,6 +555,60 @@ void sampler::purge_holdbuffer()
 
 //-------------------------------------------------------------------------------------------------
 
+void sampler::invalidate_zone_index()
+{
+    zone_index_dirty = true;
+    invalidate_modulation();
+    if (mMaintenance)
+        mMaintenance->request();
+}
+
+void sampler::refresh_zone_index()
+{
+    if (zone_index_dirty)
+        rebuild_zone_index();
+}
+
+void sampler::rebuild_zone_index()
+{
+    // build into a fresh index so PlayNote can keep using the old one until the swap. Clear
+    // the flag first so an edit racing with the build marks it dirty again
+    std::lock_guard g(cs_index);
+    auto ni = std::make_shared<zone_index>();
+    zone_index_dirty = false;
+    ni->build(zones, zone_exists, parts);
+
+    zoneIndexLive.store(ni.get(), std::memory_order_release);
+    zoneIndex.swap(ni);
+    if (ni)
+        retire(ni);
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void sampler::retire(std::shared_ptr<void> p)
+{
+    // the list is sized for every sample slot twice over. should it ever fill up the reference
+    // is dropped here, which the list counts
+    retiredObjects.retire(std::move(p), blocks_done.load(std::memory_order_acquire));
+}
+
+void sampler::reclaim_retired()
+{
+    // an object retired while block E ran can be in use until E is done, and a voice kill
+    // deferred to block E + 1 may still refer to it. once E + 1 is done too, nothing does
+    uint64_t done = blocks_done.load(std::memory_order_acquire);
+    retiredObjects.reclaim(done > 1 ? done - 1 : 0);
+}
+
+void sampler::maintain()
+{
+    refresh_zone_index();
+    reclaim_retired();
+}
+
+//-------------------------------------------------------------------------------------------------
+
 void sampler::update_zone_switches(int z)
 {
     if (!zone_exists[z])
@@ -465,6 +650,7 @@ bool sampler::clone_zone(int zone_id, int *new_z, bool same_key)
         zones[i].key_low = zones[i].key_root;
         zones[i].key_high = zones[i].key_root;
     }
+    invalidate_zone_index();
 
     if (new_z)
         (*new_z) = i;
@@ -678,11 +864,6 @@ void sampler::SInitZone(sample_zone *pZone)
 
 bool sampler::add_zone(const fs::path &filename, int *new_z, char part, bool use_root_key)
 {
-    // find free zone and create zone object
-    int i = GetFreeZoneId();
-    if (i < 0)
-        return false;
-
     // check if sample is loaded already
     int32_t s = 0;
     if (!filename.empty())
@@ -698,12 +879,14 @@ bool sampler::add_zone(const fs::path &filename, int *new_z, char part, bool use
         else
         {
             // if it's not loaded,
-            // find a free sample slot and load it
-            s = this->GetFreeSampleId();
-            if (s < 0)
-                return false;
-
-            samples[s] = std::make_shared<sample>(conf.get());
+            // reserve a free sample slot and load into it outside the lock
+            {
+                std::lock_guard g(cs_patch);
+                s = this->GetFreeSampleId();
+                if (s < 0)
+                    return false;
+                samples[s] = std::make_shared<sample>(conf.get());
+            }
 
             if (!(samples[s]->load(filename)))
             {
@@ -716,7 +899,18 @@ bool sampler::add_zone(const fs::path &filename, int *new_z, char part, bool use
     else
         s = -1;
 
+    // find free zone and create zone object
     std::lock_guard lockUntilEnd(cs_patch);
+    int i = GetFreeZoneId();
+    if (i < 0)
+    {
+        if ((s >= 0) && samples[s]->forget())
+        {
+            retire(samples[s]);
+            samples[s] = 0;
+        }
+        return false;
+    }
     InitZone(i);
 
     zones[i].part = part;
@@ -728,6 +922,8 @@ bool sampler::add_zone(const fs::path &filename, int *new_z, char part, bool use
 
     if (s >= 0)
     {
+        prepare_sample(s);
+
         zones[i].sample_stop = samples[s]->sample_length;
         zones[i].loop_end = samples[s]->sample_length;
 
@@ -793,6 +989,7 @@ bool sampler::add_zone(const fs::path &filename, int *new_z, char part, bool use
         *new_z = i;
     zone_exists[i] = true;
     update_zone_switches(i);
+    invalidate_zone_index();
     return true;
 }
 
@@ -803,6 +1000,7 @@ bool sampler::replace_zone(int z, const fs::path &fileName)
     // ATTENTION !!! if sample refcount> 1 then the sampling should only be changed for the current
     // zone !! kill all notes for the given zone
     kill_notes(z);
+    wait_for_kills();
     int s_old = zones[z].sample_id;
 
     int s = 0;
@@ -824,10 +1022,12 @@ bool sampler::replace_zone(int z, const fs::path &fileName)
     std::lock_guard lockUntilEnd(cs_patch);
     if ((s_old >= 0) && samples[s_old]->forget())
     {
+        retire(samples[s_old]);
         samples[s_old] = 0;
     }
 
     zones[z].sample_id = s;
+    prepare_sample(s);
     zones[z].sample_start = 0;
     zones[z].sample_stop = samples[s]->sample_length;
     zones[z].hp[0].start_sample = 0;
@@ -897,10 +1097,13 @@ bool sampler::free_zone(uint32_t zoneid)
     if (!zone_exists[zoneid])
         return false;
     std::lock_guard g(cs_patch);
-    kill_notes(zoneid);
+    // not existing first, so a note starting on the zone meanwhile is caught by the kill
     zone_exists[zoneid] = false;
+    invalidate_zone_index();
+    kill_notes(zoneid);
     if ((zones[zoneid].sample_id >= 0) && samples[zones[zoneid].sample_id]->forget())
     {
+        retire(samples[zones[zoneid].sample_id]);
         samples[zones[zoneid].sample_id] = 0;
     }
     return true;
@@ -918,6 +1121,7 @@ void sampler::free_all()
             free_zone(i);
         }
     }
+    wait_for_kills(); // before the zones are reused
 
     int c;
     for (c = 0; c < 16; c++)
@@ -933,8 +1137,6 @@ void sampler::free_all()
         customcontrollers_bp[i] = false;
     }
 
-    update_highest_voice_id();
-
     holdbuffer.clear();
 }
 
@@ -997,6 +1199,8 @@ int sampler::find_next_free_key(int part)
 
 void sampler::idle()
 {
+    reclaim_retired();
+
     if (sample_replace_filename[0])
     {
         if (!get_zone_poly(selected->get_active_id()))
@@ -1014,15 +1218,18 @@ void sampler::idle()
 
 void sampler::part_clear_zones(int p)
 {
-    std::lock_guard g(cs_patch);
-    int i;
-    for (i = 0; i < MAX_ZONES; i++)
     {
-        if ((zone_exists[i]) && (zones[i].part == p))
+        std::lock_guard g(cs_patch);
+        int i;
+        for (i = 0; i < MAX_ZONES; i++)
         {
-            free_zone(i);
+            if ((zone_exists[i]) && (zones[i].part == p))
+            {
+                free_zone(i);
+            }
         }
     }
+    wait_for_kills();
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -1084,6 +1291,7 @@ void sampler::part_init(int p, bool clear_zones, bool leave_outputs)
 
     if (clear_zones)
         part_clear_zones(p);
+    invalidate_zone_index();
 }
 
 //=========================================================================================
@@ -1096,7 +1304,7 @@ sampler::Preview::Preview(timedata *pTD, sampler *pParent)
 {
     // Init Preview voice/zone/sample
     mpParent = pParent;
-    mpVoice = std::make_unique<sampler_voice>(0, pTD);
+    mpVoice = std::make_unique<sampler_voice>(0, pTD, &mHalfrates);
     mpSample = std::make_unique<sample>(mpParent->conf.get());
     mActive = false;
     mAutoPreview = mpParent->mAutoPreview;
@@ -1135,7 +1343,7 @@ void sampler::Preview::Start(const fs::path &Filename)
         mZone.playmode = pm_forward_shot;
         mZone.aux[0].level = mpParent->mPreviewLevel;
         mpVoice->play(mpSample.get(), &mZone, &mPart, 60, 127, 0, mpParent->controllers,
-                      mpParent->automation, 1.f);
+                      mpParent->automation, 1.f, 0, mpParent->voice_interpolation(mZone));
 
         SetPlayingState(true);
     }
@@ -22,9 +22,17 @@ class sampler;
 #include "controllers.h"
 #include "multiselect.h"
 #include "sampler_state.h"
+#include "voice_allocator.h"
+#include "halfrate_pool.h"
+#include "synthesis/envelope.h"
+#include "util/prng.h"
 #include "infrastructure/logfile.h"
+#include "infrastructure/load_meter.h"
+#include "infrastructure/retire_list.h"
 #include "browser/ContentBrowser.h"
+#include <atomic>
 #include <list>
+#include <memory>
 #include <string>
 #include <thread>
 #include <mutex>
@@ -48,12 +56,29 @@ typedef int WrapperClass;
 class modmatrix;
 class TiXmlElement;
 class configuration;
+class zone_index;
+namespace scxt::Threading
+{
+class WorkerPool;
+class BackgroundQueue;
+class MaintenanceThread;
+}
 
 struct voicestate
 {
     bool active;
     unsigned char key, channel, part;
     uint32_t zone_id;
+    uint32_t kill_generation; // of the zone when the voice started, see kill_notes()
+};
+
+// a voice rendered on a worker thread. it renders into scratch (main L/R, aux1 L/R, aux2 L/R)
+// which is summed into the buses afterwards, in the same order the serial loop would have
+struct alignas(16) voice_render_job
+{
+    float scratch alignas(16)[6][BLOCK_SIZE];
+    int voice;
+    bool still_active;
 };
 
 static constexpr int n_custom_controllers = 16;
@@ -90,13 +115,19 @@ class sampler
         filter *pFilter[2];
         int last_ft[2];
         modmatrix *mm;
+        // samples since the part last had a voice, the part sleeps once this exceeds its tail
+        int idle_samples;
     } partv[N_SAMPLER_PARTS];
     struct alignas(16) multivoice
     {
         lipol_ps pregain, postgain;
         filter *pFilter[N_SAMPLER_EFFECTS];
         int last_ft[N_SAMPLER_EFFECTS];
+        // samples since the effect last had a non silent input
+        int idle_samples[N_SAMPLER_EFFECTS];
     } multiv;
+    // where the main outputs are rendered, output[] unless the wrapper points them at its own
+    // (16 byte aligned, BLOCK_SIZE long) buffers with set_output_pointers()
     float *output_ptr[MAX_OUTPUTS << 1];
     scxt::log::StreamLogger mLogger;
 
@@ -120,23 +151,45 @@ class sampler
 
     /*
      * Midi Messages
+     *
+     * offset is the sample position (0 .. BLOCK_SIZE-1) within the next block rendered by
+     * process_audio at which the note starts or is released
      */
     virtual bool PlayNote(char channel, char key, char velocity, bool is_release = false,
-                          char detune = 0);
+                          char detune = 0, int offset = 0);
     void PitchBend(char channel, int value);
     void ChannelAftertouch(char channel, int value);
     void ChannelController(char channel, int cc, int value);
-    void ReleaseNote(char channel, char key, char velocity);
+    void ReleaseNote(char channel, char key, char velocity, int offset = 0);
     void AllNotesOff();
 
     void play_zone(int zone_id);
     void release_zone(int zone_id);
     void voice_off(uint32_t voice_id);
+    // stops every voice of the zone. voices belong to the audio thread, elsewhere this only
+    // flags the zone and process_audio frees the voices before it renders the next block.
+    // wait_for_kills() blocks until it has, before zone data the voices read is reused
     void kill_notes(uint32_t zone_id);
+    void wait_for_kills();
     float *get_output_pointer(int id, int channel, int part); // internal
+    // render output pair out straight into L/R from the next process_audio() on, nullptr goes
+    // back to output[]
+    void set_output_pointers(int out, float *L, float *R);
     bool get_key_name(char *str, int channel, int key);
     void process_audio();
+    // render voices on n threads, the audio thread being one of them. 1 (the default) renders
+    // serially. starts and stops threads, so call it from the UI/setup side, never per block.
+    void set_voice_render_threads(int n);
+#if SCXT_ENVELOPE_BANK
+    // runs the envelopes of every active voice through envelope_bank::process, four at a time,
+    // before the voices are rendered
+    void process_envelopes();
+#endif
+    void render_voices();
+    void render_voices_threaded();
+    static void render_voice_job(void *ctx, int item, int worker);
     void process_part(int p);
+    int part_tail_length(int p);
     void process_global_effects();
     void processVUsAndPolyphonyUpdates();
     void part_check_filtertypes(int p, int f);
@@ -150,6 +203,11 @@ class sampler
 
     int get_headroom() { return headroom; };
     void set_samplerate(float sr);
+    const engine_context &get_engine_context() const { return engine_ctx; }
+    // seeds every voice, part and preset generator, so a render is reproducible for a given
+    // seed. like set_samplerate, only call it while audio isn't being processed
+    void set_random_seed(uint64_t seed);
+    uint64_t get_random_seed() const { return random_seed; }
     bool zone_exist(int id);
     bool verify_zone_validity(int zone_id);
 
@@ -201,13 +259,39 @@ class sampler
     bool replace_zone(int z, const fs::path &filename);
     bool free_zone(uint32_t zoneid);
     void update_zone_switches(int zone);
+    // the key/velocity index used by PlayNote has to be rebuilt whenever zone mapping or part
+    // channel/transpose/velocity-split state changes. invalidating is cheap, wait free and fine
+    // on the audio thread. the rebuild happens once, after the edit, on mMaintenance and is
+    // published with a pointer swap, so notes use the old mapping until it is done
+    void invalidate_zone_index();
+    // playing voices pick up edits to the modulation routing of their zone and part, or just
+    // to the values their destinations start from
+    void invalidate_modulation()
+    {
+        engine_ctx.patch_generation.fetch_add(1, std::memory_order_release);
+    }
+    void reseed_modulation()
+    {
+        engine_ctx.param_generation.fetch_add(1, std::memory_order_release);
+    }
+    // rebuilds the index now if it is out of date. not for the audio thread
+    void refresh_zone_index();
+    void rebuild_zone_index();
     bool get_sample_id(const fs::path &filename, int *s_id);
     int find_next_free_key(int part);
     int GetFreeSampleId();
     int GetFreeZoneId();
     int GetFreeVoiceId(int group_id = 0); // get a free voice id. kills an old voice if necessary
     int softkill_oldest_note(int group_id = 0);
-    void update_highest_voice_id();
+    void activate_voice(int v); // mark voice v as playing, voice_state must be filled in
+    void free_voice(int v);
+    // true on the audio thread, and on any thread while there is no audio thread
+    bool owns_voices() const
+    {
+        return AudioHalted ||
+               (std::this_thread::get_id() == audio_thread.load(std::memory_order_relaxed));
+    }
+    void process_kill_requests();
 
     int get_zone_poly(int zone);
     int get_group_poly(int zone);
@@ -267,6 +351,7 @@ class sampler
       public:
         sample_zone mZone;
         sample_part mPart;
+        halfrate_pool mHalfrates{1}; // before mpVoice, which gives its filter back on delete
         std::unique_ptr<sampler_voice> mpVoice;
         std::unique_ptr<sample> mpSample;
         sampler *mpParent{nullptr};
@@ -278,6 +363,41 @@ class sampler
     bool mAutoPreview;
     bool mPreviewConfigChanged{false};
 
+    // global interpolation (a GeneratorInterpolation) for zones set to zi_default. with
+    // draft_on_overload new voices drop to linear while the DSP load meter is too high
+    int mInterpolation;
+    bool mDraftOnOverload;
+    bool mDraftActive{false};
+    bool mInterpolationConfigChanged{false};
+    void update_draft_state();
+
+    // band limited copies of every loaded sample (sample::build_mips), built on mBackground.
+    // costs about 90% more sample memory
+    bool mBuildMips;
+    bool mMipConfigChanged{false};
+    // copies of every sample at the engine rate (sample::convert_rate), also on mBackground.
+    // zones without a loop and without transposition then play them at a ratio of one
+    bool mResampleOnLoad;
+    bool mResampleConfigChanged{false};
+    std::unique_ptr<scxt::Threading::BackgroundQueue> mBackground;
+    // zone index rebuilds and reclaim_retired(), see invalidate_zone_index()
+    std::unique_ptr<scxt::Threading::MaintenanceThread> mMaintenance;
+    void maintain();
+
+  public:
+    int voice_interpolation(const sample_zone &zone) const;
+    void set_interpolation(int interpolation);
+    void set_draft_on_overload(bool draft);
+    bool is_draft_active() const { return mDraftActive; }
+    void set_build_mips(bool build);
+    void set_resample_on_load(bool resample);
+    // queues the background work a newly loaded sample needs (mip maps, rate conversion)
+    void prepare_sample(int sample_id);
+    void prepare_all_samples();
+    // waits for the background work queued so far and brings the zone index up to date, so an
+    // offline render sounds the same every time
+    void wait_for_background();
+
   public:
     /*
      * These are the data representations of the innards of the synth.
@@ -339,11 +459,30 @@ class sampler
     void resetStateFromTimeData() {}
 
     int VUrate, VUidx, lastSentPolyphony{-1};
+    scxt::Perf::LoadMeter load_meter;
+    const scxt::Perf::LoadMeter &get_load_meter() const { return load_meter; }
     float automation[N_AUTOMATION_PARAMETERS];
 
     // AudioEffectX	*effect;
     std::unique_ptr<multiselect> selected;
     std::recursive_mutex cs_patch, cs_gui, cs_engine;
+
+    // Objects the audio thread may still be looking at (samples of deleted or replaced zones,
+    // replaced zone indices) are retired here instead of being destroyed in place, which can
+    // mean freeing hundreds of MB on the audio thread or with cs_patch held. retire() is lock
+    // free and fine from any thread. reclaim_retired() destroys what the audio thread is done
+    // with and is only ever called from non-realtime threads.
+    void retire(std::shared_ptr<void> p);
+    void reclaim_retired();
+    // retire() calls that found the list full and released in place
+    uint32_t retire_overflows() const { return retiredObjects.overflows(); }
+    // notes which wanted oversampling and took the filter of a quieter voice, which plays on
+    // without. zero unless more than HALFRATE_VOICES oversample at once
+    uint32_t halfrate_steals() const { return halfrates.stolen(); }
+    // notes which wanted oversampling and played without it
+    uint32_t halfrate_exhaustions() const { return halfrates.exhausted(); }
+    // blocks process_audio rendered without handling events because an editor held cs_patch
+    std::atomic<uint32_t> patch_busy_blocks{0};
     std::unique_ptr<configuration> conf;
     external_controller externalControllers[n_custom_controllers];
 
@@ -358,9 +497,36 @@ class sampler
     bool volatile AudioHalted; // don't care to wait for the process thread
   protected:
     bool zone_exists[MAX_ZONES];
+    // PlayNote only ever reads zoneIndexLive, the owning pointer is swapped and retired
+    std::shared_ptr<zone_index> zoneIndex;
+    std::atomic<zone_index *> zoneIndexLive{nullptr};
+    std::atomic<bool> zone_index_dirty{true};
+    std::mutex cs_index; // one rebuild at a time
+    scxt::Threading::RetireList retiredObjects{MAX_SAMPLES << 1};
+    // audio blocks completed so far, the epoch objects are retired with
+    std::atomic<uint64_t> blocks_done{0};
+    std::atomic<std::thread::id> audio_thread{};
+    // kill_notes() from threads other than the audio thread. kill_requests_seen is the audio
+    // thread's, kills_done the last request it has handled
+    std::atomic<uint32_t> zone_kill_generation[MAX_ZONES];
+    std::atomic<uint32_t> kill_requests{0}, kills_done{0};
+    uint32_t kill_requests_seen{0};
     bool holdengine;
+    engine_context engine_ctx;
+    uint64_t random_seed{0};
+    prng_x4 preset_rng;
     sampler_voice *voices[MAX_VOICES];
     voicestate voice_state[MAX_VOICES];
+    voice_allocator voice_alloc;
+    // oversampling filters for the voices. few notes are pitched up far enough to need one, so
+    // there are HALFRATE_VOICES rather than one per voice
+    halfrate_pool halfrates{HALFRATE_VOICES};
+#if SCXT_ENVELOPE_BANK
+    envelope_bank envelopes{MAX_VOICES * 2};
+    uint8_t envelope_run[MAX_VOICES * 2];
+#endif
+    std::unique_ptr<scxt::Threading::WorkerPool> voice_render_pool;
+    std::vector<voice_render_job> voice_render_jobs;
     double headroom_linear;
     int headroom;
     bool hold[16];
@@ -369,7 +535,7 @@ class sampler
     char nrpn[16][2], nrpn_v[16][2];
     char rpn[16][2], rpn_v[16][2];
     bool nrpn_last[16];
-    int highest_voice_id, highest_group_id;
+    int highest_group_id;
 
     void *chunkDataPtr, *dbSampleListDataPtr;
 };
@@ -125,6 +125,7 @@ std::string sampler::generateInternalStateView() const
             SHOW(ignore_part_polymode, z);
             SHOW(mute, z);
             SHOW(reverse, z);
+            SHOW(interpolation, z);
             oss << pfx << "lag_generator: [" << z->lag_generator[0] << ", " << z->lag_generator[1]
                 << "]\n";
             SHOW(key_root, z);
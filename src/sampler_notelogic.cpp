@@ -19,23 +19,84 @@
 #include "interaction_parameters.h"
 #include "sampler_voice.h"
 #include "util/tools.h"
+#include "infrastructure/rt_guard.h"
+#include "zone_index.h"
 #include <vt_dsp/basic_dsp.h>
 
 #include <algorithm>
+#include <chrono>
 #include <cstring>
+#include <thread>
 using std::max;
 using std::min;
 
+void sampler::activate_voice(int v)
+{
+    voice_state[v].kill_generation =
+        zone_kill_generation[voice_state[v].zone_id].load(std::memory_order_relaxed);
+    voice_state[v].active = true;
+    voice_alloc.activate(v);
+    polyphony++;
+}
+
+void sampler::free_voice(int v)
+{
+    voice_state[v].active = false;
+    voices[v]->release_oversampling();
+    voice_alloc.deactivate(v);
+    polyphony--;
+}
+
 void sampler::kill_notes(uint32_t zone_id)
 {
-    int i;
-    for (i = 0; i < MAX_VOICES; i++)
+    if (!owns_voices())
     {
-        if (voice_state[i].active && (voice_state[i].zone_id == zone_id))
-        {
-            voice_state[i].active = false;
-            polyphony--;
-        }
+        zone_kill_generation[zone_id].fetch_add(1, std::memory_order_relaxed);
+        kill_requests.fetch_add(1, std::memory_order_release);
+        return;
+    }
+
+    // backwards, as freeing a voice moves the last active voice into its slot
+    for (int i = voice_alloc.active_count() - 1; i >= 0; i--)
+    {
+        int v = voice_alloc.active_voice(i);
+        if (voice_state[v].zone_id == zone_id)
+            free_voice(v);
+    }
+}
+
+// audio thread, before anything renders. a voice goes when its zone was flagged after it
+// started, or when the zone was freed (a note may have started on it while it was going)
+void sampler::process_kill_requests()
+{
+    uint32_t r = kill_requests.load(std::memory_order_acquire);
+    if (r == kill_requests_seen)
+        return;
+    kill_requests_seen = r;
+
+    for (int i = voice_alloc.active_count() - 1; i >= 0; i--)
+    {
+        int v = voice_alloc.active_voice(i);
+        uint32_t z = voice_state[v].zone_id;
+        if (!zone_exists[z] || (voice_state[v].kill_generation !=
+                                zone_kill_generation[z].load(std::memory_order_relaxed)))
+            free_voice(v);
+    }
+    kills_done.store(r, std::memory_order_release);
+}
+
+void sampler::wait_for_kills()
+{
+    if (owns_voices())
+        return;
+    // give up after a while. if the host stopped calling process_audio nothing renders, and
+    // the requests are handled before the next block is
+    uint32_t r = kill_requests.load(std::memory_order_relaxed);
+    for (int ms = 0; ms < 200; ms++)
+    {
+        if ((int32_t)(kills_done.load(std::memory_order_acquire) - r) >= 0)
+            return;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
     }
 }
 
@@ -43,10 +104,13 @@ void sampler::AllNotesOff()
 {
     int i;
     for (i = 0; i < MAX_VOICES; i++)
+    {
         voice_state[i].active = false;
+        voices[i]->release_oversampling();
+    }
 
+    voice_alloc.reset();
     polyphony = 0;
-    highest_voice_id = 0;
 
     memset(keystate, 0, sizeof(keystate));
 
@@ -59,64 +123,23 @@ void sampler::AllNotesOff()
 
 int sampler::softkill_oldest_note(int group_id)
 {
-    bool no_group = (group_id == 0);
-    int i, oldest_id = -1;
-    float oldest = 0.f;
-
-    for (i = 0; i < MAX_VOICES; i++)
-    {
-        if (voice_state[i].active)
-        {
-            float time = voices[i]->time;
-            if ((time > oldest) && (!voices[i]->is_uberrelease) && (!voices[i]->gate))
-            {
-                oldest = time;
-                oldest_id = i;
-            }
-        }
-    }
-    if (oldest_id < 0) // no notes in the release state found, check ALL notes..
-    {
-        for (i = 0; i < MAX_VOICES; i++)
-        {
-            if (voice_state[i].active)
-            {
-                float time = voices[i]->time;
-                if ((time > oldest) && (!voices[i]->is_uberrelease))
-                {
-                    oldest = time;
-                    oldest_id = i;
-                }
-            }
-        }
-    }
+    // the allocator keeps the voices ordered released-first, then oldest-first, and drops
+    // voices already in uberrelease
+    int oldest_id = voice_alloc.steal_candidate();
     if (oldest_id >= 0)
+    {
         voices[oldest_id]->uberrelease();
+        voice_alloc.mark_killed(oldest_id);
+    }
 
     return oldest_id;
 }
 
 int sampler::GetFreeVoiceId(int group_id)
 {
-    int i, v = 0, vg = 0;
-    int v_free = -1;
+    int i, v = voice_alloc.active_count();
     int oldest_id = -1;
 
-    for (i = 0; i < MAX_VOICES; i++)
-    {
-        if (voice_state[i].active /* && (!voices[i]->is_uberrelease)*/)
-        {
-            v++;
-            //			if(zones[voice_state[i].zone_id].group_id == group_id) vg++;
-        }
-        else if (v_free < 0)
-        {
-            v_free = i;
-            if (voice_state[i].active)
-                polyphony--;
-        }
-    }
-
     // if the polyphony limit is going to be exceeded, release the oldest note
 
     int ng = 0;
@@ -139,21 +162,20 @@ int sampler::GetFreeVoiceId(int group_id)
         }
     }
 
+    int v_free = voice_alloc.peek_free();
     if (v_free < 0)
     {
         // no free voice was found at all! (all 256 have been used up)
         // KILL the oldest note!!
         if (oldest_id >= 0)
         {
-            voice_state[oldest_id].active = false;
-            polyphony--;
+            free_voice(oldest_id);
             v_free = oldest_id;
         }
         else
         {
             // rescue path. this is only supposed to happen if ALL notes are in uberrelease-mode
-            voice_state[0].active = false;
-            polyphony--;
+            free_voice(0);
             v_free = 0;
         }
     }
@@ -161,15 +183,6 @@ int sampler::GetFreeVoiceId(int group_id)
     return v_free;
 }
 
-void sampler::update_highest_voice_id()
-{
-    for (int i = 0; i < MAX_VOICES; i++)
-    {
-        if (voice_state[i].active)
-            highest_voice_id = i + 1;
-    }
-}
-
 void sampler::play_zone(int z)
 {
     if (!zone_exists[z])
@@ -189,27 +202,33 @@ void sampler::play_zone(int z)
     int ch = parts[zones[z].part].MIDIchannel;
     update_zone_switches(z);
     voices[v]->play(samples[zones[z].sample_id].get(), &zones[z], &parts[zones[z].part & 0xf],
-                    zones[z].key_root, 100, 0, &controllers[n_controllers * ch], automation, 1.f);
-    voice_state[v].active = true;
+                    zones[z].key_root, 100, 0, &controllers[n_controllers * ch], automation, 1.f, 0,
+                    voice_interpolation(zones[z]));
     voice_state[v].key = zones[z].key_root;
     voice_state[v].channel = ch;
     voice_state[v].zone_id = z;
-    polyphony++;
-    update_highest_voice_id();
+    activate_voice(v);
 }
 
 void sampler::release_zone(int zone_id)
 {
-    int i;
-    for (i = 0; i < MAX_VOICES; i++)
+    for (int i = 0; i < voice_alloc.active_count(); i++)
     {
-        if ((voice_state[i].zone_id == zone_id) && voice_state[i].active)
-            voices[i]->release(127);
+        int v = voice_alloc.active_voice(i);
+        if (voice_state[v].zone_id == zone_id)
+        {
+            voices[v]->release(127);
+            voice_alloc.mark_released(v);
+        }
     }
 }
 
-bool sampler::PlayNote(char channel, char key, char velocity, bool is_release, char detune)
+bool sampler::PlayNote(char channel, char key, char velocity, bool is_release, char detune,
+                       int offset)
 {
+    engine_context_scope ctx_scope(&engine_ctx);
+    scxt::Realtime::Scope rt_scope;
+
     // update keystate
     if (!is_release)
         keystate[channel][key] = velocity;
@@ -222,10 +241,10 @@ bool sampler::PlayNote(char channel, char key, char velocity, bool is_release, c
     bool require_ignore = false;
     if (!is_release) // look for legato notes
     {
-        for (int tv = 0; tv < MAX_VOICES; tv++)
+        for (int i = 0; i < voice_alloc.active_count(); i++)
         {
-            if (voice_state[tv].active &&
-                (parts[voice_state[tv].part].polymode == polymode_legato) &&
+            int tv = voice_alloc.active_voice(i);
+            if ((parts[voice_state[tv].part].polymode == polymode_legato) &&
                 (parts[voice_state[tv].part].MIDIchannel == channel) &&
                 !zones[voice_state[tv].zone_id].ignore_part_polymode)
             {
@@ -238,134 +257,59 @@ bool sampler::PlayNote(char channel, char key, char velocity, bool is_release, c
                 else
                 {
                     voices[tv]->uberrelease();
+                    voice_alloc.mark_killed(tv);
                 }
             }
         }
     }
 
-    // find matching zone
-    for (int z = 0; z < MAX_ZONES; z++)
+    // find matching zones. the index only holds zones whose part listens on this channel and
+    // whose key range (including fades) covers the key, with the crossfades precomputed
+    const zone_index *idx = zoneIndexLive.load(std::memory_order_acquire);
+    for (auto e = idx->begin(channel, key); e != idx->end(channel, key); ++e)
     {
-        int p = 0, v = 0, n_split = 0, zkey = 0;
-        float crossfade_amp = 1.f;
+        int z = e->zone_id;
+        int p = zones[z].part & 0xf;
+        int v = 0;
 
         if (!zone_exists[z])
-            goto skipzone;
+            continue;
         if (zones[z].mute)
-            goto skipzone;
+            continue;
         if (require_ignore && !zones[z].ignore_part_polymode)
-            goto skipzone;
+            continue;
         if (is_release && (zones[z].playmode != pm_forward_release))
-            goto skipzone;
+            continue;
         if (!is_release && (zones[z].playmode == pm_forward_release))
-            goto skipzone;
-        if (channel != parts[zones[z].part & 0xf].MIDIchannel)
-            goto skipzone;
+            continue;
         if ((sample_replace_filename[0] != 0) && (selected->zone_is_active(z)))
-            goto skipzone;
+            continue;
         if (selected->get_solo() && !selected->zone_is_selected(z))
-            goto skipzone;
-
-        p = zones[z].part & 0xf;
-        zkey = key + parts[p].transpose - parts[p].formant; // key used for range check
+            continue;
 
-        if (zkey < (zones[z].key_low - zones[z].key_low_fade))
-            goto skipzone;
-        if (zkey > (zones[z].key_high + zones[z].key_high_fade))
-            goto skipzone;
+        float velocity_amp = idx->velocity_gain(*e, velocity);
+        if (velocity_amp < 0.f)
+            continue;
         if (!partv[p].mm->check_trigger_condition(&zones[z]))
-            goto skipzone;
+            continue;
 
-        if (zones[z].key_low_fade || zones[z].key_high_fade)
-        {
-            if (zkey < (zones[z].key_low + zones[z].key_low_fade))
-                crossfade_amp = ((float)zkey - zones[z].key_low + zones[z].key_low_fade) /
-                                ((float)zones[z].key_low_fade * 2.f);
-            else if (zkey > (zones[z].key_high - zones[z].key_high_fade))
-                crossfade_amp = 1.f - (((float)zkey - zones[z].key_high + zones[z].key_high_fade) /
-                                       ((float)zones[z].key_high_fade * 2.f));
-
-            crossfade_amp = limit_range(crossfade_amp, 0.f, 1.f);
-        }
-
-        n_split = parts[zones[z].part & 0xf].vs_layercount;
-        v = 0;
-        if (n_split && (zones[z].layer <= n_split))
-        {
-            float k = zones[z].layer;
-            float xf = parts[zones[z].part & 0xf].vs_xfade;
-            float fvlo0 = (k - 0.5f * xf) / ((float)n_split + 1.0f);
-            float fvlo1 = (k + 0.5f * xf) / ((float)n_split + 1.0f);
-            float fvhi0 = (k + 1.0f - 0.5f * xf) / ((float)n_split + 1.0f);
-            float fvhi1 = (k + 1.0f + 0.5f * xf) / ((float)n_split + 1.0f);
-
-            // map to -1 .. 1
-            fvlo0 = saturate(fvlo0 * 2.f - 1.f);
-            fvlo1 = saturate(fvlo1 * 2.f - 1.f);
-            fvhi0 = saturate(fvhi0 * 2.f - 1.f);
-            fvhi1 = saturate(fvhi1 * 2.f - 1.f);
-
-            // skew
-            float sk = parts[zones[z].part & 0xf].vs_distribution;
-            fvlo0 = fvlo0 - sk * fvlo0 * fvlo0 + sk;
-            fvlo1 = fvlo1 - sk * fvlo1 * fvlo1 + sk;
-            fvhi0 = fvhi0 - sk * fvhi0 * fvhi0 + sk;
-            fvhi1 = fvhi1 - sk * fvhi1 * fvhi1 + sk;
-
-            // map back and scale to 0 .. 127
-            fvlo0 = fvlo0 * 64.f + 64.f;
-            fvlo1 = fvlo1 * 64.f + 64.f;
-            fvhi0 = fvhi0 * 64.f + 64.f;
-            fvhi1 = fvhi1 * 64.f + 64.f;
-
-            int lovel = fvlo0;
-            int hivel = fvhi1;
-
-            if ((velocity < lovel) || (velocity >= hivel))
-                goto skipzone;
-
-            if (xf > 0.001)
-            {
-                if ((velocity < fvlo1) && (zones[z].layer))
-                    crossfade_amp *= (velocity - fvlo0) / (fvlo1 - fvlo0);
-                else if ((velocity > fvhi0) && (zones[z].layer < n_split))
-                    crossfade_amp *= 1.f - ((velocity - fvhi0) / (fvhi1 - fvhi0));
-                crossfade_amp = limit_range(crossfade_amp, 0.f, 1.f);
-            }
-        }
-        else
-        {
-            int lovel = zones[z].velocity_low - zones[z].velocity_low_fade;
-            int hivel = zones[z].velocity_high + zones[z].velocity_high_fade;
-
-            if ((velocity < lovel) || (velocity > hivel))
-                goto skipzone;
-
-            if (zones[z].velocity_low_fade || zones[z].velocity_high_fade)
-            {
-                if (velocity < (zones[z].velocity_low + zones[z].velocity_low_fade))
-                    crossfade_amp *=
-                        ((float)velocity - lovel) / ((float)zones[z].velocity_low_fade * 2.f);
-                else if (velocity > (zones[z].velocity_high - zones[z].velocity_high_fade))
-                    crossfade_amp *=
-                        1.f -
-                        (((float)velocity - zones[z].velocity_high + zones[z].velocity_high_fade) /
-                         ((float)zones[z].velocity_high_fade * 2.f));
-                crossfade_amp = limit_range(crossfade_amp, 0.f, 1.f);
-            }
-        }
+        // equal power (vs_xf_equality) is already folded into both gains
+        float crossfade_amp = e->key_gain * velocity_amp;
 
         // if mono, release other voices
         // bool do_play = true;
 
         if (!zones[z].ignore_part_polymode && (parts[p].polymode == polymode_mono))
         {
-            int tv;
-            for (tv = 0; tv < MAX_VOICES; tv++)
+            for (int i = 0; i < voice_alloc.active_count(); i++)
             {
-                if (voice_state[tv].active && (voice_state[tv].part == p) &&
+                int tv = voice_alloc.active_voice(i);
+                if ((voice_state[tv].part == p) &&
                     !zones[voice_state[tv].zone_id].ignore_part_polymode)
+                {
                     voices[tv]->uberrelease();
+                    voice_alloc.mark_killed(tv);
+                }
             }
         }
 
@@ -373,44 +317,37 @@ bool sampler::PlayNote(char channel, char key, char velocity, bool is_release, c
 
         if (zones[z].mute_group)
         {
-            int tv;
             int mg = zones[z].mute_group;
-            for (tv = 0; tv < MAX_VOICES; tv++)
+            for (int i = 0; i < voice_alloc.active_count(); i++)
             {
-                if (voice_state[tv].active && (zones[voice_state[tv].zone_id].mute_group ==
-                                               mg) /* && (z!=voice_state[tv].zone_id)*/)
+                int tv = voice_alloc.active_voice(i);
+                if (zones[voice_state[tv].zone_id].mute_group ==
+                    mg /* && (z!=voice_state[tv].zone_id)*/)
                 {
                     voices[tv]->uberrelease();
+                    voice_alloc.mark_killed(tv);
                 }
             }
         }
 
-        if (parts[zones[z].part & 0xf].vs_xf_equality)
-            crossfade_amp = sqrt(crossfade_amp);
-
         if ((zones[z].sample_id >= 0) && samples[zones[z].sample_id])
         {
             update_zone_switches(z);
             voices[v]->play(samples[zones[z].sample_id].get(), &zones[z], &parts[p], key, velocity,
                             detune, &controllers[n_controllers * channel], automation,
-                            crossfade_amp);
-            voice_state[v].active = true;
+                            crossfade_amp, offset, voice_interpolation(zones[z]));
             voice_state[v].key = key;
             voice_state[v].channel = channel;
             voice_state[v].part = p;
             voice_state[v].zone_id = z;
-            polyphony++;
+            activate_voice(v);
         }
 
         if (wrappers.size() && (parts[editorpart].MIDIchannel == channel))
         {
             track_zone_triggered(z, true);
         }
-
-    skipzone:
-        int asdf = 0; // do nothing
     }
-    update_highest_voice_id();
 
     return true;
 }
@@ -445,11 +382,11 @@ void sampler::track_key_triggered(int ch, int key, int vel)
 
 int sampler::get_zone_poly(int zone)
 {
-    int n = 0, i;
+    int n = 0;
 
-    for (i = 0; i < MAX_VOICES; i++)
+    for (int i = 0; i < voice_alloc.active_count(); i++)
     {
-        if (voice_state[i].active && (voice_state[i].zone_id == zone))
+        if (voice_state[voice_alloc.active_voice(i)].zone_id == zone)
             n++;
     }
     return n;
@@ -469,12 +406,10 @@ int sampler::get_group_poly(int group)
 
 bool sampler::get_slice_state(int zone, int slice)
 {
-    int n = 0, i;
-
-    for (i = 0; i < MAX_VOICES; i++)
+    for (int i = 0; i < voice_alloc.active_count(); i++)
     {
-        if (voice_state[i].active && (voice_state[i].zone_id == zone) &&
-            (voices[i]->slice_id == slice))
+        int v = voice_alloc.active_voice(i);
+        if ((voice_state[v].zone_id == zone) && (voices[v]->slice_id == slice))
             return true;
     }
     return false;
@@ -482,14 +417,24 @@ bool sampler::get_slice_state(int zone, int slice)
 
 bool sampler::is_key_down(int channel, int key) { return (keystate[channel][key] > 0); }
 
-void sampler::ReleaseNote(char channel, char key, char velocity)
+void sampler::ReleaseNote(char channel, char key, char velocity, int offset)
 {
+    engine_context_scope ctx_scope(&engine_ctx);
+    scxt::Realtime::Scope rt_scope;
+
     // upsate keystate
     keystate[channel][key] = 0;
 
-    // find note
-    for (int i = 0; i < MAX_VOICES; i++)
+    // find note. work on a copy of the active list since retriggering a mono part below
+    // starts and frees voices
+    int16_t candidates[MAX_VOICES];
+    int n_candidates = voice_alloc.active_count();
+    for (int c = 0; c < n_candidates; c++)
+        candidates[c] = voice_alloc.active_voice(c);
+
+    for (int c = 0; c < n_candidates; c++)
     {
+        int i = candidates[c];
         if (voice_state[i].active && (voice_state[i].key == key) &&
             (voice_state[i].channel == channel))
         {
@@ -502,7 +447,8 @@ void sampler::ReleaseNote(char channel, char key, char velocity)
                 if ((polymode == polymode_poly) || z->ignore_part_polymode)
                 {
                     // poly, release as usual..
-                    voices[i]->release(127); // hold pedal is not down
+                    voices[i]->release(127, offset); // hold pedal is not down
+                    voice_alloc.mark_released(i);
                 }
                 else
                 {
@@ -532,12 +478,14 @@ void sampler::ReleaseNote(char channel, char key, char velocity)
                         else if (polymode == polymode_mono)
                         {
                             voices[i]->uberrelease();
-                            this->PlayNote(channel, k, keystate[channel][k]);
+                            voice_alloc.mark_killed(i);
+                            this->PlayNote(channel, k, keystate[channel][k], false, 0, offset);
                         }
                     }
                     else
                     {
-                        voices[i]->release(127);
+                        voices[i]->release(127, offset);
+                        voice_alloc.mark_released(i);
                     }
                 }
             }
@@ -550,12 +498,11 @@ void sampler::ReleaseNote(char channel, char key, char velocity)
     }
 
     // find matching zone and see if it has playmode == pm_forward_release
-    PlayNote(channel, key, velocity, true);
+    PlayNote(channel, key, velocity, true, 0, offset);
 }
 
 void sampler::voice_off(uint32_t voice_id)
 {
-    voice_state[voice_id].active = false;
-    polyphony--;
+    free_voice(voice_id);
     holdbuffer.remove(voice_id);
 }
@@ -24,6 +24,12 @@
 #include <vt_dsp/basic_dsp.h>
 #include "interaction_parameters.h"
 #include "util/tools.h"
+#include "infrastructure/rt_guard.h"
+#include "infrastructure/trace.h"
+#include "infrastructure/worker_pool.h"
+#include <cassert>
+#include <climits>
+#include <cstdint>
 
 using std::max;
 using std::min;
@@ -34,10 +40,17 @@ float *sampler::get_output_pointer(int id, int channel, int part)
         return output_part[(part << 1) + channel];
     else if (id >= out_fx1)
         return output_fx[(((id - out_fx1) & 0x7) << 1) + channel];
-    // else return output_ptr[(((id-out_output1)&0x7)<<1)+channel];
-    // HACK, disablad no-memcpy speedup
     else
-        return output[(((id - out_output1) & 0x7) << 1) + channel];
+        return output_ptr[(((id - out_output1) & 0x7) << 1) + channel];
+}
+
+void sampler::set_output_pointers(int out, float *L, float *R)
+{
+    assert((out >= 0) && (out < MAX_OUTPUTS));
+    assert(!L || !((uintptr_t)L & 0xf));
+    assert(!R || !((uintptr_t)R & 0xf));
+    output_ptr[out << 1] = L ? L : output[out << 1];
+    output_ptr[(out << 1) + 1] = R ? R : output[(out << 1) + 1];
 }
 
 void sampler::part_check_filtertypes(int p, int f)
@@ -58,6 +71,15 @@ void sampler::part_check_filtertypes(int p, int f)
     }
 }
 
+// below this an effect or part input counts as silent (about -140 dB)
+static constexpr float silence_threshold = 1e-7f;
+
+// idle time saturates here, past any tail a filter can declare
+static int advance_idle(int idle)
+{
+    return std::min(idle + (int)BLOCK_SIZE, tail_infinite);
+}
+
 void sampler::process_global_effects()
 {
     for (int f = 0; f < N_SAMPLER_EFFECTS; f++)
@@ -79,6 +101,15 @@ void sampler::process_global_effects()
 
             float *L = output_fx[f << 1];
             float *R = output_fx[(f << 1) + 1];
+
+            // sleep once the input has been silent for longer than the effect rings. a send
+            // arriving wakes it up in the same block
+            if (get_absmax_2(L, R, BLOCK_SIZE_QUAD) > silence_threshold)
+                multiv.idle_samples[f] = 0;
+            else if (multiv.idle_samples[f] > multiv.pFilter[f]->tail_length())
+                continue;
+            multiv.idle_samples[f] = advance_idle(multiv.idle_samples[f]);
+            scxt::Trace::Span trace_fx(scxt::Trace::Stage::Effect, f);
             float *mainL = get_output_pointer(multi.filter_output[f], 0, 0);
             float *mainR = get_output_pointer(multi.filter_output[f], 1, 0);
 
@@ -128,6 +159,17 @@ void sampler::process_part(int p)
             (1 - a) * parts[p].userparameter_smoothed[i] + a * parts[p].userparameter[i];
     }
 
+    // a part with no voices sleeps once its filters have rung out. the controllers above keep
+    // smoothing so it wakes up at the right values, render_voices() has already run so a new
+    // note wakes it in the block it starts in
+    part_check_filtertypes(p, 0);
+    part_check_filtertypes(p, 1);
+    if (partv[p].idle_samples > part_tail_length(p))
+        return;
+    partv[p].idle_samples = advance_idle(partv[p].idle_samples);
+
+    scxt::Trace::Span trace_part(scxt::Trace::Stage::Part, p);
+    scxt::Trace::Laps trace(p);
     partv[p].mm->process_part();
 
     // update interpolators
@@ -146,11 +188,9 @@ void sampler::process_part(int p)
         db_to_linear(partv[p].mm->get_destination_value(md_part_prefilter_gain)));
     partv[p].fmix1.set_target_smoothed(partv[p].mm->get_destination_value(md_part_filter1mix));
     partv[p].fmix2.set_target_smoothed(partv[p].mm->get_destination_value(md_part_filter2mix));
+    trace.mark(scxt::Trace::Stage::PartModMatrix);
 
     // process filters
-    part_check_filtertypes(p, 0);
-    part_check_filtertypes(p, 1);
-
     partv[p].pfg.multiply_2_blocks(L, R, BLOCK_SIZE_QUAD);
     if ((partv[p].pFilter[0]) && (!parts[p].Filter[0].bypass))
     {
@@ -162,6 +202,7 @@ void sampler::process_part(int p)
         partv[p].pFilter[1]->process_stereo(L, R, tempbuf[0], tempbuf[1], 0);
         partv[p].fmix2.fade_2_blocks_to(L, tempbuf[0], R, tempbuf[1], L, R, BLOCK_SIZE_QUAD);
     }
+    trace.mark(scxt::Trace::Stage::PartFilters);
 
     // process output
     partv[p].ampL.multiply_block_to(L, postfader_buf[0], BLOCK_SIZE_QUAD);
@@ -195,33 +236,179 @@ void sampler::process_part(int p)
             partv[p].aux2R.MAC_block_to(R, aux2R, BLOCK_SIZE_QUAD);
         }
     }
+    trace.mark(scxt::Trace::Stage::PartMix);
+}
+
+int sampler::part_tail_length(int p)
+{
+    int tail = BLOCK_SIZE; // let the output interpolators settle
+    for (int f = 0; f < 2; f++)
+    {
+        if (partv[p].pFilter[f] && !parts[p].Filter[f].bypass)
+            tail += partv[p].pFilter[f]->tail_length();
+    }
+    return tail;
+}
+
+#if SCXT_ENVELOPE_BANK
+void sampler::process_envelopes()
+{
+    // a voice released partway through the block splits its envelopes around the release point,
+    // it runs them itself
+    memset(envelope_run, 0, sizeof(envelope_run));
+    for (int i = 0; i < voice_alloc.active_count(); i++)
+    {
+        auto v = voices[voice_alloc.active_voice(i)];
+        if (v->release_offset)
+            continue;
+        envelope_run[v->voice_id * 2] = 1;
+        envelope_run[v->voice_id * 2 + 1] = (v->zone->element_active & ve_EG2) ? 1 : 0;
+        v->envelopes_done = true;
+    }
+    scxt::Trace::Span trace_bank(scxt::Trace::Stage::EnvelopeBank, 0);
+    envelopes.process(envelope_run);
+}
+#endif
+
+void sampler::render_voices()
+{
+    // backwards, as freeing a voice moves the last active voice into its slot
+    for (int i = voice_alloc.active_count() - 1; i >= 0; i--)
+    {
+        int v = voice_alloc.active_voice(i);
+        float *outbuf[3][2];
+        outbuf[0][0] = get_output_pointer(voices[v]->zone->aux[0].output, 0, voices[v]->zone->part);
+        outbuf[0][1] = get_output_pointer(voices[v]->zone->aux[0].output, 1, voices[v]->zone->part);
+        outbuf[1][0] = get_output_pointer(voices[v]->zone->aux[1].output, 0, voices[v]->zone->part);
+        outbuf[1][1] = get_output_pointer(voices[v]->zone->aux[1].output, 1, voices[v]->zone->part);
+        outbuf[2][0] = get_output_pointer(voices[v]->zone->aux[2].output, 0, voices[v]->zone->part);
+        outbuf[2][1] = get_output_pointer(voices[v]->zone->aux[2].output, 1, voices[v]->zone->part);
+
+        bool still_active = voices[v]->process_block(outbuf[0][0], outbuf[0][1], outbuf[1][0],
+                                                     outbuf[1][1], outbuf[2][0], outbuf[2][1]);
+
+        if (!still_active)
+        {
+            free_voice(v);
+            holdbuffer.remove(v);
+        }
+    }
 }
 
+void sampler::render_voice_job(void *ctx, int item, int worker)
+{
+    auto *s = (sampler *)ctx;
+    auto &job = s->voice_render_jobs[item];
+    engine_context_scope ctx_scope(&s->engine_ctx);
+    scxt::Realtime::Scope rt_scope;
+    for (auto &b : job.scratch)
+        clear_block(b, BLOCK_SIZE_QUAD);
+    job.still_active = s->voices[job.voice]->process_block(
+        job.scratch[0], job.scratch[1], job.scratch[2], job.scratch[3], job.scratch[4],
+        job.scratch[5]);
+}
+
+void sampler::render_voices_threaded()
+{
+    // take the voices in the order render_voices() visits them and sum them into the buses in
+    // that order too. each voice starts from silence in its scratch, so the result is
+    // bit-identical to rendering serially
+    int n = voice_alloc.active_count();
+    for (int i = 0; i < n; i++)
+        voice_render_jobs[i].voice = voice_alloc.active_voice(n - 1 - i);
+
+    voice_render_pool->run(n, render_voice_job, this);
+
+    for (int i = 0; i < n; i++)
+    {
+        auto &job = voice_render_jobs[i];
+        int v = job.voice;
+        sample_zone *zone = voices[v]->zone;
+
+        for (int a = 0; a < 3; a++)
+        {
+            // sampler_voice only writes the aux busses which are switched on
+            if (a && !zone->aux[a].outmode)
+                continue;
+            accumulate_block(job.scratch[a << 1],
+                             get_output_pointer(zone->aux[a].output, 0, zone->part),
+                             BLOCK_SIZE_QUAD);
+            accumulate_block(job.scratch[(a << 1) + 1],
+                             get_output_pointer(zone->aux[a].output, 1, zone->part),
+                             BLOCK_SIZE_QUAD);
+        }
+
+        if (!job.still_active)
+        {
+            free_voice(v);
+            holdbuffer.remove(v);
+        }
+    }
+}
+
+void sampler::set_voice_render_threads(int n)
+{
+    // start the threads before taking the lock and join the old ones after releasing it, the
+    // audio thread only waits for neither
+    std::unique_ptr<scxt::Threading::WorkerPool> pool;
+    if (n > 1)
+        pool = std::make_unique<scxt::Threading::WorkerPool>(n);
+    {
+        std::lock_guard g(cs_patch);
+        if (pool)
+            voice_render_jobs.resize(MAX_VOICES);
+        voice_render_pool.swap(pool);
+    }
+}
+
+
 void sampler::process_audio()
 {
+    // counts the block as done on every way out of here, see reclaim_retired()
+    struct block_end
+    {
+        std::atomic<uint64_t> &done;
+        ~block_end() { done.fetch_add(1, std::memory_order_release); }
+    } block_end{blocks_done};
+    engine_context_scope ctx_scope(&engine_ctx);
+    scxt::Realtime::Scope rt_scope;
+    scxt::Perf::LoadMeter::Block load_block(load_meter);
+    scxt::Trace::Span trace_block(scxt::Trace::Stage::EngineBlock, 0);
+    audio_thread.store(std::this_thread::get_id(), std::memory_order_relaxed);
+    // before the patch lock, an editor thread holding it may be waiting for these
+    process_kill_requests();
+    update_draft_state(); // from the blocks so far, before this block starts any notes
+
 #ifdef SCPB
     holdengine |= (scpb_queue_patch > -1);
 #endif
     if (holdengine)
     {
-        for (unsigned int op = 0; op < (mNumOutputs); op++)
-            clear_block(output[op], BLOCK_SIZE_QUAD << 1);
+        for (unsigned int op = 0; op < (mNumOutputs << 1); op++)
+            clear_block(output_ptr[op], BLOCK_SIZE_QUAD);
         return;
     }
-    processWrapperEvents();
 
-    /*if (sample_replace_filename[0])
+    // never wait for an editor thread holding the patch. editors only hold it to swap
+    // pointers and flags, and the voices render from what is published (zone index, compiled
+    // modulation, the kills above), so keep playing and leave the queued events for the next
+    // block. everything below runs on this thread, so the nested locks of the patch editing
+    // functions are recursive and don't wait either
+    std::unique_lock<std::recursive_mutex> patchLock(cs_patch, std::try_to_lock);
+    bool have_patch = patchLock.owns_lock();
+    if (have_patch)
     {
-            if(zone_exist(selected->get_active_id()) && (selected->get_active_type() == 1))
-                    replace_zone(selected->get_active_id(),string_to_path(sample_replace_filename));
-            sample_replace_filename[0] = 0;
-    }*/
+        processWrapperEvents();
 
-    if (sample_replace_filename[0])
-    {
-        if (zone_exist(selected->get_active_id()) && (selected->get_active_type() == 1))
-            kill_notes(selected->get_active_id());
+        // the replacement itself happens in idle(), once the zone is silent
+        if (sample_replace_filename[0])
+        {
+            if (zone_exist(selected->get_active_id()) && (selected->get_active_type() == 1))
+                kill_notes(selected->get_active_id());
+        }
     }
+    else
+        patch_busy_blocks++;
 
     // memset(output,0,sizeof(output));
     for (unsigned int op = 0; op < (mNumOutputs << 1); op++)
@@ -233,37 +420,23 @@ void sampler::process_audio()
 
     // clear buffers & process controls
     {
-        std::lock_guard g(cs_patch);
+        // parts with a voice this block are awake, see process_part()
+        for (int i = 0; i < voice_alloc.active_count(); i++)
+            partv[voices[voice_alloc.active_voice(i)]->zone->part & (N_SAMPLER_PARTS - 1)]
+                .idle_samples = 0;
 
         // render voices
-        for (unsigned int v = 0; v < highest_voice_id; v++)
         {
-            if (voice_state[v].active) // is bottleneck at idle (?)
-            {
-                float *outbuf[3][2];
-                outbuf[0][0] =
-                    get_output_pointer(voices[v]->zone->aux[0].output, 0, voices[v]->zone->part);
-                outbuf[0][1] =
-                    get_output_pointer(voices[v]->zone->aux[0].output, 1, voices[v]->zone->part);
-                outbuf[1][0] =
-                    get_output_pointer(voices[v]->zone->aux[1].output, 0, voices[v]->zone->part);
-                outbuf[1][1] =
-                    get_output_pointer(voices[v]->zone->aux[1].output, 1, voices[v]->zone->part);
-                outbuf[2][0] =
-                    get_output_pointer(voices[v]->zone->aux[2].output, 0, voices[v]->zone->part);
-                outbuf[2][1] =
-                    get_output_pointer(voices[v]->zone->aux[2].output, 1, voices[v]->zone->part);
-
-                voice_state[v].active =
-                    voices[v]->process_block(outbuf[0][0], outbuf[0][1], outbuf[1][0], outbuf[1][1],
-                                             outbuf[2][0], outbuf[2][1]);
-
-                if (!voice_state[v].active)
-                {
-                    polyphony--;
-                    holdbuffer.remove(v);
-                }
-            }
+            scxt::Trace::Span trace_voices(scxt::Trace::Stage::RenderVoices,
+                                           voice_alloc.active_count());
+#if SCXT_ENVELOPE_BANK
+            process_envelopes();
+#endif
+            // the pool is swapped under the patch lock, see set_voice_render_threads()
+            if (have_patch && voice_render_pool && (voice_alloc.active_count() > 1))
+                render_voices_threaded();
+            else
+                render_voices();
         }
 
         // process parts
@@ -278,7 +451,8 @@ void sampler::process_audio()
         if (mpPreview->mActive)
         {
             bool ContinuePreviewing =
-                mpPreview->mpVoice->process_block(output[0], output[1], NULL, NULL, NULL, NULL);
+                mpPreview->mpVoice->process_block(output_ptr[0], output_ptr[1], NULL, NULL, NULL,
+                                                  NULL);
 
             if (!ContinuePreviewing)
             {
@@ -306,7 +480,7 @@ void sampler::processVUsAndPolyphonyUpdates()
 {
     for (int op = 0; op < (mNumOutputs * 2); op++)
     {
-        vu_peak[op] = max(vu_peak[op], get_absmax(output[op], BLOCK_SIZE_QUAD));
+        vu_peak[op] = max(vu_peak[op], get_absmax(output_ptr[op], BLOCK_SIZE_QUAD));
     }
 
     VUidx--;
@@ -334,6 +508,28 @@ void sampler::processVUsAndPolyphonyUpdates()
         }
         postEventsToWrapper(ad);
 
+        // dsp load, two messages. subid 0: f[0] smoothed load, f[1] peak since the last one
+        // (1 is the whole block budget), i[2] blocks over budget, i[3] blocks timed, f[4] the
+        // budget in us, i[5] new voices are in draft quality. subid 1: i[0..11] the histogram.
+        // counts saturate
+        auto saturate_int = [](uint64_t v) { return (int)std::min(v, (uint64_t)INT_MAX); };
+        auto &ls = load_meter.stats();
+        actiondata lad;
+        lad.actiontype = vga_dspload;
+        lad.id = ip_dspload;
+        lad.subid = 0;
+        lad.data.f[0] = ls.load;
+        lad.data.f[1] = load_meter.takePeak();
+        lad.data.i[2] = saturate_int(ls.overBudget);
+        lad.data.i[3] = saturate_int(ls.blocks);
+        lad.data.f[4] = (float)(ls.budgetNs * 1e-3);
+        lad.data.i[5] = mDraftActive ? 1 : 0;
+        postEventsToWrapper(lad);
+        lad.subid = 1;
+        for (int b = 0; b < scxt::Perf::LoadMeter::histogramBuckets; b++)
+            lad.data.i[b] = saturate_int(ls.histogram[b]);
+        postEventsToWrapper(lad);
+
         if (polyphony != lastSentPolyphony)
         {
             actiondata ad;
@@ -71,6 +71,20 @@ const char playmode_names[n_playmodes][32] = {
     "Loop Bidirectional", "Oneshot", "Slice Keymapped",
     "On Release" /*,"Reverse","Reverse Oneshot"*/};
 
+// zone interpolation, zi_default follows the global setting. the rest are GeneratorInterpolation + 1
+enum zone_interpolation
+{
+    zi_default = 0,
+    zi_linear,
+    zi_cubic,
+    zi_sinc16,
+    zi_sinc32,
+    zi_sinc64,
+    n_zone_interpolations
+};
+const char zone_interpolation_names[n_zone_interpolations][16] = {
+    "Default", "Linear", "Cubic", "Sinc 16", "Sinc 32", "Sinc 64"};
+
 //-------------------------------------------------------------------------------------------------------
 
 enum
@@ -513,6 +527,7 @@ struct sample_zone
     int ignore_part_polymode;
     int mute;
     int reverse;
+    int interpolation; // zone_interpolation
     float lag_generator[2];
 
     // voice allocation (mono/legato & portamento) do not store/recall
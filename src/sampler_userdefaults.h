@@ -29,6 +29,10 @@ enum DefaultKeys
     zoomLevel,
     previewAuto,
     previewLevel,
+    interpolation,
+    draftOnOverload,
+    buildMips,
+    resampleOnLoad,
     nKeys
 };
 inline std::string defaultKeyToString(DefaultKeys k)
@@ -41,6 +45,14 @@ inline std::string defaultKeyToString(DefaultKeys k)
         return "previewAuto";
     case previewLevel:
         return "previewLevel";
+    case interpolation:
+        return "interpolation";
+    case draftOnOverload:
+        return "draftOnOverload";
+    case buildMips:
+        return "buildMips";
+    case resampleOnLoad:
+        return "resampleOnLoad";
     case nKeys:
         return "nKeys";
     default:
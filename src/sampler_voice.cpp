@@ -16,10 +16,12 @@
 */
 
 #include <cassert>
+#include <vector>
 
 #include "sst/filters/HalfRateFilter.h"
 
 #include "sampler_voice.h"
+#include "halfrate_pool.h"
 #include "controllers.h"
 #include "sampler.h"
 #include "util/tools.h"
@@ -28,6 +30,7 @@
 #include "sample.h"
 #include "sampler_state.h"
 #include "synthesis/filter.h"
+#include "infrastructure/trace.h"
 
 #include <vt_dsp/basic_dsp.h>
 
@@ -38,73 +41,133 @@ float SincTableF32 alignas(64)[(FIRipol_M + 1) * FIRipol_N];
 float SincOffsetF32 alignas(64)[(FIRipol_M)*FIRipol_N];
 short SincTableI16 alignas(64)[(FIRipol_M + 1) * FIRipolI16_N];
 short SincOffsetI16 alignas(64)[(FIRipol_M)*FIRipolI16_N];
-
-float table_dB[512], table_pitch[512], table_envrate_lpf[512], table_envrate_linear[512];
+// per phase: the 16 taps followed by their 16 offsets, for the generator block kernels
+float SincPhaseF32 alignas(64)[(FIRipol_M)*FIRipol_N * 2];
+short SincPhaseI16 alignas(64)[(FIRipol_M)*FIRipolI16_N * 2];
+// same layout for the long sincs, float only (the int16 generators convert the samples)
+float SincLongPhaseF32 alignas(64)[(FIRipol_M)*FIRipolLong_N * 2];
+float SincLongerPhaseF32 alignas(64)[(FIRipol_M)*FIRipolLonger_N * 2];
+
+float table_dB[512], table_pitch[512];
 float waveshapers[8][1024]; // typ?
 
 bool sinc_initialized = false;
 
-sampler_voice::sampler_voice(uint32_t voice_id, timedata *td)
+// same window and cutoff as the 16 tap table, the extra length only sharpens the transition
+static void init_long_sinc_table(float *table, int n)
 {
-    halfrate = new sst::filters::HalfRate::HalfRateFilter(4, false);
+    float cutoff = 0.95f;
+    std::vector<double> row(n), next(n);
+    for (int i = 0; i < n; i++)
+    {
+        double t = -double(i) + double(n / 2.0) - 1.0;
+        next[i] = (float)(SymmetricKaiser(t, n, 5.0) * cutoff * sincf(cutoff * t));
+    }
+    for (int j = 0; j < FIRipol_M; j++)
+    {
+        row.swap(next);
+        for (int i = 0; i < n; i++)
+        {
+            double t = -double(i) + double(n / 2.0) + double(j + 1) / double(FIRipol_M) - 1.0;
+            next[i] = (float)(SymmetricKaiser(t, n, 5.0) * cutoff * sincf(cutoff * t));
 
-    voice_filter[0] = nullptr;
-    voice_filter[1] = nullptr;
+            table[j * n * 2 + i] = row[i];
+            table[j * n * 2 + n + i] = (float)((next[i] - row[i]) * (1.0 / 65536.0));
+        }
+    }
+}
 
-    this->voice_id = voice_id;
-    this->td = td;
+void init_sinc_tables()
+{
+    if (sinc_initialized)
+        return;
 
-    // create filters if first instance of class
-    if (!sinc_initialized)
+    float cutoff = 0.95f;
+    float cutoffI16 = 0.95f;
+    int j;
+    for (j = 0; j < FIRipol_M + 1; j++)
     {
-        float cutoff = 0.95f;
-        float cutoffI16 = 0.95f;
-        int j;
-        for (j = 0; j < FIRipol_M + 1; j++)
+        for (int i = 0; i < FIRipol_N; i++)
         {
-            for (int i = 0; i < FIRipol_N; i++)
-            {
-                double t =
-                    -double(i) + double(FIRipol_N / 2.0) + double(j) / double(FIRipol_M) - 1.0;
-                double val =
-                    (float)(SymmetricKaiser(t, FIRipol_N, 5.0) * cutoff * sincf(cutoff * t));
-
-                SincTableF32[j * FIRipol_N + i] = val;
-            }
+            double t = -double(i) + double(FIRipol_N / 2.0) + double(j) / double(FIRipol_M) - 1.0;
+            double val = (float)(SymmetricKaiser(t, FIRipol_N, 5.0) * cutoff * sincf(cutoff * t));
+
+            SincTableF32[j * FIRipol_N + i] = val;
         }
-        for (j = 0; j < FIRipol_M; j++)
+    }
+    for (j = 0; j < FIRipol_M; j++)
+    {
+        for (int i = 0; i < FIRipol_N; i++)
         {
-            for (int i = 0; i < FIRipol_N; i++)
-            {
-                SincOffsetF32[j * FIRipol_N + i] = (float)((SincTableF32[(j + 1) * FIRipol_N + i] -
-                                                            SincTableF32[j * FIRipol_N + i]) *
-                                                           (1.0 / 65536.0));
-            }
+            SincOffsetF32[j * FIRipol_N + i] = (float)((SincTableF32[(j + 1) * FIRipol_N + i] -
+                                                        SincTableF32[j * FIRipol_N + i]) *
+                                                       (1.0 / 65536.0));
         }
+    }
 
-        for (j = 0; j < FIRipol_M + 1; j++)
+    for (j = 0; j < FIRipol_M + 1; j++)
+    {
+        for (int i = 0; i < FIRipolI16_N; i++)
         {
-            for (int i = 0; i < FIRipolI16_N; i++)
-            {
-                double t =
-                    -double(i) + double(FIRipolI16_N / 2.0) + double(j) / double(FIRipol_M) - 1.0;
-                double val =
-                    (float)(SymmetricKaiser(t, FIRipol_N, 5.0) * cutoffI16 * sincf(cutoffI16 * t));
-
-                SincTableI16[j * FIRipolI16_N + i] = val * 16384;
-            }
+            double t =
+                -double(i) + double(FIRipolI16_N / 2.0) + double(j) / double(FIRipol_M) - 1.0;
+            double val =
+                (float)(SymmetricKaiser(t, FIRipol_N, 5.0) * cutoffI16 * sincf(cutoffI16 * t));
+
+            SincTableI16[j * FIRipolI16_N + i] = val * 16384;
         }
-        for (j = 0; j < FIRipol_M; j++)
+    }
+    for (j = 0; j < FIRipol_M; j++)
+    {
+        for (int i = 0; i < FIRipolI16_N; i++)
         {
-            for (int i = 0; i < FIRipolI16_N; i++)
-            {
-                SincOffsetI16[j * FIRipolI16_N + i] =
-                    (SincTableI16[(j + 1) * FIRipolI16_N + i] - SincTableI16[j * FIRipolI16_N + i]);
-            }
+            SincOffsetI16[j * FIRipolI16_N + i] =
+                (SincTableI16[(j + 1) * FIRipolI16_N + i] - SincTableI16[j * FIRipolI16_N + i]);
         }
-        sinc_initialized = true;
     }
 
+    for (j = 0; j < FIRipol_M; j++)
+    {
+        for (int i = 0; i < FIRipol_N; i++)
+        {
+            SincPhaseF32[j * FIRipol_N * 2 + i] = SincTableF32[j * FIRipol_N + i];
+            SincPhaseF32[j * FIRipol_N * 2 + FIRipol_N + i] = SincOffsetF32[j * FIRipol_N + i];
+        }
+        for (int i = 0; i < FIRipolI16_N; i++)
+        {
+            SincPhaseI16[j * FIRipolI16_N * 2 + i] = SincTableI16[j * FIRipolI16_N + i];
+            SincPhaseI16[j * FIRipolI16_N * 2 + FIRipolI16_N + i] =
+                SincOffsetI16[j * FIRipolI16_N + i];
+        }
+    }
+
+    init_long_sinc_table(SincLongPhaseF32, FIRipolLong_N);
+    init_long_sinc_table(SincLongerPhaseF32, FIRipolLonger_N);
+    sinc_initialized = true;
+}
+
+sampler_voice::sampler_voice(uint32_t voice_id, timedata *td, halfrate_pool *halfrates,
+                             envelope_bank *envelopes)
+    : own_envelopes(envelopes ? 0 : 2),
+      AEG(envelopes ? envelopes : &own_envelopes, envelopes ? voice_id * 2 : 0),
+      EG2(envelopes ? envelopes : &own_envelopes, envelopes ? voice_id * 2 + 1 : 1)
+{
+    envelopes_done = false;
+    this->halfrates = halfrates;
+    halfrate = nullptr;
+    use_oversampling = false;
+
+    voice_filter[0] = nullptr;
+    voice_filter[1] = nullptr;
+
+    this->voice_id = voice_id;
+    this->td = td;
+    start_delay = 0;
+    release_offset = 0;
+
+    // create filters if first instance of class
+    init_sinc_tables();
+
     faderL.set_blocksize(BLOCK_SIZE);
     faderR.set_blocksize(BLOCK_SIZE);
     vca.set_blocksize(BLOCK_SIZE);
@@ -124,12 +187,27 @@ sampler_voice::~sampler_voice()
     spawn_filter_release(voice_filter[1]);
     voice_filter[1] = nullptr;
 
-    delete halfrate;
+    release_oversampling();
+}
+
+void sampler_voice::release_oversampling()
+{
+    halfrates->release(halfrate);
+    halfrate = nullptr;
+    use_oversampling = false;
+}
+
+void sampler_voice::lost_halfrate()
+{
+    halfrate = nullptr;
+    use_oversampling = false;
+    GD.BlockSize = BLOCK_SIZE;
+    pfg.set_blocksize(BLOCK_SIZE);
 }
 
 void sampler_voice::play(sample *wave, sample_zone *zone, sample_part *part, uint32_t key,
                          uint32_t velocity, int detune, float *ctrl, float *autom,
-                         float crossfade_amp)
+                         float crossfade_amp, int start_offset, int interpolation)
 {
     this->zone = zone;
     this->part = part;
@@ -173,24 +251,32 @@ void sampler_voice::play(sample *wave, sample_zone *zone, sample_part *part, uin
     slice_env = 0;
     time60 = 0;
     loop_pos = 0;
-    random = (float)rand() / (float)RAND_MAX;
-    randombp = ((float)rand() / (float)RAND_MAX) * 2.f - 1.f;
+    random = rng.unipolar();
+    randombp = rng.bipolar();
     envelope_follower = 0;
     grain_id = 0;
 
     // GDIO.fReleaseCallback = uberrelease;
     GDIO.OutputL = output[0];
     GDIO.OutputR = output[1];
-    GDIO.SampleDataL = wave->SampleData[0];
-    GDIO.SampleDataR = wave->SampleData[1];
     assert(wave);
-    assert(GDIO.SampleDataL);
+    // looped zones stay on the original, moving short loops to another rate would detune them
+    uint32_t rate = (uint32_t)lrint(current_engine().samplerate);
+    conversion = pm_has_loop(zone->playmode) ? nullptr : wave->find_conversion(rate);
+    pos_scale = conversion ? (double)conversion->rate / (double)wave->sample_rate : 1.0;
+    set_sample_data(0);
     GDIO.VoicePtr = this;
-    GDIO.WaveSize = wave->sample_length;
+    GDIO.WaveSize = conversion ? conversion->length : wave->sample_length;
 
     this->crossfade_amp = crossfade_amp;
 
-    halfrate->reset();
+    start_delay = limit_range(start_offset, 0, (int)BLOCK_SIZE - 1);
+    if (start_delay)
+        memset(start_carry, 0, sizeof(start_carry));
+    release_offset = 0;
+
+    // a voice restarted without being freed still has the filter of its last note
+    release_oversampling();
 
     mm.assign(nullptr, zone, part, this, ctrl, autom, td);
     mm.process();
@@ -205,9 +291,9 @@ void sampler_voice::play(sample *wave, sample_zone *zone, sample_part *part, uin
                mm.get_destination_ptr(md_EG2_d), mm.get_destination_ptr(md_EG2_s),
                mm.get_destination_ptr(md_EG2_r), zone->EG2.shape);
 
-    stepLFO[0].assign(&zone->LFO[0], mm.get_destination_ptr(md_LFO1_rate), td);
-    stepLFO[1].assign(&zone->LFO[1], mm.get_destination_ptr(md_LFO2_rate), td);
-    stepLFO[2].assign(&zone->LFO[2], mm.get_destination_ptr(md_LFO3_rate), td);
+    stepLFO[0].assign(&zone->LFO[0], mm.get_destination_ptr(md_LFO1_rate), td, rng);
+    stepLFO[1].assign(&zone->LFO[1], mm.get_destination_ptr(md_LFO2_rate), td, rng);
+    stepLFO[2].assign(&zone->LFO[2], mm.get_destination_ptr(md_LFO3_rate), td, rng);
 
     AEG.Attack();
     EG2.Attack();
@@ -240,20 +326,20 @@ void sampler_voice::play(sample *wave, sample_zone *zone, sample_part *part, uin
     }
 
     GD.SamplePos = (int)mm.get_destination_value(md_sample_start);
-    GD.SamplePos = limit_range(GD.SamplePos, 0, (int)zone->sample_stop);
+    GD.SamplePos = data_pos(limit_range(GD.SamplePos, 0, (int)zone->sample_stop));
 
     last_loopstart = mm.get_destination_value(md_loop_start);
     last_loopend =
         mm.get_destination_value(md_loop_length) + mm.get_destination_value(md_loop_start);
     GD.SampleSubPos = 0;
-    GD.LowerBound = zone->sample_start;
-    GD.UpperBound = zone->sample_stop;
+    GD.LowerBound = data_pos(zone->sample_start);
+    GD.UpperBound = data_pos(zone->sample_stop);
     GD.Direction = 1;
     GD.IsFinished = 0;
 
     if (zone->reverse)
     {
-        GD.SamplePos = zone->sample_stop;
+        GD.SamplePos = data_pos(zone->sample_stop);
         GD.Direction = -1;
     }
 
@@ -267,14 +353,14 @@ void sampler_voice::play(sample *wave, sample_zone *zone, sample_part *part, uin
 
     if (playmode == pm_forward_hitpoints)
     {
-        end_offset = ((unsigned int)samplerate) >> 7; //
+        end_offset = ((unsigned int)current_engine().samplerate) >> 7; //
         int sp = key - zone->key_root;
         if ((sp >= 0) && (sp < zone->n_hitpoints) && (!zone->hp[sp].muted))
         {
             slice_env = zone->hp[sp].env;
 
-            GD.LowerBound = zone->hp[sp].start_sample;
-            GD.UpperBound = zone->hp[sp].end_sample;
+            GD.LowerBound = data_pos(zone->hp[sp].start_sample);
+            GD.UpperBound = data_pos(zone->hp[sp].end_sample);
 
             GD.SamplePos = zone->reverse ? GD.UpperBound : GD.LowerBound;
             // slice_end = &zone->hp[sp].end_sample;
@@ -288,13 +374,17 @@ void sampler_voice::play(sample *wave, sample_zone *zone, sample_part *part, uin
         ((playmode == pm_forward_loop) || ((playmode == pm_forward_loop_until_release) && gate) ||
          (playmode == pm_forward_loop_bidirectional));
 
-    // determine whether to use oversampling
+    // determine whether to use oversampling. with mip maps only beyond the top level
     CalcRatio();
     if (GD.Ratio < 0)
-        GD.SamplePos = zone->sample_stop;
+        GD.SamplePos = data_pos(zone->sample_stop);
     // use_oversampling = resample_ratio > 16777216;
-    use_oversampling = abs(GD.Ratio) > 18000000;
+    int mip_levels = conversion ? 0 : wave->mip_levels.load(std::memory_order_acquire);
+    if ((abs(GD.Ratio) >> mip_levels) > MipUpRatio)
+        halfrate = halfrates->acquire(interpolation, this);
+    use_oversampling = (halfrate != nullptr);
     use_stereo = (wave->channels == 2);
+    update_mip_level(use_oversampling ? (abs(GD.Ratio) >> 1) : abs(GD.Ratio));
 
     GD.BlockSize = use_oversampling ? (BLOCK_SIZE * 2) : BLOCK_SIZE;
 
@@ -332,7 +422,7 @@ void sampler_voice::play(sample *wave, sample_zone *zone, sample_part *part, uin
         break;
     }
 
-    Generator = GetFPtrGeneratorSample(use_stereo, !wave->UseInt16, gmode);
+    Generator = GetFPtrGeneratorSample(use_stereo, !wave->UseInt16, gmode, interpolation);
 
     assert(Generator);
 }
@@ -354,8 +444,18 @@ void sampler_voice::change_key(int key, int vel, int detune)
     portamento_active = true;
 }
 
-void sampler_voice::release(uint32_t velocity)
+void sampler_voice::release(uint32_t velocity, int offset)
 {
+    // the voice's timeline lags the block grid by start_delay, so a release early in the block
+    // can already have passed for it
+    offset -= start_delay;
+    if (gate && (offset > 0) && (offset < (int)BLOCK_SIZE))
+    {
+        release_offset = offset;
+        release_velocity = velocity;
+        return;
+    }
+
     if (gate)
     {
         if (playmode != pm_forward_shot)
@@ -374,6 +474,20 @@ void sampler_voice::release(uint32_t velocity)
     }
 }
 
+void sampler_voice::apply_start_delay()
+{
+    // out = carry[0 .. d) + out[0 .. n-d), carry = out[n-d .. n)
+    const int d = start_delay;
+    for (int c = 0; c < 2; c++)
+    {
+        float tail[BLOCK_SIZE];
+        memcpy(tail, &output[c][BLOCK_SIZE - d], d * sizeof(float));
+        memmove(&output[c][d], &output[c][0], (BLOCK_SIZE - d) * sizeof(float));
+        memcpy(&output[c][0], start_carry[c], d * sizeof(float));
+        memcpy(start_carry[c], tail, d * sizeof(float));
+    }
+}
+
 void sampler_voice::uberrelease()
 {
     AEG.UberRelease();
@@ -384,6 +498,12 @@ void sampler_voice::uberrelease()
 
 inline int sampler_voice::get_filter_type(int id) const { return zone->Filter[id].type; }
 
+void sampler_voice::seed_random(uint64_t seed)
+{
+    rng.seed(seed);
+    mm.seed_noise(rng.next64());
+}
+
 void sampler_voice::check_filtertypes()
 {
     //	have the filtertypes changed?
@@ -393,7 +513,10 @@ void sampler_voice::check_filtertypes()
         voice_filter[0] = spawn_filter(get_filter_type(0), mm.get_destination_ptr(md_filter1prm0),
                                        zone->Filter[0].ip, nullptr, true);
         if (voice_filter[0])
+        {
+            voice_filter[0]->seed_random(rng.next64());
             voice_filter[0]->init();
+        }
         last_ft[0] = get_filter_type(0);
     }
     if (last_ft[1] != get_filter_type(1))
@@ -402,7 +525,10 @@ void sampler_voice::check_filtertypes()
         voice_filter[1] = spawn_filter(get_filter_type(1), mm.get_destination_ptr(md_filter2prm0),
                                        zone->Filter[1].ip, nullptr, true);
         if (voice_filter[1])
+        {
+            voice_filter[1]->seed_random(rng.next64());
             voice_filter[1]->init();
+        }
         last_ft[1] = get_filter_type(1);
     }
 }
@@ -410,7 +536,7 @@ void sampler_voice::check_filtertypes()
 void sampler_voice::update_lag_gen(int id)
 {
     // lag generators
-    const float integratorconst = samplerate_inv * BLOCK_SIZE;
+    const float integratorconst = current_engine().samplerate_inv * BLOCK_SIZE;
     if (zone->lag_generator[id] != 0)
     {
         float x = PI_1 * note_to_pitch(-12 * zone->lag_generator[id]) * integratorconst;
@@ -427,7 +553,8 @@ void sampler_voice::update_portamento()
     float ratemult = 1.f;
     if (part->portamento_mode)
         ratemult = 12.f / (0.00001f + fabs(((float)key + 0.01f * detune) - portasrc_key));
-    portaphase += BLOCK_SIZE * note_to_pitch(-12.f * part->portamento) * samplerate_inv * ratemult;
+    portaphase += BLOCK_SIZE * note_to_pitch(-12.f * part->portamento) *
+                  current_engine().samplerate_inv * ratemult;
     if (portaphase < 1.f)
     {
         fkey = (1.f - portaphase) * portasrc_key + (float)portaphase * (key + 0.01f * detune);
@@ -439,14 +566,6 @@ void sampler_voice::update_portamento()
     }
 }
 
-#define perfprof 0
-
-#if perfprof
-#define perfslot(x) perf[x] = __rdtsc();
-#else
-#define perfslot(x)
-#endif
-
 void sampler_voice::CalcRatio()
 {
     keytrack = (fkey + zone->pitch_bend_depth * ctrl[c_pitch_bend] - 60.0f) *
@@ -460,35 +579,92 @@ void sampler_voice::CalcRatio()
     // loop_pos = limit_range((sample_pos -
     // mm.get_destination_value_int(md_loop_start))/(float)mm.get_destination_value_int(md_loop_length),0,1);
 
-    GD.Ratio = Float2Int((float)((wave->sample_rate * samplerate_inv) * 16777216.f *
+    float rate = conversion ? (float)conversion->rate : wave->sample_rate;
+    GD.Ratio = Float2Int((float)((rate * current_engine().samplerate_inv) * 16777216.f *
                                  note_to_pitch(fpitch + kt - zone->pitchcorrection) *
                                  mm.get_destination_value(md_rate)));
+    // float rounding leaves an untransposed zone a step or two off unity, which would miss the
+    // generator's copy path
+    if (abs(abs(GD.Ratio) - (1 << 24)) <= 2)
+        GD.Ratio = (GD.Ratio < 0) ? -(1 << 24) : (1 << 24);
     fpitch += fkey - 69.f; // relative to A3 (440hz)
 }
 
+void sampler_voice::set_sample_data(int mip_level)
+{
+    GD.MipLevel = mip_level;
+    if (conversion)
+    {
+        GDIO.SampleDataL = wave->GetConvertedPtr(conversion, 0);
+        GDIO.SampleDataR = wave->SampleData[1] ? wave->GetConvertedPtr(conversion, 1) : nullptr;
+    }
+    else
+    {
+        GDIO.SampleDataL = wave->GetMipPtr(mip_level, 0);
+        GDIO.SampleDataR = wave->SampleData[1] ? wave->GetMipPtr(mip_level, 1) : nullptr;
+    }
+    assert(GDIO.SampleDataL);
+}
+
+// Reads from the smallest mip level which keeps the ratio within it near unity, which leaves
+// nothing above the output Nyquist to alias. The levels built after note on are picked up
+// here too. Going down waits for a lower ratio than going up, so a vibrato around a threshold
+// doesn't switch every block.
+void sampler_voice::update_mip_level(int ratio)
+{
+    // converted copies have no mip levels
+    int levels = conversion ? 0 : wave->mip_levels.load(std::memory_order_acquire);
+    int level = std::min(GD.MipLevel, levels);
+    while ((level < levels) && ((ratio >> level) > MipUpRatio))
+        level++;
+    while ((level > 0) && ((ratio >> (level - 1)) < MipDownRatio))
+        level--;
+    if (level != GD.MipLevel)
+        set_sample_data(level);
+}
+
 // template<bool stereo, bool oversampling, bool xfadeloop, int arch> bool
 // sampler_voice::process_t(float *p_L, float *p_R, float *p_aux1L, float *p_aux1R, float *p_aux2L,
 // float *p_aux2R)
 bool sampler_voice::process_block(float *p_L, float *p_R, float *p_aux1L, float *p_aux1R,
                                   float *p_aux2L, float *p_aux2R)
 {
-#if perfprof
-    unsigned __int64 perf[16];
-#endif
+    scxt::Trace::Span trace_voice(scxt::Trace::Stage::Voice, voice_id);
+    scxt::Trace::Laps trace(voice_id);
     int VE = zone->element_active;
 
-    perfslot(0);
-
     check_filtertypes();
 
-    perfslot(1);
+    trace.mark(scxt::Trace::Stage::VoiceFilterSetup);
 
     // process envelopes & stepLFO's
-    bool continue_playing = AEG.Process(BLOCK_SIZE);
-
-    if (VE & ve_EG2)
-        EG2.Process(BLOCK_SIZE);
-    perfslot(2);
+    bool continue_playing;
+    if (envelopes_done)
+    {
+        envelopes_done = false;
+        continue_playing = AEG.IsRunning();
+    }
+    else if (release_offset)
+    {
+        // released partway through the block. run the envelopes up to the release point, then
+        // release and run the rest
+        int pre = release_offset;
+        release_offset = 0;
+        AEG.Process(pre);
+        if (VE & ve_EG2)
+            EG2.Process(pre);
+        release(release_velocity);
+        continue_playing = AEG.Process(BLOCK_SIZE - pre);
+        if (VE & ve_EG2)
+            EG2.Process(BLOCK_SIZE - pre);
+    }
+    else
+    {
+        continue_playing = AEG.Process(BLOCK_SIZE);
+        if (VE & ve_EG2)
+            EG2.Process(BLOCK_SIZE);
+    }
+    trace.mark(scxt::Trace::Stage::VoiceEnvelopes);
     if (VE & ve_LFO1)
         stepLFO[0].process(BLOCK_SIZE);
     if (VE & ve_LFO2)
@@ -496,9 +672,9 @@ bool sampler_voice::process_block(float *p_L, float *p_R, float *p_aux1L, float
     if (VE & ve_LFO3)
         stepLFO[2].process(BLOCK_SIZE);
 
-    perfslot(3);
+    trace.mark(scxt::Trace::Stage::VoiceLFOs);
     mm.process();
-    perfslot(4);
+    trace.mark(scxt::Trace::Stage::VoiceModMatrix);
 
     if (first_run)
     {
@@ -552,20 +728,21 @@ bool sampler_voice::process_block(float *p_L, float *p_R, float *p_aux1L, float
         fmix2.set_target_smoothed(limit_range(mm.get_destination_value(md_filter2mix), 0.f, 1.f));
     }
 
-    perfslot(5);
+    trace.mark(scxt::Trace::Stage::VoiceTargets);
 
     if (portamento_active)
         update_portamento();
     CalcRatio();
     if (use_oversampling)
         GD.Ratio = GD.Ratio >> 1;
+    update_mip_level(abs(GD.Ratio));
 
     update_lag_gen(0);
     update_lag_gen(1);
 
     int bs = GD.BlockSize;
 
-    perfslot(6);
+    trace.mark(scxt::Trace::Stage::VoicePitch);
 
     // GD.RatioMask = looping_active ? 0xffffffff : 0;
 
@@ -579,8 +756,8 @@ bool sampler_voice::process_block(float *p_L, float *p_R, float *p_aux1L, float
         GD.UpperBound = Max(ls, le);
     }
 
-    GD.SampleStart = zone->sample_start;
-    GD.SampleStop = zone->sample_stop;
+    GD.SampleStart = data_pos(zone->sample_start);
+    GD.SampleStop = data_pos(zone->sample_stop);
     GD.Gated = gate;
     GD.InvertedBounds = 1.f / std::max(1, GD.UpperBound - GD.LowerBound);
     Generator(&GD, &GDIO);
@@ -597,7 +774,7 @@ bool sampler_voice::process_block(float *p_L, float *p_R, float *p_aux1L, float
         }
     }
 
-    perfslot(7);
+    trace.mark(scxt::Trace::Stage::VoiceGenerator);
 
     if (use_stereo)
         pfg.multiply_2_blocks(output[0], output[1],
@@ -610,11 +787,11 @@ bool sampler_voice::process_block(float *p_L, float *p_R, float *p_aux1L, float
         halfrate->process_block_D2(output[0], output[1], BLOCK_SIZE << 1);
     }
 
-    perfslot(8);
+    trace.mark(scxt::Trace::Stage::VoiceOversampling);
 
     // envelope follower
     /*{
-            const float integratorconst = samplerate_inv * BLOCK_SIZE;
+            const float integratorconst = current_engine().samplerate_inv * BLOCK_SIZE;
             float bs_inv = (float)1/bs;
             float ef_newvalue = sqrt(block_rms*bs_inv);
             if (stereo) ef_newvalue *= 0.5;
@@ -669,10 +846,12 @@ bool sampler_voice::process_block(float *p_L, float *p_R, float *p_aux1L, float
         copy_block(output[0], output[1], BLOCK_SIZE_QUAD);
     }
 
-    perfslot(9);
+    trace.mark(scxt::Trace::Stage::VoiceFilters);
 
     const unsigned int bufof = BLOCK_SIZE;
     vca.multiply_2_blocks(output[0], output[1], BLOCK_SIZE_QUAD);
+    if (start_delay)
+        apply_start_delay();
     faderL.multiply_block_to(output[0], postfader_buf[0], BLOCK_SIZE_QUAD);
     faderR.multiply_block_to(output[1], postfader_buf[1], BLOCK_SIZE_QUAD);
     accumulate_block(postfader_buf[0], p_L, BLOCK_SIZE_QUAD);
@@ -705,34 +884,12 @@ bool sampler_voice::process_block(float *p_L, float *p_R, float *p_aux1L, float
         }
     }
 
-    perfslot(10)
+    trace.mark(scxt::Trace::Stage::VoiceMix);
 
-        time += BLOCK_SIZE * samplerate_inv;
+    time += BLOCK_SIZE * current_engine().samplerate_inv;
     time60 = time * 0.0166666666666667f;
 
     first_run = false;
 
-#if perfprof
-    static unsigned __int64 ap[16];
-    static unsigned __int64 apmean;
-    ap[0] = perf[1] - perf[0];
-    ap[1] = perf[2] - perf[1];
-    ap[2] = perf[3] - perf[2];
-    ap[3] = perf[4] - perf[3];
-    ap[4] = perf[5] - perf[4];
-    ap[5] = perf[6] - perf[5];
-    ap[6] = perf[7] - perf[6];
-    ap[7] = perf[8] - perf[7];
-    ap[8] = perf[9] - perf[8];
-    ap[9] = perf[10] - perf[9];
-    ap[10] = perf[10] - perf[0];
-    apmean = ((apmean * 255) >> 8) + ap[10];
-
-    if (time > 0.1)
-    {
-        ap[11] = ap[10]; // breakpoint to hook
-    }
-#endif
-
     return continue_playing;
 }
@@ -21,6 +21,8 @@
 #include "resampling.h"
 
 #include "generator.h"
+#include "halfrate_pool.h"
+#include "sample.h"
 #include "synthesis/envelope.h"
 #include "synthesis/modmatrix.h"
 #include "synthesis/steplfo.h"
@@ -29,31 +31,37 @@
 
 class sampler_voice;
 class filter;
-class sample;
-namespace sst::filters::HalfRate
-{
-class HalfRateFilter;
-}
 
 struct sample_zone;
 struct sample_part;
 struct timedata;
 
 // sampler voice class
-class alignas(16) sampler_voice
+class alignas(16) sampler_voice : private halfrate_pool::user
 {
   public:
     float output alignas(16)[2][BLOCK_SIZE * 2];
     lipol_ps vca, faderL, faderR, pfg, aux1L, aux1R, aux2L, aux2R, fmix1, fmix2;
 
-    sampler_voice(uint32_t voice_id, timedata *);
+    // oversampling filters are taken from halfrates for the notes which need one. with
+    // envelopes the AEG and EG2 are lanes voice_id * 2 and voice_id * 2 + 1 of it, without they
+    // are the voice's own
+    sampler_voice(uint32_t voice_id, timedata *, halfrate_pool *halfrates,
+                  envelope_bank *envelopes = nullptr);
     virtual ~sampler_voice();
 
+    // start_offset/offset delay the start/release by that many samples into the next block.
+    // interpolation is a GeneratorInterpolation, the sampler resolves the zone/global setting
     void play(sample *wave, sample_zone *zone, sample_part *part, uint32_t key, uint32_t velocity,
-              int detune, float *ctrl, float *autom, float crossfade_amp);
-    void release(uint32_t velocity);
+              int detune, float *ctrl, float *autom, float crossfade_amp, int start_offset = 0,
+              int interpolation = GI_Sinc16);
+    void release(uint32_t velocity, int offset = 0);
     void uberrelease();
+    // gives the oversampling filter back to the pool, once the voice is no longer rendered
+    void release_oversampling();
     void change_key(int key, int vel, int detune);
+    // reseeds the voice generator and everything it feeds (modmatrix noise, lfos, filters)
+    void seed_random(uint64_t seed);
 
     // bool (sampler_voice::*process_block_f)(float*, float*, float*,float*, float*, float*);
     // bool process_block(float *L, float *R, float *aux1L, float *aux1R, float *aux2L, float
@@ -86,7 +94,11 @@ class alignas(16) sampler_voice
     uint32_t end_offset;
     // audio path
 
-    sst::filters::HalfRate::HalfRateFilter *halfrate;
+    halfrate_pool *halfrates;
+    sst::filters::HalfRate::HalfRateFilter *halfrate; // only while use_oversampling
+    // with the pool full, released voices give up their filter first, then the quietest
+    float keep_priority() const override { return (gate ? 2.f : 0.f) + AEG.output; }
+    void lost_halfrate() override;
 
     // modules
     filter *__restrict voice_filter[2];
@@ -95,8 +107,20 @@ class alignas(16) sampler_voice
     // control path
     modmatrix mm;
     void CalcRatio();
+    void set_sample_data(int mip_level);
+    void update_mip_level(int ratio);
+    // a copy of the wave at the engine rate, or nullptr. positions in the zone are in samples
+    // of the original and are scaled by pos_scale to index it
+    const sample::conversion *conversion;
+    double pos_scale;
+    int data_pos(int p) const { return conversion ? (int)lrint(p * pos_scale) : p; }
+    envelope_bank own_envelopes; // before AEG and EG2, which may look into it
     Envelope AEG, EG2;
+    // set when the sampler has already run this block's envelopes, with the other voices'. only
+    // with SCXT_ENVELOPE_BANK
+    bool envelopes_done;
     steplfo stepLFO[3];
+    prng rng;
     bool gate, is_uberrelease;
     float time, time60, random, randombp, keytrack, fvelocity, fgate, slice_env, loop_pos,
         loop_gate, filter_modout[2];
@@ -113,6 +137,15 @@ class alignas(16) sampler_voice
     int playmode;
     uint32_t grain_id;
     int32_t RingOut; // when sample playback is finished, this will be decremented until zero
+
+    // sub-block start. the voice runs on its own timeline, start_delay samples behind the
+    // block grid, and its output is shifted back into place through start_carry
+    int start_delay;
+    float start_carry alignas(16)[2][BLOCK_SIZE];
+    // a release partway through the next block, in the voice's own timeline
+    int release_offset;
+    uint32_t release_velocity;
+    void apply_start_delay();
     // template<bool stereo, bool oversampling, bool xfadeloop, int architecture>
     // __declspec(noalias) bool process_t(float *L, float *R, float *aux1L, float *aux1R, float
     // *aux2L, float *aux2R);
@@ -226,6 +226,7 @@ enum VAction
     vga_save_patch,
     vga_save_multi,
     vga_vudata,
+    vga_dspload, // see sampler::processVUsAndPolyphonyUpdates
     vga_set_range_and_units // see sampler_parameter_ranges.h
 };
 
@@ -417,6 +418,7 @@ inline std::ostream &operator<<(std::ostream &stream, const actiontype_t &t)
                                   C(vga_save_patch)
                                   C(vga_save_multi)
                                   C(vga_vudata)
+                                  C(vga_dspload)
                                   C(vga_set_range_and_units)
 
                               default:
@@ -77,12 +77,96 @@ void sampler::postEventsToWrapper(const actiondata &ad, bool ErrorIfClosed)
 
 //-------------------------------------------------------------------------------------------------
 
+// parameters which feed into the key/velocity index used by PlayNote
+static bool changes_zone_mapping(int id)
+{
+    switch (id)
+    {
+    case ip_channel:
+    case ip_low_key:
+    case ip_high_key:
+    case ip_low_vel:
+    case ip_high_vel:
+    case ip_low_key_f:
+    case ip_high_key_f:
+    case ip_low_vel_f:
+    case ip_high_vel_f:
+    case ip_mute:
+    case ip_part_midichannel:
+    case ip_part_transpose:
+    case ip_part_formant:
+    case ip_part_vs_layers:
+    case ip_part_vs_distribution:
+    case ip_part_vs_xf_equality:
+    case ip_part_vs_xfade:
+        return true;
+    default:
+        break;
+    }
+    return false;
+}
+
+// edits after which the modulation matrices have to recompile their routes. amounts are read
+// live and other parameter edits only move the values destinations start from, so those just
+// reseed. anything that isn't a parameter edit (loads, zone creation, cloning) recompiles
+static bool changes_routing(VAction at, int id)
+{
+    switch (id)
+    {
+    case ip_mm_src:
+    case ip_mm_src2:
+    case ip_mm_dst:
+    case ip_mm_curve:
+    case ip_mm_active:
+    case ip_part_mm_src:
+    case ip_part_mm_src2:
+    case ip_part_mm_dst:
+    case ip_part_mm_curve:
+    case ip_part_mm_active:
+        return true;
+    default:
+        break;
+    }
+
+    switch (at)
+    {
+    case vga_floatval:
+    case vga_intval:
+    case vga_intval_inc:
+    case vga_intval_dec:
+    case vga_boolval:
+    case vga_text:
+    case vga_beginedit:
+    case vga_endedit:
+    case vga_note:
+    case vga_steplfo_data_single:
+    case vga_select_zone_clear:
+    case vga_select_zone_primary:
+    case vga_select_zone_secondary:
+    case vga_select_zone_previous:
+    case vga_select_zone_next:
+    case vga_request_refresh:
+    case vga_openeditor:
+    case vga_closeeditor:
+        return false;
+    default:
+        break;
+    }
+    return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+
 void sampler::processWrapperEvents()
 {
+    engine_context_scope ctx_scope(&engine_ctx);
+
     // ingoing
     actiondata ad;
+    bool had_events = false, route_events = false;
     while (actionBuffer.try_dequeue(ad))
     {
+        had_events = true;
         if (!std::holds_alternative<VAction>(ad.actiontype))
         {
             LOGDEBUG(mLogger) << "Surprise! It's not an action" << std::flush;
@@ -90,6 +174,7 @@ void sampler::processWrapperEvents()
         }
 
         auto at = std::get<VAction>(ad.actiontype);
+        route_events = route_events || changes_routing(at, ad.id);
         switch (at) // intercept these actiontypes regardless of the control
         {
         case vga_openeditor:
@@ -263,10 +348,12 @@ void sampler::processWrapperEvents()
             break;
         case vga_movezonetopart:
             selected->move_selected_zones_to_part(ad.data.i[0]);
+            invalidate_zone_index();
             post_zonedata();
             break;
         case vga_movezonetolayer:
             selected->move_selected_zones_to_layer(ad.data.i[0]);
+            invalidate_zone_index();
             post_zonedata();
             break;
         case vga_set_zone_keyspan:
@@ -275,6 +362,7 @@ void sampler::processWrapperEvents()
                 zones[ad.data.i[0]].key_low = ad.data.i[1] & 0x7f;
                 zones[ad.data.i[0]].key_root = ad.data.i[2] & 0x7f;
                 zones[ad.data.i[0]].key_high = ad.data.i[3] & 0x7f;
+                invalidate_zone_index();
             }
             break;
         case vga_set_zone_keyspan_clone:
@@ -286,6 +374,7 @@ void sampler::processWrapperEvents()
                     zones[nz].key_low = ad.data.i[1] & 0x7f;
                     zones[nz].key_root = ad.data.i[2] & 0x7f;
                     zones[nz].key_high = ad.data.i[3] & 0x7f;
+                    invalidate_zone_index();
                 }
             }
             break;
@@ -480,7 +569,7 @@ void sampler::processWrapperEvents()
                     if (zone_exist(z))
                     {
                         int e = max(0, min(3, ad.subid));
-                        load_lfo_preset(ad.data.i[0], &zones[z].LFO[e]);
+                        load_lfo_preset(ad.data.i[0], &zones[z].LFO[e], &preset_rng);
                         selected->copy_lfo_waveform_to_selected_zones(&zones[z].LFO[e], e);
                     }
                     post_zonedata();
@@ -515,6 +604,34 @@ void sampler::processWrapperEvents()
                         mPreviewConfigChanged = true;
                     }
                     break;
+                case ip_config_interpolation:
+                    if (at == vga_intval)
+                    {
+                        set_interpolation(ad.data.i[0]);
+                        mInterpolationConfigChanged = true;
+                    }
+                    break;
+                case ip_config_draft:
+                    if (at == vga_intval)
+                    {
+                        set_draft_on_overload(ad.data.i[0] != 0);
+                        mInterpolationConfigChanged = true;
+                    }
+                    break;
+                case ip_config_mipmaps:
+                    if (at == vga_intval)
+                    {
+                        set_build_mips(ad.data.i[0] != 0);
+                        mMipConfigChanged = true;
+                    }
+                    break;
+                case ip_config_resample:
+                    if (at == vga_intval)
+                    {
+                        set_resample_on_load(ad.data.i[0] != 0);
+                        mResampleConfigChanged = true;
+                    }
+                    break;
                 case ip_browser_previewbutton:
                 {
                     if (ad.data.i[0] == 1)
@@ -572,6 +689,9 @@ void sampler::processWrapperEvents()
         }
         }
 
+        if (changes_zone_mapping(ad.id))
+            invalidate_zone_index();
+
         // extra checks that are run regardless of previous switch-blocks
         // generally used to refresh editor when setting filtertype etc
         switch (ad.id)
@@ -598,8 +718,7 @@ void sampler::processWrapperEvents()
                 ad2.id = ip_mm_amount;
                 ad2.subid = ad.subid;
                 ad2.actiontype = vga_datamode;
-                modmatrix mm;
-                mm.assign(conf.get(), &zones[z], &parts[editorpart]);
+                modmatrix_labels mm(&zones[z], &parts[editorpart]);
                 int cmode = mm.get_destination_ctrlmode(zones[z].mm[ad.subid].destination);
                 string s = datamode_from_cmode(cmode);
                 strncpy_0term((char *)ad2.data.str, s.c_str(), actiondata_maxstring);
@@ -613,8 +732,7 @@ void sampler::processWrapperEvents()
             ad2.id = ip_part_mm_amount;
             ad2.subid = ad.subid;
             ad2.actiontype = vga_datamode;
-            modmatrix mm;
-            mm.assign(conf.get(), 0, &parts[editorpart]);
+            modmatrix_labels mm(0, &parts[editorpart]);
             int cmode = mm.get_destination_ctrlmode(parts[editorpart].mm[ad.subid].destination);
             string s = datamode_from_cmode(cmode);
             strncpy_0term((char *)ad2.data.str, s.c_str(), actiondata_maxstring);
@@ -730,6 +848,11 @@ void sampler::processWrapperEvents()
         break;
         };
     }
+
+    if (route_events)
+        invalidate_modulation();
+    else if (had_events)
+        reseed_modulation();
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -914,8 +1037,7 @@ void sampler::post_zonedata()
         postEventsToWrapper(ad);
 
         // modmatrix
-        modmatrix mm;
-        mm.assign(conf.get(), &zones[z], &parts[editorpart]);
+        modmatrix_labels mm(&zones[z], &parts[editorpart]);
         post_initdata_mm(z);
 
         for (int i = 0; i < mm_entries; i++)
@@ -1427,8 +1549,7 @@ void sampler::post_initdata_mm(int zone)
     actiondata ad;
     {
         // zone matrix
-        modmatrix mm;
-        mm.assign(conf.get(), &zones[zone], &parts[editorpart]);
+        modmatrix_labels mm(&zones[zone], &parts[editorpart]);
         ad.subid = -1; // send to all
         ad.actiontype = vga_entry_clearall;
         ad.id = ip_mm_src;
@@ -1477,8 +1598,7 @@ void sampler::post_initdata_mm_part()
     // part matrix
     actiondata ad;
     {
-        modmatrix mm;
-        mm.assign(conf.get(), 0, &parts[editorpart]);
+        modmatrix_labels mm(0, &parts[editorpart]);
         ad.subid = -1; // send to all
         ad.actiontype = vga_entry_clearall;
         ad.id = ip_part_mm_src;
@@ -1567,6 +1687,17 @@ void sampler::post_initdata()
         postEventsToWrapper(ad);
     }
 
+    ad.id = ip_zone_interpolation;
+    ad.subid = -1;
+    ad.actiontype = vga_entry_clearall;
+    postEventsToWrapper(ad);
+    ad.actiontype = vga_entry_add_ival_from_self;
+    for (int i = 0; i < n_zone_interpolations; i++)
+    {
+        strncpy_0term((char *)ad.data.str, zone_interpolation_names[i], actiondata_maxstring);
+        postEventsToWrapper(ad);
+    }
+
     // output selection
     ad.id = ip_zone_aux_output;
     ad.subid = -1; // send to all
@@ -1679,6 +1810,26 @@ void sampler::post_initdata()
     ad.data.i[0] = mAutoPreview ? 1 : 0;
     postEventsToWrapper(ad);
 
+    ad.id = ip_config_interpolation;
+    ad.actiontype = vga_intval;
+    ad.data.i[0] = mInterpolation;
+    postEventsToWrapper(ad);
+
+    ad.id = ip_config_draft;
+    ad.actiontype = vga_intval;
+    ad.data.i[0] = mDraftOnOverload ? 1 : 0;
+    postEventsToWrapper(ad);
+
+    ad.id = ip_config_mipmaps;
+    ad.actiontype = vga_intval;
+    ad.data.i[0] = mBuildMips ? 1 : 0;
+    postEventsToWrapper(ad);
+
+    ad.id = ip_config_resample;
+    ad.actiontype = vga_intval;
+    ad.data.i[0] = mResampleOnLoad ? 1 : 0;
+    postEventsToWrapper(ad);
+
     ad.id = ip_browser_previewbutton;
     ad.actiontype = vga_intval;
     ad.data.i[0] = 0;
@@ -184,11 +184,12 @@ class alignas(16) biquadunit
     // 440*powf(2,scfreq)*samplerate_inv); }
     double calc_omega_from_Hz(double Hz)
     {
-        return (2 * 3.14159265358979323846) * Hz * samplerate_inv;
+        return (2 * 3.14159265358979323846) * Hz * current_engine().samplerate_inv;
     }
     static double calc_omega(double scfreq)
     {
-        return (2 * 3.14159265358979323846) * 440 * note_to_pitch(12 * scfreq) * samplerate_inv;
+        return (2 * 3.14159265358979323846) * 440 * note_to_pitch(12 * scfreq) *
+               current_engine().samplerate_inv;
     }
     static double calc_v1_Q(double reso) { return 1 / (1.02 - limit_range(reso, 0.0, 1.0)); }
     // inline void process_block_stereo(float *dataL,float *dataR);
@@ -22,10 +22,11 @@
 #include "util/tools.h"
 #include <algorithm>
 #include <assert.h>
+#include <cstring>
 
 //-------------------------------------------------------------------------------------------------
 
-#define env_phasemulti (1000.f / samplerate)
+#define env_phasemulti (1000.f / current_engine().samplerate)
 float uberrate = -7;
 const float cut_level = 1.f / 65536.f;
 
@@ -37,170 +38,179 @@ static bool envelope_initialized = false;
 
 //-------------------------------------------------------------------------------------------------
 
-Envelope::Envelope()
+static void init_envshape()
 {
-    if (!envelope_initialized)
-    {
-        envelope_initialized = true;
+    if (envelope_initialized)
+        return;
+    envelope_initialized = true;
 
-        // Lookup table for envelope shaper
-        for (int j = 0; j < n_curves; j++)
+    // Lookup table for envelope shaper
+    for (int j = 0; j < n_curves; j++)
+    {
+        for (int i = 0; i < curvesize; i++)
         {
-            for (int i = 0; i < curvesize; i++)
-            {
-                float x = (i + 0.5f) / 32.f;
-                float y = (j - 20.f) * 0.5f;
+            float x = (i + 0.5f) / 32.f;
+            float y = (j - 20.f) * 0.5f;
 
-                if (y < 0.f)
-                    y = (1.f / (1.f - y)) - 1.f;
-
-                table_envshape[j][i] = powf(x, 1.f + y);
-            }
+            if (y < 0.f)
+                y = (1.f / (1.f - y)) - 1.f;
 
-            table_envshape[j][n_curves] = 1.f;
-            table_envshape[j][n_curves + 1] = 1.f;
-            table_envshape[j][n_curves + 2] = 1.f;
-            table_envshape[j][n_curves + 3] = 1.f;
+            table_envshape[j][i] = powf(x, 1.f + y);
         }
+
+        table_envshape[j][n_curves] = 1.f;
+        table_envshape[j][n_curves + 1] = 1.f;
+        table_envshape[j][n_curves + 2] = 1.f;
+        table_envshape[j][n_curves + 3] = 1.f;
     }
-    curve = 0;
+}
+
+static inline float calc_curve(uint32_t curve, uint32_t phase)
+{
+    assert((curve >= 0) && (curve < n_curves));
+
+    unsigned int e = std::min((uint32_t)0x7fffffff, phase) >> (31 - 5 - 16);
+
+    unsigned int e_coarse = e >> 16;
+    unsigned int e_fine = e & 0xffff;
+
+    assert(e_coarse < curvesize);
+
+    return (1.f / 65536.f) * (table_envshape[curve][e_coarse] * (float)(0x10000 - e_fine) +
+                              table_envshape[curve][e_coarse + 1] * (float)e_fine);
 }
 
 //-------------------------------------------------------------------------------------------------
 
-void Envelope::Assign(float *envA, float *envH, float *envD, float *envS, float *envR,
-                      float *envshape)
+envelope_bank::envelope_bank(int lanes)
 {
+    init_envshape();
+    n_lanes = (lanes + 3) & ~3;
+    groups = std::make_unique<group[]>(n_lanes >> 2);
+    params = std::make_unique<lane_params[]>(n_lanes);
+    memset(groups.get(), 0, sizeof(group) * (n_lanes >> 2));
+    for (int l = 0; l < n_lanes; l++)
+        params[l] = lane_params{nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, false};
+}
 
-    A = envA;
-    H = envH;
-    D = envD;
-    S = envS;
-    R = envR;
-    shape = envshape;
+envelope_bank::~envelope_bank() {}
 
-    // this->edata = edata;
+//-------------------------------------------------------------------------------------------------
 
-    state = sIdle;
-    level = 0.;
-    output = 0.;
-    block = 1; // counter
-    // this->is_AEG = is_AEG;
+void envelope_bank::assign(int lane, float *envA, float *envH, float *envD, float *envS,
+                           float *envR, float *envshape)
+{
+    auto &p = params[lane];
+    auto &g = groups[lane >> 2];
+    int i = lane & 3;
+
+    p.A = envA;
+    p.H = envH;
+    p.D = envD;
+    p.S = envS;
+    p.R = envR;
+    p.shape = envshape;
+
+    g.state[i] = sIdle;
+    g.level[i] = 0.;
+    g.output[i] = 0.;
+    g.block[i] = 1; // counter
 }
 
 //-------------------------------------------------------------------------------------------------
 
-void Envelope::SetState(long State)
+void envelope_bank::set_state(int lane, long State)
 {
-    phase = 0;
+    auto &p = params[lane];
+    auto &g = groups[lane >> 2];
+    int i = lane & 3;
+
+    g.phase[i] = 0;
 
-    state = State;
+    g.state[i] = State;
 
     switch (State)
     {
     case sAttack:
-        SetRate(*A);
-        SetCurve(shape[0]);
-        level = 0.f;
+        set_rate(lane, *p.A);
+        g.curve[i] = (unsigned int)(curve_offset + p.shape[0]);
+        g.level[i] = 0.f;
         break;
     case sHold:
-        SetRate(*H);
-        level = 1.f;
+        set_rate(lane, *p.H);
+        g.level[i] = 1.f;
         break;
     case sDecay:
-        SetRate(*D);
-        SetCurve(-shape[1]);
-        level = 1.f;
+        set_rate(lane, *p.D);
+        g.curve[i] = (unsigned int)(curve_offset - p.shape[1]);
+        g.level[i] = 1.f;
         break;
     case sRelease:
-        SetRate(*R);
-        SetCurve(-shape[2]);
-        level = 1.f;
+        set_rate(lane, *p.R);
+        g.curve[i] = (unsigned int)(curve_offset - p.shape[2]);
+        g.level[i] = 1.f;
         break;
     default:
-        curve = 0;
+        g.curve[i] = 0;
         break;
     };
 }
 
 //-------------------------------------------------------------------------------------------------
 
-void Envelope::SetCurve(float x) { curve = (unsigned int)(curve_offset + x); }
-
-//-------------------------------------------------------------------------------------------------
-
-void Envelope::SetRate(float Rate)
+void envelope_bank::set_rate(int lane, float Rate)
 {
-    float frate = samplerate_inv / note_to_pitch(12.f * Rate);
-    rate = (unsigned int)(float)(0x80000000 * frate);
+    float frate = current_engine().samplerate_inv / note_to_pitch(12.f * Rate);
+    groups[lane >> 2].rate[lane & 3] = (unsigned int)(float)(0x80000000 * frate);
 }
 
 //-------------------------------------------------------------------------------------------------
 
-float Envelope::GetValue()
+void envelope_bank::attack(int lane, bool no_sustain)
 {
-    /*float fPhase = phase * (1.f / 0x80000000);
+    auto &p = params[lane];
+    p.no_sustain = no_sustain;
 
-    return fPhase;*/
-
-    return CalcCurve();
-}
+    set_state(lane, sAttack);
 
-//-------------------------------------------------------------------------------------------------
-
-float Envelope::CalcCurve()
-{
-    assert((curve >= 0) && (curve < n_curves));
-
-    unsigned int e = std::min((uint32_t)0x7fffffff, phase) >> (31 - 5 - 16);
-
-    unsigned int e_coarse = e >> 16;
-    unsigned int e_fine = e & 0xffff;
-
-    assert(e_coarse < curvesize);
-
-    return (1.f / 65536.f) * (table_envshape[curve][e_coarse] * (float)(0x10000 - e_fine) +
-                              table_envshape[curve][e_coarse + 1] * (float)e_fine);
-}
-
-//-------------------------------------------------------------------------------------------------
-
-void Envelope::Attack(bool no_sustain)
-{
-    this->no_sustain = no_sustain;
-
-    SetState(sAttack);
-
-    if (*A < -9.99)
+    if (*p.A < -9.99)
     {
 
-        SetState(sHold);
+        set_state(lane, sHold);
 
-        if (*H < -9.99)
+        if (*p.H < -9.99)
         {
-            SetState(sDecay);
+            set_state(lane, sDecay);
         }
     }
 }
 
 //-------------------------------------------------------------------------------------------------
 
-void Envelope::Release()
+void envelope_bank::release(int lane)
 {
-    droplevel = level;
-    SetState(sRelease);
+    auto &g = groups[lane >> 2];
+    g.droplevel[lane & 3] = g.level[lane & 3];
+    set_state(lane, sRelease);
 }
 
 //-------------------------------------------------------------------------------------------------
 
-void Envelope::UberRelease()
+void envelope_bank::uber_release(int lane)
 {
-    state = sRelease;
-    droplevel = level;
-    phase = 0;
+    auto &g = groups[lane >> 2];
+    int i = lane & 3;
+    g.state[i] = sRelease;
+    g.droplevel[i] = g.level[i];
+    g.phase[i] = 0;
     // rate = samplerate_inv/powf(2,uberrate);
-    R = &uberrate;
-    SetRate(*R);
+    params[lane].R = &uberrate;
+    set_rate(lane, uberrate);
+}
+
+bool envelope_bank::is_running(int lane) const
+{
+    return groups[lane >> 2].state[lane & 3] != sIdle;
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -212,66 +222,73 @@ if (envshape<0) envshape = (1/(1-envshape)) - 1;
 
 //-------------------------------------------------------------------------------------------------
 
-bool Envelope::Process(unsigned int samples)
+bool envelope_bank::process_lane(int lane, unsigned int samples)
 {
+    auto &p = params[lane];
+    auto &g = groups[lane >> 2];
+    int i = lane & 3;
+    uint32_t &phase = g.phase[i];
+    float &level = g.level[i];
+    int32_t &state = g.state[i];
+
     switch (state)
     {
     case sAttack: // attack
     {
-        phase += samples * rate;
+        phase += samples * g.rate[i];
 
-        level = GetValue();
+        level = calc_curve(g.curve[i], phase);
 
         if (phase > 0x80000000)
         {
-            SetState(sHold);
+            set_state(lane, sHold);
         }
     }
     break;
     case sHold: // attack
-        phase += samples * rate;
+        phase += samples * g.rate[i];
         level = 1;
         if (phase > 0x80000000)
         {
-            SetState(sDecay);
+            set_state(lane, sDecay);
         }
         break;
     case sDecay: // decay
     {
-        phase += samples * rate;
+        phase += samples * g.rate[i];
 
         if (phase > 0x80000000)
         {
             phase = 0;
-            level = clamp01(*S);
-            if (no_sustain)
+            level = clamp01(*p.S);
+            if (p.no_sustain)
             {
-                Release();
+                release(lane);
             }
             else
                 state = sSustain;
         }
         else
         {
-            level = 1.f + GetValue() * (clamp01(*S) - 1);
+            level = 1.f + calc_curve(g.curve[i], phase) * (clamp01(*p.S) - 1);
             if (level < cut_level)
                 state = sIdle;
         }
     }
     break;
     case sSustain:
-        level = clamp01(*S); // add a lag generator to the sustain section as well
+        level = clamp01(*p.S); // add a lag generator to the sustain section as well
         if (level < cut_level)
             state = sIdle;
         break;
     case sRelease: // release
     {
-        block++;
-        if (!(block & 0xff))
+        g.block[i]++;
+        if (!(g.block[i] & 0xff))
         {
-            SetRate(*R);
+            set_rate(lane, *p.R);
         }
-        phase += samples * rate;
+        phase += samples * g.rate[i];
 
         if (phase > 0x80000000)
             state = sIdle;
@@ -279,7 +296,7 @@ bool Envelope::Process(unsigned int samples)
         if (level < cut_level)
             state = sIdle;
 
-        level = droplevel * (1.f - GetValue());
+        level = g.droplevel[i] * (1.f - calc_curve(g.curve[i], phase));
         break;
     }
     }
@@ -287,7 +304,7 @@ bool Envelope::Process(unsigned int samples)
     if (state == sIdle)
         level = 0;
 
-    output = level;
+    g.output[i] = level;
     if (state == sIdle)
         return false;
     return true;
@@ -295,4 +312,123 @@ bool Envelope::Process(unsigned int samples)
 
 //-------------------------------------------------------------------------------------------------
 
+void envelope_bank::process(const uint8_t *run)
+{
+    for (int g = 0; g < (n_lanes >> 2); g++)
+    {
+        int mask = (run[g * 4] ? 1 : 0) | (run[g * 4 + 1] ? 2 : 0) | (run[g * 4 + 2] ? 4 : 0) |
+                   (run[g * 4 + 3] ? 8 : 0);
+        if (mask)
+            process_group(g, mask);
+    }
+}
+
+// process_lane for the four lanes of a group at once, as far as none of them leaves its segment
+void envelope_bank::process_group(int gi, int mask)
+{
+    auto &g = groups[gi];
+    const __m128i sign = _mm_set1_epi32((int)0x80000000);
+    const __m128 one = _mm_set1_ps(1.f);
+
+    __m128i state = _mm_load_si128((const __m128i *)g.state);
+    __m128i is_attack = _mm_cmpeq_epi32(state, _mm_set1_epi32(sAttack));
+    __m128i is_hold = _mm_cmpeq_epi32(state, _mm_set1_epi32(sHold));
+    __m128i is_decay = _mm_cmpeq_epi32(state, _mm_set1_epi32(sDecay));
+    __m128i is_sustain = _mm_cmpeq_epi32(state, _mm_set1_epi32(sSustain));
+    __m128i is_release = _mm_cmpeq_epi32(state, _mm_set1_epi32(sRelease));
+    __m128i is_idle = _mm_cmpeq_epi32(state, _mm_setzero_si128());
+    __m128i still = _mm_or_si128(is_sustain, is_idle); // the phase doesn't move
+    __m128i moving = _mm_or_si128(_mm_or_si128(is_attack, is_hold),
+                                  _mm_or_si128(is_decay, is_release));
+
+    // BLOCK_SIZE is a power of two, so samples * rate is a shift
+    const int block_bits = (BLOCK_SIZE == 16)   ? 4
+                           : (BLOCK_SIZE == 32) ? 5
+                           : (BLOCK_SIZE == 64) ? 6
+                                                : 7;
+    __m128i phase = _mm_load_si128((const __m128i *)g.phase);
+    __m128i rate = _mm_load_si128((const __m128i *)g.rate);
+    __m128i block = _mm_load_si128((const __m128i *)g.block);
+    __m128i next_phase = _mm_add_epi32(phase, _mm_slli_epi32(rate, block_bits));
+    __m128i next_block = _mm_add_epi32(block, _mm_and_si128(is_release, _mm_set1_epi32(1)));
+    // unsigned next_phase > 0x80000000
+    __m128i crossed = _mm_cmpgt_epi32(_mm_xor_si128(next_phase, sign), _mm_setzero_si128());
+
+    // the curve lookups and the sustain levels are gathers
+    alignas(16) uint32_t np[4];
+    alignas(16) float lo[4], hi[4], fine[4], sus[4];
+    _mm_store_si128((__m128i *)np, next_phase);
+    for (int i = 0; i < 4; i++)
+    {
+        auto &p = params[gi * 4 + i];
+        unsigned int e = std::min((uint32_t)0x7fffffff, np[i]) >> (31 - 5 - 16);
+        unsigned int e_coarse = std::min(e >> 16, (unsigned int)curvesize - 1);
+        uint32_t c = std::min(g.curve[i], (uint32_t)n_curves - 1);
+        lo[i] = table_envshape[c][e_coarse];
+        hi[i] = table_envshape[c][e_coarse + 1];
+        fine[i] = (float)(e & 0xffff);
+        sus[i] = p.S ? clamp01(*p.S) : 0.f;
+    }
+    __m128 f = _mm_load_ps(fine);
+    __m128 lo_w = _mm_mul_ps(_mm_load_ps(lo), _mm_sub_ps(_mm_set1_ps(65536.f), f));
+    __m128 curve =
+        _mm_mul_ps(_mm_set1_ps(1.f / 65536.f), _mm_add_ps(lo_w, _mm_mul_ps(_mm_load_ps(hi), f)));
+    __m128 S = _mm_load_ps(sus);
+    __m128 level = _mm_load_ps(g.level);
+
+    __m128 l_decay = _mm_add_ps(one, _mm_mul_ps(curve, _mm_sub_ps(S, one)));
+    __m128 l_release = _mm_mul_ps(_mm_load_ps(g.droplevel), _mm_sub_ps(one, curve));
+    __m128 next_level = _mm_and_ps(_mm_castsi128_ps(is_attack), curve);
+    next_level = _mm_or_ps(next_level, _mm_and_ps(_mm_castsi128_ps(is_hold), one));
+    next_level = _mm_or_ps(next_level, _mm_and_ps(_mm_castsi128_ps(is_decay), l_decay));
+    next_level = _mm_or_ps(next_level, _mm_and_ps(_mm_castsi128_ps(is_sustain), S));
+    next_level = _mm_or_ps(next_level, _mm_and_ps(_mm_castsi128_ps(is_release), l_release));
+
+    // lanes which change state: a segment ends, the level falls under the cut or the release
+    // rate is refreshed. idle lanes output zero, which is what next_level has for them
+    const __m128 cut = _mm_set1_ps(cut_level);
+    __m128i scalar = _mm_andnot_si128(_mm_or_si128(moving, still), _mm_set1_epi32(-1));
+    scalar = _mm_or_si128(scalar, _mm_and_si128(moving, crossed));
+    __m128i low = _mm_castps_si128(_mm_cmplt_ps(next_level, cut));
+    scalar = _mm_or_si128(scalar, _mm_and_si128(_mm_or_si128(is_decay, is_sustain), low));
+    __m128i was_low = _mm_castps_si128(_mm_cmplt_ps(level, cut));
+    __m128i refresh =
+        _mm_cmpeq_epi32(_mm_and_si128(next_block, _mm_set1_epi32(0xff)), _mm_setzero_si128());
+    scalar = _mm_or_si128(scalar, _mm_and_si128(is_release, _mm_or_si128(was_low, refresh)));
+
+    int scalar_mask = _mm_movemask_ps(_mm_castsi128_ps(scalar)) & mask;
+    int simd_mask = ~scalar_mask & mask;
+    if (simd_mask)
+    {
+        next_phase =
+            _mm_or_si128(_mm_and_si128(still, phase), _mm_andnot_si128(still, next_phase));
+        alignas(16) uint32_t ph[4], bl[4];
+        alignas(16) float lv[4];
+        _mm_store_si128((__m128i *)ph, next_phase);
+        _mm_store_si128((__m128i *)bl, next_block);
+        _mm_store_ps(lv, next_level);
+        for (int i = 0; i < 4; i++)
+        {
+            if (!(simd_mask & (1 << i)))
+                continue;
+            g.phase[i] = ph[i];
+            g.block[i] = bl[i];
+            g.level[i] = lv[i];
+            g.output[i] = lv[i];
+        }
+    }
+    for (int i = 0; i < 4; i++)
+    {
+        if (scalar_mask & (1 << i))
+            process_lane(gi * 4 + i, BLOCK_SIZE);
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+Envelope::Envelope(envelope_bank *bank, int lane)
+    : output(bank->output(lane)), bank(bank), lane(lane)
+{
+}
+
 Envelope::~Envelope() {}
@@ -32,40 +32,96 @@ enum envelope_state
 
 //-------------------------------------------------------------------------------------------------
 
-struct envelope_AHDSR;
+#include <cstdint>
+#include <memory>
+
+//-------------------------------------------------------------------------------------------------
+
+/*
+ * The state of many envelopes, kept as structure of arrays in groups of four lanes so the
+ * envelopes of four voices step through a block in one go (process). Each Envelope is a view
+ * of one lane.
+ *
+ * By default every voice has a bank of its own for its AEG and EG2 and runs them lane by lane,
+ * which keeps the state with the voice on whichever thread renders it. Built with
+ * SCXT_ENVELOPE_BANK the sampler owns one bank with a lane for each instead and runs them all
+ * before the voices. That measured slower, 20-28 ns against 6-20 ns per voice-block for the
+ * pair, so it stays opt-in.
+ *
+ * Within a segment the SSE path does the whole group. A lane which changes state during the
+ * block (or refreshes its release rate) takes the scalar path, which is the original per
+ * envelope code and gives the same result.
+ *
+ * Only envelopes are banked. At one step per block the masking and gathers already cost about
+ * as much as the scalar switch, so step LFOs, lag generators, the lipol_ps smoothers (already
+ * SIMD across the block) and the mod matrix stay per voice. sc3-bench --stages shows what each
+ * costs in the engine.
+ */
+class envelope_bank
+{
+  public:
+    explicit envelope_bank(int lanes);
+    ~envelope_bank();
+
+    // one block for every lane with run[lane] set. BLOCK_SIZE samples
+    void process(const uint8_t *run);
+
+    // the scalar path, also used for partial blocks
+    bool process_lane(int lane, unsigned int samples);
+    void assign(int lane, float *envA, float *envH, float *envD, float *envS, float *envR,
+                float *shape);
+    void attack(int lane, bool no_sustain);
+    void release(int lane);
+    void uber_release(int lane);
+
+    bool is_running(int lane) const;
+    float &output(int lane) { return groups[lane >> 2].output[lane & 3]; }
+    float level(int lane) const { return groups[lane >> 2].level[lane & 3]; }
+    int size() const { return n_lanes; }
+
+  protected:
+    struct alignas(16) group
+    {
+        uint32_t phase[4], rate[4], curve[4], block[4];
+        int32_t state[4];
+        float level[4], droplevel[4], output[4];
+    };
+    struct lane_params
+    {
+        float *A, *H, *D, *S, *R, *shape;
+        bool no_sustain;
+    };
+
+    void set_state(int lane, long state);
+    void set_rate(int lane, float rate);
+    void process_group(int g, int mask);
+
+    std::unique_ptr<group[]> groups;
+    std::unique_ptr<lane_params[]> params;
+    int n_lanes;
+};
 
 //-------------------------------------------------------------------------------------------------
 
 class Envelope
 {
   public:
-    Envelope();
+    Envelope(envelope_bank *bank, int lane);
     ~Envelope();
-    void Assign(float *envA, float *envH, float *envD, float *envS, float *envR, float *shape);
-    void Attack(bool no_sustain = false);
-    void Release();
-    void UberRelease();
-    bool Process(unsigned int samples);
-    float output;
-    float level, droplevel;
+    void Assign(float *envA, float *envH, float *envD, float *envS, float *envR, float *shape)
+    {
+        bank->assign(lane, envA, envH, envD, envS, envR, shape);
+    }
+    void Attack(bool no_sustain = false) { bank->attack(lane, no_sustain); }
+    void Release() { bank->release(lane); }
+    void UberRelease() { bank->uber_release(lane); }
+    bool Process(unsigned int samples) { return bank->process_lane(lane, samples); }
+    bool IsRunning() const { return bank->is_running(lane); }
+    float &output; // in the bank, modulation sources point at it
 
   protected:
-    void SetState(long);
-    void SetCurve(float);
-    void SetRate(float Rate);
-    float GetValue();
-    float CalcCurve();
-
-    float *A, *H, *D, *S, *R, *shape;
-    envelope_AHDSR *edata;
-    // float phase;
-    // float rate;
-    unsigned int phase, rate;
-    unsigned int curve;
-    bool no_sustain;
-    long state;
-    bool is_AEG;
-    unsigned int block;
+    envelope_bank *bank;
+    int lane;
 };
 
-//-------------------------------------------------------------------------------------------------
\ No newline at end of file
+//-------------------------------------------------------------------------------------------------
@@ -16,10 +16,13 @@
 */
 #pragma once
 
+#include "util/prng.h"
 #include <cstdlib> // for aligned alloc
 
 const int max_fparams = 9;
 const int labelsize = 32;
+// tail_length() of a filter that can keep ringing (or generate output) without input
+const int tail_infinite = 0x1000000;
 
 /*	base class			*/
 
@@ -59,6 +62,8 @@ class filter
     // filters are required to be able to process stereo blocks if stereo is true in the constructor
     virtual void suspend() {}
     virtual int tail_length() { return 1000; }
+    // for filters which need randomness (oscillator phases etc), set by the owner after spawn
+    void seed_random(uint64_t seed) { rng.seed(seed); }
 
     float modulation_output; // filters can use this to output modulation data to the matrix
 
@@ -77,6 +82,7 @@ class filter
     char filtername[32];
     void *loader;
     bool is_stereo;
+    prng rng;
 };
 
 filter *spawn_filter(int id, float *fp, int *ip, void *loader, bool stereo);
@@ -22,6 +22,7 @@
 #include "resampling.h"
 #include "sampler_state.h"
 #include "synthesis/biquadunit.h"
+#include <algorithm>
 #include <memory>
 #include <vt_dsp/basic_dsp.h>
 #include <vt_dsp/lattice.h>
@@ -37,8 +38,6 @@ const char str_freqdef[] = ("f,-5,0.04,6,5,Hz"), str_freqmoddef[] = ("f,-12,0.04
            str_dbbpdef[] = ("f,-48,0.1,48,0,dB"), str_dbmoddef[] = ("f,-96,0.1,96,0,dB"),
            str_mpitch[] = ("f,-96,0.04,96,0,cents"), str_bwdef[] = ("f,0.001,0.005,6,0,oct");
 
-const int tail_infinite = 0x1000000;
-
 //-------------------------------------------------------------------------------------------------------
 
 class alignas(16) LP2A : public filter
@@ -1065,6 +1064,12 @@ class alignas(16) dualdelay : public filter
     void process_stereo(float *datainL, float *datainR, float *dataoutL, float *dataoutR,
                         float pitch);
     virtual void suspend();
+    virtual int tail_length()
+    {
+        if (ringout_time < 0)
+            return tail_infinite;
+        return (int)std::min((int64_t)ringout_time * BLOCK_SIZE, (int64_t)tail_infinite);
+    }
     void setvars(bool init);
 
   private:
@@ -1095,6 +1100,7 @@ class alignas(16) rotary_speaker : public filter
                         float pitch);
     virtual void init_params();
     virtual void init();
+    virtual int tail_length() { return max_delay_length; }
 
   protected:
     float buffer[max_delay_length];
@@ -1120,6 +1126,7 @@ class alignas(16) phaser : public filter
     virtual void init_params();
     virtual void init();
     virtual void suspend();
+    virtual int tail_length() { return tail_infinite; }
     void setvars();
 
   protected:
@@ -1149,6 +1156,8 @@ class alignas(16) fauxstereo : public filter
     virtual void init_params();
     // virtual void init();
     // virtual void suspend();
+    virtual int tail_length() { return tail_infinite; }
+
   protected:
     // lag<float,true> l_amplitude,l_source;
     std::unique_ptr<COMB3> combfilter;
@@ -1166,6 +1175,7 @@ class alignas(16) fs_flange : public filter
     void process_stereo(float *datainL, float *datainR, float *dataoutL, float *dataoutR,
                         float pitch);
     virtual void init_params();
+    virtual int tail_length() { return tail_infinite; }
 
   protected:
     lipol<float> dry, wet, feedback;
@@ -1187,6 +1197,7 @@ class alignas(16) freqshiftdelay : public filter
                         float pitch);
     virtual void init_params();
     virtual void suspend();
+    virtual int tail_length() { return tail_infinite; }
 
   protected:
     float *buffer;
@@ -1228,6 +1239,10 @@ class alignas(16) reverb : public filter
     virtual const char *get_ip_label(int ip_id);
     virtual int get_ip_entry_count(int ip_id);
     virtual const char *get_ip_entry_label(int ip_id, int c_id);
+    virtual int tail_length()
+    {
+        return (int)std::min((int64_t)ringout_time * BLOCK_SIZE, (int64_t)tail_infinite);
+    }
 
   protected:
     void update_rtime();
@@ -1259,6 +1274,7 @@ class alignas(16) chorus : public filter
     virtual void init_params();
     virtual void init();
     virtual void suspend();
+    virtual int tail_length() { return tail_infinite; }
 
   protected:
     void setvars(bool init);
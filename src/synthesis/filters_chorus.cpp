@@ -113,7 +113,7 @@ void chorus::setvars(bool init)
                 lfophase[i] -= 1;
             // float lfoout = 0.5*storage->lookup_waveshape_warp(3,4.f*lfophase[i]-2.f) * *f[2];
             float lfoout = (2.f * fabs(2.f * lfophase[i] - 1.f) - 1.f) * param[2];
-            time[i].newValue(samplerate * tm * (1 + lfoout));
+            time[i].newValue(current_engine().samplerate * tm * (1 + lfoout));
         }
 
         hp.coeff_HP(hp.calc_omega(param[4]), 0.707);
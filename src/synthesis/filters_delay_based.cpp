@@ -58,13 +58,13 @@ void COMB1::process_stereo(float *datainL, float *datainR, float *dataoutL, floa
 {
     /*float p0powf = powf(2,param[0]);
     float dtime = 1.f/(440.f*p0powf);
-    dtime = dtime*samplerate - FIRoffset;
+    dtime = dtime*current_engine().samplerate - FIRoffset;
     dtime = limit_range(dtime,0,comb_max_delay-FIRipol_N-1);
     delaytime.newValue(dtime);
     feedback.newValue(limit_range(((param[1]>0.f)?1.f:-1.f)*powf(fabs(param[1]),1.f/p0powf),-1.f,1.f));*/
 
     float dtime = 1 / (440.f * powf(2, param[0]));
-    dtime = dtime * samplerate - FIRoffset;
+    dtime = dtime * current_engine().samplerate - FIRoffset;
     dtime = limit_range(dtime, 0.f, (float)(comb_max_delay - FIRipol_N - 1));
     delaytime.newValue(dtime);
     feedback.newValue(clamp1bp(param[1]));
@@ -104,7 +104,7 @@ void COMB1::process_stereo(float *datainL, float *datainR, float *dataoutL, floa
 void COMB1::process(float *datain, float *dataout, float pitch)
 {
     float dtime = 1 / (440.f * powf(2, param[0]));
-    dtime = dtime * samplerate - FIRoffset;
+    dtime = dtime * current_engine().samplerate - FIRoffset;
     dtime = limit_range(dtime, 0.f, (float)comb_max_delay - FIRipol_N - 1);
     delaytime.newValue(dtime);
     feedback.newValue(clamp1bp(param[1]));
@@ -172,7 +172,7 @@ void COMB3::init_params()
 void COMB3::process(float *data, float pitch)
 {
     float dtime = powf(2, param[0]);
-    dtime = dtime * samplerate - FIRoffset;
+    dtime = dtime * current_engine().samplerate - FIRoffset;
     dtime = limit_range(dtime, 0.f, (float)(comb_max_delay - FIRipol_N - 1));
     delaytime.newValue(dtime);
     feedback.newValue(clamp1bp(param[1]));
@@ -101,7 +101,7 @@ void BF::init_params()
 void BF::process_stereo(float *datainL, float *datainR, float *dataoutL, float *dataoutR,
                         float pitch)
 {
-    float t = samplerate_inv * 440 * note_to_pitch(12 * param[0]);
+    float t = current_engine().samplerate_inv * 440 * note_to_pitch(12 * param[0]);
     float bd = 16.f * std::min(1.f, std::max(0.f, param[1]));
     float b = powf(2, bd), b_inv = 1 / b;
 
@@ -138,7 +138,7 @@ void BF::process_stereo(float *datainL, float *datainR, float *dataoutL, float *
 }
 void BF::process(float *datain, float *dataout, float pitch)
 {
-    float t = samplerate_inv * 440 * note_to_pitch(12 * param[0]);
+    float t = current_engine().samplerate_inv * 440 * note_to_pitch(12 * param[0]);
     float bd = 16.f * std::min(1.f, std::max(0.f, param[1]));
 
     float b = powf(2.f, bd), b_inv = 1 / b;
@@ -579,7 +579,7 @@ void microgate::process_stereo(float *datainL, float *datainR, float *dataoutL,
 {
     float threshold = db_to_linear(param[2]);
     float reduction = db_to_linear(param[3]);
-    int ihtime = (int)(float)(samplerate * note_to_pitch(12 * param[0]));
+    int ihtime = (int)(float)(current_engine().samplerate * note_to_pitch(12 * param[0]));
 
     copy_block(datainL, dataoutL, BLOCK_SIZE_QUAD);
     copy_block(datainR, dataoutR, BLOCK_SIZE_QUAD);
@@ -667,7 +667,7 @@ void microgate::process(float *datain, float *dataout, float pitch)
 {
     float threshold = db_to_linear(param[2]);
     float reduction = db_to_linear(param[3]);
-    int ihtime = (int)(float)(samplerate * note_to_pitch(12 * param[0]));
+    int ihtime = (int)(float)(current_engine().samplerate * note_to_pitch(12 * param[0]));
 
     copy_block(datain, dataout, BLOCK_SIZE_QUAD);
 
@@ -754,7 +754,7 @@ fslewer::~fslewer() {}
 void fslewer::calc_coeffs()
 {
     assert(param);
-    rate.newValue(samplerate_inv * 440 * note_to_pitch(12 * param[3]));
+    rate.newValue(current_engine().samplerate_inv * 440 * note_to_pitch(12 * param[3]));
 
     if ((lastparam[0] != param[0]) || (lastparam[1] != param[1]) || (lastparam[2] != param[2]) ||
         (lastparam[4] != param[4]) || (lastparam[5] != param[5]))
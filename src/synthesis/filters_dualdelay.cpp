@@ -120,15 +120,17 @@ void dualdelay::setvars(bool init)
     else
         LFOval = ca * LFOval - lfo_increment;
 
-    timeL.newValue(samplerate * (note_to_pitch(12 * param[0])) + LFOval - FIRoffset);
-    timeR.newValue(samplerate * (note_to_pitch(12 * param[1])) - LFOval - FIRoffset);
+    float sr = current_engine().samplerate;
+    timeL.newValue(sr * (note_to_pitch(12 * param[0])) + LFOval - FIRoffset);
+    timeR.newValue(sr * (note_to_pitch(12 * param[1])) - LFOval - FIRoffset);
 
     const float db96 = powf(10.f, 0.05f * -96.f);
     float maxfb = max(db96, fb + cf);
     if (maxfb < 1.f)
     {
         float f = INV_BLOCK_SIZE * max(timeL.v, timeR.v) * (1.f + log(db96) / log(maxfb));
-        ringout_time = (int)f;
+        // clamp in float, (int) of a huge f is undefined
+        ringout_time = (int)std::min(f, (float)(tail_infinite / BLOCK_SIZE));
     }
     else
     {
@@ -116,14 +116,14 @@ void limiter::process_stereo(float *datainL, float *datainR, float *dataoutL, fl
 
     /*if(lastparam[1] != param[1])
     {
-            at = 2-cos(pi*note_to_pitch(-12*param[1])*samplerate_inv),
+            at = 2-cos(pi*note_to_pitch(-12*param[1])*current_engine().samplerate_inv),
             at -= sqrt(at*at - 1.f);
             at = min(0.999999f,at);
             lastparam[1] = param[1];
     }
     if(lastparam[2] != param[2])
     {
-            re = 2-cos(pi*note_to_pitch(-12*param[2])*samplerate_inv);
+            re = 2-cos(pi*note_to_pitch(-12*param[2])*current_engine().samplerate_inv);
             re -= sqrt(re*re - 1.f);
             lastparam[2] = param[2];
     }*/
@@ -230,13 +230,13 @@ void limiter::process(float *datain, float *dataout, float pitch)
 
     /*if(lastparam[1] != param[1])
     {
-            at = 2-cos(pi*note_to_pitch(-12*param[1])*samplerate_inv),
+            at = 2-cos(pi*note_to_pitch(-12*param[1])*current_engine().samplerate_inv),
             at -= sqrt(at*at - 1.f);
             lastparam[1] = param[1];
     }
     if(lastparam[2] != param[2])
     {
-            re = 2-cos(pi*note_to_pitch(-12*param[2])*samplerate_inv);
+            re = 2-cos(pi*note_to_pitch(-12*param[2])*current_engine().samplerate_inv);
             re -= sqrt(re*re - 1.f);
             lastparam[2] = param[2];
     }*/
@@ -361,7 +361,7 @@ void gate::process_stereo(float *datainL, float *datainR, float *dataoutL, float
     float threshold_lo = db_to_linear(param[1] - param[3]);
     float threshold_hi = db_to_linear(param[1] + param[3]);
     float reduction = db_to_linear(param[2]);
-    int ihtime = (int)(float)(samplerate * powf(2, param[0]));
+    int ihtime = (int)(float)(current_engine().samplerate * powf(2, param[0]));
 
     copy_block(datainL, dataoutL, BLOCK_SIZE_QUAD);
     copy_block(datainR, dataoutR, BLOCK_SIZE_QUAD);
@@ -400,7 +400,7 @@ void gate::process(float *datain, float *dataout, float pitch)
     float threshold_lo = db_to_linear(param[1] - param[3]);
     float threshold_hi = db_to_linear(param[1] + param[3]);
     float reduction = db_to_linear(param[2]);
-    int ihtime = (int)(float)(samplerate * powf(2, param[0]));
+    int ihtime = (int)(float)(current_engine().samplerate * powf(2, param[0]));
 
     copy_block(datain, dataout, BLOCK_SIZE_QUAD);
 
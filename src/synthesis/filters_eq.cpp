@@ -420,7 +420,7 @@ void EQ6B::calc_coeffs()
     if ((lastparam[0] != param[0]) || (lastparam[1] != param[1]) || (lastparam[2] != param[2]) ||
         (lastparam[3] != param[3]) || (lastparam[4] != param[4]) || (lastparam[5] != param[5]))
     {
-        double a = PI_2 * samplerate_inv;
+        double a = PI_2 * current_engine().samplerate_inv;
         const double bw = 3;
 
         parametric[0].coeff_peakEQ(100 * a, bw, param[0]);
@@ -489,7 +489,7 @@ void LP2HP2_morph::init_params()
 void LP2HP2_morph::calc_coeffs()
 {
     assert(param);
-    double omega = PI_2 * min(0.499, 440.0 * powf(2.f, param[0]) * samplerate_inv);
+    double omega = PI_2 * min(0.499, 440.0 * powf(2.f, param[0]) * current_engine().samplerate_inv);
     double q = M_SQRT1_2 / (1.0 - limit_range(param[1], 0.f, 0.999f));
 
     f.coeff_LPHPmorph(omega, q, param[2]);
@@ -532,7 +532,7 @@ void COMB2::process(float *data, float pitch)
 {
     assert(param);
 
-    double omega = PI_2 * min(0.499, 440.0 * powf(2, param[0]) * samplerate_inv);
+    double omega = PI_2 * min(0.499, 440.0 * powf(2, param[0]) * current_engine().samplerate_inv);
     double q = 1.0 / (1.02 - clamp01(param[1]));
     fbval.newValue(limit_range(param[2], -0.99f, 0.99f));
 
@@ -113,8 +113,9 @@ void LP4M_sat::process_stereo(float *datainL, float *datainR, float *dataoutL, f
     assert(datainL);
     assert(datainR);
     assert(param);
-    double gg = limit_range(
-        (440.0 * (double)note_to_pitch(12.0 * param[0]) * (double)samplerate_inv * 0.5), 0.0, 0.25);
+    double gg = limit_range((440.0 * (double)note_to_pitch(12.0 * param[0]) *
+                             (double)current_engine().samplerate_inv * 0.5),
+                            0.0, 0.25);
 
     double t_b1 = 1.0 - exp(-2.0 * M_PI * gg);
     g.newValue(t_b1);
@@ -165,8 +166,9 @@ void LP4M_sat::process(float *datain, float *dataout, float pitch)
 {
     assert(datain);
     assert(param);
-    double gg = limit_range(
-        (440.0 * (double)note_to_pitch(12.0 * param[0]) * (double)samplerate_inv * 0.5), 0.0, 0.25);
+    double gg = limit_range((440.0 * (double)note_to_pitch(12.0 * param[0]) *
+                             (double)current_engine().samplerate_inv * 0.5),
+                            0.0, 0.25);
 
     double t_b1 = 1 - exp(-2.0 * M_PI * gg);
     g.newValue(t_b1);
@@ -60,7 +60,7 @@ void RING::process_stereo(float *datainL, float *datainR, float *dataoutL, float
                           float pitch)
 {
     amount.newValue(limit_range(param[1], 0.f, 1.f));
-    double omega = 0.5 * 440 * powf(2, param[0]) * PI_2 * samplerate_inv;
+    double omega = 0.5 * 440 * powf(2, param[0]) * PI_2 * current_engine().samplerate_inv;
     qosc.set_rate(omega);
 
     const int bs2 = BLOCK_SIZE << 1;
@@ -82,7 +82,7 @@ void RING::process_stereo(float *datainL, float *datainR, float *dataoutL, float
 void RING::process(float *datain, float *dataout, float pitch)
 {
     amount.newValue(limit_range(param[1], 0.f, 1.f));
-    double omega = 0.5 * 440 * powf(2, param[0]) * PI_2 * samplerate_inv;
+    double omega = 0.5 * 440 * powf(2, param[0]) * PI_2 * current_engine().samplerate_inv;
     qosc.set_rate(omega);
 
     const int bs2 = BLOCK_SIZE << 1;
@@ -132,9 +132,9 @@ void FREQSHIFT::process_stereo(float *datainL, float *datainR, float *dataoutL,
     double omega;
     if (iparam[0])
         omega = (1000 * param[0] + 440 * pow((double)1.05946309435, (double)pitch)) * PI_2 *
-                samplerate_inv;
+                current_engine().samplerate_inv;
     else
-        omega = 1000 * param[0] * PI_2 * samplerate_inv;
+        omega = 1000 * param[0] * PI_2 * current_engine().samplerate_inv;
 
     o1.set_rate(M_PI * 0.5 - min(0.0, omega));
     o2.set_rate(M_PI * 0.5 + max(0.0, omega));
@@ -174,9 +174,9 @@ void FREQSHIFT::process(float *datain, float *dataout, float pitch)
     double omega;
     if (iparam[0])
         omega = (1000.0 * param[0] + 440.0 * pow((double)1.05946309435, (double)pitch)) * PI_2 *
-                samplerate_inv;
+                current_engine().samplerate_inv;
     else
-        omega = 1000.0 * param[0] * PI_2 * samplerate_inv;
+        omega = 1000.0 * param[0] * PI_2 * current_engine().samplerate_inv;
 
     o1.set_rate(M_PI * 0.5 - min(0.0, omega));
     o2.set_rate(M_PI * 0.5 + max(0.0, omega));
@@ -255,7 +255,8 @@ void PMOD::init_params()
 
 void PMOD::process(float *datain, float *dataout, float pitch)
 {
-    omega.newValue(0.5 * 440 * note_to_pitch(pitch + param[0]) * PI_2 * samplerate_inv);
+    omega.newValue(0.5 * 440 * note_to_pitch(pitch + param[0]) * PI_2 *
+                   current_engine().samplerate_inv);
     // amp.newValue(3.1415 * dB_to_linear(param[1]));
 
     pregain.set_target(3.1415 * dB_to_linear(param[1]));
@@ -280,7 +281,8 @@ void PMOD::process(float *datain, float *dataout, float pitch)
 void PMOD::process_stereo(float *datainL, float *datainR, float *dataoutL, float *dataoutR,
                           float pitch)
 {
-    omega.newValue(0.5 * 440 * note_to_pitch(pitch + param[0]) * PI_2 * samplerate_inv);
+    omega.newValue(0.5 * 440 * note_to_pitch(pitch + param[0]) * PI_2 *
+                   current_engine().samplerate_inv);
     pregain.set_target(3.1415 * dB_to_linear(param[1]));
     // postgain.set_target(dB_to_linear(max(0,-param[1])));
 
@@ -370,8 +372,9 @@ void rotary_speaker::process_stereo(float *datainL, float *datainR, float *dataL
 {
     const int mindelay = 64; // 33?
 
-    lfo.set_rate(2 * M_PI * powf(2, param[rsp_rate]) * samplerate_inv * BLOCK_SIZE);
-    lf_lfo.set_rate(0.7 * 2 * M_PI * powf(2, param[rsp_rate]) * samplerate_inv);
+    float sr_inv = current_engine().samplerate_inv;
+    lfo.set_rate(2 * M_PI * powf(2, param[rsp_rate]) * sr_inv * BLOCK_SIZE);
+    lf_lfo.set_rate(0.7 * 2 * M_PI * powf(2, param[rsp_rate]) * sr_inv);
 
     float precalc0 = (-2 - (float)lfo.i);
     float precalc1 = (-1 - (float)lfo.r);
@@ -379,7 +382,7 @@ void rotary_speaker::process_stereo(float *datainL, float *datainR, float *dataL
     float lenL = sqrt(precalc0 * precalc0 + precalc1 * precalc1);
     float lenR = sqrt(precalc0 * precalc0 + precalc2 * precalc2);
 
-    float delay = samplerate * 0.0018f * param[rsp_doppler];
+    float delay = current_engine().samplerate * 0.0018f * param[rsp_doppler];
     dL.newValue(delay * lenL);
     dR.newValue(delay * lenR);
     float dotp_L = (precalc1 * (float)lfo.r + precalc0 * (float)lfo.i) / lenL;
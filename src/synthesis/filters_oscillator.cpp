@@ -88,8 +88,8 @@ void osc_pulse::convolute()
 
     // add time until next statechange
     double width = (0.5 - 0.499f * min(1.f, max(0.f, param[1])));
-    double t =
-        max(0.5, samplerate / (440.0 * pow((double)1.05946309435, (double)pitch + param[0])));
+    double t = max(0.5, current_engine().samplerate /
+                            (440.0 * pow((double)1.05946309435, (double)pitch + param[0])));
     if (polarity)
     {
         width = 1 - width;
@@ -190,8 +190,8 @@ void osc_pulse_sync::convolute()
     if (syncstate < oscstate)
     {
         ipos = ((large + syncstate) >> 16) & 0xFFFFFFFF;
-        double t =
-            max(0.5, samplerate / (440.0 * pow((double)1.05946309435, (double)pitch + param[0])));
+        double t = max(0.5, current_engine().samplerate /
+                                (440.0 * pow((double)1.05946309435, (double)pitch + param[0])));
         int64_t syncrate = (int64_t)(double)(65536.0 * 16777216.0 * t);
         oscstate = syncstate;
         syncstate += syncrate;
@@ -217,9 +217,9 @@ void osc_pulse_sync::convolute()
 
     // add time until next statechange
     double width = (0.5 - 0.499f * min(1.f, max(0.f, param[1])));
-    double t =
-        max(0.5,
-            samplerate / (440.0 * pow((double)1.05946309435, (double)pitch + param[0] + param[2])));
+    double t = max(0.5, current_engine().samplerate /
+                            (440.0 * pow((double)1.05946309435,
+                                         (double)pitch + param[0] + param[2])));
     lastpulselength = t;
     if (polarity)
     {
@@ -356,7 +356,8 @@ void osc_saw::convolute(int voice)
 
     // add time until next statechange
     double detune = param[1] * (detune_bias * float(voice) + detune_offset);
-    double t = max(2.0, samplerate / (440.0 * pow(1.05946309435, pitch + param[0] + detune)));
+    double t = max(2.0, current_engine().samplerate /
+                            (440.0 * pow(1.05946309435, pitch + param[0] + detune)));
     dc_uni[voice] = s / t;
     int64_t rate = (int64_t)(double)(65536.0 * 16777216.0 * t);
 
@@ -412,9 +413,10 @@ void osc_saw::process(float *datain, float *dataout, float pitch)
         int i;
         for (i = 0; i < n_unison; i++)
         {
-            double drand = (double)rand() / RAND_MAX;
-            double t = drand * max(2.0, samplerate / (440.0 * pow((double)1.05946309435,
-                                                                  (double)pitch + param[0])));
+            double drand = rng.unipolar();
+            double t = drand * max(2.0, current_engine().samplerate /
+                                            (440.0 * pow((double)1.05946309435,
+                                                         (double)pitch + param[0])));
             oscstate[i] = (int64_t)(double)(65536.0 * 16777216.0 * t);
             dc_uni[i] = 0;
         }
@@ -470,7 +472,7 @@ void osc_sin::init_params()
 void osc_sin::process(float *datain, float *dataout, float pitch)
 {
     osc.set_rate(440.0 * PI_2 * pow((double)1.05946309435, (double)pitch + param[0]) *
-                 samplerate_inv);
+                 current_engine().samplerate_inv);
 
     for (int k = 0; k < BLOCK_SIZE; k++)
     {
@@ -483,7 +485,7 @@ void osc_sin::process_stereo(float *datainL, float *datainR, float *dataoutL, fl
                              float pitch)
 {
     osc.set_rate(440.0 * PI_2 * pow((double)1.05946309435, (double)pitch + param[0]) *
-                 samplerate_inv);
+                 current_engine().samplerate_inv);
 
     for (int k = 0; k < BLOCK_SIZE; k++)
     {
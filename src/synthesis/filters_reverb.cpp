@@ -225,16 +225,16 @@ void reverb::loadpreset(int id)
 void reverb::update_rtime()
 {
     int max_dt = 0;
+    float sr = current_engine().samplerate;
     for (int t = 0; t < rev_taps; t++)
     {
-        delay_fb[t] =
-            powf(db60, delay_time[t] / (256.f * samplerate * powf(2.f, param[rp_decaytime])));
+        delay_fb[t] = powf(db60, delay_time[t] / (256.f * sr * powf(2.f, param[rp_decaytime])));
         max_dt = std::max(max_dt, delay_time[t]);
     }
     lastf[rp_decaytime] = param[rp_decaytime];
-    float t = INV_BLOCK_SIZE * ((float)(max_dt >> 8) + samplerate * powf(2.f, param[rp_decaytime]) *
-                                                           2.f); // *2 is to get the db120 time
-    ringout_time = (int)t;
+    // *2 is to get the db120 time
+    float t = INV_BLOCK_SIZE * ((float)(max_dt >> 8) + sr * powf(2.f, param[rp_decaytime]) * 2.f);
+    ringout_time = (int)std::min(t, (float)(tail_infinite / BLOCK_SIZE));
 }
 void reverb::update_rsize()
 {
@@ -269,7 +269,7 @@ void reverb::process_stereo(float *datainL, float *datainR, float *dataoutL, flo
 
     width.set_target_smoothed(db_to_linear(param[rp_width]));
 
-    int pdtime = (int)(float)samplerate * note_to_pitch(12 * param[rp_predelay]);
+    int pdtime = (int)(float)current_engine().samplerate * note_to_pitch(12 * param[rp_predelay]);
     const __m128 one4 = _mm_set1_ps(1.f);
     __m128 damp4 = _mm_load1_ps(&param[rp_damping]);
     __m128 damp4m1 = _mm_sub_ps(one4, damp4);
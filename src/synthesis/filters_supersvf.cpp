@@ -81,7 +81,8 @@ void SuperSVF::calc_coeffs()
     if ((lastparam[0] != param[0]) || (lastparam[1] != param[1]) || (lastiparam[1] != iparam[1]))
     {
         float f = 440.f * note_to_pitch(param[0] * 12.f);
-        float F1 = 2.0 * sin(M_PI * min(0.11, f * (0.25 * samplerate_inv))); // 4x oversampling
+        // 4x oversampling
+        float F1 = 2.0 * sin(M_PI * min(0.11, f * (0.25 * current_engine().samplerate_inv)));
 
         float Reso = sqrt(limit_range(param[1], 0.f, 1.f));
 
@@ -181,7 +181,7 @@ freqshiftdelay::freqshiftdelay(float *ep, int *ip) : filter(ep)
 
     if (ep)
     {
-        delaytime_filtered = (float)(samplerate * powf(2, param[0]));
+        delaytime_filtered = (float)(current_engine().samplerate * powf(2, param[0]));
     }
 }
 
@@ -199,7 +199,7 @@ void freqshiftdelay::init_params()
     param[0] = -1.0f;
     param[1] = -15.f;
     param[2] = 1.0f;
-    delaytime_filtered = (float)(samplerate * powf(2, param[0]));
+    delaytime_filtered = (float)(current_engine().samplerate * powf(2, param[0]));
 }
 
 void freqshiftdelay::suspend()
@@ -217,7 +217,7 @@ void freqshiftdelay::process_stereo(float *datainL, float *datainR, float *datao
     float feedback = db_to_linear(param[1]);
     float delaytime;
 
-    delaytime = (float)(samplerate * powf(2, param[0]));
+    delaytime = (float)(current_engine().samplerate * powf(2, param[0]));
 
     float tbuffer[BLOCK_SIZE];
 
@@ -21,21 +21,18 @@
 #include <math.h>
 #define _USE_MATH_DEFINES
 
-extern float table_dB[512], table_pitch[512], table_envrate_lpf[512], table_envrate_linear[512];
+extern float table_dB[512], table_pitch[512];
 extern float waveshapers[8][1024]; // typ?
 
 inline double shafted_tanh(double x) { return (exp(x) - exp(-x * 1.2)) / (exp(x) + exp(-x)); }
 
-inline void init_tables(double samplerate, int BLOCK_SIZE)
+// sample rate independent tables, the rate dependent ones live in engine_context
+inline void init_tables()
 {
-    float db60 = powf(10.f, 0.05f * -60.f);
     for (int i = 0; i < 512; i++)
     {
         table_dB[i] = powf(10.f, 0.05f * ((float)i - 384.f));
         table_pitch[i] = powf(2.f, ((float)i - 256.f) * (1.f / 12.f));
-        double k = samplerate * pow(2.0, (((double)i - 256.0) / 16.0)) / (double)BLOCK_SIZE;
-        table_envrate_lpf[i] = (float)(1.f - exp(log(db60) / k));
-        table_envrate_linear[i] = 1 / k;
     }
 
     double mult = 1.0 / 32.0;
@@ -24,6 +24,7 @@
 #include "sampler_voice.h"
 #include "synthesis/filter.h"
 #include <algorithm>
+#include <cassert>
 #include <cstring>
 #include <vt_dsp/basic_dsp.h>
 #include "util/scxtstring.h"
@@ -32,84 +33,138 @@ using std::min;
 
 float one = 1.0f;
 
-const float randscale = (2.f / (float)RAND_MAX);
-
 int modmatrix::get_destination_value_int(int id) { return Float2Int(fdst[id]); }
 
-modmatrix::modmatrix() {}
+static void add_source(mm_layout &l, unsigned char RIFFID, const char *name,
+                       const char *dispname = 0)
+{
+    assert(l.n_src < mm_max_sources);
+    mm_src &t = l.src[l.n_src++];
+    strncpy_0term(t.id_name, name, namelen);
 
-void modmatrix::assign(configuration *conf, sample_zone *zone, sample_part *part,
-                       sampler_voice *voice, float *control, float *automation, timedata *td)
+    if (dispname)
+        strncpy_0term(t.display_name, dispname, namelen);
+    else
+        strncpy_0term(t.display_name, name, namelen);
+
+    t.RIFFID = RIFFID;
+}
+
+static void add_destination(mm_layout &l, unsigned char RIFFID, int id, const char *name,
+                            int control_type, const char *dispname = 0)
 {
-    // zero mem
-    memset(fdst, 0, sizeof(float) * md_num_destinations);
-    alternate = 1.f;
+    strncpy_0term(l.dst[id].id_name, name, namelen);
 
-    this->zone = zone;
-    this->part = part;
-    this->voice = voice;
-    this->control = control;
-    this->automation = automation;
+    if (dispname)
+        strncpy_0term(l.dst[id].display_name, dispname, namelen);
+    else
+        strncpy_0term(l.dst[id].display_name, name, namelen);
+
+    l.dst[id].ctrlmode = control_type;
+    l.dst[id].RIFFID = RIFFID;
+}
 
-    add_source(RMS_None, "none", 0, "None");
+/*
+ * Fills in the layout of a zone matrix, or a part matrix when !zone_matrix. The labels come from
+ * zone and part where given, the shared layouts have neither.
+ */
+namespace
+{
+// the parameter labels and mod modes of every filter type, which depend on the type alone.
+// spawning a filter to ask allocates, so they're collected once, with the shared layouts
+struct filter_labels
+{
+    bool known[ft_num_types];
+    char label[ft_num_types][max_fparams][labelsize];
+    int ctrlmode[ft_num_types][max_fparams];
+
+    filter_labels()
+    {
+        float fp[n_filter_parameters] = {};
+        int ip[n_filter_iparameters] = {};
+        memset(label, 0, sizeof(label));
+        memset(ctrlmode, 0, sizeof(ctrlmode));
+        for (int t = 0; t < ft_num_types; t++)
+        {
+            filter *f = valid_filtertype(t) ? spawn_filter(t, fp, ip, 0, false) : nullptr;
+            known[t] = (f != nullptr);
+            for (int p = 0; f && (p < max_fparams); p++)
+            {
+                strncpy_0term(label[t][p], f->get_parameter_label(p), labelsize);
+                ctrlmode[t][p] = f->get_parameter_ctrlmode(p);
+            }
+            spawn_filter_release(f);
+        }
+    }
+
+    static const filter_labels &get()
+    {
+        static const filter_labels fl;
+        return fl;
+    }
+};
+} // namespace
+
+static void build_layout(mm_layout &l, bool zone_matrix, sample_zone *zone, sample_part *part)
+{
+    memset(&l, 0, sizeof(l));
+
+    add_source(l, RMS_None, "none", "None");
     // voice sources
-    if (zone) // only available for the zone
+    if (zone_matrix) // only available for the zone
     {
-        add_source(RMS_Keytrack, "keytrack", voice ? &voice->keytrack : 0, "Keytrack");
-        add_source(RMS_Velocity, "velocity", voice ? &voice->fvelocity : 0, "Velocity");
-        add_source(RMS_Modulator1, "AEG", voice ? &voice->AEG.output : 0);
-        ss_id[ss_EG2] = (int)src.size();
-        add_source(RMS_Modulator2, "EG2", voice ? &voice->EG2.output : 0);
-        ss_id[ss_LFO1] = (int)src.size();
-        add_source(RMS_Modulator3, "stepLFO1", voice ? &voice->stepLFO[0].output : 0, "Step LFO 1");
-        ss_id[ss_LFO2] = (int)src.size();
-        add_source(RMS_Modulator4, "stepLFO2", voice ? &voice->stepLFO[1].output : 0, "Step LFO 2");
-        ss_id[ss_LFO3] = (int)src.size();
-        add_source(RMS_Modulator5, "stepLFO3", voice ? &voice->stepLFO[2].output : 0, "Step LFO 3");
-        add_source(RMS_SliceEnv, "slice_env", voice ? &voice->slice_env : 0, "Slice Envelope");
-        add_source(RMS_Random, "random+", voice ? &voice->random : 0, "Random Uni");
-        add_source(RMS_RandomBP, "random +/-", voice ? &voice->randombp : 0, "Random Bi");
-        add_source(RMS_Gate, "gate", voice ? &voice->fgate : 0, "Gate");
-        add_source(RMS_Time, "time", voice ? &voice->time : 0, "Time (s)");
-        add_source(RMS_TimeMinutes, "time60", voice ? &voice->time60 : 0, "Time (m)");
-        ss_id[ss_lag0] = (int)src.size();
-        add_source(RMS_LagGenerator1, "lag1", voice ? &voice->lag[0] : 0, "Lag 1");
-        ss_id[ss_lag1] = (int)src.size();
-        add_source(RMS_LagGenerator2, "lag2", voice ? &voice->lag[1] : 0, "Lag 2");
-        ss_id[ss_envf] = (int)src.size();
+        add_source(l, RMS_Keytrack, "keytrack", "Keytrack");
+        add_source(l, RMS_Velocity, "velocity", "Velocity");
+        add_source(l, RMS_Modulator1, "AEG");
+        l.ss_id[ss_EG2] = l.n_src;
+        add_source(l, RMS_Modulator2, "EG2");
+        l.ss_id[ss_LFO1] = l.n_src;
+        add_source(l, RMS_Modulator3, "stepLFO1", "Step LFO 1");
+        l.ss_id[ss_LFO2] = l.n_src;
+        add_source(l, RMS_Modulator4, "stepLFO2", "Step LFO 2");
+        l.ss_id[ss_LFO3] = l.n_src;
+        add_source(l, RMS_Modulator5, "stepLFO3", "Step LFO 3");
+        add_source(l, RMS_SliceEnv, "slice_env", "Slice Envelope");
+        add_source(l, RMS_Random, "random+", "Random Uni");
+        add_source(l, RMS_RandomBP, "random +/-", "Random Bi");
+        add_source(l, RMS_Gate, "gate", "Gate");
+        add_source(l, RMS_Time, "time", "Time (s)");
+        add_source(l, RMS_TimeMinutes, "time60", "Time (m)");
+        l.ss_id[ss_lag0] = l.n_src;
+        add_source(l, RMS_LagGenerator1, "lag1", "Lag 1");
+        l.ss_id[ss_lag1] = l.n_src;
+        add_source(l, RMS_LagGenerator2, "lag2", "Lag 2");
+        l.ss_id[ss_envf] = l.n_src;
         // add_source("envfollow",		voice ? &voice->envelope_follower : 0);
-        add_source(RMS_WithinLoop, "loop_gate", voice ? &voice->loop_gate : 0, "Is Within Loop");
-        add_source(RMS_LoopPos, "loop_pos", voice ? &voice->loop_pos : 0, "Position In Loop");
-        add_source(RMS_Filter1ModOut, "f1modout", voice ? &voice->filter_modout[0] : 0,
-                   "F1 Mod Out");
-        add_source(RMS_Filter2ModOut, "f2modout", voice ? &voice->filter_modout[1] : 0,
-                   "F2 Mod Out");
+        add_source(l, RMS_WithinLoop, "loop_gate", "Is Within Loop");
+        add_source(l, RMS_LoopPos, "loop_pos", "Position In Loop");
+        add_source(l, RMS_Filter1ModOut, "f1modout", "F1 Mod Out");
+        add_source(l, RMS_Filter2ModOut, "f2modout", "F2 Mod Out");
     }
 
-    add_source(RMS_Noise, "noise", &noisegen, "Noise");
-    add_source(RMS_Alternate, "alternate", voice ? &voice->alternate : &alternate, "Alternate");
+    add_source(l, RMS_Noise, "noise", "Noise");
+    add_source(l, RMS_Alternate, "alternate", "Alternate");
 
-    add_source(RMS_PosBeat, "pos_beat", td ? &td->pos_in_beat : 0, "Sync (1 Beat)");
-    add_source(RMS_Pos2Beats, "pos_2beats", td ? &td->pos_in_2beats : 0, "Sync (2 Beats)");
-    add_source(RMS_PosBar, "pos_bar", td ? &td->pos_in_bar : 0, "Sync (1 Bar)");
-    add_source(RMS_Pos2Bars, "pos_2bars", td ? &td->pos_in_2bars : 0, "Sync (2 Bars)");
-    add_source(RMS_Pos4Bars, "pos_4bars", td ? &td->pos_in_4bars : 0, "Sync (4 Bars)");
+    add_source(l, RMS_PosBeat, "pos_beat", "Sync (1 Beat)");
+    add_source(l, RMS_Pos2Beats, "pos_2beats", "Sync (2 Beats)");
+    add_source(l, RMS_PosBar, "pos_bar", "Sync (1 Bar)");
+    add_source(l, RMS_Pos2Bars, "pos_2bars", "Sync (2 Bars)");
+    add_source(l, RMS_Pos4Bars, "pos_4bars", "Sync (4 Bars)");
 
-    add_source(RMS_One, "constant1", &one, "Constant");
+    add_source(l, RMS_One, "constant1", "Constant");
     // automation & channel modulation sources
-    add_source(RMS_PitchBend, "pitchbend", control ? &control[c_pitch_bend] : 0, "Pitch Bend");
+    add_source(l, RMS_PitchBend, "pitchbend", "Pitch Bend");
     // add_source("pb_up",			&pb_up,"pitchbend up");
     // add_source("pb_down",		&pb_down,"pitchbend down");
-    add_source(RMS_ChAftertouch, "channelAT", control ? &control[c_channel_aftertouch] : 0,
-               "Channel AT");
-    add_source(RMS_ModulationWheel, "modwheel", control ? &control[c_modwheel] : 0, "Modwheel");
+    add_source(l, RMS_ChAftertouch, "channelAT", "Channel AT");
+    add_source(l, RMS_ModulationWheel, "modwheel", "Modwheel");
     int i;
     for (i = 0; i < n_custom_controllers; i++)
     {
         char stnice[namelen], st[namelen];
         sprintf(stnice, "C%i: %s", i + 1, part ? part->userparametername[i] : "");
         sprintf(st, "C%i", i + 1);
-        add_source(RMS_Ctrl1 + i, st, part ? &part->userparameter_smoothed[i] : 0, stnice);
+        add_source(l, RMS_Ctrl1 + i, st, stnice);
     }
     /*for(i=0; i<N_AUTOMATION_PARAMETERS; i++)
     {
@@ -120,34 +175,36 @@ void modmatrix::assign(configuration *conf, sample_zone *zone, sample_part *part
 
     // destinations
 
-    add_destination(RMD_None, md_none, "none", 0, "None");
-    if (zone)
+    add_destination(l, RMD_None, md_none, "none", 0, "None");
+    if (zone_matrix)
     {
         // zone-level matrix
-        add_destination(RMD_Pitch, md_pitch, "pitch", cm_mod_pitch, "Pitch");
-        add_destination(RMD_Rate, md_rate, "rate", cm_mod_percent, "Rate (Linear)");
-        add_destination(RMD_Amplitude, md_amplitude, "amplitude", cm_mod_decibel, "Amplitude");
-        add_destination(RMD_PreFilterGain, md_prefilter_gain, "pfg", cm_mod_decibel,
+        l.n_dst = md_num_zone_destinations;
+        add_destination(l, RMD_Pitch, md_pitch, "pitch", cm_mod_pitch, "Pitch");
+        add_destination(l, RMD_Rate, md_rate, "rate", cm_mod_percent, "Rate (Linear)");
+        add_destination(l, RMD_Amplitude, md_amplitude, "amplitude", cm_mod_decibel, "Amplitude");
+        add_destination(l, RMD_PreFilterGain, md_prefilter_gain, "pfg", cm_mod_decibel,
                         "Pre-Filter Gain");
-        add_destination(RMD_Balance, md_pan, "pan", cm_mod_percent, "Pan");
-        add_destination(RMD_AmplitudeAux1, md_aux_level, "aux_level", cm_mod_decibel,
+        add_destination(l, RMD_Balance, md_pan, "pan", cm_mod_percent, "Pan");
+        add_destination(l, RMD_AmplitudeAux1, md_aux_level, "aux_level", cm_mod_decibel,
                         "Aux 1 Level");
-        add_destination(RMD_BalanceAux1, md_aux_balance, "aux_balance", cm_mod_percent,
+        add_destination(l, RMD_BalanceAux1, md_aux_balance, "aux_balance", cm_mod_percent,
                         "Aux 1 Balance");
-        add_destination(RMD_AmplitudeAux2, md_aux2_level, "aux2_level", cm_mod_decibel,
+        add_destination(l, RMD_AmplitudeAux2, md_aux2_level, "aux2_level", cm_mod_decibel,
                         "Aux 2 Level");
-        add_destination(RMD_BalanceAux2, md_aux2_balance, "aux2_balance", cm_mod_percent,
+        add_destination(l, RMD_BalanceAux2, md_aux2_balance, "aux2_balance", cm_mod_percent,
                         "Aux 2 Balance");
 
-        add_destination(RMD_Filter1Mix, md_filter1mix, "f1mix", cm_mod_percent, "Filter 1 Mix");
-        add_destination(RMD_Filter2Mix, md_filter2mix, "f2mix", cm_mod_percent, "Filter 2 Mix");
+        add_destination(l, RMD_Filter1Mix, md_filter1mix, "f1mix", cm_mod_percent,
+                        "Filter 1 Mix");
+        add_destination(l, RMD_Filter2Mix, md_filter2mix, "f2mix", cm_mod_percent,
+                        "Filter 2 Mix");
 
+        auto &fl = filter_labels::get();
         for (unsigned int fs = 0; fs < 2; fs++)
         {
-            filter *tempf = 0;
-            if (zone)
-                tempf = spawn_filter(zone->Filter[fs].type, zone->Filter[fs].p, zone->Filter[fs].ip,
-                                     0, false);
+            int ft = zone ? zone->Filter[fs].type : 0;
+            bool known = valid_filtertype(ft) && fl.known[ft];
 
             for (unsigned int fp = 0; fp < 6; fp++)
             {
@@ -155,88 +212,79 @@ void modmatrix::assign(configuration *conf, sample_zone *zone, sample_part *part
                 char txt[namelen];
                 char idname[namelen];
                 sprintf(idname, "f%ip%i", fs + 1, fp + 1);
-                if (tempf)
-                    sprintf(txt, "F%i: %s", fs + 1, tempf->get_parameter_label(fp));
+                if (known)
+                    sprintf(txt, "F%i: %s", fs + 1, fl.label[ft][fp]);
                 else
                     sprintf(txt, "F%i: ---", fs + 1);
-                if (tempf)
-                    ct = tempf->get_parameter_ctrlmode(fp);
+                if (known)
+                    ct = fl.ctrlmode[ft][fp];
 
                 ct = get_mod_mode(ct);
 
-                add_destination(RMD_Filter1Param0 + 0x10 * fs + fp,
+                add_destination(l, RMD_Filter1Param0 + 0x10 * fs + fp,
                                 md_filter1prm0 + fs * (md_filter2prm0 - md_filter1prm0) + fp,
                                 idname, ct, txt);
             }
-            spawn_filter_release(tempf);
         }
 
-        add_destination(RMD_SampleStart, md_sample_start, "samplestart", cm_mod_percent,
+        add_destination(l, RMD_SampleStart, md_sample_start, "samplestart", cm_mod_percent,
                         "Sample Start");
-        add_destination(RMD_LoopStart, md_loop_start, "loopstart", cm_mod_percent, "Loop Start");
-        add_destination(RMD_LoopLength, md_loop_length, "looplength", cm_mod_percent,
+        add_destination(l, RMD_LoopStart, md_loop_start, "loopstart", cm_mod_percent,
+                        "Loop Start");
+        add_destination(l, RMD_LoopLength, md_loop_length, "looplength", cm_mod_percent,
                         "Loop Length");
 
         // add_destination(md_granularpos,"granular",cm_mod_percent,"granular pos");
 
-        add_destination(RMD_AEGAttack, md_AEG_a, "eg1a", cm_mod_time, "AEG Attack");
-        add_destination(RMD_AEGHold, md_AEG_h, "eg1h", cm_mod_time, "AEG Hold");
-        add_destination(RMD_AEGDecay, md_AEG_d, "eg1d", cm_mod_time, "AEG Decay");
-        add_destination(RMD_AEGSustain, md_AEG_s, "eg1s", cm_mod_percent, "AEG Sustain");
-        add_destination(RMD_AEGRelease, md_AEG_r, "eg1r", cm_mod_time, "AEG Release");
-        add_destination(RMD_EG2Attack, md_EG2_a, "eg2a", cm_mod_time, "EG2 Attack");
-        add_destination(RMD_EG2Hold, md_EG2_h, "eg2h", cm_mod_time, "EG2 Hold");
-        add_destination(RMD_EG2Decay, md_EG2_d, "eg2d", cm_mod_time, "EG2 Decay");
-        add_destination(RMD_EG2Sustain, md_EG2_s, "eg2s", cm_mod_percent, "EG2 Sustain");
-        add_destination(RMD_EG2Release, md_EG2_r, "eg2r", cm_mod_time, "EG2 Release");
-
-        add_destination(RMD_LFO1Rate, md_LFO1_rate, "lfo1rate", cm_mod_freq, "Step LFO 1 Rate");
-        add_destination(RMD_LFO2Rate, md_LFO2_rate, "lfo2rate", cm_mod_freq, "Step LFO 2 Rate");
-        add_destination(RMD_LFO3Rate, md_LFO3_rate, "lfo3rate", cm_mod_freq, "Step LFO 3 Rate");
-
-        add_destination(RMD_LagGenerator1, md_lag0, "lag1", cm_mod_percent, "Lag 1");
-        add_destination(RMD_LagGenerator2, md_lag1, "lag2", cm_mod_percent, "Lag 2");
-
-        /*for(i=0; i<mm_entries; i++)
-        {
-                char label[namelen],id[namelen];
-                sprintf(label,"mod slot #%i",i+1);
-                sprintf(id,"mm%i",i);
-                int ct = cm_mod_percent;
-                if (zone)
-                {
-                        int d = zone->mm[i].destination;
-                        if((d>0)&&(d<(int)dst.size())) ct = dst[d].ctrlmode;
-                }
-                add_destination(md_MM0_depth+i,id,ct,label);
-        }*/
+        add_destination(l, RMD_AEGAttack, md_AEG_a, "eg1a", cm_mod_time, "AEG Attack");
+        add_destination(l, RMD_AEGHold, md_AEG_h, "eg1h", cm_mod_time, "AEG Hold");
+        add_destination(l, RMD_AEGDecay, md_AEG_d, "eg1d", cm_mod_time, "AEG Decay");
+        add_destination(l, RMD_AEGSustain, md_AEG_s, "eg1s", cm_mod_percent, "AEG Sustain");
+        add_destination(l, RMD_AEGRelease, md_AEG_r, "eg1r", cm_mod_time, "AEG Release");
+        add_destination(l, RMD_EG2Attack, md_EG2_a, "eg2a", cm_mod_time, "EG2 Attack");
+        add_destination(l, RMD_EG2Hold, md_EG2_h, "eg2h", cm_mod_time, "EG2 Hold");
+        add_destination(l, RMD_EG2Decay, md_EG2_d, "eg2d", cm_mod_time, "EG2 Decay");
+        add_destination(l, RMD_EG2Sustain, md_EG2_s, "eg2s", cm_mod_percent, "EG2 Sustain");
+        add_destination(l, RMD_EG2Release, md_EG2_r, "eg2r", cm_mod_time, "EG2 Release");
+
+        add_destination(l, RMD_LFO1Rate, md_LFO1_rate, "lfo1rate", cm_mod_freq,
+                        "Step LFO 1 Rate");
+        add_destination(l, RMD_LFO2Rate, md_LFO2_rate, "lfo2rate", cm_mod_freq,
+                        "Step LFO 2 Rate");
+        add_destination(l, RMD_LFO3Rate, md_LFO3_rate, "lfo3rate", cm_mod_freq,
+                        "Step LFO 3 Rate");
+
+        add_destination(l, RMD_LagGenerator1, md_lag0, "lag1", cm_mod_percent, "Lag 1");
+        add_destination(l, RMD_LagGenerator2, md_lag1, "lag2", cm_mod_percent, "Lag 2");
     }
     else
     {
         // part-level matrix
-        add_destination(RMD_PartAmplitude, md_part_amplitude, "amplitude", cm_mod_decibel,
+        l.n_dst = md_num_part_destinations;
+        add_destination(l, RMD_PartAmplitude, md_part_amplitude, "amplitude", cm_mod_decibel,
                         "Amplitude");
-        add_destination(RMD_PartPreFilterGain, md_part_prefilter_gain, "pfg", cm_mod_decibel,
+        add_destination(l, RMD_PartPreFilterGain, md_part_prefilter_gain, "pfg", cm_mod_decibel,
                         "Pre-Filter Gain");
-        add_destination(RMD_PartBalance, md_part_pan, "balance", cm_mod_percent, "Balance");
-        add_destination(RMD_PartAmplitudeAux1, md_part_aux_level, "aux_level", cm_mod_decibel,
+        add_destination(l, RMD_PartBalance, md_part_pan, "balance", cm_mod_percent, "Balance");
+        add_destination(l, RMD_PartAmplitudeAux1, md_part_aux_level, "aux_level", cm_mod_decibel,
                         "Aux 1 Level");
-        add_destination(RMD_PartBalanceAux1, md_part_aux_balance, "aux_balance", cm_mod_percent,
-                        "Aux 1 Balance");
-        add_destination(RMD_PartAmplitudeAux2, md_part_aux2_level, "aux2_level", cm_mod_decibel,
-                        "Aux 2 Level");
-        add_destination(RMD_PartBalanceAux2, md_part_aux2_balance, "aux2_balance", cm_mod_percent,
-                        "Aux 2 Balance");
-
-        add_destination(RMD_PartFilter1Mix, md_part_filter1mix, "f1mix", cm_mod_percent, "F1 Mix");
-        add_destination(RMD_PartFilter2Mix, md_part_filter2mix, "f2mix", cm_mod_percent, "F2 Mix");
-
+        add_destination(l, RMD_PartBalanceAux1, md_part_aux_balance, "aux_balance",
+                        cm_mod_percent, "Aux 1 Balance");
+        add_destination(l, RMD_PartAmplitudeAux2, md_part_aux2_level, "aux2_level",
+                        cm_mod_decibel, "Aux 2 Level");
+        add_destination(l, RMD_PartBalanceAux2, md_part_aux2_balance, "aux2_balance",
+                        cm_mod_percent, "Aux 2 Balance");
+
+        add_destination(l, RMD_PartFilter1Mix, md_part_filter1mix, "f1mix", cm_mod_percent,
+                        "F1 Mix");
+        add_destination(l, RMD_PartFilter2Mix, md_part_filter2mix, "f2mix", cm_mod_percent,
+                        "F2 Mix");
+
+        auto &fl = filter_labels::get();
         for (unsigned int fs = 0; fs < 2; fs++)
         {
-            filter *tempf = 0;
-            if (part)
-                tempf = spawn_filter(part->Filter[fs].type, part->Filter[fs].p, part->Filter[fs].ip,
-                                     0, false);
+            int ft = part ? part->Filter[fs].type : 0;
+            bool known = valid_filtertype(ft) && fl.known[ft];
 
             for (unsigned int fp = 0; fp < n_filter_parameters; fp++)
             {
@@ -244,80 +292,147 @@ void modmatrix::assign(configuration *conf, sample_zone *zone, sample_part *part
                 char txt[namelen];
                 char idname[namelen];
                 sprintf(idname, "f%ip%i", fs + 1, fp + 1);
-                if (tempf)
-                    sprintf(txt, "F%i: %s", fs + 1, tempf->get_parameter_label(fp));
+                if (known)
+                    sprintf(txt, "F%i: %s", fs + 1, fl.label[ft][fp]);
                 else
                     sprintf(txt, "F%i: ---", fs + 1);
-                if (tempf)
-                    ct = tempf->get_parameter_ctrlmode(fp);
+                if (known)
+                    ct = fl.ctrlmode[ft][fp];
 
                 ct = get_mod_mode(ct);
 
-                add_destination(RMD_PartFilter1Param0 + 0x10 * fs + fp,
+                add_destination(l, RMD_PartFilter1Param0 + 0x10 * fs + fp,
                                 md_part_filter1prm0 +
                                     fs * (md_part_filter2prm0 - md_part_filter1prm0) + fp,
                                 idname, ct, txt);
             }
-            spawn_filter_release(tempf);
         }
     }
 }
 
-int modmatrix::is_source_used(int source) // for CPU saving purposes
+const mm_layout &modmatrix::shared_layout(bool zone)
 {
-    if ((source < 0) || (source > num_switchable_sources))
-        return 0;
-    if (!zone)
-        return 0;
-    int sid = ss_id[source];
-    for (int i = 0; i < mm_entries; i++)
-    {
-        if ((zone->mm[i].source == sid) || (zone->mm[i].source2 == sid))
-            return 0xffffffff;
-    }
-    return 0;
+    static const mm_layout zone_layout = [] {
+        mm_layout l;
+        build_layout(l, true, nullptr, nullptr);
+        return l;
+    }();
+    static const mm_layout part_layout = [] {
+        mm_layout l;
+        build_layout(l, false, nullptr, nullptr);
+        return l;
+    }();
+    return zone ? zone_layout : part_layout;
 }
 
-void modmatrix::add_destination(unsigned char RIFFID, int id, const char *name, int control_type,
-                                const char *dispname)
+modmatrix_labels::modmatrix_labels(sample_zone *zone, sample_part *part)
 {
-    strncpy_0term(dst[id].id_name, name, namelen);
-
-    if (dispname)
-        strncpy_0term(dst[id].display_name, dispname, namelen);
-    else
-        strncpy_0term(dst[id].display_name, name, namelen);
-
-    dst[id].ctrlmode = control_type;
-    dst[id].RIFFID = RIFFID;
+    build_layout(labels, zone != nullptr, zone, part);
 }
 
+modmatrix::modmatrix() : layout(&shared_layout(false)) {}
+
 modmatrix::~modmatrix() {}
 
-void modmatrix::add_source(unsigned char RIFFID, const char *name, float *fptr,
-                           const char *dispname)
+// where the value of a source is read from, for what the matrix was assigned
+const float *modmatrix::source_ptr(unsigned char RIFFID, timedata *td)
 {
-    mm_src t;
-    strncpy_0term(t.id_name, name, namelen);
+    switch (RIFFID)
+    {
+    case RMS_Keytrack:
+        return voice ? &voice->keytrack : 0;
+    case RMS_Velocity:
+        return voice ? &voice->fvelocity : 0;
+    case RMS_Modulator1:
+        return voice ? &voice->AEG.output : 0;
+    case RMS_Modulator2:
+        return voice ? &voice->EG2.output : 0;
+    case RMS_Modulator3:
+    case RMS_Modulator4:
+    case RMS_Modulator5:
+        return voice ? &voice->stepLFO[RIFFID - RMS_Modulator3].output : 0;
+    case RMS_SliceEnv:
+        return voice ? &voice->slice_env : 0;
+    case RMS_Random:
+        return voice ? &voice->random : 0;
+    case RMS_RandomBP:
+        return voice ? &voice->randombp : 0;
+    case RMS_Gate:
+        return voice ? &voice->fgate : 0;
+    case RMS_Time:
+        return voice ? &voice->time : 0;
+    case RMS_TimeMinutes:
+        return voice ? &voice->time60 : 0;
+    case RMS_LagGenerator1:
+    case RMS_LagGenerator2:
+        return voice ? &voice->lag[RIFFID - RMS_LagGenerator1] : 0;
+    case RMS_WithinLoop:
+        return voice ? &voice->loop_gate : 0;
+    case RMS_LoopPos:
+        return voice ? &voice->loop_pos : 0;
+    case RMS_Filter1ModOut:
+    case RMS_Filter2ModOut:
+        return voice ? &voice->filter_modout[RIFFID - RMS_Filter1ModOut] : 0;
+    case RMS_Noise:
+        return &noisegen;
+    case RMS_Alternate:
+        return voice ? &voice->alternate : &alternate;
+    case RMS_PosBeat:
+        return td ? &td->pos_in_beat : 0;
+    case RMS_Pos2Beats:
+        return td ? &td->pos_in_2beats : 0;
+    case RMS_PosBar:
+        return td ? &td->pos_in_bar : 0;
+    case RMS_Pos2Bars:
+        return td ? &td->pos_in_2bars : 0;
+    case RMS_Pos4Bars:
+        return td ? &td->pos_in_4bars : 0;
+    case RMS_One:
+        return &one;
+    case RMS_PitchBend:
+        return control ? &control[c_pitch_bend] : 0;
+    case RMS_ChAftertouch:
+        return control ? &control[c_channel_aftertouch] : 0;
+    case RMS_ModulationWheel:
+        return control ? &control[c_modwheel] : 0;
+    }
+    if ((RIFFID >= RMS_Ctrl1) && (RIFFID < RMS_Ctrl1 + n_custom_controllers))
+        return part ? &part->userparameter_smoothed[RIFFID - RMS_Ctrl1] : 0;
+    return 0;
+}
 
-    if (dispname)
-        strncpy_0term(t.display_name, dispname, namelen);
-    else
-        strncpy_0term(t.display_name, name, namelen);
+void modmatrix::assign(configuration *conf, sample_zone *zone, sample_part *part,
+                       sampler_voice *voice, float *control, float *automation, timedata *td)
+{
+    // zero mem
+    memset(fdst, 0, sizeof(float) * md_num_destinations);
+    alternate = 1.f;
+    compiled = false;
 
-    t.fptr = fptr;
-    t.RIFFID = RIFFID;
-    src.push_back(t);
+    this->zone = zone;
+    this->part = part;
+    this->voice = voice;
+    this->control = control;
+    this->automation = automation;
+
+    layout = &shared_layout(zone != nullptr);
+    for (int i = 0; i < layout->n_src; i++)
+        sources[i] = source_ptr(layout->src[i].RIFFID, td);
 }
 
-int modmatrix::get_n_sources() { return (int)src.size(); }
-int modmatrix::get_n_destinations()
+int modmatrix::is_source_used(int source) // for CPU saving purposes
 {
-    // return (int)dst.size();
-    if (zone)
-        return md_num_zone_destinations;
-    else
-        return md_num_part_destinations;
+    if ((source < 0) || (source > num_switchable_sources))
+        return 0;
+    if (!zone)
+        return 0;
+    int sid = layout->ss_id[source];
+    for (int i = 0; i < mm_entries; i++)
+    {
+        if ((zone->mm[i].source == sid) || (zone->mm[i].source2 == sid))
+            return 0xffffffff;
+    }
+    return 0;
 }
 
 bool modmatrix::check_trigger_condition(sample_zone *z)
@@ -328,9 +443,9 @@ bool modmatrix::check_trigger_condition(sample_zone *z)
     // checks NCs
     for (int i = 0; i < num_zone_trigger_conditions; i++)
     {
-        if (src[z->trigger_conditions[i].source].fptr)
+        if (sources[z->trigger_conditions[i].source])
         {
-            int val = (int)(float)(*src[z->trigger_conditions[i].source].fptr * 127.f);
+            int val = (int)(float)(*sources[z->trigger_conditions[i].source] * 127.f);
             if ((val < z->trigger_conditions[i].low) || (val > z->trigger_conditions[i].high))
                 return false;
         }
@@ -339,9 +454,9 @@ bool modmatrix::check_trigger_condition(sample_zone *z)
     for (int i = (layer * num_layer_trigger_conditions);
          i < (layer * num_layer_trigger_conditions + num_layer_trigger_conditions); i++)
     {
-        if (src[part->trigger_conditions[i].source].fptr)
+        if (sources[part->trigger_conditions[i].source])
         {
-            int val = (int)(float)(*src[part->trigger_conditions[i].source].fptr * 127.f);
+            int val = (int)(float)(*sources[part->trigger_conditions[i].source] * 127.f);
             if ((val < part->trigger_conditions[i].low) || (val > part->trigger_conditions[i].high))
                 return false;
         }
@@ -412,145 +527,304 @@ float do_curve(unsigned int curve, float x)
     return x;
 }
 
-void modmatrix::process_part()
+static_assert((mm_entries <= 12) && (mm_part_entries <= 12), "see modmatrix::max_routes");
+
+// sources which keep their value for the life of a note
+static bool is_note_constant(unsigned char RIFFID, bool voice)
 {
-    //	pb_up = max(0,control[c_pitch_bend]);
-    //	pb_down = max(0,-control[c_pitch_bend]);
-    noisegen = ((float)rand() * randscale) - 1.f;
+    switch (RIFFID)
+    {
+    case RMS_One:
+        return true;
+    case RMS_Velocity:
+    case RMS_Random:
+    case RMS_RandomBP:
+    case RMS_Alternate: // the part matrix flips its own on every trigger check
+        return voice;
+    }
+    return false;
+}
 
-    fdst[md_part_amplitude] = part->aux[0].level;
-    fdst[md_part_pan] = part->aux[0].balance;
-    fdst[md_part_aux_level] = part->aux[1].level;
-    fdst[md_part_aux_balance] = part->aux[1].balance;
-    fdst[md_part_aux2_level] = part->aux[2].level;
-    fdst[md_part_aux2_balance] = part->aux[2].balance;
-    fdst[md_part_prefilter_gain] = part->pfg;
+static inline float route_input(const float *source, const float *source2, int curve)
+{
+    float tmodulation = *source;
+    if (source2)
+        tmodulation *= *source2;
 
-    if (part->Filter[0].type && !part->Filter[0].bypass)
+    if (curve)
+        tmodulation = do_curve(curve, tmodulation);
+    return tmodulation;
+}
+
+void modmatrix::compile()
+{
+    compiled = true;
+    compiled_generation = current_engine().patch_generation.load(std::memory_order_acquire);
+
+    mm_entry *entries = zone ? zone->mm : part->mm;
+    int n_entries = zone ? mm_entries : mm_part_entries;
+    int n_src = layout->n_src;
+    bool is_touched[md_num_destinations];
+    memset(is_touched, 0, sizeof(is_touched));
+
+    n_routes = 0;
+    n_touched = 0;
+    for (int i = 0; i < n_entries; i++)
     {
-        fdst[md_part_filter1mix] = part->Filter[0].mix;
-        fdst[md_part_filter1prm0] = part->Filter[0].p[0];
-        fdst[md_part_filter1prm1] = part->Filter[0].p[1];
-        fdst[md_part_filter1prm2] = part->Filter[0].p[2];
-        fdst[md_part_filter1prm3] = part->Filter[0].p[3];
-        fdst[md_part_filter1prm4] = part->Filter[0].p[4];
-        fdst[md_part_filter1prm5] = part->Filter[0].p[5];
-        fdst[md_part_filter1prm6] = part->Filter[0].p[6];
-        fdst[md_part_filter1prm7] = part->Filter[0].p[7];
-        fdst[md_part_filter1prm8] = part->Filter[0].p[8];
+        // a copy, an editor may be changing the entry while the audio thread compiles it
+        const mm_entry e = entries[i];
+        if (!e.destination || !(e.source || e.source2) || !e.active)
+            continue;
+        if ((e.source < 0) || (e.source >= n_src) || (e.source2 < 0) || (e.source2 >= n_src) ||
+            (e.destination >= md_num_destinations) || !sources[e.source])
+            continue;
+
+        route &r = routes[n_routes++];
+        r.source = sources[e.source];
+        r.source2 = sources[e.source2];
+        r.strength = &entries[i].strength; // + fdst[md_MM0_depth+i];
+        r.dest = e.destination;
+        r.curve = e.curve;
+        r.constant = is_note_constant(layout->src[e.source].RIFFID, voice) &&
+                     (!r.source2 || is_note_constant(layout->src[e.source2].RIFFID, voice));
+        r.folded = r.constant ? route_input(r.source, r.source2, r.curve) : 0.f;
+        r.scale_by_length = zone && ((r.dest == md_sample_start) || (r.dest == md_loop_start) ||
+                                     (r.dest == md_loop_length));
+
+        if (!is_touched[r.dest])
+        {
+            is_touched[r.dest] = true;
+            touched[n_touched++] = r.dest;
+        }
     }
-    if (part->Filter[1].type && !part->Filter[1].bypass)
+
+    seed_all();
+}
+
+void modmatrix::seed_all()
+{
+    // before reading the values, an edit made while seeding moves it on again
+    seeded_generation = current_engine().param_generation.load(std::memory_order_acquire);
+    for (int d = 1; d < get_n_destinations(); d++)
     {
-        fdst[md_part_filter2mix] = part->Filter[1].mix;
-        fdst[md_part_filter2prm0] = part->Filter[1].p[0];
-        fdst[md_part_filter2prm1] = part->Filter[1].p[1];
-        fdst[md_part_filter2prm2] = part->Filter[1].p[2];
-        fdst[md_part_filter2prm3] = part->Filter[1].p[3];
-        fdst[md_part_filter2prm4] = part->Filter[1].p[4];
-        fdst[md_part_filter2prm5] = part->Filter[1].p[5];
-        fdst[md_part_filter2prm6] = part->Filter[1].p[6];
-        fdst[md_part_filter2prm7] = part->Filter[1].p[7];
-        fdst[md_part_filter2prm8] = part->Filter[1].p[8];
+        if (zone)
+            seed_destination(d);
+        else
+            seed_part_destination(d);
     }
+}
 
-    for (int i = 0; i < mm_part_entries; i++)
+// recompile or reseed if the patch was edited since the last block, otherwise reset only the
+// destinations the routes add to
+void modmatrix::prepare()
+{
+    auto &ec = current_engine();
+    if (!compiled || (compiled_generation != ec.patch_generation.load(std::memory_order_acquire)))
+        compile();
+    else if (seeded_generation != ec.param_generation.load(std::memory_order_acquire))
+        seed_all();
+    else if (zone)
+        for (int i = 0; i < n_touched; i++)
+            seed_destination(touched[i]);
+    else
+        for (int i = 0; i < n_touched; i++)
+            seed_part_destination(touched[i]);
+}
+
+void modmatrix::run_routes()
+{
+    for (int i = 0; i < n_routes; i++)
     {
-        if (part->mm[i].destination && (part->mm[i].source || part->mm[i].source2) &&
-            (part->mm[i].active) && (src[part->mm[i].source].fptr))
-        {
-            int dest = part->mm[i].destination;
-            int curve = part->mm[i].curve;
-            float strength = part->mm[i].strength; // + fdst[md_MM0_depth+i];
-            float tmodulation = *src[part->mm[i].source].fptr;
-            if (src[part->mm[i].source2].fptr)
-                tmodulation *= *src[part->mm[i].source2].fptr;
-
-            if (curve)
-                tmodulation = do_curve(curve, tmodulation);
-            tmodulation *= strength;
-
-            if (curve >= mmc_quantitize1)
-            {
-                float qval = 1.f + (curve - mmc_quantitize1);
-                tmodulation = qval * floor(0.5f + tmodulation / qval);
-            }
+        const route &r = routes[i];
+        float tmodulation = r.constant ? r.folded : route_input(r.source, r.source2, r.curve);
+
+        tmodulation *= *r.strength;
 
-            fdst[dest] += tmodulation;
+        if (r.curve >= mmc_quantitize1)
+        {
+            float qval = 1.f + (r.curve - mmc_quantitize1);
+            tmodulation = qval * floor(0.5f + tmodulation / qval);
         }
+
+        if (r.scale_by_length)
+            fdst[r.dest] += zone->sample_stop * tmodulation;
+        else
+            fdst[r.dest] += tmodulation;
     }
 }
 
-void modmatrix::process()
+// the unmodulated value of a part destination
+void modmatrix::seed_part_destination(int id)
 {
-    // calculate special controllers that only exist within the modmatrix
-    // pb_up = max(0,control[c_pitch_bend]);
-    // pb_down = max(0,-control[c_pitch_bend]);
-    noisegen = ((float)rand() * randscale) - 1.f;
+    auto &f0 = part->Filter[0], &f1 = part->Filter[1];
+    bool f0_on = f0.type && !f0.bypass, f1_on = f1.type && !f1.bypass;
 
-    if (!zone)
-        return;
-    if (!voice)
-        return;
-    int i;
-    // init destinations
-    // memset(fdst,0,sizeof(float)*md_num_destinations);
-
-    fdst[md_pitch] = 0.0f;
-    fdst[md_rate] = 1.0f;
+    switch (id)
+    {
+    case md_part_amplitude:
+        fdst[id] = part->aux[0].level;
+        break;
+    case md_part_pan:
+        fdst[id] = part->aux[0].balance;
+        break;
+    case md_part_aux_level:
+        fdst[id] = part->aux[1].level;
+        break;
+    case md_part_aux_balance:
+        fdst[id] = part->aux[1].balance;
+        break;
+    case md_part_aux2_level:
+        fdst[id] = part->aux[2].level;
+        break;
+    case md_part_aux2_balance:
+        fdst[id] = part->aux[2].balance;
+        break;
+    case md_part_prefilter_gain:
+        fdst[id] = part->pfg;
+        break;
+    case md_part_filter1mix:
+        if (f0_on)
+            fdst[id] = f0.mix;
+        break;
+    case md_part_filter2mix:
+        if (f1_on)
+            fdst[id] = f1.mix;
+        break;
+    default:
+        if ((id >= md_part_filter1prm0) && (id <= md_part_filter1prm8) && f0_on)
+            fdst[id] = f0.p[id - md_part_filter1prm0];
+        else if ((id >= md_part_filter2prm0) && (id <= md_part_filter2prm8) && f1_on)
+            fdst[id] = f1.p[id - md_part_filter2prm0];
+        break;
+    }
+}
 
-    fdst[md_amplitude] = zone->aux[0].level;
-    fdst[md_prefilter_gain] = zone->pre_filter_gain;
-    fdst[md_pan] = zone->aux[0].balance;
-    fdst[md_aux_level] = zone->aux[1].level;
-    fdst[md_aux_balance] = zone->aux[1].balance;
-    fdst[md_aux2_level] = zone->aux[2].level;
-    fdst[md_aux2_balance] = zone->aux[2].balance;
+void modmatrix::process_part()
+{
+    //	pb_up = max(0,control[c_pitch_bend]);
+    //	pb_down = max(0,-control[c_pitch_bend]);
+    noisegen = noise_rng.bipolar();
 
-    fdst[md_lag0] = 0.0f;
-    fdst[md_lag1] = 0.0f;
+    prepare();
+    run_routes();
+}
 
-    fdst[md_AEG_a] = zone->AEG.attack;
-    fdst[md_AEG_h] = zone->AEG.hold;
-    fdst[md_AEG_d] = zone->AEG.decay;
-    fdst[md_AEG_s] = zone->AEG.sustain;
-    fdst[md_AEG_r] = zone->AEG.release;
+// the unmodulated value of a zone destination
+void modmatrix::seed_destination(int id)
+{
+    auto &f0 = zone->Filter[0], &f1 = zone->Filter[1];
 
+    switch (id)
     {
-        fdst[md_EG2_a] = zone->EG2.attack;
-        fdst[md_EG2_h] = zone->EG2.hold;
-        fdst[md_EG2_d] = zone->EG2.decay;
-        fdst[md_EG2_s] = zone->EG2.sustain;
-        fdst[md_EG2_r] = zone->EG2.release;
+    case md_pitch:
+        fdst[id] = 0.0f;
+        break;
+    case md_rate:
+        fdst[id] = 1.0f;
+        break;
+    case md_amplitude:
+        fdst[id] = zone->aux[0].level;
+        break;
+    case md_prefilter_gain:
+        fdst[id] = zone->pre_filter_gain;
+        break;
+    case md_pan:
+        fdst[id] = zone->aux[0].balance;
+        break;
+    case md_aux_level:
+        fdst[id] = zone->aux[1].level;
+        break;
+    case md_aux_balance:
+        fdst[id] = zone->aux[1].balance;
+        break;
+    case md_aux2_level:
+        fdst[id] = zone->aux[2].level;
+        break;
+    case md_aux2_balance:
+        fdst[id] = zone->aux[2].balance;
+        break;
+    case md_lag0:
+    case md_lag1:
+        fdst[id] = 0.0f;
+        break;
+    case md_AEG_a:
+        fdst[id] = zone->AEG.attack;
+        break;
+    case md_AEG_h:
+        fdst[id] = zone->AEG.hold;
+        break;
+    case md_AEG_d:
+        fdst[id] = zone->AEG.decay;
+        break;
+    case md_AEG_s:
+        fdst[id] = zone->AEG.sustain;
+        break;
+    case md_AEG_r:
+        fdst[id] = zone->AEG.release;
+        break;
+    case md_EG2_a:
+        fdst[id] = zone->EG2.attack;
+        break;
+    case md_EG2_h:
+        fdst[id] = zone->EG2.hold;
+        break;
+    case md_EG2_d:
+        fdst[id] = zone->EG2.decay;
+        break;
+    case md_EG2_s:
+        fdst[id] = zone->EG2.sustain;
+        break;
+    case md_EG2_r:
+        fdst[id] = zone->EG2.release;
+        break;
+    case md_filter1mix:
+        if (f0.type && !f0.bypass)
+            fdst[id] = f0.mix;
+        break;
+    case md_filter2mix:
+        if (f1.type && !f1.bypass)
+            fdst[id] = f1.mix;
+        break;
+    case md_LFO1_rate:
+        fdst[id] = zone->LFO[0].rate;
+        break;
+    case md_LFO2_rate:
+        fdst[id] = zone->LFO[1].rate;
+        break;
+    case md_LFO3_rate:
+        fdst[id] = zone->LFO[2].rate;
+        break;
+    case md_sample_start:
+        fdst[id] = (float)(zone->sample_start);
+        break;
+    case md_loop_start:
+        fdst[id] = (float)(zone->loop_start);
+        break;
+    case md_loop_length:
+        fdst[id] = (float)(int)(zone->loop_end - zone->loop_start);
+        break;
+    default:
+        if ((id >= md_filter1prm0) && (id <= md_filter1prm5) && f0.type && !f0.bypass)
+            fdst[id] = f0.p[id - md_filter1prm0];
+        else if ((id >= md_filter2prm0) && (id <= md_filter2prm5) && f1.type && !f1.bypass)
+            fdst[id] = f1.p[id - md_filter2prm0];
+        break;
     }
+}
 
-    if (zone->Filter[0].type && !zone->Filter[0].bypass)
-    {
-        fdst[md_filter1mix] = zone->Filter[0].mix;
-        fdst[md_filter1prm0] = zone->Filter[0].p[0];
-        fdst[md_filter1prm1] = zone->Filter[0].p[1];
-        fdst[md_filter1prm2] = zone->Filter[0].p[2];
-        fdst[md_filter1prm3] = zone->Filter[0].p[3];
-        fdst[md_filter1prm4] = zone->Filter[0].p[4];
-        fdst[md_filter1prm5] = zone->Filter[0].p[5];
-    }
-    if (zone->Filter[1].type && !zone->Filter[1].bypass)
-    {
-        fdst[md_filter2mix] = zone->Filter[1].mix;
-        fdst[md_filter2prm0] = zone->Filter[1].p[0];
-        fdst[md_filter2prm1] = zone->Filter[1].p[1];
-        fdst[md_filter2prm2] = zone->Filter[1].p[2];
-        fdst[md_filter2prm3] = zone->Filter[1].p[3];
-        fdst[md_filter2prm4] = zone->Filter[1].p[4];
-        fdst[md_filter2prm5] = zone->Filter[1].p[5];
-    }
+void modmatrix::process()
+{
+    // calculate special controllers that only exist within the modmatrix
+    // pb_up = max(0,control[c_pitch_bend]);
+    // pb_down = max(0,-control[c_pitch_bend]);
+    noisegen = noise_rng.bipolar();
 
-    fdst[md_LFO1_rate] = zone->LFO[0].rate;
-    fdst[md_LFO2_rate] = zone->LFO[1].rate;
-    fdst[md_LFO3_rate] = zone->LFO[2].rate;
+    if (!zone)
+        return;
+    if (!voice)
+        return;
 
-    fdst[md_sample_start] = (float)(zone->sample_start);
-    fdst[md_loop_start] = (float)(zone->loop_start);
-    fdst[md_loop_length] = (float)(int)(zone->loop_end - zone->loop_start);
+    prepare();
 
     // process mm depth slots
     /*for(i=0; i<mm_entries; i++)
@@ -563,51 +837,15 @@ void modmatrix::process()
             }
     }*/
 
-    for (i = 0; i < mm_entries; i++)
-    {
-        if (zone->mm[i].destination && (zone->mm[i].source || zone->mm[i].source2) &&
-            (zone->mm[i].active) && (src[zone->mm[i].source].fptr))
-        {
-            int dest = zone->mm[i].destination;
-            int curve = zone->mm[i].curve;
-            float strength = zone->mm[i].strength; // + fdst[md_MM0_depth+i];
-            float tmodulation = *src[zone->mm[i].source].fptr;
-            if (src[zone->mm[i].source2].fptr)
-                tmodulation *= *src[zone->mm[i].source2].fptr;
-
-            if (curve)
-                tmodulation = do_curve(curve, tmodulation);
-
-            tmodulation *= strength;
-
-            if (curve >= mmc_quantitize1)
-            {
-                float qval = 1.f + (curve - mmc_quantitize1);
-                tmodulation = qval * floor(0.5f + tmodulation / qval);
-            }
-
-            switch (dest)
-            {
-            case md_sample_start:
-            case md_loop_start:
-            case md_loop_length:
-                fdst[dest] += zone->sample_stop * tmodulation;
-                break;
-            default:
-                fdst[dest] += tmodulation;
-            };
-        }
-    }
+    run_routes();
 }
 
 int get_mm_source_id(const char *txt)
 {
-    modmatrix mm;
-    mm.assign(0, 0, 0);
-    int k, n = mm.get_n_sources();
-    for (k = 0; k < n; k++)
+    const mm_layout &l = modmatrix::shared_layout(false);
+    for (int k = 0; k < l.n_src; k++)
     {
-        if (!strcmp(txt, mm.get_source_idname(k)))
+        if (!strcmp(txt, l.src[k].id_name))
             return k;
     }
     return 0;
@@ -615,12 +853,10 @@ int get_mm_source_id(const char *txt)
 
 int get_mm_dest_id(const char *txt)
 {
-    modmatrix mm;
-    mm.assign(0, 0, 0);
-    int k, n = mm.get_n_destinations();
-    for (k = 0; k < n; k++)
+    const mm_layout &l = modmatrix::shared_layout(false);
+    for (int k = 0; k < l.n_dst; k++)
     {
-        if (!strcmp(txt, mm.get_destination_idname(k)))
+        if (!strcmp(txt, l.dst[k].id_name))
             return k;
     }
     return 0;
@@ -16,7 +16,8 @@
 */
 #pragma once
 
-#include <vector>
+#include "util/prng.h"
+#include <cstdint>
 
 class modmatrix;
 class sampler_voice;
@@ -132,7 +133,6 @@ struct mm_src
 {
     char display_name[namelen];
     char id_name[namelen];
-    float *fptr;
     unsigned char RIFFID;
 };
 
@@ -144,6 +144,21 @@ struct mm_dst
     unsigned char RIFFID;
 };
 
+const int mm_max_sources = 48;
+
+/*
+ * The sources and destinations of a zone or a part matrix. Which ones there are doesn't depend
+ * on the zone or part, so every matrix points at one of two shared layouts, built on first use.
+ * Only the editor's labels (controller names, filter parameters) do, see modmatrix_labels.
+ */
+struct mm_layout
+{
+    mm_src src[mm_max_sources];
+    mm_dst dst[md_num_destinations];
+    int n_src{0}, n_dst{0};
+    int ss_id[num_switchable_sources];
+};
+
 class alignas(16) modmatrix
 {
   public:
@@ -151,6 +166,7 @@ class alignas(16) modmatrix
     ~modmatrix();
     void process();
 
+    // only looks up the source pointers, no names or filters, so it is cheap enough for note-on
     void assign(configuration *conf, sample_zone *zone, sample_part *part, sampler_voice *voice = 0,
                 float *control = 0, float *automation = 0, timedata *td = 0);
 
@@ -158,21 +174,16 @@ class alignas(16) modmatrix
     void process_part();
     void process_group();
     int get_controltype(int destination);
-    void add_destination(unsigned char RIFFID, int id, const char *name, int control_type,
-                         const char *dispname = 0);
-    void add_source(unsigned char RIFFID, const char *name, float *fptr, const char *dispname = 0);
     int is_source_used(int source);
-    int get_n_sources();
-    int get_n_destinations();
-    char *get_source_name(int id) { return src[id].display_name; }
-    char *get_source_idname(int id) { return src[id].id_name; }
-    char *get_destination_name(int id) { return dst[id].display_name; }
-    char *get_destination_idname(int id) { return dst[id].id_name; }
-    int get_destination_ctrlmode(int id) { return dst[id].ctrlmode; }
-    unsigned char get_source_RIFFID(int id) { return src[id].RIFFID; }
-    unsigned char get_destination_RIFFID(int id) { return dst[id].RIFFID; }
+    int get_n_sources() { return layout->n_src; }
+    int get_n_destinations() { return layout->n_dst; }
+    const char *get_source_idname(int id) { return layout->src[id].id_name; }
+    const char *get_destination_idname(int id) { return layout->dst[id].id_name; }
+    unsigned char get_source_RIFFID(int id) { return layout->src[id].RIFFID; }
+    unsigned char get_destination_RIFFID(int id) { return layout->dst[id].RIFFID; }
     inline float get_destination_value(int id) { return fdst[id]; }
     int get_destination_value_int(int id);
+    void seed_noise(uint64_t seed) { noise_rng.seed(seed); }
     float *get_destination_ptr(int id) { return &fdst[id]; }
 
     int SourceRiffIDToInternal(unsigned char);
@@ -180,18 +191,73 @@ class alignas(16) modmatrix
     int DestinationRiffIDToInternal(unsigned char);
     unsigned char DestinationInternalToRiffID(unsigned int);
 
+    static const mm_layout &shared_layout(bool zone);
+
   private:
-    std::vector<mm_src> src;
-    mm_dst dst[md_num_destinations];
+    /*
+     * process() and process_part() run a program compiled from the mm entries rather than the
+     * entries themselves: only the active routes, with the ones whose sources can't change
+     * during a note (velocity, the randoms, alternate, constant) evaluated once. Only the
+     * destinations a route adds to are reset every block, the others are set when compiling
+     * and again whenever the engine's param_generation moves. It is recompiled on the first
+     * block of a note and whenever the engine's patch_generation moves.
+     */
+    struct route
+    {
+        const float *source, *source2; // source2 is nullptr when there is none
+        const float *strength;         // read live, so depth edits apply straight away
+        float folded;                  // the sources through the curve, if constant
+        int dest, curve;
+        bool constant, scale_by_length;
+    };
+    static constexpr int max_routes = 12;
+    void prepare();
+    void compile();
+    void seed_all();
+    void seed_destination(int id);
+    void seed_part_destination(int id);
+    inline void run_routes();
+    const float *source_ptr(unsigned char RIFFID, timedata *td);
+    route routes[max_routes];
+    int n_routes{0};
+    int touched[md_num_destinations];
+    int n_touched{0};
+    bool compiled{false};
+    uint32_t compiled_generation{0}, seeded_generation{0};
+
+    const mm_layout *layout;
+    const float *sources[mm_max_sources]; // nullptr where there is nothing to read
     float fdst[md_num_destinations];
     sample_zone *__restrict zone;
     sample_part *__restrict part;
     sampler_voice *__restrict voice;
     float *__restrict control, *__restrict automation;
-    int ss_id[num_switchable_sources];
     bool first_run;
     float noisegen, alternate;
+    prng noise_rng;
+};
+
+/*
+ * The matrix layout with the display names and control modes the editor shows for a zone (or
+ * a part, when zone is null): the part's controller names and the labels of the filters it
+ * uses. The filter labels come from a per type table filled along with the shared layouts, so
+ * nothing is spawned or allocated and the editor handlers on the audio thread may build one.
+ */
+class modmatrix_labels
+{
+  public:
+    modmatrix_labels(sample_zone *zone, sample_part *part);
+    int get_n_sources() { return labels.n_src; }
+    int get_n_destinations() { return labels.n_dst; }
+    const char *get_source_name(int id) { return labels.src[id].display_name; }
+    const char *get_destination_name(int id) { return labels.dst[id].display_name; }
+    int get_destination_ctrlmode(int id) { return labels.dst[id].ctrlmode; }
+
+  private:
+    mm_layout labels;
 };
 
 int get_mm_source_id(const char *);
 int get_mm_dest_id(const char *);
+// a modulation through one of the mm_curves, except the quantizers which apply after the amount
+float do_curve(unsigned int curve, float x);
@@ -19,6 +19,7 @@
 #include "globals.h"
 #include "mathtables.h"
 #include "sampler_state.h"
+#include "util/prng.h"
 #include "util/unitconversion.h"
 #include <algorithm>
 #include <cmath>
@@ -28,7 +29,7 @@
 using std::max;
 using std::min;
 
-void load_lfo_preset(int id, steplfostruct *settings)
+void load_lfo_preset(int id, steplfostruct *settings, prng_x4 *rng)
 {
     if (!settings)
         return;
@@ -100,18 +101,17 @@ void load_lfo_preset(int id, steplfostruct *settings)
         else
             settings->smooth = 2.0f;
 
-        float noisev[32];
+        alignas(16) float noisev[32];
         int nmean = 1, j;
         if (id == lp_noise_mean3)
             nmean = 3;
         if (id == lp_noise_mean5)
             nmean = 5;
 
+        prng_x4 local_rng;
+        (rng ? rng : &local_rng)->fill_bipolar(noisev, 32 >> 2);
         for (t = 0; t < 32; t++)
-        {
-            noisev[t] = (((float)rand() / (float)RAND_MAX) * 2 - 1);
             noisev[t] /= (float)nmean;
-        }
         for (t = 0; t < 32; t++)
         {
             settings->data[t] = 0;
@@ -171,7 +171,7 @@ float QuadraticBSpline(float y0, float y1, float y2, float mu)
 
 steplfo::steplfo() {}
 
-void steplfo::assign(steplfostruct *settings, float *rate, timedata *td)
+void steplfo::assign(steplfostruct *settings, float *rate, timedata *td, prng &rng)
 {
     this->settings = settings;
     this->td = td;
@@ -185,8 +185,8 @@ void steplfo::assign(steplfostruct *settings, float *rate, timedata *td)
     if (settings->triggermode == 2)
     {
         // simulate free running lfo by randomizing start phase
-        phase = (float)rand() / (float)RAND_MAX;
-        state = rand() % settings->repeat;
+        phase = rng.unipolar();
+        state = rng.below(settings->repeat);
     }
     else if (settings->triggermode == 1)
     {
@@ -206,7 +206,7 @@ void steplfo::assign(steplfostruct *settings, float *rate, timedata *td)
 
 void steplfo::UpdatePhaseIncrement()
 {
-    phaseInc = BLOCK_SIZE * note_to_pitch(12 * (*rate)) * samplerate_inv *
+    phaseInc = BLOCK_SIZE * note_to_pitch(12 * (*rate)) * current_engine().samplerate_inv *
                (settings->cyclemode ? 1 : settings->repeat) *
                (settings->temposync ? (td->tempo * (1.f / 120.f)) : 1);
 }
@@ -18,8 +18,11 @@
 
 struct timedata;
 struct steplfostruct;
+class prng;
+class prng_x4;
 
-void load_lfo_preset(int preset, steplfostruct *settings);
+// rng fills the noise presets, a fixed-seed generator is used when none is given
+void load_lfo_preset(int preset, steplfostruct *settings, prng_x4 *rng = nullptr);
 float lfo_ipol(float *step_history, float phase, float smooth, int odd);
 
 class steplfo
@@ -27,7 +30,8 @@ class steplfo
   public:
     steplfo();
     ~steplfo();
-    void assign(steplfostruct *settings, float *rate, timedata *td);
+    // rng is only used for the random start phase of free running (triggermode 2) lfos
+    void assign(steplfostruct *settings, float *rate, timedata *td, prng &rng);
     void sync();
     void process(int samples);
     float output;
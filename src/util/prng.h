@@ -0,0 +1,140 @@
+/*
+** Shortcircuit XT is Free and Open Source Software
+**
+** Shortcircuit is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html; The authors of the code
+** reserve the right to re-license their contributions under the MIT license in the
+** future at the discretion of the project maintainers.
+**
+** Copyright 2004-2022 by various individuals as described by the git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/shortcircuit-xt.git
+**
+** Shortcircuit was a commercial product from 2004-2018, with copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Shortcircuit
+** open source in December 2020.
+*/
+
+#pragma once
+
+#include "globals.h"
+#include <cstdint>
+
+#if !defined(__aarch64__)
+#include <emmintrin.h>
+#endif
+
+/*
+ * Small seedable generator (xoshiro128+) for the audio path. Unlike rand() it holds no shared
+ * state and takes no lock, so every voice and modulation matrix can own one and a render is
+ * reproducible for a given seed whatever the thread layout. The low bits of xoshiro128+ are
+ * weak, which doesn't matter here as floats are taken from the top 24 bits.
+ */
+class prng
+{
+  public:
+    prng(uint64_t s = 0) { seed(s); }
+
+    void seed(uint64_t s)
+    {
+        for (int i = 0; i < 4; i += 2)
+        {
+            uint64_t v = splitmix64(s);
+            state[i] = (uint32_t)v;
+            state[i + 1] = (uint32_t)(v >> 32);
+        }
+    }
+
+    uint32_t next()
+    {
+        const uint32_t result = state[0] + state[3];
+        const uint32_t t = state[1] << 9;
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3] = (state[3] << 11) | (state[3] >> 21);
+        return result;
+    }
+
+    uint64_t next64() { return ((uint64_t)next() << 32) | next(); }
+
+    // 0 .. 1 (exclusive)
+    float unipolar() { return (float)(next() >> 8) * (1.f / 16777216.f); }
+    // -1 .. 1 (exclusive)
+    float bipolar() { return unipolar() * 2.f - 1.f; }
+    // 0 .. n-1
+    int below(int n) { return (int)(((uint64_t)next() * (uint64_t)n) >> 32); }
+
+    /*
+     * splitmix64, used to expand seeds. Also handy to derive per-voice/per-part seeds from
+     * an instance seed: splitmix64(x) with x = instance_seed + id.
+     */
+    static uint64_t splitmix64(uint64_t &x)
+    {
+        uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+  private:
+    uint32_t state[4];
+};
+
+/*
+ * Four interleaved xoshiro128+ streams stepped together in SSE2 registers, for filling whole
+ * blocks with noise. The streams are seeded independently, so the output is not the same
+ * sequence as a scalar prng with the same seed.
+ */
+class prng_x4
+{
+  public:
+    prng_x4(uint64_t s = 0) { seed(s); }
+
+    void seed(uint64_t s)
+    {
+        alignas(16) uint32_t lanes[4][4];
+        for (int l = 0; l < 4; l++)
+        {
+            for (int i = 0; i < 4; i += 2)
+            {
+                uint64_t v = prng::splitmix64(s);
+                lanes[i][l] = (uint32_t)v;
+                lanes[i + 1][l] = (uint32_t)(v >> 32);
+            }
+        }
+        for (int i = 0; i < 4; i++)
+            state[i] = _mm_load_si128((__m128i *)lanes[i]);
+    }
+
+    // fills nquads * 4 floats in -1 .. 1, dst must be 16-byte aligned
+    void fill_bipolar(float *__restrict dst, int nquads)
+    {
+        const __m128 scale = _mm_set1_ps(2.f / 16777216.f);
+        const __m128 one = _mm_set1_ps(1.f);
+        __m128i s0 = state[0], s1 = state[1], s2 = state[2], s3 = state[3];
+        for (int i = 0; i < nquads; i++)
+        {
+            __m128i r = _mm_add_epi32(s0, s3);
+            __m128i t = _mm_slli_epi32(s1, 9);
+            s2 = _mm_xor_si128(s2, s0);
+            s3 = _mm_xor_si128(s3, s1);
+            s1 = _mm_xor_si128(s1, s2);
+            s0 = _mm_xor_si128(s0, s3);
+            s2 = _mm_xor_si128(s2, t);
+            s3 = _mm_or_si128(_mm_slli_epi32(s3, 11), _mm_srli_epi32(s3, 21));
+
+            __m128 f = _mm_cvtepi32_ps(_mm_srli_epi32(r, 8));
+            _mm_store_ps(dst + (i << 2), _mm_sub_ps(_mm_mul_ps(f, scale), one));
+        }
+        state[0] = s0;
+        state[1] = s1;
+        state[2] = s2;
+        state[3] = s3;
+    }
+
+  private:
+    __m128i state[4];
+};
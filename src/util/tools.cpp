@@ -83,5 +83,6 @@ float envelope_rate_linear(float x)
     int e = (int)x;
     float a = x - (float)e;
 
-    return (1.f - a) * table_envrate_linear[e & 0x1ff] + a * table_envrate_linear[(e + 1) & 0x1ff];
+    const float *table = current_engine().table_envrate_linear;
+    return (1.f - a) * table[e & 0x1ff] + a * table[(e + 1) & 0x1ff];
 }
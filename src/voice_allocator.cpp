@@ -0,0 +1,153 @@
+/*
+** Shortcircuit XT is Free and Open Source Software
+**
+** Shortcircuit is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html; The authors of the code
+** reserve the right to re-license their contributions under the MIT license in the
+** future at the discretion of the project maintainers.
+**
+** Copyright 2004-2022 by various individuals as described by the git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/shortcircuit-xt.git
+**
+** Shortcircuit was a commercial product from 2004-2018, with copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Shortcircuit
+** open source in December 2020.
+*/
+
+#include "voice_allocator.h"
+
+#include <utility>
+
+voice_allocator::voice_allocator() { reset(); }
+
+void voice_allocator::reset()
+{
+    n_active = 0;
+    n_heap = 0;
+    n_free = MAX_VOICES;
+    next_serial = 0;
+    for (int v = 0; v < MAX_VOICES; v++)
+    {
+        // lowest id on top of the stack
+        free_stack[v] = MAX_VOICES - 1 - v;
+        free_pos[MAX_VOICES - 1 - v] = v;
+        active_pos[v] = -1;
+        heap_pos[v] = -1;
+        serial[v] = 0;
+        released[v] = false;
+    }
+}
+
+void voice_allocator::activate(int v)
+{
+    if (free_pos[v] < 0)
+        return;
+
+    // take it off the free stack
+    int i = free_pos[v];
+    int last = free_stack[--n_free];
+    free_stack[i] = last;
+    free_pos[last] = i;
+    free_pos[v] = -1;
+
+    active_pos[v] = n_active;
+    active[n_active++] = v;
+
+    serial[v] = next_serial++;
+    released[v] = false;
+    heap_pos[v] = n_heap;
+    heap[n_heap++] = v;
+    sift_up(n_heap - 1);
+}
+
+void voice_allocator::deactivate(int v)
+{
+    if (active_pos[v] < 0)
+        return;
+
+    int i = active_pos[v];
+    int last = active[--n_active];
+    active[i] = last;
+    active_pos[last] = i;
+    active_pos[v] = -1;
+
+    heap_remove(v);
+
+    free_pos[v] = n_free;
+    free_stack[n_free++] = v;
+}
+
+void voice_allocator::mark_released(int v)
+{
+    if ((heap_pos[v] < 0) || released[v])
+        return;
+    released[v] = true;
+    sift_up(heap_pos[v]);
+}
+
+void voice_allocator::mark_killed(int v) { heap_remove(v); }
+
+bool voice_allocator::steal_before(int a, int b) const
+{
+    if (released[a] != released[b])
+        return released[a];
+    // serial may wrap, compare the distance
+    return (int32_t)(serial[a] - serial[b]) < 0;
+}
+
+void voice_allocator::heap_swap(int i, int j)
+{
+    std::swap(heap[i], heap[j]);
+    heap_pos[heap[i]] = i;
+    heap_pos[heap[j]] = j;
+}
+
+void voice_allocator::sift_up(int i)
+{
+    while (i > 0)
+    {
+        int parent = (i - 1) >> 1;
+        if (!steal_before(heap[i], heap[parent]))
+            break;
+        heap_swap(i, parent);
+        i = parent;
+    }
+}
+
+void voice_allocator::sift_down(int i)
+{
+    while (true)
+    {
+        int l = (i << 1) + 1;
+        if (l >= n_heap)
+            break;
+        int c = l;
+        if ((l + 1 < n_heap) && steal_before(heap[l + 1], heap[l]))
+            c = l + 1;
+        if (!steal_before(heap[c], heap[i]))
+            break;
+        heap_swap(i, c);
+        i = c;
+    }
+}
+
+void voice_allocator::heap_remove(int v)
+{
+    int i = heap_pos[v];
+    if (i < 0)
+        return;
+
+    heap_pos[v] = -1;
+    n_heap--;
+    if (i == n_heap)
+        return;
+
+    // move the last entry into the hole, it can need to go either way
+    int moved = heap[n_heap];
+    heap[i] = moved;
+    heap_pos[moved] = i;
+    sift_up(i);
+    if (heap_pos[moved] == i)
+        sift_down(i);
+}
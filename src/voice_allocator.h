@@ -0,0 +1,71 @@
+/*
+** Shortcircuit XT is Free and Open Source Software
+**
+** Shortcircuit is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html; The authors of the code
+** reserve the right to re-license their contributions under the MIT license in the
+** future at the discretion of the project maintainers.
+**
+** Copyright 2004-2022 by various individuals as described by the git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/shortcircuit-xt.git
+**
+** Shortcircuit was a commercial product from 2004-2018, with copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Shortcircuit
+** open source in December 2020.
+*/
+
+#pragma once
+
+#include "globals.h"
+#include <cstdint>
+
+/*
+ * Bookkeeping for sampler::voices[] so that note-on, note-off and rendering only touch the
+ * voices which are actually playing.
+ *
+ * - the active voices are kept in a dense array (in no particular order) for iteration
+ * - the free voices are kept on a stack, so the most recently freed voice is reused first
+ * - the stealable voices are kept in a binary heap ordered by release state and age; the top
+ *   is the oldest voice that is already released, or the oldest voice if none are. voices in
+ *   uberrelease are already on their way out and are taken out of the heap.
+ *
+ * all operations are O(1) or O(log n) and nothing allocates.
+ */
+class voice_allocator
+{
+  public:
+    voice_allocator();
+
+    void reset();
+
+    // next voice activate() should be called with, -1 if every voice is in use
+    int peek_free() const { return n_free ? free_stack[n_free - 1] : -1; }
+
+    void activate(int v);
+    void deactivate(int v);
+    void mark_released(int v);
+    void mark_killed(int v);
+
+    // the voice to steal when the polyphony limit is reached, -1 if there is none
+    int steal_candidate() const { return n_heap ? heap[0] : -1; }
+
+    bool is_active(int v) const { return active_pos[v] >= 0; }
+    int active_count() const { return n_active; }
+    int active_voice(int i) const { return active[i]; }
+
+  private:
+    bool steal_before(int a, int b) const;
+    void heap_swap(int i, int j);
+    void sift_up(int i);
+    void sift_down(int i);
+    void heap_remove(int v);
+
+    int16_t active[MAX_VOICES], active_pos[MAX_VOICES];
+    int16_t free_stack[MAX_VOICES], free_pos[MAX_VOICES];
+    int16_t heap[MAX_VOICES], heap_pos[MAX_VOICES];
+    uint32_t serial[MAX_VOICES];
+    bool released[MAX_VOICES];
+    int n_active, n_free, n_heap;
+    uint32_t next_serial;
+};
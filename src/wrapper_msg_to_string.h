@@ -40,6 +40,14 @@ inline std::string debug_wrapper_ip_to_string(int in)
         return "ip_config_autopreview";
     case ip_config_previewvolume:
         return "ip_config_previewvolume";
+    case ip_config_interpolation:
+        return "ip_config_interpolation";
+    case ip_config_draft:
+        return "ip_config_draft";
+    case ip_config_mipmaps:
+        return "ip_config_mipmaps";
+    case ip_config_resample:
+        return "ip_config_resample";
     case ip_sample_prevnext:
         return "ip_sample_prevnext";
     case ip_patch_prevnext:
@@ -58,6 +66,8 @@ inline std::string debug_wrapper_ip_to_string(int in)
         return "ip_select_all";
     case ip_polyphony:
         return "ip_polphyony";
+    case ip_dspload:
+        return "ip_dspload";
     case ip_vumeter:
         return "ip_vumeter";
     case ip_zone_name:
@@ -172,6 +182,8 @@ inline std::string debug_wrapper_ip_to_string(int in)
         return "ip_nc_high";
     case ip_ignore_part_polymode:
         return "ip_ignore_part_polymode";
+    case ip_zone_interpolation:
+        return "ip_zone_interpolation";
     case ip_mute:
         return "ip_mute";
     case ip_pfg:
@@ -450,6 +462,8 @@ inline std::string debug_wrapper_vga_to_string(int in)
         return "vga_save_multi";
     case vga_vudata:
         return "vga_vudata";
+    case vga_dspload:
+        return "vga_dspload";
     case vga_set_range_and_units:
         return "vga_set_range_and_units";
     }
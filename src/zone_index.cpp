@@ -0,0 +1,197 @@
+/*
+** Shortcircuit XT is Free and Open Source Software
+**
+** Shortcircuit is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html; The authors of the code
+** reserve the right to re-license their contributions under the MIT license in the
+** future at the discretion of the project maintainers.
+**
+** Copyright 2004-2022 by various individuals as described by the git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/shortcircuit-xt.git
+**
+** Shortcircuit was a commercial product from 2004-2018, with copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Shortcircuit
+** open source in December 2020.
+*/
+
+#include "zone_index.h"
+#include "sampler_state.h"
+#include <vt_dsp/basic_dsp.h>
+
+#include <cmath>
+#include <cstring>
+
+zone_index::zone_index() { memset(bucket_start, 0, sizeof(bucket_start)); }
+
+void zone_index::build_velocity_table(const sample_zone &z, const sample_part &p, float *table)
+{
+    int n_split = p.vs_layercount;
+
+    for (int velocity = 0; velocity < zone_index_keys; velocity++)
+    {
+        float crossfade_amp = 1.f;
+
+        if (n_split && (z.layer <= n_split))
+        {
+            float k = z.layer;
+            float xf = p.vs_xfade;
+            float fvlo0 = (k - 0.5f * xf) / ((float)n_split + 1.0f);
+            float fvlo1 = (k + 0.5f * xf) / ((float)n_split + 1.0f);
+            float fvhi0 = (k + 1.0f - 0.5f * xf) / ((float)n_split + 1.0f);
+            float fvhi1 = (k + 1.0f + 0.5f * xf) / ((float)n_split + 1.0f);
+
+            // map to -1 .. 1
+            fvlo0 = saturate(fvlo0 * 2.f - 1.f);
+            fvlo1 = saturate(fvlo1 * 2.f - 1.f);
+            fvhi0 = saturate(fvhi0 * 2.f - 1.f);
+            fvhi1 = saturate(fvhi1 * 2.f - 1.f);
+
+            // skew
+            float sk = p.vs_distribution;
+            fvlo0 = fvlo0 - sk * fvlo0 * fvlo0 + sk;
+            fvlo1 = fvlo1 - sk * fvlo1 * fvlo1 + sk;
+            fvhi0 = fvhi0 - sk * fvhi0 * fvhi0 + sk;
+            fvhi1 = fvhi1 - sk * fvhi1 * fvhi1 + sk;
+
+            // map back and scale to 0 .. 127
+            fvlo0 = fvlo0 * 64.f + 64.f;
+            fvlo1 = fvlo1 * 64.f + 64.f;
+            fvhi0 = fvhi0 * 64.f + 64.f;
+            fvhi1 = fvhi1 * 64.f + 64.f;
+
+            int lovel = fvlo0;
+            int hivel = fvhi1;
+
+            if ((velocity < lovel) || (velocity >= hivel))
+            {
+                table[velocity] = -1.f;
+                continue;
+            }
+
+            if (xf > 0.001)
+            {
+                if ((velocity < fvlo1) && (z.layer))
+                    crossfade_amp *= (velocity - fvlo0) / (fvlo1 - fvlo0);
+                else if ((velocity > fvhi0) && (z.layer < n_split))
+                    crossfade_amp *= 1.f - ((velocity - fvhi0) / (fvhi1 - fvhi0));
+                crossfade_amp = limit_range(crossfade_amp, 0.f, 1.f);
+            }
+        }
+        else
+        {
+            int lovel = z.velocity_low - z.velocity_low_fade;
+            int hivel = z.velocity_high + z.velocity_high_fade;
+
+            if ((velocity < lovel) || (velocity > hivel))
+            {
+                table[velocity] = -1.f;
+                continue;
+            }
+
+            if (z.velocity_low_fade || z.velocity_high_fade)
+            {
+                if (velocity < (z.velocity_low + z.velocity_low_fade))
+                    crossfade_amp *= ((float)velocity - lovel) / ((float)z.velocity_low_fade * 2.f);
+                else if (velocity > (z.velocity_high - z.velocity_high_fade))
+                    crossfade_amp *= 1.f - (((float)velocity - z.velocity_high + z.velocity_high_fade) /
+                                            ((float)z.velocity_high_fade * 2.f));
+                crossfade_amp = limit_range(crossfade_amp, 0.f, 1.f);
+            }
+        }
+
+        // sqrt(key * vel) == sqrt(key) * sqrt(vel), so equal power can be folded in per table
+        if (p.vs_xf_equality)
+            crossfade_amp = sqrt(crossfade_amp);
+
+        table[velocity] = crossfade_amp;
+    }
+}
+
+void zone_index::build(const sample_zone *zones, const bool *zone_exists, const sample_part *parts)
+{
+    struct candidate
+    {
+        uint32_t bucket;
+        entry e;
+    };
+    std::vector<candidate> candidates;
+    uint32_t count[zone_index_channels * zone_index_keys];
+    memset(count, 0, sizeof(count));
+
+    entries.clear();
+    vel_gain.clear();
+
+    uint16_t n_tables = 0;
+    for (int z = 0; z < MAX_ZONES; z++)
+    {
+        if (!zone_exists[z] || zones[z].mute)
+            continue;
+
+        int p = zones[z].part & 0xf;
+        int channel = parts[p].MIDIchannel;
+        if ((channel < 0) || (channel >= zone_index_channels))
+            continue;
+
+        const sample_zone &zn = zones[z];
+        bool table_used = false;
+
+        for (int key = 0; key < zone_index_keys; key++)
+        {
+            int zkey = key + parts[p].transpose - parts[p].formant; // key used for range check
+
+            if (zkey < (zn.key_low - zn.key_low_fade))
+                continue;
+            if (zkey > (zn.key_high + zn.key_high_fade))
+                continue;
+
+            float crossfade_amp = 1.f;
+            if (zn.key_low_fade || zn.key_high_fade)
+            {
+                if (zkey < (zn.key_low + zn.key_low_fade))
+                    crossfade_amp = ((float)zkey - zn.key_low + zn.key_low_fade) /
+                                    ((float)zn.key_low_fade * 2.f);
+                else if (zkey > (zn.key_high - zn.key_high_fade))
+                    crossfade_amp = 1.f - (((float)zkey - zn.key_high + zn.key_high_fade) /
+                                           ((float)zn.key_high_fade * 2.f));
+
+                crossfade_amp = limit_range(crossfade_amp, 0.f, 1.f);
+            }
+            if (parts[p].vs_xf_equality)
+                crossfade_amp = sqrt(crossfade_amp);
+
+            candidate c;
+            c.bucket = bucket(channel, key);
+            c.e.zone_id = z;
+            c.e.vel_table = n_tables;
+            c.e.key_gain = crossfade_amp;
+            candidates.push_back(c);
+            count[c.bucket]++;
+            table_used = true;
+        }
+
+        if (table_used)
+        {
+            vel_gain.resize((n_tables + 1) * zone_index_keys);
+            build_velocity_table(zn, parts[p], &vel_gain[n_tables * zone_index_keys]);
+            n_tables++;
+        }
+    }
+
+    // counting sort into buckets. stable, so each bucket stays in ascending zone order
+    uint32_t pos = 0;
+    for (int b = 0; b < zone_index_channels * zone_index_keys; b++)
+    {
+        bucket_start[b] = pos;
+        pos += count[b];
+    }
+    bucket_start[zone_index_channels * zone_index_keys] = pos;
+
+    entries.resize(pos);
+    memset(count, 0, sizeof(count));
+    for (auto &c : candidates)
+    {
+        entries[bucket_start[c.bucket] + count[c.bucket]] = c.e;
+        count[c.bucket]++;
+    }
+}
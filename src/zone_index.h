@@ -0,0 +1,79 @@
+/*
+** Shortcircuit XT is Free and Open Source Software
+**
+** Shortcircuit is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html; The authors of the code
+** reserve the right to re-license their contributions under the MIT license in the
+** future at the discretion of the project maintainers.
+**
+** Copyright 2004-2022 by various individuals as described by the git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/shortcircuit-xt.git
+**
+** Shortcircuit was a commercial product from 2004-2018, with copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Shortcircuit
+** open source in December 2020.
+*/
+
+#pragma once
+
+#include "globals.h"
+#include <cstdint>
+#include <vector>
+
+struct sample_zone;
+struct sample_part;
+
+static constexpr int zone_index_keys = 128;
+static constexpr int zone_index_channels = 16;
+
+/*
+ * Key/velocity lookup used by sampler::PlayNote so a note-on only has to look at the zones
+ * which can actually respond to it. For every MIDI channel and key the index holds the
+ * candidate zones (in ascending zone order, same as the old linear scan) together with the
+ * key crossfade gain. Each zone also gets a 128 entry velocity table which folds in the
+ * velocity fades, the part velocity-split layers and the equal power option; a negative
+ * value means the zone doesn't respond to that velocity.
+ *
+ * The index is a pure function of the zone and part state and is rebuilt by the sampler
+ * whenever that changes (see sampler::rebuild_zone_index).
+ */
+class zone_index
+{
+  public:
+    struct entry
+    {
+        uint16_t zone_id;
+        uint16_t vel_table;
+        float key_gain;
+    };
+
+    zone_index();
+
+    void build(const sample_zone *zones, const bool *zone_exists, const sample_part *parts);
+
+    const entry *begin(int channel, int key) const
+    {
+        return entries.data() + bucket_start[bucket(channel, key)];
+    }
+    const entry *end(int channel, int key) const
+    {
+        return entries.data() + bucket_start[bucket(channel, key) + 1];
+    }
+    float velocity_gain(const entry &e, int velocity) const
+    {
+        return vel_gain[(e.vel_table * zone_index_keys) + (velocity & 0x7f)];
+    }
+    size_t size() const { return entries.size(); }
+
+  private:
+    static int bucket(int channel, int key)
+    {
+        return ((channel & 0xf) * zone_index_keys) + (key & 0x7f);
+    }
+    void build_velocity_table(const sample_zone &z, const sample_part &p, float *table);
+
+    std::vector<entry> entries;
+    std::vector<float> vel_gain;
+    uint32_t bucket_start[zone_index_channels * zone_index_keys + 1];
+};
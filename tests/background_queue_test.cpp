@@ -0,0 +1,142 @@
+/*
+** Shortcircuit XT is Free and Open Source Software
+**
+** Shortcircuit is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html; The authors of the code
+** reserve the right to re-license their contributions under the MIT license in the
+** future at the discretion of the project maintainers.
+**
+** Copyright 2004-2022 by various individuals as described by the git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/shortcircuit-xt.git
+**
+** Shortcircuit was a commercial product from 2004-2018, with copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Shortcircuit
+** open source in December 2020.
+*/
+
+#include "test_main.h"
+#include "infrastructure/background_queue.h"
+#include "sample.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace
+{
+// a mono 32 bit float wave file in memory
+std::vector<char> floatWave(const std::vector<float> &data, int rate)
+{
+    auto le = [](std::vector<char> &to, uint32_t v, int n) {
+        for (int i = 0; i < n; i++)
+            to.push_back((char)(v >> (8 * i)));
+    };
+    uint32_t bytes = data.size() * sizeof(float);
+    std::vector<char> w = {'R', 'I', 'F', 'F'};
+    le(w, 4 + 24 + 8 + bytes, 4);
+    w.insert(w.end(), {'W', 'A', 'V', 'E', 'f', 'm', 't', ' '});
+    le(w, 16, 4);
+    le(w, 3, 2); // WAVE_FORMAT_IEEE_FLOAT
+    le(w, 1, 2);
+    le(w, rate, 4);
+    le(w, rate * sizeof(float), 4);
+    le(w, sizeof(float), 2);
+    le(w, 32, 2);
+    w.insert(w.end(), {'d', 'a', 't', 'a'});
+    le(w, bytes, 4);
+    size_t at = w.size();
+    w.resize(at + bytes);
+    memcpy(&w[at], data.data(), bytes);
+    return w;
+}
+} // namespace
+
+TEST_CASE("Background Queue", "[threading]")
+{
+    SECTION("Jobs run in order, off the posting thread")
+    {
+        scxt::Threading::BackgroundQueue q;
+        std::vector<int> order;
+        std::atomic<int> elsewhere{0};
+        auto self = std::this_thread::get_id();
+        for (int i = 0; i < 50; i++)
+            q.post([&order, &elsewhere, self, i]() {
+                order.push_back(i);
+                if (std::this_thread::get_id() != self)
+                    elsewhere++;
+            });
+        q.waitIdle();
+        REQUIRE(order.size() == 50);
+        for (int i = 0; i < 50; i++)
+            REQUIRE(order[i] == i);
+        REQUIRE(elsewhere == 50);
+    }
+    SECTION("Destruction drops what hasn't started")
+    {
+        std::atomic<int> ran{0};
+        std::atomic<bool> started{false};
+        {
+            scxt::Threading::BackgroundQueue q;
+            q.post([&ran, &started]() {
+                started = true;
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                ran++;
+            });
+            while (!started)
+                std::this_thread::yield();
+            for (int i = 0; i < 10; i++)
+                q.post([&ran]() { ran++; });
+        }
+        REQUIRE(ran == 1);
+    }
+}
+
+TEST_CASE("Sample Mip Build", "[threading]")
+{
+    const int n = 8192;
+    const double amp = 0.5;
+
+    // a tone every level passes and one above what the first level keeps
+    for (double cycles : {0.01, 0.4})
+    {
+        DYNAMIC_SECTION("A tone at " << cycles << " cycles per sample")
+        {
+            std::vector<float> data(n);
+            for (int i = 0; i < n; i++)
+                data[i] = (float)(amp * sin(2.0 * M_PI * cycles * i));
+            auto wav = floatWave(data, 48000);
+
+            sample s(nullptr);
+            REQUIRE(s.parse_riff_wave(wav.data(), wav.size()));
+            REQUIRE(!s.UseInt16);
+            REQUIRE(s.mip_levels == 0);
+
+            // built where the engine builds them, on the background queue
+            scxt::Threading::BackgroundQueue q;
+            std::atomic<bool> built{false};
+            q.post([&s, &built]() { built = s.build_mips(); });
+            q.waitIdle();
+            REQUIRE(built);
+            REQUIRE(s.mip_levels == sample::MaxMipLevels);
+            REQUIRE(!s.build_mips());
+
+            for (int k = 1; k <= sample::MaxMipLevels; k++)
+            {
+                INFO("level " << k);
+                auto *m = (const float *)s.GetMipPtr(k, 0);
+                REQUIRE(m);
+                // away from the ends, where the filter reaches into the margins
+                double worst = 0;
+                for (int j = 64; j < (n >> k) - 64; j++)
+                {
+                    double expected = cycles < 0.2 ? amp * sin(2.0 * M_PI * cycles * (j << k)) : 0;
+                    worst = std::max(worst, std::fabs(m[j] - expected));
+                }
+                REQUIRE(worst < 1e-3);
+            }
+        }
+    }
+}
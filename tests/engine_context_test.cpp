@@ -0,0 +1,72 @@
+/*
+** Shortcircuit XT is Free and Open Source Software
+**
+** Shortcircuit is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html; The authors of the code
+** reserve the right to re-license their contributions under the MIT license in the
+** future at the discretion of the project maintainers.
+**
+** Copyright 2004-2022 by various individuals as described by the git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/shortcircuit-xt.git
+**
+** Shortcircuit was a commercial product from 2004-2018, with copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Shortcircuit
+** open source in December 2020.
+*/
+
+#include "test_main.h"
+#include "globals.h"
+#include "synthesis/mathtables.h"
+
+#include <thread>
+
+TEST_CASE("Engine Context", "[engine]")
+{
+    SECTION("Rate dependent state follows the current context")
+    {
+        engine_context a, b;
+        a.set_samplerate(44100.f);
+        b.set_samplerate(96000.f);
+
+        REQUIRE(a.samplerate_inv == Approx(1.f / 44100.f));
+        REQUIRE(b.samplerate_inv == Approx(1.f / 96000.f));
+
+        float rate_a, rate_b;
+        {
+            engine_context_scope sa(&a);
+            REQUIRE(current_engine().samplerate == 44100.f);
+            rate_a = envelope_rate_linear(0.f);
+            {
+                engine_context_scope sb(&b);
+                REQUIRE(current_engine().samplerate == 96000.f);
+                rate_b = envelope_rate_linear(0.f);
+            }
+            REQUIRE(current_engine().samplerate == 44100.f);
+        }
+        REQUIRE(current_engine_context == nullptr);
+        REQUIRE(&current_engine() == &default_engine_context());
+
+        // one block per sample period, so the linear rate scales with the inverse of the rate
+        REQUIRE(rate_a == Approx(BLOCK_SIZE / 44100.f));
+        REQUIRE(rate_b == Approx(BLOCK_SIZE / 96000.f));
+    }
+
+    SECTION("Contexts are per thread")
+    {
+        engine_context a, b;
+        a.set_samplerate(44100.f);
+        b.set_samplerate(192000.f);
+
+        engine_context_scope sa(&a);
+        float seen = 0;
+        std::thread t([&]() {
+            engine_context_scope sb(&b);
+            seen = current_engine().samplerate;
+        });
+        t.join();
+
+        REQUIRE(seen == 192000.f);
+        REQUIRE(current_engine().samplerate == 44100.f);
+    }
+}
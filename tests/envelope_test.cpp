@@ -0,0 +1,107 @@
+/*
+** Shortcircuit XT is Free and Open Source Software
+**
+** Shortcircuit is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html; The authors of the code
+** reserve the right to re-license their contributions under the MIT license in the
+** future at the discretion of the project maintainers.
+**
+** Copyright 2004-2022 by various individuals as described by the git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/shortcircuit-xt.git
+**
+** Shortcircuit was a commercial product from 2004-2018, with copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Shortcircuit
+** open source in December 2020.
+*/
+
+#include "test_main.h"
+#include "globals.h"
+#include "synthesis/envelope.h"
+#include "util/prng.h"
+
+#include <vector>
+
+TEST_CASE("Envelope Bank", "[voices]")
+{
+    SECTION("Grouped processing matches per lane processing")
+    {
+        const int lanes = 64;
+        envelope_bank grouped(lanes), single(lanes);
+        REQUIRE(grouped.size() == lanes);
+
+        // A, H, D, S, R and the three shapes per lane
+        std::vector<float> prm(lanes * 8);
+        prng rng(17);
+        for (int l = 0; l < lanes; l++)
+        {
+            float *p = &prm[l * 8];
+            p[0] = (l % 7) ? rng.unipolar() * 8.f - 9.f : -10.f; // some lanes skip the attack
+            p[1] = (l % 5) ? -10.f : rng.unipolar() * 4.f - 8.f;
+            p[2] = rng.unipolar() * 8.f - 8.f;
+            p[3] = (l % 3) ? rng.unipolar() : 0.f; // some decay to silence
+            p[4] = rng.unipolar() * 8.f - 8.f;
+            for (int s = 5; s < 8; s++)
+                p[s] = rng.bipolar() * 10.f;
+            for (auto *b : {&grouped, &single})
+            {
+                b->assign(l, &p[0], &p[1], &p[2], &p[3], &p[4], &p[5]);
+                b->attack(l, (l % 11) == 0);
+            }
+        }
+
+        std::vector<uint8_t> run(lanes);
+        for (int blk = 0; blk < 20000; blk++)
+        {
+            for (int l = 0; l < lanes; l++)
+            {
+                run[l] = (l % 9) != 4; // some lanes sit out, like EG2 when it is off
+                if ((blk == (l * 37) % 3000 + 100) && run[l])
+                {
+                    grouped.release(l);
+                    single.release(l);
+                }
+                if ((blk == 5000) && (l % 13 == 0))
+                {
+                    grouped.uber_release(l);
+                    single.uber_release(l);
+                }
+            }
+
+            grouped.process(run.data());
+            for (int l = 0; l < lanes; l++)
+                if (run[l])
+                    single.process_lane(l, BLOCK_SIZE);
+
+            // the whole bank at once, and only look for the lane when it differs
+            int differs = -1;
+            for (int l = 0; l < lanes && differs < 0; l++)
+                if ((grouped.output(l) != single.output(l)) ||
+                    (grouped.is_running(l) != single.is_running(l)))
+                    differs = l;
+            INFO("block " << blk << " lane " << differs);
+            REQUIRE(differs == -1);
+        }
+
+        // everything has been released and has run out by now
+        for (int l = 0; l < lanes; l++)
+            if (run[l])
+                REQUIRE(!grouped.is_running(l));
+    }
+
+    SECTION("Envelope is a view of a lane")
+    {
+        envelope_bank b(2);
+        REQUIRE(b.size() == 4);
+        float a = -10.f, h = -10.f, d = -2.f, s = 0.5f, r = -2.f, shape[3] = {0, 0, 0};
+        Envelope e0(&b, 0), e1(&b, 1);
+        e0.Assign(&a, &h, &d, &s, &r, shape);
+        e1.Assign(&a, &h, &d, &s, &r, shape);
+        e0.Attack();
+        REQUIRE(e0.Process(BLOCK_SIZE));
+        REQUIRE(&e0.output == &b.output(0));
+        REQUIRE(e0.output > 0.5f);
+        REQUIRE(e1.output == 0.f);
+        REQUIRE(!e1.IsRunning());
+    }
+}
@@ -37,6 +37,7 @@ TEST_CASE("Simple SF2 Load", "[formats]")
 #else
         REQUIRE(sc3->load_file(string_to_path("resources/test_samples/harpsi.sf2")));
 #endif
+        sc3->wait_for_background();
 
         auto notes = {60, 64, 66};
         std::vector<float> rmses;
@@ -79,6 +80,7 @@ TEST_CASE("Simple WAV Load", "[formats]")
 #else
         REQUIRE(sc3->load_file(string_to_path("resources/test_samples/BadPluckSample.wav")));
 #endif
+        sc3->wait_for_background();
 
         double rms = 0;
         int n = 36;
@@ -120,6 +122,7 @@ TEST_CASE("Simple SFZ+WAV Load", "[formats]")
 
         sc3->set_samplerate(48000);
         REQUIRE(sc3->load_file("resources/test_samples/malicex_sfz/miniguitar_octavelike.sfz"));
+        sc3->wait_for_background();
 
         // play single note
         double rms = 0;
@@ -149,6 +152,7 @@ TEST_CASE("Simple SFZ+WAV Load", "[formats]")
 
         sc3->set_samplerate(48000);
         REQUIRE(sc3->load_file("resources/test_samples/malicex_sfz/YM-FM_Font FM Drums.sfz"));
+        sc3->wait_for_background();
 
         double rms = 0;
         int n_lo = 35, n_hi = 60; // play several notes at once
@@ -181,6 +185,7 @@ TEST_CASE("Simple SFZ+WAV Load", "[formats]")
 
         sc3->set_samplerate(48000);
         REQUIRE(sc3->load_file("resources/test_samples/malicex_sfz/YM-FM_Font Music Box.sfz"));
+        sc3->wait_for_background();
 
         // play notes (same key, different velocities) at once.
         double rms = 0;
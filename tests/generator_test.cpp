@@ -0,0 +1,300 @@
+/*
+** Shortcircuit XT is Free and Open Source Software
+**
+** Shortcircuit is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html; The authors of the code
+** reserve the right to re-license their contributions under the MIT license in the
+** future at the discretion of the project maintainers.
+**
+** Copyright 2004-2022 by various individuals as described by the git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/shortcircuit-xt.git
+**
+** Shortcircuit was a commercial product from 2004-2018, with copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Shortcircuit
+** open source in December 2020.
+*/
+
+#include "test_main.h"
+#include "generator.h"
+#include "globals.h"
+#include "resampling.h"
+#include "util/prng.h"
+
+#include <cmath>
+#include <vector>
+
+namespace
+{
+// the longest kernel reads 32 samples either side of the play position
+constexpr int waveSize = 4096, pad = 64, blockSize = BLOCK_SIZE * 2;
+
+struct GeneratorRun
+{
+    GeneratorState state;
+    GeneratorIO io;
+    float out[2][blockSize];
+
+    GeneratorRun(int ratio, void *dataL, void *dataR)
+    {
+        state = GeneratorState();
+        state.Direction = 1;
+        state.SamplePos = ratio < 0 ? 3000 : 100;
+        state.SampleSubPos = 0;
+        state.LowerBound = 100;
+        state.UpperBound = 3000;
+        state.InvertedBounds = 1.f / 2900.f;
+        state.Ratio = ratio;
+        state.BlockSize = blockSize;
+        state.IsFinished = 0;
+        state.SampleStart = 0;
+        state.SampleStop = waveSize - 1;
+        state.Gated = true;
+
+        io.OutputL = out[0];
+        io.OutputR = out[1];
+        io.SampleDataL = dataL;
+        io.SampleDataR = dataR;
+        io.WaveSize = waveSize;
+        io.VoicePtr = nullptr;
+    }
+};
+} // namespace
+
+TEST_CASE("Generator Variants", "[generator]")
+{
+    init_sinc_tables();
+
+    std::vector<float> fData[2];
+    std::vector<short> iData[2];
+    prng rng(2022);
+    for (int c = 0; c < 2; c++)
+    {
+        fData[c].resize(waveSize + 2 * pad);
+        iData[c].resize(waveSize + 2 * pad);
+        for (int i = 0; i < waveSize + 2 * pad; i++)
+        {
+            fData[c][i] = rng.bipolar();
+            iData[c][i] = (short)(fData[c][i] * 32767.f);
+        }
+    }
+
+    REQUIRE(GeneratorArchAvailable(GA_Reference));
+    REQUIRE(GeneratorArchAvailable(GA_SSE2));
+    REQUIRE(GeneratorArchAvailable(GetGeneratorArch()));
+
+    // unity, down, up and backwards
+    const int ratios[] = {1 << 24, 12237291, 32045913, -21810380};
+
+    for (int a = GA_Reference + 1; a < GA_NumArchs; a++)
+    {
+        auto arch = (GeneratorArch)a;
+        if (!GeneratorArchAvailable(arch))
+            continue;
+        INFO("Comparing " << GeneratorArchName(arch) << " with "
+                          << GeneratorArchName(GA_Reference));
+
+        // SSE2 does the same float operations in the same order as the reference. SIMDe on
+        // aarch64 leaves the compiler free to fuse the multiply adds.
+#if defined(__aarch64__)
+        bool exact = false;
+#else
+        bool exact = (arch == GA_SSE2);
+#endif
+
+        for (int variant = 0; variant < 4 * (GSM_LoopUntilRelease + 1); variant++)
+        {
+            bool stereo = variant & 1, fp = variant & 2;
+            int mode = variant >> 2;
+            auto ref = GetFPtrGeneratorSample(stereo, fp, mode, GA_Reference);
+            auto var = GetFPtrGeneratorSample(stereo, fp, mode, arch);
+            REQUIRE(ref);
+            REQUIRE(var);
+
+            void *dataL = fp ? (void *)&fData[0][pad] : (void *)&iData[0][pad];
+            void *dataR = fp ? (void *)&fData[1][pad] : (void *)&iData[1][pad];
+
+            for (auto ratio : ratios)
+            {
+                INFO("stereo=" << stereo << " float=" << fp << " mode=" << mode
+                               << " ratio=" << ratio);
+                GeneratorRun r(ratio, dataL, dataR), v(ratio, dataL, dataR);
+
+                for (int b = 0; b < 100; b++)
+                {
+                    if (b == 60)
+                        r.state.Gated = v.state.Gated = false;
+                    ref(&r.state, &r.io);
+                    var(&v.state, &v.io);
+
+                    REQUIRE(r.state.SamplePos == v.state.SamplePos);
+                    REQUIRE(r.state.SampleSubPos == v.state.SampleSubPos);
+                    REQUIRE(r.state.IsFinished == v.state.IsFinished);
+                    REQUIRE(r.state.Direction == v.state.Direction);
+
+                    // the int16 kernels are bit exact, the float ones differ in rounding only
+                    for (int c = 0; c < 1 + stereo; c++)
+                        for (int i = 0; i < blockSize; i++)
+                        {
+                            if (fp && !exact)
+                                REQUIRE(v.out[c][i] == Approx(r.out[c][i]).margin(1e-5));
+                            else
+                                REQUIRE(v.out[c][i] == r.out[c][i]);
+                        }
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("Generator Interpolation", "[generator]")
+{
+    init_sinc_tables();
+
+    // a slow sine, well inside the passband of every mode
+    const double w = 2.0 * M_PI * 0.02, amp = 0.5;
+    std::vector<float> fData(waveSize + 2 * pad);
+    std::vector<short> iData(waveSize + 2 * pad);
+    for (int i = 0; i < waveSize + 2 * pad; i++)
+    {
+        fData[i] = (float)(amp * sin(w * (i - pad)));
+        iData[i] = (short)lrint(fData[i] * 32768.0);
+    }
+
+    // sinc16 has the 14 bit int16 coefficient tables to allow for
+    const float tolerance[GI_NumInterpolations] = {2e-3f, 1e-4f, 1e-3f, 1e-4f, 1e-4f};
+
+    for (int gi = GI_Linear; gi < GI_NumInterpolations; gi++)
+    {
+        for (int variant = 0; variant < 4; variant++)
+        {
+            bool stereo = variant & 1, fp = variant & 2;
+            INFO("interpolation=" << gi << " stereo=" << stereo << " float=" << fp);
+            REQUIRE(GetFPtrGeneratorSample(stereo, fp, GSM_Normal, GA_Reference, gi));
+            auto gen = GetFPtrGeneratorSample(stereo, fp, GSM_Normal, gi);
+            REQUIRE(gen);
+
+            void *data = fp ? (void *)&fData[pad] : (void *)&iData[pad];
+
+            // at unity the position lands on samples and every mode copies sample pos - 1 out.
+            // one step off unity the sincs filter, within the tolerance
+            for (int ratio : {1 << 24, (1 << 24) + 1})
+            {
+                GeneratorRun r(ratio, data, data);
+                gen(&r.state, &r.io);
+                for (int i = 0; i < blockSize; i++)
+                {
+                    float expected = fp ? fData[pad + 100 + i - 1]
+                                        : iData[pad + 100 + i - 1] * (1.f / 32768.f);
+                    if ((gi <= GI_Cubic) || (ratio == (1 << 24)))
+                        REQUIRE(r.out[0][i] == Approx(expected).margin(1e-6));
+                    else
+                        REQUIRE(r.out[0][i] == Approx(expected).margin(tolerance[gi]));
+                    if (stereo)
+                        REQUIRE(r.out[1][i] == r.out[0][i]);
+                }
+            }
+
+            // in between samples
+            {
+                const int ratio = 12237291;
+                GeneratorRun r(ratio, data, data);
+                for (int b = 0; b < 2000 / blockSize; b++) // stay short of the upper bound
+                {
+                    gen(&r.state, &r.io);
+                    for (int i = 0; i < blockSize; i++)
+                    {
+                        double pos = 100.0 + (double)(b * blockSize + i) * ratio / (1 << 24);
+                        double expected = amp * sin(w * (pos - 1.0));
+                        REQUIRE(r.out[0][i] == Approx(expected).margin(tolerance[gi]));
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("Generator Mip Levels", "[generator]")
+{
+    init_sinc_tables();
+
+    // every level is the same sine at its own rate, so the output shouldn't depend on the level
+    const double w = 2.0 * M_PI * 0.01, amp = 0.5;
+    const int ratio = 12237291;
+
+    for (int level = 0; level <= 3; level++)
+    {
+        std::vector<float> fData(waveSize + 2 * pad);
+        for (int i = 0; i < waveSize + 2 * pad; i++)
+            fData[i] = (float)(amp * sin(w * ((i - pad) << level)));
+
+        for (int gi : {GI_Linear, GI_Cubic, GI_Sinc16})
+        {
+            INFO("level=" << level << " interpolation=" << gi);
+            auto gen = GetFPtrGeneratorSample(false, true, GSM_Normal, gi);
+            REQUIRE(gen);
+
+            GeneratorRun r(ratio << level, &fData[pad], nullptr);
+            r.state.MipLevel = level;
+            for (int b = 0; b < (2000 >> level) / blockSize; b++)
+            {
+                gen(&r.state, &r.io);
+                for (int i = 0; i < blockSize; i++)
+                {
+                    double pos =
+                        100.0 + (double)(b * blockSize + i) * ((double)ratio * (1 << level)) /
+                                    (1 << 24);
+                    double expected = amp * sin(w * (pos - 1.0));
+                    REQUIRE(r.out[0][i] == Approx(expected).margin(gi == GI_Linear ? 2e-2 : 2e-3));
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("Generator Unity Ratio", "[generator]")
+{
+    init_sinc_tables();
+
+    std::vector<float> fData(waveSize + 2 * pad);
+    prng rng(2023);
+    for (auto &f : fData)
+        f = rng.bipolar();
+    for (int i = 0; i < pad; i++)
+        fData[i] = fData[waveSize + pad + i] = 0.f;
+
+    // the copy has to walk loops and reverse playback the way the kernels would. (GSM_Loop
+    // only wraps forwards)
+    for (int mode : {GSM_Normal, GSM_Loop, GSM_Shot})
+    {
+        for (int ratio : {1 << 24, -(1 << 24)})
+        {
+            if ((mode == GSM_Loop) && (ratio < 0))
+                continue;
+            INFO("mode=" << mode << " ratio=" << ratio);
+            auto gen = GetFPtrGeneratorSample(false, true, mode);
+            auto linear = GetFPtrGeneratorSample(false, true, mode, GI_Linear);
+            REQUIRE(gen);
+            REQUIRE(linear);
+            GeneratorRun r(ratio, &fData[pad], nullptr);
+            r.state.LowerBound = 100;
+            r.state.UpperBound = 100 + blockSize * 5 / 2;
+            r.state.SamplePos = ratio < 0 ? r.state.UpperBound : r.state.LowerBound;
+
+            for (int b = 0; b < 6; b++)
+            {
+                GeneratorState before = r.state;
+                gen(&r.state, &r.io);
+
+                // the same block one step off unity goes through a kernel, linear so that the
+                // tiny sub positions don't filter. + 1 either way keeps them above zero
+                GeneratorRun o(0, &fData[pad], nullptr);
+                o.state = before;
+                o.state.Ratio = ratio + 1;
+                linear(&o.state, &o.io);
+                for (int i = 0; i < blockSize; i++)
+                    REQUIRE(r.out[0][i] == Approx(o.out[0][i]).margin(1e-4));
+            }
+        }
+    }
+}
@@ -0,0 +1,111 @@
+/*
+** Shortcircuit XT is Free and Open Source Software
+**
+** Shortcircuit is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html; The authors of the code
+** reserve the right to re-license their contributions under the MIT license in the
+** future at the discretion of the project maintainers.
+**
+** Copyright 2004-2022 by various individuals as described by the git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/shortcircuit-xt.git
+**
+** Shortcircuit was a commercial product from 2004-2018, with copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Shortcircuit
+** open source in December 2020.
+*/
+
+#include "test_main.h"
+#include "halfrate_pool.h"
+#include "generator.h"
+
+#include <set>
+
+TEST_CASE("Halfrate Pool", "[voices]")
+{
+    SECTION("Acquire and release")
+    {
+        halfrate_pool p(8);
+        REQUIRE(p.size() == 8);
+        REQUIRE(p.in_use() == 0);
+
+        std::set<sst::filters::HalfRate::HalfRateFilter *> taken;
+        for (int i = 0; i < 8; i++)
+        {
+            auto f = p.acquire(i % GI_NumInterpolations);
+            REQUIRE(f);
+            taken.insert(f);
+        }
+        REQUIRE(taken.size() == 8);
+        REQUIRE(p.in_use() == 8);
+        REQUIRE(p.exhausted() == 0);
+        REQUIRE(p.acquire(GI_Sinc16) == nullptr);
+        REQUIRE(p.exhausted() == 1);
+
+        auto f = *taken.begin();
+        p.release(f);
+        REQUIRE(p.in_use() == 7);
+        // the most recently released slot comes back first
+        REQUIRE(p.acquire(GI_Linear) == f);
+        REQUIRE(p.acquire(GI_Linear) == nullptr);
+        REQUIRE(p.exhausted() == 2);
+
+        p.release(nullptr);
+        REQUIRE(p.in_use() == 8);
+        for (auto t : taken)
+            p.release(t);
+        REQUIRE(p.in_use() == 0);
+    }
+
+    SECTION("A full pool takes the filter of the lowest priority user")
+    {
+        struct voice : halfrate_pool::user
+        {
+            float priority{0};
+            sst::filters::HalfRate::HalfRateFilter *f{nullptr};
+            float keep_priority() const override { return priority; }
+            void lost_halfrate() override { f = nullptr; }
+        };
+        halfrate_pool p(3);
+        voice v[4];
+        v[0].priority = 2.5f; // held
+        v[1].priority = 0.1f; // released, nearly silent
+        v[2].priority = 0.9f; // released
+        v[3].priority = 2.f;
+        for (int i = 0; i < 3; i++)
+            v[i].f = p.acquire(GI_Sinc16, &v[i]);
+
+        auto taken = v[1].f;
+        v[3].f = p.acquire(GI_Sinc64, &v[3]);
+        REQUIRE(v[3].f == taken);
+        REQUIRE(v[1].f == nullptr);
+        REQUIRE(v[0].f);
+        REQUIRE(v[2].f);
+        REQUIRE(p.stolen() == 1);
+        REQUIRE(p.exhausted() == 0);
+        REQUIRE(p.in_use() == 3);
+
+        // the next one goes to whoever is lowest now
+        v[1].f = p.acquire(GI_Sinc16, &v[1]);
+        REQUIRE(v[2].f == nullptr);
+        REQUIRE(v[1].f);
+        REQUIRE(p.stolen() == 2);
+
+        for (auto &x : v)
+            p.release(x.f);
+        REQUIRE(p.in_use() == 0);
+    }
+
+    SECTION("Order follows interpolation")
+    {
+        REQUIRE(halfrate_pool::filter_order(GI_Linear) < halfrate_pool::filter_order(GI_Sinc16));
+        REQUIRE(halfrate_pool::filter_order(GI_Cubic) < halfrate_pool::filter_order(GI_Sinc16));
+        REQUIRE(halfrate_pool::filter_order(GI_Sinc16) == 4);
+        REQUIRE(halfrate_pool::filter_order(GI_Sinc64) > halfrate_pool::filter_order(GI_Sinc16));
+        for (int i = 0; i < GI_NumInterpolations; i++)
+        {
+            REQUIRE(halfrate_pool::filter_order(i) >= 1);
+            REQUIRE(halfrate_pool::filter_order(i) <= 6);
+        }
+    }
+}
@@ -0,0 +1,260 @@
+/*
+** Shortcircuit XT is Free and Open Source Software
+**
+** Shortcircuit is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html; The authors of the code
+** reserve the right to re-license their contributions under the MIT license in the
+** future at the discretion of the project maintainers.
+**
+** Copyright 2004-2022 by various individuals as described by the git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/shortcircuit-xt.git
+**
+** Shortcircuit was a commercial product from 2004-2018, with copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Shortcircuit
+** open source in December 2020.
+*/
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "test_main.h"
+#include "filesystem/import.h"
+
+#include "midi_file.h"
+#include "wav_writer.h"
+
+using scxt::headless::MidiEvent;
+
+namespace
+{
+typedef std::vector<uint8_t> bytes;
+
+void append(bytes &to, const bytes &b) { to.insert(to.end(), b.begin(), b.end()); }
+bytes be32(uint32_t v)
+{
+    return {(uint8_t)(v >> 24), (uint8_t)(v >> 16), (uint8_t)(v >> 8), (uint8_t)v};
+}
+
+bytes header(int format, int tracks, int division)
+{
+    bytes b = {'M', 'T', 'h', 'd', 0, 0, 0, 6};
+    append(b, {0, (uint8_t)format, 0, (uint8_t)tracks, (uint8_t)(division >> 8),
+               (uint8_t)division});
+    return b;
+}
+
+bytes track(const bytes &body)
+{
+    bytes b = {'M', 'T', 'r', 'k'};
+    append(b, be32(body.size()));
+    append(b, body);
+    return b;
+}
+
+const bytes end_of_track = {0x00, 0xff, 0x2f, 0x00};
+
+bytes tempo(uint32_t us_per_quarter)
+{
+    return {0xff, 0x51, 0x03, (uint8_t)(us_per_quarter >> 16), (uint8_t)(us_per_quarter >> 8),
+            (uint8_t)us_per_quarter};
+}
+
+std::string scratch(const char *name)
+{
+    return path_to_string(fs::temp_directory_path() / string_to_path(name));
+}
+
+std::vector<MidiEvent> readBack(const bytes &file, bool expectOk = true)
+{
+    auto fn = scratch("sc3_test.mid");
+    {
+        std::ofstream o(fn, std::ios::binary);
+        o.write((const char *)file.data(), file.size());
+    }
+    std::vector<MidiEvent> ev;
+    std::string err;
+    REQUIRE(scxt::headless::readMidiFile(fn, ev, err) == expectOk);
+    REQUIRE(err.empty() == expectOk);
+    fs::remove(string_to_path(fn));
+    return ev;
+}
+} // namespace
+
+TEST_CASE("Headless MIDI File Reader", "[headless]")
+{
+    SECTION("Format 0")
+    {
+        auto f = header(0, 1, 480);
+        bytes t = {0x00, 0x90, 60, 100, 0x83, 0x60, 0x80, 60, 0}; // 480 ticks apart
+        append(t, end_of_track);
+        append(f, track(t));
+
+        auto ev = readBack(f);
+        REQUIRE(ev.size() == 2);
+        REQUIRE(ev[0].seconds == Approx(0.0));
+        REQUIRE(ev[0].status == 0x90);
+        REQUIRE(ev[0].data1 == 60);
+        REQUIRE(ev[0].data2 == 100);
+        REQUIRE(ev[1].seconds == Approx(0.5)); // 120 bpm by default
+        REQUIRE(ev[1].status == 0x80);
+    }
+    SECTION("Format 1 merges the tracks and applies the tempo track")
+    {
+        auto f = header(1, 3, 480);
+        bytes conductor = {0x00};
+        append(conductor, tempo(1000000)); // 60 bpm
+        append(conductor, end_of_track);
+        append(f, track(conductor));
+
+        bytes a = {0x83, 0x60, 0x91, 64, 90}; // tick 480, channel 2
+        append(a, end_of_track);
+        append(f, track(a));
+        bytes b = {0x00, 0xc0, 5, 0x87, 0x40, 0x90, 67, 80}; // program at 0, note at 960
+        append(b, end_of_track);
+        append(f, track(b));
+
+        auto ev = readBack(f);
+        REQUIRE(ev.size() == 3);
+        REQUIRE(ev[0].status == 0xc0);
+        REQUIRE(ev[0].data1 == 5);
+        REQUIRE(ev[0].seconds == Approx(0.0));
+        REQUIRE(ev[1].status == 0x91);
+        REQUIRE(ev[1].seconds == Approx(1.0));
+        REQUIRE(ev[2].data1 == 67);
+        REQUIRE(ev[2].seconds == Approx(2.0));
+    }
+    SECTION("Running status")
+    {
+        auto f = header(0, 1, 96);
+        bytes t = {0x00, 0x90, 60, 100, 0x30, 62, 101, 0x30, 60, 0, 0x00, 0xc0, 7, 0x00, 8};
+        append(t, end_of_track);
+        append(f, track(t));
+
+        auto ev = readBack(f);
+        REQUIRE(ev.size() == 5);
+        for (int i = 0; i < 3; i++)
+            REQUIRE(ev[i].status == 0x90);
+        REQUIRE(ev[1].data1 == 62);
+        REQUIRE(ev[1].data2 == 101);
+        REQUIRE(ev[2].data1 == 60);
+        REQUIRE(ev[2].data2 == 0);
+        // one data byte messages keep running status too
+        REQUIRE(ev[3].status == 0xc0);
+        REQUIRE(ev[4].status == 0xc0);
+        REQUIRE(ev[4].data1 == 8);
+        REQUIRE(ev[2].seconds == Approx(0.5));
+    }
+    SECTION("Tempo changes apply from their tick on")
+    {
+        auto f = header(0, 1, 480);
+        bytes t = {0x83, 0x60};
+        append(t, tempo(1000000)); // 60 bpm from tick 480, which is 0.5 s in
+        append(t, {0x83, 0x60, 0x90, 60, 100});
+        append(t, {0x00});
+        append(t, tempo(250000)); // 240 bpm from tick 960
+        append(t, {0x83, 0x60, 0x80, 60, 0});
+        append(t, end_of_track);
+        append(f, track(t));
+
+        auto ev = readBack(f);
+        REQUIRE(ev.size() == 2);
+        REQUIRE(ev[0].seconds == Approx(1.5));
+        REQUIRE(ev[1].seconds == Approx(1.75));
+    }
+    SECTION("A truncated track chunk keeps what was read")
+    {
+        auto f = header(0, 1, 480);
+        bytes t = {0x00, 0x90, 60, 100, 0x83, 0x60, 0x80, 60, 0};
+        append(t, end_of_track);
+        auto chunk = track(t);
+        chunk[7] += 100; // claims more than the file holds
+        chunk.resize(chunk.size() - 6);
+        append(f, chunk);
+
+        auto ev = readBack(f);
+        REQUIRE(ev.size() == 1);
+        REQUIRE(ev[0].status == 0x90);
+    }
+    SECTION("A truncated header is refused")
+    {
+        auto f = header(0, 1, 480);
+        f.resize(10);
+        readBack(f, false);
+        readBack({'R', 'I', 'F', 'F', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}, false);
+    }
+}
+
+TEST_CASE("Headless WAV Writer", "[headless]")
+{
+    for (int channels : {2, 3})
+    {
+        DYNAMIC_SECTION("Header and data round trip with " << channels << " channels")
+        {
+            const int frames = 100, rate = 48000;
+            std::vector<std::vector<float>> src(channels, std::vector<float>(frames));
+            std::vector<const float *> ptrs;
+            for (int c = 0; c < channels; c++)
+            {
+                for (int i = 0; i < frames; i++)
+                    src[c][i] = (float)(c * 1000 + i) / 4096.f;
+                ptrs.push_back(src[c].data());
+            }
+
+            auto fn = scratch("sc3_test.wav");
+            {
+                scxt::headless::WavWriter w;
+                REQUIRE(w.open(fn, channels, rate));
+                w.write(ptrs.data(), 60);
+                std::vector<const float *> rest;
+                for (auto p : ptrs)
+                    rest.push_back(p + 60);
+                w.write(rest.data(), frames - 60);
+                REQUIRE(w.framesWritten() == frames);
+                REQUIRE(w.close());
+            }
+
+            std::ifstream in(fn, std::ios::binary);
+            bytes d((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+            in.close();
+            fs::remove(string_to_path(fn));
+
+            auto le16 = [&d](size_t at) { return (uint32_t)(d[at] | (d[at + 1] << 8)); };
+            auto le32 = [&](size_t at) { return le16(at) | (le16(at + 2) << 16); };
+            auto tag = [&d](size_t at) { return std::string((const char *)&d[at], 4); };
+
+            REQUIRE(d.size() > 44);
+            REQUIRE(tag(0) == "RIFF");
+            REQUIRE(le32(4) == d.size() - 8);
+            REQUIRE(tag(8) == "WAVE");
+            REQUIRE(tag(12) == "fmt ");
+            size_t fmtLen = le32(16);
+            REQUIRE(le16(20) == (channels > 2 ? 0xfffe : 3));
+            REQUIRE(le16(22) == (uint32_t)channels);
+            REQUIRE(le32(24) == (uint32_t)rate);
+            REQUIRE(le32(28) == rate * channels * sizeof(float));
+            REQUIRE(le16(32) == channels * sizeof(float));
+            REQUIRE(le16(34) == 32);
+
+            size_t at = 20 + fmtLen;
+            REQUIRE(tag(at) == "fact");
+            REQUIRE(le32(at + 8) == (uint32_t)frames);
+            at += 12;
+            REQUIRE(tag(at) == "data");
+            REQUIRE(le32(at + 4) == frames * channels * sizeof(float));
+            at += 8;
+            REQUIRE(d.size() == at + frames * channels * sizeof(float));
+
+            std::vector<float> back(frames * channels);
+            memcpy(back.data(), &d[at], back.size() * sizeof(float));
+            bool same = true;
+            for (int i = 0; i < frames; i++)
+                for (int c = 0; c < channels; c++)
+                    same = same && (back[i * channels + c] == src[c][i]);
+            REQUIRE(same);
+        }
+    }
+}
@@ -0,0 +1,74 @@
+/*
+** Shortcircuit XT is Free and Open Source Software
+**
+** Shortcircuit is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html; The authors of the code
+** reserve the right to re-license their contributions under the MIT license in the
+** future at the discretion of the project maintainers.
+**
+** Copyright 2004-2022 by various individuals as described by the git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/shortcircuit-xt.git
+**
+** Shortcircuit was a commercial product from 2004-2018, with copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Shortcircuit
+** open source in December 2020.
+*/
+
+#include "test_main.h"
+#include "infrastructure/load_meter.h"
+
+using scxt::Perf::LoadMeter;
+
+TEST_CASE("DSP Load Meter", "[perf]")
+{
+    LoadMeter m;
+    m.setBudget(48000, 32);
+    auto budget = m.stats().budgetNs;
+    REQUIRE(budget == Approx(32.0 / 48000.0 * 1e9));
+
+    SECTION("Histogram and over budget counts")
+    {
+        m.addBlock(budget * 0.05);
+        m.addBlock(budget * 0.55);
+        m.addBlock(budget * 0.95);
+        m.addBlock(budget * 1.2);
+        m.addBlock(budget * 3.0);
+
+        auto &s = m.stats();
+        REQUIRE(s.blocks == 5);
+        REQUIRE(s.overBudget == 2);
+        REQUIRE(s.histogram[0] == 1);
+        REQUIRE(s.histogram[5] == 1);
+        REQUIRE(s.histogram[9] == 1);
+        REQUIRE(s.histogram[10] == 1);
+        REQUIRE(s.histogram[11] == 1);
+        REQUIRE(s.worst == Approx(3.0));
+
+        REQUIRE(m.takePeak() == Approx(3.0));
+        REQUIRE(m.stats().peak == 0);
+        REQUIRE(m.stats().worst == Approx(3.0));
+
+        m.reset();
+        REQUIRE(m.stats().blocks == 0);
+        REQUIRE(m.stats().budgetNs == budget);
+    }
+
+    SECTION("Smoothed load settles over a few hundred ms")
+    {
+        // a second at a steady 25%
+        for (int i = 0; i < 48000 / 32; i++)
+            m.addBlock(budget * 0.25);
+        REQUIRE(m.stats().load == Approx(0.25).margin(0.01));
+        REQUIRE(m.stats().totalNs / (m.stats().blocks * budget) == Approx(0.25));
+    }
+
+    SECTION("Timing a real block")
+    {
+        {
+            LoadMeter::Block b(m);
+        }
+        REQUIRE(m.stats().blocks == 1);
+        REQUIRE(m.stats().totalNs >= 0);
+    }
+}
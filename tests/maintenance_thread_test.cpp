@@ -0,0 +1,63 @@
+/*
+** Shortcircuit XT is Free and Open Source Software
+**
+** Shortcircuit is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html; The authors of the code
+** reserve the right to re-license their contributions under the MIT license in the
+** future at the discretion of the project maintainers.
+**
+** Copyright 2004-2022 by various individuals as described by the git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/shortcircuit-xt.git
+**
+** Shortcircuit was a commercial product from 2004-2018, with copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Shortcircuit
+** open source in December 2020.
+*/
+
+#include "test_main.h"
+#include "infrastructure/maintenance_thread.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+TEST_CASE("Maintenance Thread", "[threading]")
+{
+    SECTION("A request runs the task off the requesting thread")
+    {
+        std::atomic<int> runs{0};
+        std::atomic<bool> elsewhere{false};
+        auto self = std::this_thread::get_id();
+        scxt::Threading::MaintenanceThread mt(
+            [&]() {
+                elsewhere = (std::this_thread::get_id() != self);
+                runs++;
+            },
+            10000);
+        mt.request();
+        auto until = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (!runs && std::chrono::steady_clock::now() < until)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        REQUIRE(runs >= 1);
+        REQUIRE(elsewhere);
+    }
+    SECTION("The task runs periodically without requests")
+    {
+        std::atomic<int> runs{0};
+        {
+            scxt::Threading::MaintenanceThread mt([&]() { runs++; }, 5);
+            auto until = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+            while (runs < 3 && std::chrono::steady_clock::now() < until)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        REQUIRE(runs >= 3);
+    }
+    SECTION("Destruction doesn't wait for the period")
+    {
+        auto start = std::chrono::steady_clock::now();
+        {
+            scxt::Threading::MaintenanceThread mt([]() {}, 60000);
+        }
+        REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::seconds(10));
+    }
+}
@@ -0,0 +1,329 @@
+/*
+** Shortcircuit XT is Free and Open Source Software
+**
+** Shortcircuit is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html; The authors of the code
+** reserve the right to re-license their contributions under the MIT license in the
+** future at the discretion of the project maintainers.
+**
+** Copyright 2004-2022 by various individuals as described by the git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/shortcircuit-xt.git
+**
+** Shortcircuit was a commercial product from 2004-2018, with copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Shortcircuit
+** open source in December 2020.
+*/
+
+#include "test_main.h"
+#include "sampler.h"
+#include "sampler_voice.h"
+#include "loaders/shortcircuit2_RIFF_format.h"
+#include "synthesis/modmatrix.h"
+#include "util/prng.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+/*
+ * The matrices run a program compiled from the mm entries. These check it against the entries
+ * read one by one, the way the matrix used to run them, over random routings of the sources and
+ * destinations whose values the test can set and work out by itself.
+ */
+namespace
+{
+struct Rig
+{
+    std::unique_ptr<sample_zone> zone{new sample_zone};
+    std::unique_ptr<sample_part> part{new sample_part};
+    halfrate_pool halfrates{1};
+    envelope_bank envelopes{2};
+    timedata td{};
+    std::unique_ptr<sampler_voice> voice;
+    std::vector<float> control = std::vector<float>(16 * n_controllers);
+    std::vector<float> automation = std::vector<float>(256);
+    engine_context ec;
+
+    Rig()
+    {
+        memset(zone.get(), 0, sizeof(sample_zone));
+        memset(part.get(), 0, sizeof(sample_part));
+        voice = std::make_unique<sampler_voice>(0, &td, &halfrates, &envelopes);
+    }
+
+    const float *source(unsigned char riff, bool zoneMatrix)
+    {
+        static const float one = 1.f;
+        switch (riff)
+        {
+        case RMS_One:
+            return &one;
+        case RMS_PitchBend:
+            return &control[c_pitch_bend];
+        case RMS_ChAftertouch:
+            return &control[c_channel_aftertouch];
+        case RMS_ModulationWheel:
+            return &control[c_modwheel];
+        }
+        if (!zoneMatrix)
+        {
+            if ((riff >= RMS_Ctrl1) && (riff < RMS_Ctrl1 + n_custom_controllers))
+                return &part->userparameter_smoothed[riff - RMS_Ctrl1];
+            return nullptr;
+        }
+        switch (riff)
+        {
+        case RMS_Keytrack:
+            return &voice->keytrack;
+        case RMS_Velocity:
+            return &voice->fvelocity;
+        case RMS_Modulator1:
+            return &voice->AEG.output;
+        case RMS_Random:
+            return &voice->random;
+        case RMS_RandomBP:
+            return &voice->randombp;
+        case RMS_Gate:
+            return &voice->fgate;
+        case RMS_Time:
+            return &voice->time;
+        case RMS_Alternate:
+            return &voice->alternate;
+        }
+        return nullptr;
+    }
+
+    // the unmodulated values, for the destinations the routings use
+    float zoneBase(int d)
+    {
+        auto &z = *zone;
+        switch (d)
+        {
+        case md_pitch:
+            return 0.f;
+        case md_rate:
+            return 1.f;
+        case md_amplitude:
+            return z.aux[0].level;
+        case md_pan:
+            return z.aux[0].balance;
+        case md_aux_level:
+            return z.aux[1].level;
+        case md_AEG_a:
+            return z.AEG.attack;
+        case md_AEG_r:
+            return z.AEG.release;
+        case md_EG2_d:
+            return z.EG2.decay;
+        case md_LFO1_rate:
+            return z.LFO[0].rate;
+        case md_sample_start:
+            return (float)z.sample_start;
+        case md_loop_length:
+            return (float)(int)(z.loop_end - z.loop_start);
+        }
+        return 0.f;
+    }
+    float partBase(int d)
+    {
+        auto &p = *part;
+        switch (d)
+        {
+        case md_part_amplitude:
+            return p.aux[0].level;
+        case md_part_pan:
+            return p.aux[0].balance;
+        case md_part_aux_level:
+            return p.aux[1].level;
+        case md_part_prefilter_gain:
+            return p.pfg;
+        }
+        return 0.f;
+    }
+
+    float expected(bool zoneMatrix, modmatrix &mm, int d)
+    {
+        float v = zoneMatrix ? zoneBase(d) : partBase(d);
+        mm_entry *entries = zoneMatrix ? zone->mm : part->mm;
+        int n = zoneMatrix ? mm_entries : mm_part_entries;
+        for (int i = 0; i < n; i++)
+        {
+            auto &e = entries[i];
+            if (!e.active || (e.destination != d))
+                continue;
+            float m = *source(mm.get_source_RIFFID(e.source), zoneMatrix);
+            if (e.source2)
+                m *= *source(mm.get_source_RIFFID(e.source2), zoneMatrix);
+            m = do_curve(e.curve, m) * e.strength;
+            if (e.curve >= mmc_quantitize1)
+            {
+                float q = 1.f + (e.curve - mmc_quantitize1);
+                m = q * floor(0.5f + m / q);
+            }
+            if (zoneMatrix && ((d == md_sample_start) || (d == md_loop_length)))
+                m *= zone->sample_stop;
+            v += m;
+        }
+        return v;
+    }
+};
+
+const int zoneDestinations[] = {md_pitch, md_rate, md_amplitude, md_pan, md_aux_level, md_AEG_a,
+                                md_AEG_r, md_EG2_d, md_LFO1_rate, md_sample_start,
+                                md_loop_length};
+const int partDestinations[] = {md_part_amplitude, md_part_pan, md_part_aux_level,
+                                md_part_prefilter_gain};
+
+void randomEntries(Rig &rig, prng &rng, modmatrix &mm, bool zoneMatrix)
+{
+    std::vector<int> sources;
+    for (int s = 1; s < mm.get_n_sources(); s++)
+        if (rig.source(mm.get_source_RIFFID(s), zoneMatrix))
+            sources.push_back(s);
+    REQUIRE(sources.size() > 3);
+
+    auto pick = [&rng](int n) { return std::min(n - 1, (int)(rng.unipolar() * n)); };
+    mm_entry *entries = zoneMatrix ? rig.zone->mm : rig.part->mm;
+    int n = zoneMatrix ? mm_entries : mm_part_entries;
+    for (int i = 0; i < n; i++)
+    {
+        auto &e = entries[i];
+        e.source = sources[pick(sources.size())];
+        e.source2 = (rng.unipolar() < 0.5f) ? 0 : sources[pick(sources.size())];
+        e.destination = zoneMatrix ? zoneDestinations[pick(std::size(zoneDestinations))]
+                                   : partDestinations[pick(std::size(partDestinations))];
+        e.strength = rng.bipolar();
+        e.active = rng.unipolar() < 0.8f;
+        e.curve = pick(mmc_num_types);
+    }
+}
+
+void randomBases(Rig &rig, prng &rng)
+{
+    auto &z = *rig.zone;
+    z.aux[0].level = rng.bipolar() * 12.f;
+    z.aux[0].balance = rng.bipolar();
+    z.aux[1].level = rng.bipolar() * 12.f;
+    z.AEG.attack = rng.bipolar() * 4.f;
+    z.AEG.release = rng.bipolar() * 4.f;
+    z.EG2.decay = rng.bipolar() * 4.f;
+    z.LFO[0].rate = rng.bipolar() * 4.f;
+    z.sample_start = (int)(rng.unipolar() * 1000);
+    z.loop_start = (int)(rng.unipolar() * 1000);
+    z.loop_end = z.loop_start + (int)(rng.unipolar() * 50000);
+    auto &p = *rig.part;
+    p.aux[0].level = rng.bipolar() * 12.f;
+    p.aux[0].balance = rng.bipolar();
+    p.aux[1].level = rng.bipolar() * 12.f;
+    p.pfg = rng.bipolar() * 12.f;
+}
+
+// the sources which may change during a note
+void randomLiveSources(Rig &rig, prng &rng)
+{
+    rig.voice->keytrack = rng.bipolar();
+    rig.voice->AEG.output = rng.unipolar();
+    rig.voice->fgate = rng.unipolar() < 0.5f ? 0.f : 1.f;
+    rig.voice->time += 0.01f;
+    rig.control[c_pitch_bend] = rng.bipolar();
+    rig.control[c_channel_aftertouch] = rng.unipolar();
+    rig.control[c_modwheel] = rng.unipolar();
+    for (int c = 0; c < n_custom_controllers; c++)
+        rig.part->userparameter_smoothed[c] = rng.bipolar();
+}
+
+// the largest difference between the matrix and the entries, relative to the value
+template <size_t N> float worst(Rig &rig, modmatrix &mm, bool zoneMatrix, const int (&dst)[N])
+{
+    float w = 0.f;
+    for (int d : dst)
+    {
+        float e = rig.expected(zoneMatrix, mm, d);
+        w = std::max(w, std::fabs(mm.get_destination_value(d) - e) / (1.f + std::fabs(e)));
+    }
+    return w;
+}
+} // namespace
+
+TEST_CASE("Mod Matrix", "[modulation]")
+{
+    Rig rig;
+    engine_context_scope scope(&rig.ec);
+    rig.zone->sample_stop = 100000;
+    prng rng(2024);
+
+    SECTION("Compiled zone and part matrices match the entries")
+    {
+        for (int note = 0; note < 200; note++)
+        {
+            modmatrix mm, pm;
+            mm.assign(nullptr, rig.zone.get(), rig.part.get(), rig.voice.get(),
+                      rig.control.data(), rig.automation.data(), &rig.td);
+            pm.assign(nullptr, nullptr, rig.part.get(), nullptr, rig.control.data(),
+                      rig.automation.data(), &rig.td);
+            randomEntries(rig, rng, mm, true);
+            randomEntries(rig, rng, pm, false);
+            randomBases(rig, rng);
+
+            // constant for the note, the matrix folds these when compiling
+            rig.voice->fvelocity = rng.unipolar();
+            rig.voice->random = rng.unipolar();
+            rig.voice->randombp = rng.bipolar();
+            rig.voice->alternate = (note & 1) ? 1.f : -1.f;
+            rig.voice->time = 0.f;
+
+            for (int b = 0; b < 50; b++)
+            {
+                INFO("note " << note << " block " << b);
+                randomLiveSources(rig, rng);
+                if (b == 10)
+                {
+                    // amounts are read live, no recompile needed
+                    rig.zone->mm[note % mm_entries].strength = rng.bipolar();
+                    rig.part->mm[note % mm_part_entries].strength = rng.bipolar();
+                }
+                if (b == 20)
+                {
+                    // what processWrapperEvents does after a parameter edit
+                    randomBases(rig, rng);
+                    rig.ec.param_generation++;
+                }
+                if (b == 30)
+                {
+                    // and after a routing edit
+                    randomEntries(rig, rng, mm, true);
+                    randomEntries(rig, rng, pm, false);
+                    rig.ec.patch_generation++;
+                }
+
+                mm.process();
+                pm.process_part();
+                REQUIRE(worst(rig, mm, true, zoneDestinations) < 1e-5f);
+                REQUIRE(worst(rig, pm, false, partDestinations) < 1e-5f);
+            }
+        }
+    }
+
+    SECTION("Parameter edits reseed without recompiling")
+    {
+        modmatrix mm;
+        mm.assign(nullptr, rig.zone.get(), rig.part.get(), rig.voice.get(), rig.control.data(),
+                  rig.automation.data(), &rig.td);
+        for (auto &e : rig.zone->mm)
+            e.active = 0;
+        rig.zone->aux[0].level = -6.f;
+        mm.process();
+        REQUIRE(mm.get_destination_value(md_amplitude) == -6.f);
+
+        rig.zone->aux[0].level = -3.f;
+        mm.process();
+        REQUIRE(mm.get_destination_value(md_amplitude) == -6.f); // not announced yet
+
+        rig.ec.param_generation++;
+        mm.process();
+        REQUIRE(mm.get_destination_value(md_amplitude) == -3.f);
+    }
+}
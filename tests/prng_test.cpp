@@ -0,0 +1,84 @@
+/*
+** Shortcircuit XT is Free and Open Source Software
+**
+** Shortcircuit is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html; The authors of the code
+** reserve the right to re-license their contributions under the MIT license in the
+** future at the discretion of the project maintainers.
+**
+** Copyright 2004-2022 by various individuals as described by the git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/shortcircuit-xt.git
+**
+** Shortcircuit was a commercial product from 2004-2018, with copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Shortcircuit
+** open source in December 2020.
+*/
+
+#include "test_main.h"
+#include "util/prng.h"
+
+TEST_CASE("PRNG", "[util]")
+{
+    SECTION("Same seed gives the same sequence")
+    {
+        prng a(1234), b(1234), c(1235);
+        bool differs = false;
+        for (int i = 0; i < 1000; i++)
+        {
+            auto va = a.next();
+            REQUIRE(va == b.next());
+            differs |= (va != c.next());
+        }
+        REQUIRE(differs);
+
+        a.seed(99);
+        auto first = a.next();
+        a.seed(99);
+        REQUIRE(a.next() == first);
+    }
+
+    SECTION("Float ranges")
+    {
+        prng r(7);
+        double sum = 0;
+        const int n = 100000;
+        for (int i = 0; i < n; i++)
+        {
+            float u = r.unipolar();
+            REQUIRE(u >= 0.f);
+            REQUIRE(u < 1.f);
+            float b = r.bipolar();
+            REQUIRE(b >= -1.f);
+            REQUIRE(b < 1.f);
+            sum += b;
+            int k = r.below(5);
+            REQUIRE(k >= 0);
+            REQUIRE(k < 5);
+        }
+        REQUIRE(sum / n == Approx(0.0).margin(0.01));
+    }
+
+    SECTION("Block fill")
+    {
+        prng_x4 a(42), b(42);
+        alignas(16) float da[64], db[64];
+        double sum = 0;
+        for (int blk = 0; blk < 100; blk++)
+        {
+            a.fill_bipolar(da, 16);
+            b.fill_bipolar(db, 16);
+            for (int i = 0; i < 64; i++)
+            {
+                REQUIRE(da[i] == db[i]);
+                REQUIRE(da[i] >= -1.f);
+                REQUIRE(da[i] < 1.f);
+                sum += da[i];
+            }
+        }
+        REQUIRE(sum / 6400 == Approx(0.0).margin(0.05));
+        // the lanes are independent streams
+        REQUIRE(da[0] != da[1]);
+        REQUIRE(da[1] != da[2]);
+    }
+}
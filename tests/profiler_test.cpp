@@ -19,7 +19,9 @@
 #include "infrastructure/profiler.h"
 #include "infrastructure/ticks.h"
 #include <chrono>
+#include <string>
 #include <thread>
+#include <vector>
 #if WINDOWS
 #include <windows.h>
 #endif
@@ -58,3 +60,63 @@ TEST_CASE("Profiler Basic", "[profiler]")
     }
 }
 #endif
+
+struct CaptureLogger : public scxt::log::LoggingCallback
+{
+    std::vector<std::string> lines;
+    scxt::log::Level getLevel() override { return scxt::log::Level::Debug; }
+    void message(scxt::log::Level, const std::string &msg) override { lines.push_back(msg); }
+    std::string find(const std::string &prefix) const
+    {
+        for (auto &l : lines)
+            if (l.find(prefix) != std::string::npos)
+                return l;
+        return "";
+    }
+};
+
+TEST_CASE("Profiler Realtime", "[profiler]")
+{
+    SECTION("Ids are hashed at compile time")
+    {
+        static constexpr scxt::Perf::ProfileId id("voice render");
+        static_assert(id.hash == scxt::Perf::ProfileId::fnv1a("voice render"));
+        REQUIRE(id.hash == scxt::Perf::ProfileId(std::string("voice render").c_str()).hash);
+    }
+
+    SECTION("Sections from several threads are merged")
+    {
+        CaptureLogger log;
+        scxt::Perf::Profiler p(&log);
+        auto work = [&p]() {
+            for (int i = 0; i < 100; i++)
+            {
+                scxt::Perf::Profiler::Scope outer(p, "outer");
+                scxt::Perf::Profiler::Scope inner(p, "inner");
+            }
+        };
+        std::thread t1(work), t2(work);
+        work();
+        t1.join();
+        t2.join();
+
+        p.dump("threads");
+        REQUIRE(log.find("outer,").find(",300") != std::string::npos);
+        REQUIRE(log.find("inner,").find(",300") != std::string::npos);
+
+        p.reset("again");
+        log.lines.clear();
+        work();
+        p.dump("one thread");
+        REQUIRE(log.find("outer,").find(",100") != std::string::npos);
+    }
+
+    SECTION("Unbalanced exits are counted, not fatal")
+    {
+        CaptureLogger log;
+        scxt::Perf::Profiler p(&log);
+        p.exit("nothing entered");
+        p.dump("unbalanced");
+        REQUIRE(!log.find("Inconsistent").empty());
+    }
+}
@@ -0,0 +1,93 @@
+/*
+** Shortcircuit XT is Free and Open Source Software
+**
+** Shortcircuit is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html; The authors of the code
+** reserve the right to re-license their contributions under the MIT license in the
+** future at the discretion of the project maintainers.
+**
+** Copyright 2004-2022 by various individuals as described by the git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/shortcircuit-xt.git
+**
+** Shortcircuit was a commercial product from 2004-2018, with copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Shortcircuit
+** open source in December 2020.
+*/
+
+#include "test_main.h"
+#include "infrastructure/retire_list.h"
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace
+{
+struct Tracked
+{
+    std::atomic<int> &alive;
+    Tracked(std::atomic<int> &a) : alive(a) { alive++; }
+    ~Tracked() { alive--; }
+};
+} // namespace
+
+TEST_CASE("Retire List", "[threading]")
+{
+    SECTION("Objects live until their epoch is reclaimed")
+    {
+        std::atomic<int> alive{0};
+        scxt::Threading::RetireList rl(16);
+        for (uint64_t e = 0; e < 4; e++)
+            REQUIRE(rl.retire(std::make_shared<Tracked>(alive), e));
+        REQUIRE(alive == 4);
+        REQUIRE(rl.pending() == 4);
+
+        REQUIRE(rl.reclaim(0) == 0);
+        REQUIRE(rl.reclaim(2) == 2);
+        REQUIRE(alive == 2);
+        REQUIRE(rl.reclaim(UINT64_MAX) == 2);
+        REQUIRE(alive == 0);
+        REQUIRE(rl.pending() == 0);
+    }
+    SECTION("A full list releases in place and counts it")
+    {
+        std::atomic<int> alive{0};
+        scxt::Threading::RetireList rl(4);
+        for (int i = 0; i < 4; i++)
+            REQUIRE(rl.retire(std::make_shared<Tracked>(alive), 0));
+        REQUIRE(!rl.retire(std::make_shared<Tracked>(alive), 0));
+        REQUIRE(alive == 4);
+        REQUIRE(rl.overflows() == 1);
+        rl.reclaim(1);
+        REQUIRE(rl.retire(std::make_shared<Tracked>(alive), 0));
+        REQUIRE(rl.overflows() == 1);
+    }
+    SECTION("Concurrent producers and a reclaimer lose nothing")
+    {
+        std::atomic<int> alive{0};
+        std::atomic<int> overflowed{0};
+        {
+            scxt::Threading::RetireList rl(64);
+            std::atomic<bool> done{false};
+            std::thread reclaimer([&]() {
+                while (!done)
+                    rl.reclaim(UINT64_MAX);
+            });
+            std::vector<std::thread> producers;
+            for (int t = 0; t < 4; t++)
+                producers.emplace_back([&]() {
+                    for (int i = 0; i < 5000; i++)
+                        if (!rl.retire(std::make_shared<Tracked>(alive), i))
+                            overflowed++;
+                });
+            for (auto &p : producers)
+                p.join();
+            done = true;
+            reclaimer.join();
+            REQUIRE(rl.overflows() == (uint32_t)overflowed.load());
+            REQUIRE(alive == (int)rl.pending());
+        }
+        REQUIRE(alive == 0);
+    }
+}
@@ -0,0 +1,157 @@
+/*
+** Shortcircuit XT is Free and Open Source Software
+**
+** Shortcircuit is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html; The authors of the code
+** reserve the right to re-license their contributions under the MIT license in the
+** future at the discretion of the project maintainers.
+**
+** Copyright 2004-2022 by various individuals as described by the git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/shortcircuit-xt.git
+**
+** Shortcircuit was a commercial product from 2004-2018, with copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Shortcircuit
+** open source in December 2020.
+*/
+
+#include "test_main.h"
+#include "infrastructure/trace.h"
+
+#include <atomic>
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace scxt::Trace;
+
+static int count(const std::string &s, const std::string &what)
+{
+    int n = 0;
+    for (auto p = s.find(what); p != std::string::npos; p = s.find(what, p + 1))
+        n++;
+    return n;
+}
+
+TEST_CASE("Stage Trace", "[perf]")
+{
+    SECTION("Nothing is recorded while stopped")
+    {
+        start(64);
+        stop();
+        {
+            Span s(Stage::Voice, 3);
+        }
+        std::ostringstream os;
+        REQUIRE(writeChromeTrace(os));
+        REQUIRE(count(os.str(), "\"ph\":\"X\"") == 0);
+    }
+
+    SECTION("Spans and laps from several threads")
+    {
+        start(64);
+        auto work = [](int id) {
+            Span s(Stage::Voice, id);
+            Laps l(id);
+            l.mark(Stage::VoiceEnvelopes);
+            l.mark(Stage::VoiceGenerator);
+        };
+        work(1);
+        std::thread t(work, 2);
+        t.join();
+        stop();
+
+        std::ostringstream os;
+        REQUIRE(writeChromeTrace(os));
+        auto s = os.str();
+        REQUIRE(count(s, "\"ph\":\"X\"") == 6);
+        REQUIRE(count(s, "\"name\":\"voice\"") == 2);
+        REQUIRE(count(s, "\"name\":\"voice.generator\"") == 2);
+        REQUIRE(count(s, "\"id\":2") == 3);
+        REQUIRE(s.front() == '{');
+    }
+
+    SECTION("Rings keep the newest events")
+    {
+        start(64);
+        for (int i = 0; i < 1000; i++)
+        {
+            Span s(Stage::Effect, i & 0xff);
+        }
+        stop();
+
+        std::ostringstream os;
+        REQUIRE(writeChromeTrace(os));
+        auto s = os.str();
+        // the capacity was fixed by the first start() of the run
+        REQUIRE(count(s, "\"ph\":\"X\"") == 64);
+        REQUIRE(count(s, "\"id\":231}") == 1);
+    }
+
+    SECTION("Rings are given back when a thread exits")
+    {
+        start(64);
+        // more threads over the run than rings, but one at a time
+        for (int i = 0; i < maxThreads * 3; i++)
+        {
+            std::thread t([i]() { Span s(Stage::Part, i); });
+            t.join();
+        }
+        stop();
+
+        std::ostringstream os;
+        REQUIRE(writeChromeTrace(os));
+        REQUIRE(count(os.str(), "\"ph\":\"X\"") == maxThreads * 3);
+        REQUIRE(count(os.str(), "\"droppedEvents\":0}") == 1);
+        REQUIRE(dropped() == 0);
+    }
+
+    SECTION("Events from threads beyond the rings are counted")
+    {
+        start(64);
+        {
+            Span s(Stage::EngineBlock, 0); // this thread holds a ring too
+        }
+        std::atomic<int> pushed{0};
+        std::vector<std::thread> threads;
+        for (int i = 0; i < maxThreads; i++)
+            threads.emplace_back([&pushed, i]() {
+                {
+                    Span s(Stage::Part, i);
+                }
+                pushed++;
+                while (pushed.load() < maxThreads)
+                    std::this_thread::yield();
+            });
+        for (auto &t : threads)
+            t.join();
+        stop();
+
+        double seconds[(int)Stage::numStages];
+        REQUIRE(stageTotals(seconds) == 1);
+        std::ostringstream os;
+        REQUIRE(writeChromeTrace(os));
+        REQUIRE(count(os.str(), "\"ph\":\"X\"") == maxThreads);
+        REQUIRE(count(os.str(), "\"droppedEvents\":1}") == 1);
+    }
+
+    SECTION("Stage totals add up the held events")
+    {
+        start(64);
+        {
+            Span s(Stage::Voice, 1);
+            Laps l(1);
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            l.mark(Stage::VoiceGenerator);
+        }
+        stop();
+
+        double seconds[(int)Stage::numStages];
+        stageTotals(seconds);
+        REQUIRE(seconds[(int)Stage::VoiceGenerator] >= 0.004);
+        REQUIRE(seconds[(int)Stage::Voice] >= seconds[(int)Stage::VoiceGenerator]);
+        REQUIRE(seconds[(int)Stage::Effect] == 0);
+    }
+}
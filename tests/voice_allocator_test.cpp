@@ -0,0 +1,88 @@
+/*
+** Shortcircuit XT is Free and Open Source Software
+**
+** Shortcircuit is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html; The authors of the code
+** reserve the right to re-license their contributions under the MIT license in the
+** future at the discretion of the project maintainers.
+**
+** Copyright 2004-2022 by various individuals as described by the git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/shortcircuit-xt.git
+**
+** Shortcircuit was a commercial product from 2004-2018, with copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Shortcircuit
+** open source in December 2020.
+*/
+
+#include "test_main.h"
+#include "voice_allocator.h"
+
+#include <set>
+
+TEST_CASE("Voice Allocator", "[voices]")
+{
+    SECTION("Allocate and free")
+    {
+        voice_allocator va;
+        REQUIRE(va.active_count() == 0);
+        REQUIRE(va.peek_free() == 0);
+
+        for (int i = 0; i < MAX_VOICES; i++)
+        {
+            int v = va.peek_free();
+            REQUIRE(v == i);
+            va.activate(v);
+        }
+        REQUIRE(va.active_count() == MAX_VOICES);
+        REQUIRE(va.peek_free() == -1);
+
+        va.deactivate(17);
+        REQUIRE(!va.is_active(17));
+        REQUIRE(va.active_count() == MAX_VOICES - 1);
+        REQUIRE(va.peek_free() == 17);
+
+        std::set<int> seen;
+        for (int i = 0; i < va.active_count(); i++)
+            seen.insert(va.active_voice(i));
+        REQUIRE(seen.size() == MAX_VOICES - 1);
+        REQUIRE(seen.count(17) == 0);
+    }
+
+    SECTION("Steal order")
+    {
+        voice_allocator va;
+        for (int i = 0; i < 8; i++)
+            va.activate(va.peek_free());
+
+        // oldest first
+        REQUIRE(va.steal_candidate() == 0);
+
+        // released voices go before held ones, oldest released first
+        va.mark_released(5);
+        va.mark_released(3);
+        REQUIRE(va.steal_candidate() == 3);
+
+        // killed voices are no longer candidates
+        va.mark_killed(3);
+        REQUIRE(va.steal_candidate() == 5);
+        va.mark_killed(5);
+        REQUIRE(va.steal_candidate() == 0);
+
+        va.deactivate(0);
+        REQUIRE(va.steal_candidate() == 1);
+
+        // a reused voice is the youngest
+        va.activate(va.peek_free());
+        for (int i = 1; i < 8; i++)
+        {
+            if (i == 3 || i == 5)
+                continue;
+            REQUIRE(va.steal_candidate() == i);
+            va.mark_killed(i);
+        }
+        REQUIRE(va.steal_candidate() == 0);
+        va.mark_killed(0);
+        REQUIRE(va.steal_candidate() == -1);
+    }
+}
@@ -0,0 +1,73 @@
+/*
+** Shortcircuit XT is Free and Open Source Software
+**
+** Shortcircuit is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html; The authors of the code
+** reserve the right to re-license their contributions under the MIT license in the
+** future at the discretion of the project maintainers.
+**
+** Copyright 2004-2022 by various individuals as described by the git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/shortcircuit-xt.git
+**
+** Shortcircuit was a commercial product from 2004-2018, with copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Shortcircuit
+** open source in December 2020.
+*/
+
+#include "test_main.h"
+#include "infrastructure/worker_pool.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace
+{
+struct Counts
+{
+    std::vector<std::atomic<int>> hits;
+    Counts(int n) : hits(n) {}
+};
+void countItem(void *ctx, int item, int worker) { ((Counts *)ctx)->hits[item]++; }
+} // namespace
+
+TEST_CASE("Worker Pool", "[threading]")
+{
+    SECTION("Every item runs exactly once")
+    {
+        scxt::Threading::WorkerPool pool(4);
+        REQUIRE(pool.size() == 4);
+
+        for (int n : {1, 2, 3, 7, 64, 255})
+        {
+            Counts c(n);
+            for (int rep = 0; rep < 100; rep++)
+                pool.run(n, countItem, &c);
+            for (int i = 0; i < n; i++)
+                REQUIRE(c.hits[i] == 100);
+        }
+    }
+    SECTION("Workers join whether spinning or asleep")
+    {
+        scxt::Threading::WorkerPool pool(3);
+        Counts c(32);
+        for (int rep = 0; rep < 2000; rep++)
+        {
+            // every so often leave long enough for the workers to fall asleep
+            if (rep % 100 == 0)
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            pool.run(32, countItem, &c);
+        }
+        for (int i = 0; i < 32; i++)
+            REQUIRE(c.hits[i] == 2000);
+    }
+    SECTION("Single worker runs inline")
+    {
+        scxt::Threading::WorkerPool pool(1);
+        Counts c(10);
+        pool.run(10, countItem, &c);
+        for (int i = 0; i < 10; i++)
+            REQUIRE(c.hits[i] == 1);
+    }
+}
@@ -110,6 +110,7 @@ TEST_CASE("Zones from 3 Wavs", "[zones]")
                 int newG, newZ;
                 REQUIRE(sc3->load_file(item, &newG, &newZ));
             }
+            sc3->wait_for_background();
 
             for (auto i = 0; i < MAX_ZONES; ++i)
             {
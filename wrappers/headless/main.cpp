@@ -15,28 +15,348 @@
 ** open source in December 2020.
 */
 
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "sampler.h"
+#include "generator.h"
 #include "version.h"
 #include "infrastructure/logfile.h"
+#include "infrastructure/rt_guard.h"
+#include "infrastructure/trace.h"
+#include "midi_file.h"
+#include "wav_writer.h"
 
 class HeadlessLogger : public scxt::log::LoggingCallback
 {
-    scxt::log::Level getLevel() override { return scxt::log::Level::Debug; }
+  public:
+    scxt::log::Level level{scxt::log::Level::Debug};
+    scxt::log::Level getLevel() override { return level; }
     void message(scxt::log::Level lev, const std::string &msg) override
     {
         std::cout << scxt::log::getShortLevelStr(lev) << msg << std::endl;
     }
 };
 
+struct RenderOptions
+{
+    std::string patch, midi, out, trace;
+    int samplerate{48000};
+    int outputs{1};
+    double tail{2.0};
+    uint64_t seed{0};
+    int interpolation{-1}; // a GeneratorInterpolation, -1 keeps the user default
+    bool mipmaps{false};
+    bool resample{false};
+    bool stems{false};
+};
+
+static int parseInterpolation(const std::string &s)
+{
+    static const char *names[GI_NumInterpolations] = {"linear", "cubic", "sinc16", "sinc32",
+                                                      "sinc64"};
+    for (int i = 0; i < GI_NumInterpolations; i++)
+        if (s == names[i])
+            return i;
+    return -1;
+}
+
+static void usage()
+{
+    std::cout
+        << "usage: sc3-headless\n"
+        << "           load the test harpsichord and print the engine state\n"
+        << "       sc3-headless [options] <patch or multi> <midi file> <out.wav>\n"
+        << "           render the MIDI file offline, as fast as possible\n"
+        << "options:\n"
+        << "  -r, --samplerate <hz>   render sample rate (48000)\n"
+        << "  -b, --block-size <n>    fail unless the engine was built with this block size\n"
+        << "                          (it is fixed per build, see SCXT_BLOCK_SIZE)\n"
+        << "  -o, --outputs <n>       stereo outputs to render, 1 to " << MAX_OUTPUTS << " (1)\n"
+        << "  -t, --tail <seconds>    keep rendering after the last event (2)\n"
+        << "      --seed <n>          seed for the random sources, same seed same render (0)\n"
+        << "  -i, --interpolation <linear|cubic|sinc16|sinc32|sinc64>\n"
+        << "                          interpolation for zones set to default (user default)\n"
+        << "  -m, --mipmaps           build band limited copies of the samples for high pitches\n"
+        << "      --resample          resample the samples to the render rate, so untransposed\n"
+        << "                          zones without a loop play them back as they are\n"
+        << "      --trace <file.json> write a per stage trace of the render, for\n"
+        << "                          chrome://tracing or ui.perfetto.dev\n"
+        << "  -s, --stems             one stereo file per output, out_1.wav, out_2.wav, ...\n"
+        << "                          instead of one multichannel file" << std::endl;
+}
+
+static bool parseArgs(int argc, char **argv, RenderOptions &o)
+{
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string a = argv[i];
+        auto value = [&]() -> const char * { return (i + 1 < argc) ? argv[++i] : nullptr; };
+        if ((a == "-h") || (a == "--help"))
+        {
+            return false;
+        }
+        else if ((a == "-r") || (a == "--samplerate"))
+        {
+            auto v = value();
+            if (!v || ((o.samplerate = atoi(v)) < 8000))
+                return false;
+        }
+        else if ((a == "-b") || (a == "--block-size"))
+        {
+            auto v = value();
+            if (!v)
+                return false;
+            if (atoi(v) != (int)BLOCK_SIZE)
+            {
+                std::cout << "this build uses a block size of " << BLOCK_SIZE
+                          << ", rebuild with -DSCXT_BLOCK_SIZE=" << v << std::endl;
+                return false;
+            }
+        }
+        else if ((a == "-o") || (a == "--outputs"))
+        {
+            auto v = value();
+            if (!v || ((o.outputs = atoi(v)) < 1) || (o.outputs > (int)MAX_OUTPUTS))
+                return false;
+        }
+        else if ((a == "-t") || (a == "--tail"))
+        {
+            auto v = value();
+            if (!v || ((o.tail = atof(v)) < 0))
+                return false;
+        }
+        else if (a == "--trace")
+        {
+            auto v = value();
+            if (!v)
+                return false;
+            o.trace = v;
+        }
+        else if ((a == "-i") || (a == "--interpolation"))
+        {
+            auto v = value();
+            if (!v || ((o.interpolation = parseInterpolation(v)) < 0))
+                return false;
+        }
+        else if ((a == "-m") || (a == "--mipmaps"))
+        {
+            o.mipmaps = true;
+        }
+        else if (a == "--resample")
+        {
+            o.resample = true;
+        }
+        else if (a == "--seed")
+        {
+            auto v = value();
+            if (!v)
+                return false;
+            o.seed = strtoull(v, nullptr, 0);
+        }
+        else if ((a == "-s") || (a == "--stems"))
+        {
+            o.stems = true;
+        }
+        else
+        {
+            positional.push_back(a);
+        }
+    }
+    if (positional.size() != 3)
+        return false;
+    o.patch = positional[0];
+    o.midi = positional[1];
+    o.out = positional[2];
+    return true;
+}
+
+static void dispatch(sampler &sc3, const scxt::headless::MidiEvent &e, int offset)
+{
+    char ch = e.status & 0xf;
+    switch (e.status & 0xf0)
+    {
+    case 0x90:
+        if (e.data2)
+        {
+            sc3.PlayNote(ch, e.data1, e.data2, false, 0, offset);
+            break;
+        }
+        // note on with velocity 0 is a note off
+        [[fallthrough]];
+    case 0x80:
+        sc3.ReleaseNote(ch, e.data1, e.data2, offset);
+        break;
+    case 0xa0:
+    case 0xd0:
+        sc3.ChannelAftertouch(ch, (e.status & 0xf0) == 0xa0 ? e.data2 : e.data1);
+        break;
+    case 0xb0:
+        sc3.ChannelController(ch, e.data1, e.data2);
+        break;
+    case 0xe0:
+        sc3.PitchBend(ch, ((e.data2 << 7) | e.data1) - 8192);
+        break;
+    }
+}
+
+static std::string stemName(const std::string &out, int i)
+{
+    auto dot = out.rfind('.');
+    auto slash = out.find_last_of("/\\");
+    if ((dot == std::string::npos) || ((slash != std::string::npos) && (dot < slash)))
+        dot = out.size();
+    return out.substr(0, dot) + "_" + std::to_string(i + 1) + out.substr(dot);
+}
+
+static int render(const RenderOptions &o, HeadlessLogger &logger)
+{
+    std::vector<scxt::headless::MidiEvent> events;
+    std::string error;
+    if (!scxt::headless::readMidiFile(o.midi, events, error))
+    {
+        std::cout << "# " << error << std::endl;
+        return 1;
+    }
+
+    logger.level = scxt::log::Level::Warning;
+    auto sc3 = std::make_unique<sampler>(nullptr, o.outputs, nullptr, &logger);
+    sc3->set_samplerate(o.samplerate);
+    sc3->set_random_seed(o.seed);
+    // an offline render is never over budget in the realtime sense, so never draft
+    sc3->set_draft_on_overload(false);
+    if (o.interpolation >= 0)
+        sc3->set_interpolation(o.interpolation);
+    if (o.mipmaps)
+        sc3->set_build_mips(true);
+    if (o.resample)
+        sc3->set_resample_on_load(true);
+    if (!sc3->load_file(string_to_path(o.patch)))
+    {
+        std::cout << "# Couldn't load " << o.patch << std::endl;
+        return 1;
+    }
+    // mip maps and rate conversions requested by the load (or the user default) are in before the first note
+    sc3->wait_for_background();
+
+    std::vector<std::unique_ptr<scxt::headless::WavWriter>> writers;
+    for (int w = 0; w < (o.stems ? o.outputs : 1); w++)
+    {
+        auto fn = o.stems ? stemName(o.out, w) : o.out;
+        writers.push_back(std::make_unique<scxt::headless::WavWriter>());
+        if (!writers.back()->open(fn, o.stems ? 2 : (o.outputs << 1), o.samplerate))
+        {
+            std::cout << "# Couldn't open " << fn << " for writing" << std::endl;
+            return 1;
+        }
+    }
+
+    double length = (events.empty() ? 0.0 : events.back().seconds) + o.tail;
+    auto totalSamples = (int64_t)(length * o.samplerate);
+
+    std::cout << "# Rendering " << o.midi << " (" << events.size() << " events, " << std::fixed
+              << std::setprecision(2) << length << "s) at " << o.samplerate << "Hz, block size "
+              << BLOCK_SIZE << std::endl;
+
+    // offline there is no need to run a block behind like the plugin does. every event is
+    // handed to the engine before the block it falls in, at its offset within that block
+    if (!o.trace.empty())
+        scxt::Trace::start();
+    auto start = std::chrono::steady_clock::now();
+    size_t next = 0;
+    const float *channels[MAX_OUTPUTS << 1];
+    for (int64_t pos = 0; pos < totalSamples; pos += BLOCK_SIZE)
+    {
+        {
+            // what a host would do on its audio thread, see infrastructure/rt_guard.h
+            scxt::Realtime::Scope rtScope;
+            while ((next < events.size()) &&
+                   ((int64_t)(events[next].seconds * o.samplerate) < pos + (int64_t)BLOCK_SIZE))
+            {
+                auto at = (int64_t)(events[next].seconds * o.samplerate);
+                dispatch(*sc3, events[next], (int)std::max((int64_t)0, at - pos));
+                next++;
+            }
+
+            sc3->process_audio();
+        }
+
+        int n = (int)std::min((int64_t)BLOCK_SIZE, totalSamples - pos);
+        for (int c = 0; c < (o.outputs << 1); c++)
+            channels[c] = sc3->output[c];
+        if (o.stems)
+            for (int w = 0; w < o.outputs; w++)
+                writers[w]->write(&channels[w << 1], n);
+        else
+            writers[0]->write(channels, n);
+    }
+    auto elapsed =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (!o.trace.empty())
+    {
+        // the rings keep the newest events, so a long render only has its end
+        scxt::Trace::stop();
+        std::ofstream tf(o.trace);
+        if (!scxt::Trace::writeChromeTrace(tf))
+            std::cout << "# Error writing trace " << o.trace << std::endl;
+    }
+
+    bool ok = true;
+    for (auto &w : writers)
+        ok = w->close() && ok;
+    if (!ok)
+    {
+        std::cout << "# Error writing " << o.out << std::endl;
+        return 1;
+    }
+
+    std::cout << "# Rendered " << length << "s in " << std::setprecision(3) << elapsed
+              << "s, " << std::setprecision(1) << (elapsed > 0 ? length / elapsed : 0.0)
+              << "x realtime" << std::endl;
+
+    // the same numbers the plugin shows in its debug panel, against the realtime block budget
+    auto &ls = sc3->get_load_meter().stats();
+    double mean = ls.blocks ? ls.totalNs / (ls.blocks * ls.budgetNs) : 0.0;
+    std::cout << "# DSP load " << mean * 100.0 << "% mean, " << ls.worst * 100.f
+              << "% worst block, " << ls.overBudget << " of " << ls.blocks
+              << " blocks over budget" << std::endl;
+    std::cout << "# Block load histogram:";
+    for (int b = 0; b < scxt::Perf::LoadMeter::histogramBuckets; b++)
+    {
+        if (b < 10)
+            std::cout << " " << b * 10 << "%:" << ls.histogram[b];
+        else
+            std::cout << ((b == 10) ? " 100%:" : " 150%+:") << ls.histogram[b];
+    }
+    std::cout << std::endl;
+    return 0;
+}
+
 int main(int argc, char **argv)
 {
     HeadlessLogger logger;
     std::cout << "# Shortcircuit XT Headless. " << scxt::build::FullVersionStr << std::endl;
 
+    if (argc > 1)
+    {
+        RenderOptions options;
+        if (!parseArgs(argc, argv, options))
+        {
+            usage();
+            return 1;
+        }
+        return render(options, logger);
+    }
+
     auto sc3 = std::make_unique<sampler>(nullptr, 2, nullptr, &logger);
     sc3->set_samplerate(48000);
     if (!sc3)
@@ -0,0 +1,217 @@
+/*
+** Shortcircuit XT is Free and Open Source Software
+**
+** Shortcircuit is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html; The authors of the code
+** reserve the right to re-license their contributions under the MIT license in the
+** future at the discretion of the project maintainers.
+**
+** Copyright 2004-2022 by various individuals as described by the git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/shortcircuit-xt.git
+**
+** Shortcircuit was a commercial product from 2004-2018, with copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Shortcircuit
+** open source in December 2020.
+*/
+
+#include "midi_file.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+namespace scxt
+{
+namespace headless
+{
+namespace
+{
+struct Reader
+{
+    const std::vector<uint8_t> &data;
+    size_t pos;
+    size_t end;
+    bool overrun{false}; // something was read past the end of the chunk
+
+    bool atEnd() const { return pos >= end; }
+    uint8_t byte()
+    {
+        if (pos < end)
+            return data[pos++];
+        overrun = true;
+        return 0;
+    }
+    uint32_t be(int n)
+    {
+        uint32_t v = 0;
+        for (int i = 0; i < n; i++)
+            v = (v << 8) | byte();
+        return v;
+    }
+    uint32_t vlq()
+    {
+        uint32_t v = 0;
+        for (int i = 0; i < 4; i++)
+        {
+            auto b = byte();
+            v = (v << 7) | (b & 0x7f);
+            if (!(b & 0x80))
+                break;
+        }
+        return v;
+    }
+};
+
+struct TickEvent
+{
+    uint64_t tick;
+    uint32_t order;
+    uint32_t tempo; // microseconds per quarter note, 0 for channel events
+    uint8_t status, data1, data2;
+};
+
+int channelMessageDataBytes(uint8_t status)
+{
+    auto kind = status & 0xf0;
+    return ((kind == 0xc0) || (kind == 0xd0)) ? 1 : 2;
+}
+} // namespace
+
+bool readMidiFile(const std::string &filename, std::vector<MidiEvent> &events, std::string &error)
+{
+    std::ifstream in(filename, std::ios::binary);
+    if (!in)
+    {
+        error = "can't open " + filename;
+        return false;
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(in)),
+                              std::istreambuf_iterator<char>());
+
+    Reader hdr{data, 0, data.size()};
+    if ((data.size() < 14) || (hdr.be(4) != 0x4d546864) || (hdr.be(4) < 6)) // 'MThd'
+    {
+        error = filename + " is not a standard MIDI file";
+        return false;
+    }
+    hdr.be(2); // format, all of them are merged the same way
+    auto tracks = hdr.be(2);
+    auto division = hdr.be(2);
+    hdr.pos = 8 + ((data[4] << 24) | (data[5] << 16) | (data[6] << 8) | data[7]);
+
+    if (division == 0)
+    {
+        error = filename + " has no time division";
+        return false;
+    }
+
+    std::vector<TickEvent> ticked;
+    uint32_t order = 0;
+    for (uint32_t t = 0; (t < tracks) && (hdr.pos + 8 <= data.size()); t++)
+    {
+        auto id = hdr.be(4);
+        auto length = hdr.be(4);
+        Reader trk{data, hdr.pos, std::min(data.size(), hdr.pos + length)};
+        hdr.pos += length;
+        if (id != 0x4d54726b) // 'MTrk', unknown chunks are skipped
+            continue;
+
+        uint64_t tick = 0;
+        uint8_t running = 0;
+        while (!trk.atEnd())
+        {
+            tick += trk.vlq();
+            uint8_t status = trk.byte();
+            uint8_t first = 0;
+            bool haveFirst = false;
+            if (status < 0x80)
+            {
+                // running status, the byte we just read is the first data byte
+                first = status;
+                haveFirst = true;
+                status = running;
+                if (!status)
+                    break;
+            }
+
+            if (status >= 0xf0)
+                running = 0; // sysex and meta events cancel running status
+
+            if (status == 0xff)
+            {
+                auto type = trk.byte();
+                auto len = trk.vlq();
+                if ((type == 0x51) && (len == 3))
+                {
+                    TickEvent e{tick, order++, trk.be(3), 0, 0, 0};
+                    ticked.push_back(e);
+                }
+                else
+                {
+                    trk.pos += len;
+                }
+                if (type == 0x2f)
+                    break;
+            }
+            else if ((status == 0xf0) || (status == 0xf7))
+            {
+                trk.pos += trk.vlq();
+            }
+            else if (status >= 0xf0)
+            {
+                // system common/realtime messages don't belong in a file, give up on the track
+                break;
+            }
+            else
+            {
+                running = status;
+                TickEvent e{tick, order++, 0, status, 0, 0};
+                e.data1 = (haveFirst ? first : trk.byte()) & 0x7f;
+                if (channelMessageDataBytes(status) == 2)
+                    e.data2 = trk.byte() & 0x7f;
+                if (trk.overrun)
+                    break; // cut short by a truncated chunk
+                ticked.push_back(e);
+            }
+        }
+    }
+
+    std::sort(ticked.begin(), ticked.end(), [](const TickEvent &a, const TickEvent &b) {
+        return (a.tick != b.tick) ? (a.tick < b.tick) : (a.order < b.order);
+    });
+
+    // SMPTE divisions give a fixed tick length, metrical ones follow the tempo map
+    bool smpte = division & 0x8000;
+    double secondsPerTick;
+    if (smpte)
+    {
+        int fps = -(int8_t)(division >> 8);
+        int ticksPerFrame = division & 0xff;
+        secondsPerTick = 1.0 / ((fps == 29 ? 29.97 : fps) * ticksPerFrame);
+    }
+    else
+    {
+        secondsPerTick = 0.5 / division; // 120 bpm until told otherwise
+    }
+
+    events.clear();
+    uint64_t lastTick = 0;
+    double seconds = 0;
+    for (auto &e : ticked)
+    {
+        seconds += (double)(e.tick - lastTick) * secondsPerTick;
+        lastTick = e.tick;
+        if (e.tempo)
+        {
+            if (!smpte)
+                secondsPerTick = e.tempo * 1e-6 / division;
+            continue;
+        }
+        events.push_back({seconds, e.status, e.data1, e.data2});
+    }
+    return true;
+}
+
+} // namespace headless
+} // namespace scxt
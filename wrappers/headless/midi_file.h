@@ -0,0 +1,50 @@
+/*
+** Shortcircuit XT is Free and Open Source Software
+**
+** Shortcircuit is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html; The authors of the code
+** reserve the right to re-license their contributions under the MIT license in the
+** future at the discretion of the project maintainers.
+**
+** Copyright 2004-2022 by various individuals as described by the git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/shortcircuit-xt.git
+**
+** Shortcircuit was a commercial product from 2004-2018, with copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Shortcircuit
+** open source in December 2020.
+*/
+
+#ifndef SHORTCIRCUIT_HEADLESS_MIDI_FILE_H
+#define SHORTCIRCUIT_HEADLESS_MIDI_FILE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace scxt
+{
+namespace headless
+{
+/*
+ * A channel message from a standard MIDI file, with its time resolved through the tempo map.
+ * Meta and sysex events are dropped since the engine has no use for them.
+ */
+struct MidiEvent
+{
+    double seconds;
+    uint8_t status, data1, data2;
+};
+
+/*
+ * Reads a format 0, 1 or 2 standard MIDI file. All tracks are merged into one list sorted by
+ * time; events at the same time keep their file order. Returns false and fills error if the
+ * file can't be read or isn't a MIDI file.
+ */
+bool readMidiFile(const std::string &filename, std::vector<MidiEvent> &events,
+                  std::string &error);
+
+} // namespace headless
+} // namespace scxt
+
+#endif // SHORTCIRCUIT_HEADLESS_MIDI_FILE_H
@@ -0,0 +1,124 @@
+/*
+** Shortcircuit XT is Free and Open Source Software
+**
+** Shortcircuit is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html; The authors of the code
+** reserve the right to re-license their contributions under the MIT license in the
+** future at the discretion of the project maintainers.
+**
+** Copyright 2004-2022 by various individuals as described by the git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/shortcircuit-xt.git
+**
+** Shortcircuit was a commercial product from 2004-2018, with copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Shortcircuit
+** open source in December 2020.
+*/
+
+#include "wav_writer.h"
+
+namespace scxt
+{
+namespace headless
+{
+namespace
+{
+void put16(std::ofstream &o, uint16_t v)
+{
+    char b[2] = {(char)(v & 0xff), (char)(v >> 8)};
+    o.write(b, 2);
+}
+void put32(std::ofstream &o, uint32_t v)
+{
+    char b[4] = {(char)(v & 0xff), (char)((v >> 8) & 0xff), (char)((v >> 16) & 0xff),
+                 (char)(v >> 24)};
+    o.write(b, 4);
+}
+
+const uint16_t WAVE_FORMAT_IEEE_FLOAT = 3;
+const uint16_t WAVE_FORMAT_EXTENSIBLE = 0xfffe;
+// KSDATAFORMAT_SUBTYPE_IEEE_FLOAT, following the format tag
+const char float_subformat_tail[14] = {0x00, 0x00, 0x00, 0x00, 0x10, 0x00, (char)0x80,
+                                       0x00, 0x00, (char)0xaa, 0x00, 0x38, (char)0x9b, 0x71};
+} // namespace
+
+bool WavWriter::open(const std::string &filename, int channels, int samplerate)
+{
+    out.open(filename, std::ios::binary | std::ios::trunc);
+    if (!out)
+        return false;
+    numChannels = channels;
+    frames = 0;
+
+    bool extensible = channels > 2;
+    uint16_t blockAlign = channels * sizeof(float);
+
+    out.write("RIFF", 4);
+    put32(out, 0); // patched by close()
+    out.write("WAVE", 4);
+
+    out.write("fmt ", 4);
+    put32(out, extensible ? 40 : 18);
+    put16(out, extensible ? WAVE_FORMAT_EXTENSIBLE : WAVE_FORMAT_IEEE_FLOAT);
+    put16(out, channels);
+    put32(out, samplerate);
+    put32(out, samplerate * blockAlign);
+    put16(out, blockAlign);
+    put16(out, 32);
+    if (extensible)
+    {
+        put16(out, 22);
+        put16(out, 32); // valid bits
+        put32(out, 0);  // no speaker positions, these are separate outputs
+        put16(out, WAVE_FORMAT_IEEE_FLOAT);
+        out.write(float_subformat_tail, sizeof(float_subformat_tail));
+    }
+    else
+    {
+        put16(out, 0);
+    }
+
+    out.write("fact", 4);
+    put32(out, 4);
+    put32(out, 0); // patched by close()
+
+    out.write("data", 4);
+    put32(out, 0); // patched by close()
+    dataStart = out.tellp();
+    return (bool)out;
+}
+
+void WavWriter::write(const float *const *channels, int n)
+{
+    interleaved.resize(n * numChannels);
+    for (int c = 0; c < numChannels; c++)
+        for (int i = 0; i < n; i++)
+            interleaved[i * numChannels + c] = channels[c][i];
+
+    // WAV is little endian, as is everything we build for
+    out.write((const char *)interleaved.data(), interleaved.size() * sizeof(float));
+    frames += n;
+}
+
+bool WavWriter::close()
+{
+    if (!out.is_open())
+        return true;
+
+    uint64_t dataBytes = frames * numChannels * sizeof(float);
+    auto end = out.tellp();
+
+    out.seekp(4);
+    put32(out, (uint32_t)((uint64_t)end - 8));
+    out.seekp(dataStart - std::streamoff(12));
+    put32(out, (uint32_t)frames);
+    out.seekp(dataStart - std::streamoff(4));
+    put32(out, (uint32_t)dataBytes);
+
+    bool ok = (bool)out;
+    out.close();
+    return ok;
+}
+
+} // namespace headless
+} // namespace scxt
@@ -0,0 +1,58 @@
+/*
+** Shortcircuit XT is Free and Open Source Software
+**
+** Shortcircuit is made available under the Gnu General Public License, v3.0
+** https://www.gnu.org/licenses/gpl-3.0.en.html; The authors of the code
+** reserve the right to re-license their contributions under the MIT license in the
+** future at the discretion of the project maintainers.
+**
+** Copyright 2004-2022 by various individuals as described by the git transaction log
+**
+** All source at: https://github.com/surge-synthesizer/shortcircuit-xt.git
+**
+** Shortcircuit was a commercial product from 2004-2018, with copyright and ownership
+** in that period held by Claes Johanson at Vember Audio. Claes made Shortcircuit
+** open source in December 2020.
+*/
+
+#ifndef SHORTCIRCUIT_HEADLESS_WAV_WRITER_H
+#define SHORTCIRCUIT_HEADLESS_WAV_WRITER_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace scxt
+{
+namespace headless
+{
+/*
+ * Streams 32 bit float WAV files. Frames are appended block by block from separate channel
+ * buffers and the header sizes are patched in by close(). More than two channels are written
+ * as WAVE_FORMAT_EXTENSIBLE so the usual tools accept them.
+ */
+class WavWriter
+{
+  public:
+    WavWriter() = default;
+    ~WavWriter() { close(); }
+
+    bool open(const std::string &filename, int channels, int samplerate);
+    void write(const float *const *channels, int frames);
+    bool close();
+
+    uint64_t framesWritten() const { return frames; }
+
+  private:
+    std::ofstream out;
+    int numChannels{0};
+    uint64_t frames{0};
+    std::streampos dataStart;
+    std::vector<float> interleaved;
+};
+
+} // namespace headless
+} // namespace scxt
+
+#endif // SHORTCIRCUIT_HEADLESS_WAV_WRITER_H
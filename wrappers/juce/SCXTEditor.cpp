@@ -23,6 +23,7 @@
 #include "version.h"
 
 #include <unordered_map>
+#include <fmt/core.h>
 
 #include "SCXTLayoutValues.h"
 
@@ -276,6 +277,23 @@ void SCXTEditor::refreshSamplerTextViewInThreadUnsafeWay()
     debugWindow->setSamplerText(audioProcessor.sc3->generateInternalStateView());
 }
 
+void SCXTEditor::refreshDSPLoadView()
+{
+    auto &d = dspLoad;
+    auto s = fmt::format("DSP load {:.1f}% (peak {:.1f}%), {} of {} blocks over {:.0f}us\n",
+                         d.load * 100.f, d.peak * 100.f, d.overBudget, d.blocks, d.budgetUS);
+    if (d.draft)
+        s += "new voices in draft quality\n";
+    for (int b = 0; b < (int)d.histogram.size(); ++b)
+    {
+        if (b < 10)
+            s += fmt::format("{}%:{} ", b * 10, d.histogram[b]);
+        else
+            s += fmt::format("{}%:{} ", (b == 10) ? "100" : "150+", d.histogram[b]);
+    }
+    debugWindow->setLoadText(s);
+}
+
 void SCXTEditor::dumpStyles()
 {
     std::function<void(juce::Component *, const std::string &)> rdump;
@@ -308,6 +326,8 @@ void SCXTEditor::dumpStyles()
 
 void SCXTEditor::idle()
 {
+    audioProcessor.sc3->reclaim_retired();
+
     int mcount = 0;
     actiondata ad;
 
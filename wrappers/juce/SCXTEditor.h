@@ -122,6 +122,7 @@ class SCXTEditor : public juce::AudioProcessorEditor,
 
     // Fixme - obviously this is done with no thought of threading or anything else
     void refreshSamplerTextViewInThreadUnsafeWay();
+    void refreshDSPLoadView();
 
     void receiveActionFromProgram(const actiondata &ad) override;
     void sendActionToEngine(const actiondata &ad) override;
@@ -217,6 +218,14 @@ class SCXTEditor : public juce::AudioProcessorEditor,
     std::array<VUData, MAX_OUTPUTS> vuData;
     int polyphony{0};
 
+    struct DSPLoadData
+    {
+        float load{0}, peak{0}, budgetUS{0};
+        int overBudget{0}, blocks{0};
+        bool draft{false};
+        std::array<int, scxt::Perf::LoadMeter::histogramBuckets> histogram{};
+    } dspLoad;
+
     int selectedPart{0};
     int selectedLayer{0};
     int selectedZone{-1};
@@ -248,7 +257,7 @@ class SCXTEditor : public juce::AudioProcessorEditor,
     scxt::data::NameList partAuxOutputNames;
     scxt::data::NameList partMMSrc, partMMSrc2, partMMDst, partMMCurve, partNCSrc;
 
-    scxt::data::NameList zonePlaymode, zoneAuxOutput, zoneFilterType;
+    scxt::data::NameList zonePlaymode, zoneAuxOutput, zoneFilterType, zoneInterpolation;
     scxt::data::NameList zoneMMSrc, zoneMMSrc2, zoneMMDst, zoneMMCurve, zoneNCSrc, zoneLFOPresets;
 
     std::array<database_samplelist, MAX_SAMPLES> samplesCopy;
@@ -17,9 +17,13 @@
 
 #include "SCXTProcessor.h"
 #include "SCXTEditor.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <string>
 #include "sst/plugininfra/cpufeatures.h"
+#include "infrastructure/rt_guard.h"
 
 //==============================================================================
 SCXTProcessor::SCXTProcessor()
@@ -86,6 +90,8 @@ void SCXTProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
     // initialisation that you need..
     sc3->set_samplerate(sampleRate);
     sc3->AudioHalted = false;
+    setLatencySamples(BLOCK_SIZE);
+    numQueuedMidi = 0;
 }
 
 void SCXTProcessor::releaseResources()
@@ -117,6 +123,7 @@ bool SCXTProcessor::isBusesLayoutSupported(const BusesLayout &layouts) const
 void SCXTProcessor::processBlock(juce::AudioBuffer<float> &buffer, juce::MidiBuffer &midiMessages)
 {
     auto ftzGuard = sst::plugininfra::cpufeatures::FPUStateGuard();
+    scxt::Realtime::Scope rtScope;
 
     auto playhead = getPlayHead();
     if (playhead)
@@ -147,6 +154,7 @@ void SCXTProcessor::processBlock(juce::AudioBuffer<float> &buffer, juce::MidiBuf
         nextMidi = (*midiIt).samplePosition;
     }
 
+    float *busL[8], *busR[8];
     int activeBusCount = 0;
     for (int i = 0; i < 8; ++i)
     {
@@ -162,14 +170,51 @@ void SCXTProcessor::processBlock(juce::AudioBuffer<float> &buffer, juce::MidiBuf
         {
             break;
         }
+        busL[activeBusCount] = outL;
+        busR[activeBusCount] = outR;
         activeBusCount++;
     }
 
-    for (int i = 0; i < buffer.getNumSamples(); i++)
+    // when a whole engine block fits in the host buffer and the bus memory is suitably aligned
+    // the engine renders straight into it. otherwise it renders into its own output[] and we
+    // copy out, which is also what a block straddling two host buffers needs
+    auto renderDirect = [&](int pos) {
+        if (buffer.getNumSamples() - pos < (int)BLOCK_SIZE)
+            return false;
+        for (int bus = 0; bus < activeBusCount; bus++)
+            if (((uintptr_t)(busL[bus] + pos) & 0xf) || ((uintptr_t)(busR[bus] + pos) & 0xf))
+                return false;
+        return true;
+    };
+
+    bool direct = false;
+    int i = 0;
+    while (i < buffer.getNumSamples())
     {
+        if (blockPos == 0)
+        {
+            for (int q = 0; q < numQueuedMidi; q++)
+            {
+                auto &qm = queuedMidi[q];
+                applyMidi(juce::MidiMessage(qm.data, qm.size), qm.offset);
+            }
+            numQueuedMidi = 0;
+
+            direct = renderDirect(i);
+            for (int bus = 0; bus < activeBusCount; bus++)
+            {
+                if (direct)
+                    sc3->set_output_pointers(bus, busL[bus] + i, busR[bus] + i);
+                else
+                    sc3->set_output_pointers(bus, nullptr, nullptr);
+            }
+
+            sc3->process_audio();
+        }
+
         while (i == nextMidi)
         {
-            applyMidi(*midiIt);
+            queueMidi(*midiIt);
             midiIt++;
             if (midiIt == midiMessages.cend())
             {
@@ -181,47 +226,74 @@ void SCXTProcessor::processBlock(juce::AudioBuffer<float> &buffer, juce::MidiBuf
             }
         }
 
-        if (blockPos == 0)
-            sc3->process_audio();
+        // run to the end of the engine block, the host buffer or the next event
+        int n = std::min((int)(BLOCK_SIZE - blockPos), buffer.getNumSamples() - i);
+        if (nextMidi > i)
+            n = std::min(n, nextMidi - i);
 
-        for (int bus = 0; bus < activeBusCount; bus++)
+        if (!direct)
         {
-            auto iob = getBusBuffer(buffer, false, bus);
-
-            auto outL = iob.getWritePointer(0, i);
-            auto outR = iob.getWritePointer(1, i);
-
-            *outL = sc3->output[2 * bus][blockPos];
-            *outR = sc3->output[2 * bus + 1][blockPos];
+            for (int bus = 0; bus < activeBusCount; bus++)
+            {
+                juce::FloatVectorOperations::copy(busL[bus] + i, &sc3->output[2 * bus][blockPos],
+                                                  n);
+                juce::FloatVectorOperations::copy(busR[bus] + i,
+                                                  &sc3->output[2 * bus + 1][blockPos], n);
+            }
         }
 
-        blockPos++;
+        i += n;
+        blockPos += n;
 
         if (blockPos >= BLOCK_SIZE)
         {
             blockPos = 0;
-            sc3->time_data.ppqPos += (double)BLOCK_SIZE * sc3->time_data.tempo / (60. * samplerate);
+            sc3->time_data.ppqPos += (double)BLOCK_SIZE * sc3->time_data.tempo /
+                                     (60. * sc3->get_engine_context().samplerate);
         }
     }
 
+    // the bus pointers are only valid during this call
+    for (int bus = 0; bus < activeBusCount; bus++)
+        sc3->set_output_pointers(bus, nullptr, nullptr);
+
     // This should, in theory, never happen, but better safe than sorry
     while (midiIt != midiMessages.cend())
     {
-        applyMidi(*midiIt);
+        queueMidi(*midiIt);
         midiIt++;
     }
 }
 
-void SCXTProcessor::applyMidi(const juce::MidiMessageMetadata &msg)
+void SCXTProcessor::queueMidi(const juce::MidiMessageMetadata &msg)
+{
+    // only short messages are of interest to the engine
+    if (msg.numBytes > 3)
+        return;
+
+    if (numQueuedMidi >= maxQueuedMidi)
+    {
+        // should never happen with a sane amount of MIDI per block. apply it late rather than
+        // dropping it
+        applyMidi(msg.getMessage(), 0);
+        return;
+    }
+
+    auto &qm = queuedMidi[numQueuedMidi++];
+    memcpy(qm.data, msg.data, msg.numBytes);
+    qm.size = msg.numBytes;
+    qm.offset = (int)blockPos;
+}
+
+void SCXTProcessor::applyMidi(const juce::MidiMessage &m, int offset)
 {
-    auto m = msg.getMessage();
     if (m.isNoteOn())
     {
-        sc3->PlayNote(m.getChannel() - 1, m.getNoteNumber(), m.getVelocity());
+        sc3->PlayNote(m.getChannel() - 1, m.getNoteNumber(), m.getVelocity(), false, 0, offset);
     }
     else if (m.isNoteOff())
     {
-        sc3->ReleaseNote(m.getChannel() - 1, m.getNoteNumber(), m.getVelocity());
+        sc3->ReleaseNote(m.getChannel() - 1, m.getNoteNumber(), m.getVelocity(), offset);
     }
     else if (m.isPitchWheel())
     {
@@ -20,6 +20,7 @@
 #include "sampler.h"
 #include "juce_audio_processors/juce_audio_processors.h"
 #include "clap-juce-extensions/clap-juce-extensions.h"
+#include <array>
 
 //==============================================================================
 /**
@@ -58,7 +59,8 @@ class SCXTProcessor : public juce::AudioProcessor,
     bool isBusesLayoutSupported(const BusesLayout &layouts) const override;
 
     void processBlock(juce::AudioBuffer<float> &, juce::MidiBuffer &) override;
-    void applyMidi(const juce::MidiMessageMetadata &msg);
+    void queueMidi(const juce::MidiMessageMetadata &msg);
+    void applyMidi(const juce::MidiMessage &m, int offset);
 
     //==============================================================================
     juce::AudioProcessorEditor *createEditor() override;
@@ -87,6 +89,22 @@ class SCXTProcessor : public juce::AudioProcessor,
 
   private:
     size_t blockPos;
+
+    /*
+     * MIDI is applied sample accurately by running the engine one block behind the host. An
+     * event arriving at position blockPos of the engine block currently being played out is
+     * handed to the engine at the start of the next block, with offset blockPos. That makes
+     * the latency a constant BLOCK_SIZE samples, reported to the host.
+     */
+    struct QueuedMidi
+    {
+        uint8_t data[3];
+        int size;
+        int offset;
+    };
+    static constexpr int maxQueuedMidi = 1024;
+    std::array<QueuedMidi, maxQueuedMidi> queuedMidi;
+    int numQueuedMidi{0};
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SCXTProcessor)
 };
@@ -25,6 +25,12 @@ DebugPanel::DebugPanel() : Component("Debug Panel")
                      juce::dontSendNotification);
     addAndMakeVisible(*warning);
 
+    // dsp load and block time histogram
+    loadT = std::make_unique<juce::Label>();
+    loadT->setFont(juce::Font(11));
+    loadT->setJustificationType(juce::Justification::topLeft);
+    addAndMakeVisible(*loadT);
+
     // sampler state window
     samplerT = std::make_unique<juce::TextEditor>();
     samplerT->setMultiLine(true, false);
@@ -40,6 +46,9 @@ void DebugPanel::resized()
     auto r = getLocalBounds();
     r.reduce(5, 5);
 
+    loadT->setBounds(r.removeFromTop(32));
+    r.removeFromTop(5);
+
     auto h = r.getHeight() - 5; // 5 is space between
 
     // state occupies half rest of space
@@ -35,6 +35,7 @@ class DebugPanel : public juce::Component
     std::unique_ptr<juce::TextEditor> samplerT;
     std::unique_ptr<juce::TextEditor> logT;
     std::unique_ptr<juce::Label> warning;
+    std::unique_ptr<juce::Label> loadT;
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DebugPanel);
 };
 
@@ -46,6 +47,10 @@ class DebugPanelWindow : public juce::DocumentWindow
     DebugPanelWindow();
 
     void setSamplerText(const juce::String &s) { panel->samplerT->setText(s); }
+    void setLoadText(const juce::String &s)
+    {
+        panel->loadT->setText(s, juce::dontSendNotification);
+    }
 
     void setEditor(SCXTEditor *ed) { panel->mEditor = ed; }
 
@@ -103,6 +103,7 @@ struct ZoneData
     ParameterProxy<int> sample_id;
     ParameterProxy<int> mute_group;
     ParameterProxy<int> ignore_part_polymode;
+    ParameterProxy<int> interpolation;
     ParameterProxy<int> mute;
     ParameterProxy<int> reverse;
     ParameterProxy<float> lag_generator[2];
@@ -145,6 +146,7 @@ struct ConfigData
 {
     ParameterProxy<float> previewLevel;
     ParameterProxy<int> autoPreview;
+    ParameterProxy<int> interpolation, draftOnOverload, buildMips, resampleOnLoad;
 
     ParameterProxy<int> controllerId[n_custom_controllers], controllerMode[n_custom_controllers];
 };
@@ -446,6 +446,8 @@ struct Sample : ContentBaseSSTJuceGui
         auto &cz = parentPage.editor->currentZone;
         playmode = bind<widgets::IntParamComboBox>(cz.playmode, parentPage.editor->zonePlaymode);
         reverse = bind<widgets::IntParamToggleButton>(cz.reverse, "reverse");
+        interpolation = bind<widgets::IntParamComboBox>(cz.interpolation,
+                                                        parentPage.editor->zoneInterpolation);
 
         transposeL = whiteLabel("transpose");
         transpose = bindIntSpinBox(cz.transpose);
@@ -460,12 +462,14 @@ struct Sample : ContentBaseSSTJuceGui
         auto q = b.withTrimmedTop(50).withWidth(150);
         reverse->setBounds(q.reduced(1));
 
-        r = r.translated(0, 22).withTrimmedLeft(100);
+        r = r.translated(0, 22);
+        interpolation->setBounds(r.withWidth(100).reduced(1));
+        r = r.withTrimmedLeft(100);
         transposeL->setBounds(r.withWidth(r.getWidth() / 2));
         transpose->setBounds(r.withTrimmedLeft(r.getWidth() / 2));
     }
 
-    std::unique_ptr<widgets::IntParamComboBox> playmode;
+    std::unique_ptr<widgets::IntParamComboBox> playmode, interpolation;
     std::unique_ptr<widgets::IntParamToggleButton> reverse;
     std::unique_ptr<widgets::IntParamSpinBox> transpose;
     std::unique_ptr<juce::Label> transposeL;
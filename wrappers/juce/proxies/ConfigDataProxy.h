@@ -37,6 +37,14 @@ struct ConfigDataProxy : public scxt::data::UIStateProxy
             return true;
         if (applyActionDataIf(ad, ip_config_autopreview, cd.autoPreview))
             return true;
+        if (applyActionDataIf(ad, ip_config_interpolation, cd.interpolation))
+            return true;
+        if (applyActionDataIf(ad, ip_config_draft, cd.draftOnOverload))
+            return true;
+        if (applyActionDataIf(ad, ip_config_mipmaps, cd.buildMips))
+            return true;
+        if (applyActionDataIf(ad, ip_config_resample, cd.resampleOnLoad))
+            return true;
 
         if (ad.id == ip_config_controller_id)
             if (data::applyToOneOrAll(ad, cd.controllerId))
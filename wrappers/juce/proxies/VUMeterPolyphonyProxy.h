@@ -59,6 +59,31 @@ struct VUMeterPolyphonyProxy : public scxt::data::UIStateProxy
             return true;
             break;
         }
+        case ip_dspload:
+        {
+            auto at = std::get<VAction>(ad.actiontype);
+            if (at != vga_dspload)
+                break;
+            auto &d = editor->dspLoad;
+            if (ad.subid == 0)
+            {
+                d.load = ad.data.f[0];
+                d.peak = ad.data.f[1];
+                d.overBudget = ad.data.i[2];
+                d.blocks = ad.data.i[3];
+                d.budgetUS = ad.data.f[4];
+                d.draft = ad.data.i[5] != 0;
+            }
+            else
+            {
+                // the histogram comes second, so the summary is already in
+                for (int i = 0; i < (int)d.histogram.size(); ++i)
+                    d.histogram[i] = ad.data.i[i];
+                editor->refreshDSPLoadView();
+            }
+            return true;
+            break;
+        }
         case ip_polyphony:
         {
             auto at = std::get<VAction>(ad.actiontype);
@@ -177,6 +177,11 @@ class ZoneDataProxy : public scxt::data::UIStateProxy
         case ip_ignore_part_polymode:
             res = applyActionData(ad, cz.ignore_part_polymode);
             break;
+        case ip_zone_interpolation:
+            res = collectStringEntries(ad, editor->zoneInterpolation);
+            if (!res)
+                res = applyActionData(ad, cz.interpolation);
+            break;
         case ip_lag:
             res = applyToOneOrAll(
                 ad, cz.lag_generator, [](auto &r) -> auto & { return r; });